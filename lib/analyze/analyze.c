@@ -0,0 +1,180 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file analyze.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Offline analyzer of ROP capture files
+
+   The capture files are decoded by mapirops_analyze_run() on a pool
+   of threads. This tool reports the merged statistics per RopId and
+   direction.
+ */
+
+#include "libmapirops.h"
+
+#include <popt.h>
+#include <time.h>
+
+static uint64_t analyze_now(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+   Upper bound of the bucket holding the given fraction of the sizes
+ */
+static uint32_t analyze_percentile(const struct mapirops_analyze_rop_stats *rs, double fraction)
+{
+	uint64_t	target = (uint64_t)(rs->count * fraction);
+	uint64_t	seen = 0;
+	uint32_t	i;
+
+	for (i = 0; i < MAPIROPS_ANALYZE_SIZE_BUCKETS; i++) {
+		seen += rs->sizes[i];
+		if (seen > target) {
+			break;
+		}
+	}
+
+	return 1U << MIN(i, MAPIROPS_ANALYZE_SIZE_BUCKETS - 1);
+}
+
+static void analyze_report(const struct mapirops_analyze_stats *total, uint32_t files,
+			   uint32_t workers, int timing, double elapsed)
+{
+	const struct mapirops_rop_dispatch	*dispatch;
+	const struct mapirops_analyze_rop_stats	*rs;
+	const char				*dirname[2] = { "request", "response" };
+	uint32_t				dir;
+	uint32_t				i;
+
+	printf("Files: %u  Records: %llu  Bytes: %llu  Threads: %u\n", files,
+	       (unsigned long long)total->records, (unsigned long long)total->bytes, workers);
+	printf("Decoded in %.3f s: %.1f MB/s\n", elapsed,
+	       elapsed > 0 ? (total->bytes / (1024.0 * 1024.0)) / elapsed : 0.0);
+	if (total->invalid) {
+		printf("Malformed ROP buffers: %llu\n", (unsigned long long)total->invalid);
+	}
+
+	printf("\n%-9s %-5s %-28s %10s %8s %7s %9s %6s %6s %8s\n", "Direction", "RopId", "Name",
+	       "Count", "Errors", "Error%", "Avg size", "p50", "p99", "Avg ns");
+	for (dir = 0; dir < 2; dir++) {
+		for (i = 0; i < 256; i++) {
+			rs = &total->rops[dir][i];
+			if (rs->count) {
+				dispatch = mapirops_rop_dispatch_get(i);
+				printf("%-9s 0x%.2X  %-28s %10llu %8llu %6.2f%% %9.1f %6u %6u %8.1f\n",
+				       dirname[dir], i, dispatch->name,
+				       (unsigned long long)rs->count, (unsigned long long)rs->errors,
+				       100.0 * rs->errors / rs->count,
+				       rs->count > rs->errors ? (double)rs->bytes / (rs->count - rs->errors) : 0.0,
+				       analyze_percentile(rs, 0.5), analyze_percentile(rs, 0.99),
+				       timing ? (double)rs->ns / rs->count : 0.0);
+			}
+			if (total->unknown[dir][i]) {
+				printf("%-9s 0x%.2X  %-28s %10llu\n", dirname[dir], i, "(no decoder)",
+				       (unsigned long long)total->unknown[dir][i]);
+			}
+		}
+	}
+}
+
+int main(int argc, const char *argv[])
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_analyze		*analyze;
+	struct mapirops_analyze_stats	*total;
+	poptContext			pc;
+	const char			*path;
+	uint64_t			start;
+	uint32_t			files = 0;
+	uint32_t			workers = 0;
+	uint32_t			flags = 0;
+	int				opt;
+	int				threads = 0;
+	int				client = 0;
+	int				notiming = 0;
+
+	struct poptOption	long_options[] = {
+		POPT_AUTOHELP
+		{"threads", 't', POPT_ARG_INT, &threads, 0, "Number of decoding threads, one per online CPU by default", "COUNT"},
+		{"client", 'c', POPT_ARG_NONE, &client, 0, "Captured on the client side: pulled buffers are responses", NULL},
+		{"no-timing", 'n', POPT_ARG_NONE, &notiming, 0, "Don't measure the decoding time of each ROP", NULL},
+		{ NULL, 0, 0, NULL, 0, NULL, NULL }
+	};
+
+	pc = poptGetContext("mapirops_analyze", argc, argv, long_options, 0);
+	poptSetOtherOptionHelp(pc, "[OPTION...] CAPTURE...");
+	while ((opt = poptGetNextOpt(pc)) != -1) {
+		if (opt < -1) {
+			fprintf(stderr, "%s: %s\n", poptBadOption(pc, POPT_BADOPTION_NOALIAS),
+				poptStrerror(opt));
+			poptFreeContext(pc);
+			return EXIT_FAILURE;
+		}
+	}
+
+	if (client) {
+		flags |= MAPIROPS_ANALYZE_CLIENT;
+	}
+	if (!notiming) {
+		flags |= MAPIROPS_ANALYZE_TIMING;
+	}
+
+	mem_ctx = talloc_named(NULL, 0, "mapirops_analyze");
+	analyze = mapirops_analyze_init(mem_ctx, flags);
+	total = talloc_zero(mem_ctx, struct mapirops_analyze_stats);
+	if (analyze == NULL || total == NULL) {
+		poptFreeContext(pc);
+		talloc_free(mem_ctx);
+		return EXIT_FAILURE;
+	}
+
+	while ((path = poptGetArg(pc)) != NULL) {
+		if (mapirops_analyze_add(analyze, path) != MAPIROPS_ERR_SUCCESS) {
+			fprintf(stderr, "%s: can't read capture\n", path);
+			poptFreeContext(pc);
+			talloc_free(mem_ctx);
+			return EXIT_FAILURE;
+		}
+		files++;
+	}
+	poptFreeContext(pc);
+	if (!files) {
+		fprintf(stderr, "mapirops_analyze: no capture file\n");
+		talloc_free(mem_ctx);
+		return EXIT_FAILURE;
+	}
+
+	start = analyze_now();
+	if (mapirops_analyze_run(analyze, threads > 0 ? threads : 0, total, &workers) != MAPIROPS_ERR_SUCCESS) {
+		talloc_free(mem_ctx);
+		return EXIT_FAILURE;
+	}
+
+	analyze_report(total, files, workers, !notiming, (analyze_now() - start) / 1e9);
+	talloc_free(mem_ctx);
+
+	return EXIT_SUCCESS;
+}
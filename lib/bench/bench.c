@@ -0,0 +1,664 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file bench.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Throughput benchmarks for libmapirops
+ */
+
+#include "libmapirops.h"
+
+#include <popt.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/** \cond */
+#define	BENCH_DEFAULT_ITERATIONS	2000
+/** \endcond */
+
+static double bench_now(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void bench_report(const char *name, uint64_t bytes, double elapsed)
+{
+	printf("  %-36s %10.1f MB/s\n", name, (bytes / (1024.0 * 1024.0)) / elapsed);
+}
+
+/**
+   \details Build a buffer of RopLogon mailbox responses as sent to
+   Outlook at logon time
+ */
+static struct mapibuf bench_payload_logon(TALLOC_CTX *mem_ctx)
+{
+	struct mapirops_push		*push;
+	struct RopLogon_response	response;
+	struct RopLogon_mailbox		*mailbox;
+	struct mapibuf			payload;
+	int				i;
+
+	push = mapirops_push_init(mem_ctx);
+
+	memset(&response, 0, sizeof (struct RopLogon_response));
+	response.RopId = RopLogon;
+	response.ReturnValue = MAPI_E_SUCCESS;
+	response.ResponseType.success.LogonFlags = LogonFlags_LogonPrivate;
+	mailbox = &response.ResponseType.success.LogonType.mailbox;
+	mapirops_GUID_from_string("c4f1ae21-0a3b-4a1e-9c2d-40c4b1f1a7e5", &mailbox->MailboxGuid);
+	mapirops_GUID_from_string("2f5d0a3c-8b1e-4e6a-a2c4-7d1c0e6f9b21", &mailbox->ReplGuid);
+	mailbox->ResponseFlags = ResponseFlags_Reserved|ResponseFlags_OwnerRight;
+	mailbox->ReplId = 0x1;
+	mailbox->LogonTime.Year = 2014;
+	mailbox->LogonTime.CurrentMonth = CurrentMonth_February;
+
+	for (i = 0; i < 64; i++) {
+		response.OutputHandleIndex = i;
+		mailbox->Root = 0x0100000000000001ULL + ((uint64_t)i << 48);
+		mailbox->Inbox = mailbox->Root + 0x0600000000000000ULL;
+		mailbox->Outbox = mailbox->Root + 0x0700000000000000ULL;
+		mailbox->IPMSubtree = mailbox->Root + 0x0200000000000000ULL;
+		mailbox->LogonTime.Seconds = i % 60;
+		mapirops_push_struct_RopLogon_response(push, &response);
+	}
+
+	payload.data = push->data.data;
+	payload.length = push->offset;
+	return payload;
+}
+
+/**
+   \details Build a buffer looking like a table of property rows
+   (tag, PT_UNICODE display name, PT_I8 folder id, PT_LONG count)
+ */
+static struct mapibuf bench_payload_properties(TALLOC_CTX *mem_ctx)
+{
+	struct mapirops_push	*push;
+	struct mapibuf		payload;
+	const char		*names[] = { "Inbox", "Outbox", "Sent Items", "Deleted Items",
+					     "Calendar", "Contacts", "Journal", "Notes" };
+	uint32_t		seed = 0x2a;
+	int			i;
+
+	push = mapirops_push_init(mem_ctx);
+
+	for (i = 0; i < 1024; i++) {
+		seed = seed * 1103515245 + 12345;
+		mapirops_push_uint32(push, 0x3001001F);
+		mapirops_push_utf16_string(push, 0, (char *)names[i % 8]);
+		mapirops_push_uint32(push, 0x67480014);
+		mapirops_push_uint64(push, 0x0100000000000001ULL + i);
+		mapirops_push_uint32(push, 0x36020003);
+		mapirops_push_uint32(push, seed >> 20);
+	}
+
+	payload.data = push->data.data;
+	payload.length = push->offset;
+	return payload;
+}
+
+/**
+   \details Build a PropertyRowSet as returned by RopQueryRows on a
+   hierarchy table (PT_UNICODE display name, PT_I8 folder id, PT_LONG
+   count)
+ */
+static struct mapibuf bench_payload_rows(TALLOC_CTX *mem_ctx, uint32_t rows)
+{
+	struct mapirops_push	*push;
+	struct mapibuf		payload;
+	const char		*names[] = { "Inbox", "Outbox", "Sent Items", "Deleted Items",
+					     "Calendar", "Contacts", "Journal", "Notes" };
+	uint32_t		i;
+
+	push = mapirops_push_init(mem_ctx);
+
+	for (i = 0; i < rows; i++) {
+		mapirops_push_uint8(push, PROPERTY_ROW_STANDARD);
+		mapirops_push_utf16_string(push, 0, (char *)names[i % 8]);
+		mapirops_push_uint64(push, 0x0100000000000001ULL + i);
+		mapirops_push_uint32(push, i % 1000);
+	}
+
+	payload.data = push->data.data;
+	payload.length = push->offset;
+	return payload;
+}
+
+/**
+   \details Build a FastTransfer stream of messages, each with a few
+   properties and an attachment
+ */
+static struct mapibuf bench_payload_fx(TALLOC_CTX *mem_ctx, uint32_t messages)
+{
+	struct mapirops_push	*push;
+	struct mapibuf		payload;
+	uint8_t			attachment[16384];
+	uint32_t		i;
+
+	push = mapirops_push_init(mem_ctx);
+	memset(attachment, 0x42, sizeof (attachment));
+
+	for (i = 0; i < messages; i++) {
+		mapirops_push_uint32(push, StartMessage);
+		mapirops_push_uint32(push, 0x0E070003);
+		mapirops_push_uint32(push, 0x1);
+		mapirops_push_uint32(push, 0x30070040);
+		mapirops_push_uint64(push, 0x01CF000000000000ULL + i);
+		mapirops_push_uint32(push, 0x0037001F);
+		mapirops_push_uint32(push, 24);
+		mapirops_push_bytes(push, (const uint8_t *) "M\0e\0e\0t\0i\0n\0g\0 \0n\0o\0w\0\0\0", 24);
+		mapirops_push_uint32(push, NewAttach);
+		mapirops_push_uint32(push, 0x0E210003);
+		mapirops_push_uint32(push, 0);
+		mapirops_push_uint32(push, 0x37010102);
+		mapirops_push_uint32(push, sizeof (attachment));
+		mapirops_push_bytes(push, attachment, sizeof (attachment));
+		mapirops_push_uint32(push, EndAttach);
+		mapirops_push_uint32(push, EndMessage);
+	}
+
+	payload.data = push->data.data;
+	payload.length = push->offset;
+	return payload;
+}
+
+static void bench_lzxpress_payload(TALLOC_CTX *mem_ctx, const char *name,
+				   struct mapibuf payload, int iterations)
+{
+	struct mapibuf	compressed;
+	struct mapibuf	dst;
+	uint8_t		*buffer;
+	uint8_t		*output;
+	size_t		buffer_size;
+	double		start;
+	char		label[64];
+	int		i;
+
+	buffer_size = payload.length + payload.length / 8 + 8;
+	buffer = talloc_array(mem_ctx, uint8_t, buffer_size);
+	output = talloc_array(mem_ctx, uint8_t, payload.length);
+
+	compressed.data = buffer;
+	compressed.length = buffer_size;
+	if (mapirops_lzxpress_compress(&payload, &compressed) != MAPIROPS_ERR_SUCCESS) {
+		fprintf(stderr, "%s: compression failed\n", name);
+		return;
+	}
+	printf("  %s: %zu bytes -> %zu bytes (%.1f%%)\n", name, payload.length,
+	       compressed.length, 100.0 * compressed.length / payload.length);
+
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		dst.data = buffer;
+		dst.length = buffer_size;
+		mapirops_lzxpress_compress(&payload, &dst);
+	}
+	snprintf(label, sizeof (label), "%s compress", name);
+	bench_report(label, (uint64_t)payload.length * iterations, bench_now() - start);
+
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		dst.data = output;
+		dst.length = payload.length;
+		mapirops_lzxpress_decompress(&compressed, &dst);
+	}
+	snprintf(label, sizeof (label), "%s decompress", name);
+	bench_report(label, (uint64_t)payload.length * iterations, bench_now() - start);
+
+	if (dst.length != payload.length || memcmp(output, payload.data, payload.length)) {
+		fprintf(stderr, "%s: round trip mismatch\n", name);
+	}
+}
+
+static void bench_lzxpress(TALLOC_CTX *mem_ctx, int iterations)
+{
+	printf("LZ77+DIRECT2 ([MS-XCA]):\n");
+	bench_lzxpress_payload(mem_ctx, "RopLogon", bench_payload_logon(mem_ctx), iterations);
+	bench_lzxpress_payload(mem_ctx, "properties", bench_payload_properties(mem_ctx), iterations);
+}
+
+static void bench_property(TALLOC_CTX *mem_ctx, int iterations)
+{
+	TALLOC_CTX		*values_ctx;
+	struct mapirops_push	*push;
+	struct mapirops_pull	*pull;
+	struct mapibuf		payload;
+	TaggedPropertyValue	tagged;
+	PropertyValue		value;
+	uint32_t		longs[4096];
+	double			start;
+	int			i;
+
+	printf("PropertyValue ([MS-OXCDATA]):\n");
+
+	pull = mapirops_pull_init(mem_ctx);
+	payload = bench_payload_properties(mem_ctx);
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		values_ctx = talloc_new(mem_ctx);
+		pull->data = payload;
+		pull->offset = 0;
+		while (pull->offset < payload.length) {
+			if (mapirops_pull_TaggedPropertyValue(pull, values_ctx, &tagged) != MAPIROPS_ERR_SUCCESS) {
+				fprintf(stderr, "TaggedPropertyValue: pull failed at offset %u\n", pull->offset);
+				talloc_free(values_ctx);
+				return;
+			}
+		}
+		talloc_free(values_ctx);
+	}
+	bench_report("TaggedPropertyValue pull", (uint64_t)payload.length * iterations, bench_now() - start);
+
+	for (i = 0; i < 4096; i++) {
+		longs[i] = i;
+	}
+	value.MVl.cValues = 4096;
+	value.MVl.lpl = longs;
+	push = mapirops_push_init(mem_ctx);
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		push->offset = 0;
+		mapirops_push_PropertyValue(push, PT_MV_LONG, &value);
+	}
+	bench_report("PT_MV_LONG push", (uint64_t)push->offset * iterations, bench_now() - start);
+
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		pull->data.data = push->data.data;
+		pull->data.length = push->offset;
+		pull->offset = 0;
+		mapirops_pull_PropertyValue(pull, mem_ctx, PT_MV_LONG, &value);
+		talloc_free(value.MVl.lpl);
+	}
+	bench_report("PT_MV_LONG pull", (uint64_t)push->offset * iterations, bench_now() - start);
+}
+
+static void bench_rowset(TALLOC_CTX *mem_ctx, int iterations)
+{
+	TALLOC_CTX		*rows_ctx;
+	struct mapirops_pull	*pull;
+	struct mapirops_rowset	*rowset;
+	struct mapibuf		payload;
+	PropertyValue		*values;
+	const uint32_t		tags[] = { 0x3001001F, 0x67480014, 0x36020003 };
+	const uint32_t		rows = 4096;
+	uint8_t			flag;
+	uint32_t		row;
+	uint32_t		j;
+	double			start;
+	int			i;
+
+	printf("PropertyRowSet ([MS-OXCDATA]), %u rows:\n", rows);
+
+	pull = mapirops_pull_init(mem_ctx);
+	payload = bench_payload_rows(mem_ctx, rows);
+	iterations = iterations / 10 + 1;
+
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		rows_ctx = talloc_new(mem_ctx);
+		values = talloc_array(rows_ctx, PropertyValue, rows * 3);
+		pull->data = payload;
+		pull->offset = 0;
+		for (row = 0; row < rows; row++) {
+			mapirops_pull_uint8(pull, &flag);
+			for (j = 0; j < 3; j++) {
+				mapirops_pull_PropertyValue(pull, rows_ctx, PROP_TYPE(tags[j]), &values[row * 3 + j]);
+			}
+		}
+		talloc_free(rows_ctx);
+	}
+	bench_report("by row", (uint64_t)payload.length * iterations, bench_now() - start);
+
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		pull->data = payload;
+		pull->offset = 0;
+		if (mapirops_pull_PropertyRowSet_columns(pull, mem_ctx, tags, 3, rows, &rowset) != MAPIROPS_ERR_SUCCESS) {
+			fprintf(stderr, "PropertyRowSet: pull failed at offset %u\n", pull->offset);
+			return;
+		}
+		talloc_free(rowset);
+	}
+	bench_report("by column", (uint64_t)payload.length * iterations, bench_now() - start);
+}
+
+static enum mapirops_err_code bench_fx_marker(void *private_data, uint32_t marker)
+{
+	(*(uint64_t *) private_data)++;
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static enum mapirops_err_code bench_fx_property(void *private_data, const struct mapirops_fx_property *prop)
+{
+	(*(uint64_t *) private_data)++;
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static void bench_fxparser(TALLOC_CTX *mem_ctx, int iterations)
+{
+	struct mapirops_fxparser	*fx;
+	struct mapirops_fx_callbacks	callbacks;
+	struct mapibuf			payload;
+	const uint32_t			chunk = 32000;
+	uint64_t			events = 0;
+	size_t				offset;
+	double				start;
+	int				i;
+
+	printf("FastTransfer stream ([MS-OXCFXICS]), %u bytes buffers:\n", chunk);
+
+	memset(&callbacks, 0, sizeof (callbacks));
+	callbacks.marker = bench_fx_marker;
+	callbacks.property = bench_fx_property;
+	payload = bench_payload_fx(mem_ctx, 256);
+	iterations = iterations / 10 + 1;
+
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		fx = mapirops_fxparser_init(mem_ctx, &callbacks, &events);
+		for (offset = 0; offset < payload.length; offset += chunk) {
+			if (mapirops_fxparser_parse(fx, payload.data + offset,
+						    MIN(chunk, payload.length - offset)) != MAPIROPS_ERR_SUCCESS) {
+				fprintf(stderr, "FastTransfer: parse failed\n");
+				return;
+			}
+		}
+		mapirops_fxparser_end(fx);
+		talloc_free(fx);
+	}
+	bench_report("parse", (uint64_t)payload.length * iterations, bench_now() - start);
+}
+
+static enum mapirops_err_code bench_fx_message(void *private_data, uint32_t index, struct mapirops_push *push)
+{
+	TaggedPropertyValue	value;
+	uint32_t		i;
+
+	MAPIROPS_CHECK(mapirops_push_uint32(push, StartMessage));
+	for (i = 0; i < 64; i++) {
+		value.PropertyTag = ((0x3001 + i) << 16) | PT_UNICODE;
+		value.Value.lpszW = "Quarterly report for the sales department";
+		MAPIROPS_CHECK(mapirops_push_TaggedPropertyValue(push, &value));
+	}
+	MAPIROPS_CHECK(mapirops_push_uint32(push, EndMessage));
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static void bench_fxproducer(TALLOC_CTX *mem_ctx, int iterations)
+{
+	struct mapirops_fxproducer	*fx;
+	struct mapirops_push		*push;
+	const uint32_t			threads[] = { 1, 0 };
+	char				label[64];
+	uint64_t			bytes;
+	uint32_t			length;
+	uint8_t				last;
+	double				start;
+	int				i;
+	int				t;
+
+	printf("FastTransfer producer ([MS-OXCFXICS]), 2048 messages:\n");
+
+	push = mapirops_push_init(mem_ctx);
+	iterations = iterations / 100 + 1;
+
+	for (t = 0; t < 2; t++) {
+		bytes = 0;
+		start = bench_now();
+		for (i = 0; i < iterations; i++) {
+			fx = mapirops_fxproducer_init(mem_ctx, 2048, threads[t], 0, bench_fx_message, NULL);
+			do {
+				push->offset = 0;
+				if (mapirops_fxproducer_get_buffer(fx, push, 32000, &length, &last) != MAPIROPS_ERR_SUCCESS) {
+					fprintf(stderr, "FastTransfer: producer failed\n");
+					return;
+				}
+				bytes += length;
+			} while (!last);
+			talloc_free(fx);
+		}
+		snprintf(label, sizeof (label), threads[t] ? "%u thread" : "all CPUs", threads[t]);
+		bench_report(label, bytes, bench_now() - start);
+	}
+}
+
+/**
+   \details Previous sscanf based GUID parser, kept as a baseline
+ */
+static enum mapirops_err_code bench_guid_sscanf(const char *s, GUID *guid)
+{
+	TALLOC_CTX	*mem_ctx;
+	char		*string;
+	unsigned int	d2, d3, d4[8];
+	int		n;
+	int		i;
+
+	mem_ctx = talloc_new(NULL);
+	string = talloc_strdup(mem_ctx, s);
+	n = sscanf(string, "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+		   &guid->Data1, &d2, &d3, &d4[0], &d4[1], &d4[2], &d4[3],
+		   &d4[4], &d4[5], &d4[6], &d4[7]);
+	talloc_free(mem_ctx);
+	if (n != 11) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+	guid->Data2 = d2;
+	guid->Data3 = d3;
+	for (i = 0; i < 8; i++) {
+		guid->Data4[i] = d4[i];
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static void bench_guid(TALLOC_CTX *mem_ctx, int iterations)
+{
+	GUID		*guids;
+	char		*strings;
+	const char	**list;
+	char		*string;
+	const uint32_t	count = 1024;
+	uint32_t	j;
+	double		start;
+	int		i;
+
+	printf("GUID strings, %u GUIDs:\n", count);
+
+	guids = talloc_array(mem_ctx, GUID, count);
+	strings = talloc_array(mem_ctx, char, count * MAPIROPS_GUID_STRING_SIZE);
+	list = talloc_array(mem_ctx, const char *, count);
+	for (j = 0; j < count; j++) {
+		guids[j].Data1 = 0x9e8d7c6b * j;
+		guids[j].Data2 = j;
+		guids[j].Data3 = 0x4000 | (j & 0xfff);
+		memset(guids[j].Data4, j, 8);
+		list[j] = strings + j * MAPIROPS_GUID_STRING_SIZE;
+	}
+	mapirops_GUID_format_array(guids, count, strings);
+	iterations = iterations / 10 + 1;
+
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < count; j++) {
+			bench_guid_sscanf(list[j], &guids[j]);
+		}
+	}
+	bench_report("parse (sscanf)", (uint64_t)count * 36 * iterations, bench_now() - start);
+
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		mapirops_GUID_parse_array(list, count, guids);
+	}
+	bench_report("parse", (uint64_t)count * 36 * iterations, bench_now() - start);
+
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		for (j = 0; j < count; j++) {
+			string = talloc_asprintf(mem_ctx, "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
+						 guids[j].Data1, guids[j].Data2, guids[j].Data3,
+						 guids[j].Data4[0], guids[j].Data4[1],
+						 guids[j].Data4[2], guids[j].Data4[3],
+						 guids[j].Data4[4], guids[j].Data4[5],
+						 guids[j].Data4[6], guids[j].Data4[7]);
+			talloc_free(string);
+		}
+	}
+	bench_report("format (talloc_asprintf)", (uint64_t)count * 36 * iterations, bench_now() - start);
+
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		mapirops_GUID_format_array(guids, count, strings);
+	}
+	bench_report("format", (uint64_t)count * 36 * iterations, bench_now() - start);
+}
+
+/**
+   \details Previous printf based hexdump, kept as a baseline
+ */
+static void bench_hexdump_printf(FILE *f, const uint8_t *buf, int len)
+{
+	int	i;
+	int	j;
+	int	n;
+
+	for (i = 0; i < len;) {
+		if (i % 16 == 0) {
+			fprintf(f, "[%04X] ", i);
+		}
+		fprintf(f, "%02X ", (int)buf[i]);
+		i++;
+		if (i % 8 == 0) fprintf(f, "  ");
+		if (i % 16 == 0) {
+			for (j = i - 16; j < i - 8; j++) fprintf(f, "%c", isprint(buf[j]) ? buf[j] : '.');
+			fprintf(f, " ");
+			for (j = i - 8; j < i; j++) fprintf(f, "%c", isprint(buf[j]) ? buf[j] : '.');
+			fprintf(f, "\n");
+		}
+	}
+	if (i % 16) {
+		n = 16 - (i % 16);
+		fprintf(f, " ");
+		if (n > 8) fprintf(f, " ");
+		while (n--) fprintf(f, "   ");
+		for (j = i - (i % 16); j < i; j++) {
+			if (j == i - (i % 16) + 8) fprintf(f, " ");
+			fprintf(f, "%c", isprint(buf[j]) ? buf[j] : '.');
+		}
+		if (i % 16 <= 8) fprintf(f, " ");
+		fprintf(f, "\n");
+	}
+}
+
+static void bench_hexdump(TALLOC_CTX *mem_ctx, int iterations)
+{
+	struct mapibuf	payload;
+	char		*out;
+	size_t		size;
+	FILE		*f;
+	int		fd;
+	double		start;
+	int		i;
+
+	payload = bench_payload_logon(mem_ctx);
+	printf("Hexdump, %zu bytes:\n", payload.length);
+
+	f = fopen("/dev/null", "w");
+	fd = open("/dev/null", O_WRONLY);
+	if (f == NULL || fd < 0) {
+		if (f) fclose(f);
+		if (fd >= 0) close(fd);
+		return;
+	}
+	size = mapirops_hexdump_size(payload.length, NULL, 0);
+	out = talloc_array(mem_ctx, char, size);
+	iterations = iterations / 10 + 1;
+
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		bench_hexdump_printf(f, payload.data, payload.length);
+	}
+	fflush(f);
+	bench_report("stdio (printf per byte)", (uint64_t)payload.length * iterations, bench_now() - start);
+
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		mapirops_hexdump_buf(payload.data, payload.length, NULL, 0, out, size, NULL);
+	}
+	bench_report("buffer", (uint64_t)payload.length * iterations, bench_now() - start);
+
+	start = bench_now();
+	for (i = 0; i < iterations; i++) {
+		mapirops_hexdump_fd(fd, payload.data, payload.length, NULL, 0);
+	}
+	bench_report("file descriptor", (uint64_t)payload.length * iterations, bench_now() - start);
+
+	close(fd);
+	fclose(f);
+}
+
+int main(int argc, const char *argv[])
+{
+	TALLOC_CTX	*mem_ctx;
+	poptContext	pc;
+	int		opt;
+	int		iterations = BENCH_DEFAULT_ITERATIONS;
+
+	struct poptOption	long_options[] = {
+		POPT_AUTOHELP
+		{"iterations", 'i', POPT_ARG_INT, &iterations, 0, "Number of iterations for each benchmark", "COUNT"},
+		{ NULL, 0, 0, NULL, 0, NULL, NULL }
+	};
+
+	pc = poptGetContext("mapirops_bench", argc, argv, long_options, 0);
+	while ((opt = poptGetNextOpt(pc)) != -1) {
+		if (opt < -1) {
+			fprintf(stderr, "%s: %s\n", poptBadOption(pc, POPT_BADOPTION_NOALIAS),
+				poptStrerror(opt));
+			poptFreeContext(pc);
+			return EXIT_FAILURE;
+		}
+	}
+	poptFreeContext(pc);
+
+	if (iterations <= 0) {
+		iterations = BENCH_DEFAULT_ITERATIONS;
+	}
+
+	mem_ctx = talloc_named(NULL, 0, "mapirops_bench");
+
+	bench_lzxpress(mem_ctx, iterations);
+	bench_property(mem_ctx, iterations);
+	bench_rowset(mem_ctx, iterations);
+	bench_fxparser(mem_ctx, iterations);
+	bench_fxproducer(mem_ctx, iterations);
+	bench_guid(mem_ctx, iterations);
+	bench_hexdump(mem_ctx, iterations);
+
+	talloc_free(mem_ctx);
+
+	return EXIT_SUCCESS;
+}
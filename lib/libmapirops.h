@@ -41,10 +41,16 @@
 #include <talloc.h>
 
 #include <mapirops_uuid.h>
+#include <mapirops_property.h>
+#include <mapirops_restriction.h>
 #include <mapistatus.h>
 struct mapirops_push;
 struct mapirops_pull;
+struct mapirops_template;
+struct mapirops_rop_table;
 #include <oxcstor.h>
+#include <oxcrpc.h>
+#include <oxcprpt.h>
 
 /**
    \enum RopId
@@ -219,7 +225,7 @@ struct mapibuf {
  */
 enum mapirops_err_code {
 	MAPIROPS_ERR_SUCCESS = 0,	/*!< Success error code */
-	MAPIROPS_ERR_BUFFER_TOO_SMALL,	/*!< Buffer is too small */
+	MAPIROPS_ERR_BUFFER_TOO_SMALL,	/*!< Buffer is too small or push limit reached */
 	MAPIROPS_ERR_BUFSIZE,		/*!< Invalid buffer size */
 	MAPIROPS_ERR_NO_MEMORY,		/*!< No more memory left */
 	MAPIROPS_ERR_ALLOC,		/*!< Memory allocation error */
@@ -227,12 +233,34 @@ enum mapirops_err_code {
 	MAPIROPS_ERR_INVALID_FLAGS,	/*!< Invalid flag or combination of flags */
 	MAPIROPS_ERR_INVALID_VAL,	/*!< Invalid value */
 	MAPIROPS_ERR_INVALID_EC,	/*!< Invalid MAPI error code supplied for the call */
-	MAPIROPS_GENERIC_ERR		/*!< Generic error code */
+	MAPIROPS_GENERIC_ERR,		/*!< Generic error code */
+	MAPIROPS_ERR_NOT_FOUND		/*!< Requested entry was not found */
 };
 
 #define	MAPIROPS_STR_NOSIZE	(1<<0)	/*!< No prefixing size was retrieved from the wire. */
 #define	MAPIROPS_STR_NOTERM	(1<<1)	/*!< The string has no termination char */
 
+/** \def MAPIROPS_CODEPAGE_UTF8
+    Codepage identifier of UTF-8
+*/
+#define	MAPIROPS_CODEPAGE_UTF8		65001
+
+/** \def MAPIROPS_CODEPAGE_UTF8_SIZE
+    Size of the buffer holding the UTF-8 conversion of an 8-bit string
+    of len bytes, null character included
+*/
+#define	MAPIROPS_CODEPAGE_UTF8_SIZE(len)	((len) * 3 + 1)
+
+/** \def MAPIROPS_CODEPAGE_STRING8_SIZE
+    Size of the buffer holding the 8-bit conversion of a UTF-8 string
+    of len bytes, shift sequences of stateful codepages included
+*/
+#define	MAPIROPS_CODEPAGE_STRING8_SIZE(len)	((len) * 4 + 8)
+
+struct mapirops_codepage;
+struct mapirops_timing;
+struct mapirops_stats;
+
 /**
    \struct mapirops_pull
    \brief Structure passed to routines that unpack MAPI rops
@@ -242,6 +270,13 @@ struct mapirops_pull {
 	uint32_t	offset;		/*!< Current MAPI buffer offset */
 	TALLOC_CTX	*mem_ctx;	/*!< Pointer to the memory context */
 	iconv_t		utf16to8;	/*!< Pointer to utf16 to utf8 iconv descriptor */
+	const struct mapirops_codepage	*codepage;	/*!< Codepage of 8-bit strings, NULL for ASCII */
+	struct mapirops_capture		*capture;	/*!< Recorder of the ROP buffers, NULL if not recording */
+	uint32_t			session;	/*!< Session identifier of the recorded ROP buffers */
+	struct mapirops_timing		*timing;	/*!< Latency histograms of the ROP codecs, NULL if not timing */
+	struct mapirops_stats		*stats;		/*!< Published statistics, NULL if not publishing */
+	enum mapirops_err_code		error;		/*!< First error of a sticky-error pull function */
+	uint8_t				is_cursor;	/*!< Set by mapirops_pull_cursor_init: strings need a memory context */
 };
 
 /**
@@ -251,10 +286,483 @@ struct mapirops_pull {
 struct mapirops_push {
 	struct mapibuf	data;		/*!< MAPI buffer where data are pushed */
 	uint32_t	offset;		/*!< MAPI buffer offset */
+	uint32_t	limit;		/*!< Maximum size of the MAPI buffer, 0 for no limit */
 	iconv_t		utf8to16;	/*!< Pointer to utf8 to utf16 iconv descriptor */
-	iconv_t		utf8toascii;	/*!< Pointer to utf8 to ascii iconv descriptor */
+	iconv_t		utf8toascii;	/*!< Unused: 8-bit strings are converted with codepage */
+	const struct mapirops_codepage	*codepage;	/*!< Codepage of 8-bit strings, NULL for ASCII */
+	struct mapirops_capture		*capture;	/*!< Recorder of the ROP buffers, NULL if not recording */
+	uint32_t			session;	/*!< Session identifier of the recorded ROP buffers */
+	struct mapirops_timing		*timing;	/*!< Latency histograms of the ROP codecs, NULL if not timing */
+	struct mapirops_stats		*stats;		/*!< Published statistics, NULL if not publishing */
+	uint32_t			capacity;	/*!< Size of the caller-provided buffer, 0 if the buffer is grown as needed */
+};
+
+/**
+   \struct mapirops_template_slot
+   \brief Location of a field within a structure byte template
+ */
+struct mapirops_template_slot {
+	const char	*name;		/*!< Name of the structure field */
+	uint32_t	offset;		/*!< Offset of the field from the start of the template */
+	uint32_t	size;		/*!< Size in bytes of the field */
+};
+
+/**
+   \struct mapirops_template
+   \brief Pre-serialized fixed-size prefix of a generated structure
+
+   Constant fields are already encoded in data. Push copies data and
+   fills the variable slots in place, pull compares the constant runs
+   and reads the variable slots in place.
+ */
+struct mapirops_template {
+	const char				*name;		/*!< Name of the structure */
+	const uint8_t				*data;		/*!< Template bytes with constant fields in place */
+	uint32_t				size;		/*!< Size in bytes of the template */
+	const struct mapirops_template_slot	*slots;		/*!< Variable fields */
+	uint32_t				slot_count;	/*!< Number of variable fields */
+	const struct mapirops_template_slot	*consts;	/*!< Runs of adjacent constant fields */
+	uint32_t				const_count;	/*!< Number of constant runs */
+};
+
+/**
+   \details Pull a ROP request or response into the generated structure
+   pointed by r
+ */
+typedef enum mapirops_err_code (*mapirops_rop_pull_fn)(struct mapirops_pull *mr, void *r);
+
+/**
+   \struct mapirops_rop_dispatch
+   \brief Generated decoders of a ROP
+ */
+struct mapirops_rop_dispatch {
+	uint8_t			RopId;		/*!< ROP identifier */
+	const char		*name;		/*!< Name of the ROP */
+	size_t			request_size;	/*!< Size of the request structure */
+	mapirops_rop_pull_fn	pull_request;	/*!< Pull function of the request */
+	size_t			response_size;	/*!< Size of the response structure */
+	mapirops_rop_pull_fn	pull_response;	/*!< Pull function of the response */
+};
+
+/**
+   \struct mapirops_rop_table
+   \brief ROPs generated from a specification
+ */
+struct mapirops_rop_table {
+	const struct mapirops_rop_dispatch	*rops;		/*!< Decoders of the ROPs */
+	uint32_t				count;		/*!< Number of ROPs */
+};
+
+/** \def MAPIROPS_RPCEXT_HEADER_SIZE
+    Size in bytes of a RPC_HEADER_EXT
+*/
+#define	MAPIROPS_RPCEXT_HEADER_SIZE	8
+
+/** \def MAPIROPS_RPCEXT_MAX_PAYLOAD
+    Maximum size in bytes of the payload of an extended buffer
+*/
+#define	MAPIROPS_RPCEXT_MAX_PAYLOAD	0x8000
+
+/**
+   \struct mapirops_rpcext_iter
+   \brief Iterator over chained RPC_HEADER_EXT extended buffers
+ */
+struct mapirops_rpcext_iter {
+	struct mapibuf	data;		/*!< Chained extended buffers */
+	uint32_t	offset;		/*!< Offset of the next RPC_HEADER_EXT */
+	uint16_t	flags;		/*!< Flags of the current extended buffer */
+	TALLOC_CTX	*mem_ctx;	/*!< Memory context of the decompression buffer */
+	struct mapibuf	inflate;	/*!< Decompression buffer reused across extended buffers */
+};
+
+/**
+   \struct mapirops_rpcext_frame
+   \brief Extended buffer being pushed
+ */
+struct mapirops_rpcext_frame {
+	uint32_t	header;		/*!< Offset of the RPC_HEADER_EXT in the push buffer */
+	uint32_t	limit;		/*!< Push limit restored once the frame is closed */
+};
+
+/**
+   \enum FastTransferMarker
+   \brief Markers of a FastTransfer stream ([MS-OXCFXICS] section
+   2.2.4.1.4)
+ */
+enum FastTransferMarker {
+	NewAttach		= 0x40000003,
+	StartEmbed		= 0x40010003,
+	EndEmbed		= 0x40020003,
+	StartRecip		= 0x40030003,
+	EndToRecip		= 0x40040003,
+	StartTopFld		= 0x40090003,
+	StartSubFld		= 0x400A0003,
+	EndFolder		= 0x400B0003,
+	StartMessage		= 0x400C0003,
+	EndMessage		= 0x400D0003,
+	EndAttach		= 0x400E0003,
+	StartFAIMsg		= 0x40100003,
+	IncrSyncChg		= 0x40120003,
+	IncrSyncDel		= 0x40130003,
+	IncrSyncEnd		= 0x40140003,
+	IncrSyncMessage		= 0x40150003,
+	FXErrorInfo		= 0x40180003,
+	IncrSyncRead		= 0x402F0003,
+	IncrSyncStateBegin	= 0x403A0003,
+	IncrSyncStateEnd	= 0x403B0003,
+	IncrSyncProgressMode	= 0x4074000B,
+	IncrSyncProgressPerMsg	= 0x4075000B,
+	IncrSyncGroupInfo	= 0x407B0102,
+	IncrSyncChgPartial	= 0x407D0003
+};
+
+/** \def MAPIROPS_FX_NAME_MAX
+    Maximum size in bytes of the name of a named property in a
+    FastTransfer stream, null character included
+*/
+#define	MAPIROPS_FX_NAME_MAX	1024
+
+/**
+   \struct mapirops_fx_property
+   \brief Property value being parsed from a FastTransfer stream
+
+   Multiple-valued properties are reported one value at a time, index
+   going from 0 to count - 1. Fixed-size values are returned whole in
+   value. Variable-size values only have their length set: their bytes
+   are handed to the data callback as they arrive.
+ */
+struct mapirops_fx_property {
+	uint32_t	PropertyTag;	/*!< Property tag as found in the stream */
+	uint8_t		named;		/*!< Whether the property is a named property */
+	GUID		guid;		/*!< Property set of a named property */
+	uint8_t		Kind;		/*!< 0x00 if the named property has a LID, 0x01 if it has a name */
+	uint32_t	lid;		/*!< LID of a named property */
+	const uint8_t	*name;		/*!< UTF-16LE name of a named property, null character excluded */
+	uint32_t	name_length;	/*!< Size in bytes of name */
+	uint32_t	count;		/*!< Number of values, 1 for single-valued properties */
+	uint32_t	index;		/*!< Index of the current value */
+	const uint8_t	*value;		/*!< Fixed-size value in wire format, NULL for variable-size values */
+	uint32_t	length;		/*!< Size in bytes of the current value */
+};
+
+/**
+   \struct mapirops_fx_callbacks
+   \brief Events raised by the FastTransfer stream parser
+
+   Any callback can be NULL. A callback returning an error stops the
+   parser and the error is returned to the caller.
+ */
+struct mapirops_fx_callbacks {
+	/** Called for every marker */
+	enum mapirops_err_code	(*marker)(void *private_data, uint32_t marker);
+	/** Called for every value of a property, before its data if any */
+	enum mapirops_err_code	(*property)(void *private_data, const struct mapirops_fx_property *prop);
+	/** Called with consecutive fragments of a variable-size value,
+	    offset being the position of data within the value */
+	enum mapirops_err_code	(*data)(void *private_data, const struct mapirops_fx_property *prop,
+					const uint8_t *data, uint32_t length, uint32_t offset);
+};
+
+struct mapirops_fxparser;
+
+/** \def MAPIROPS_FXPRODUCER_WINDOW
+    Default number of segments serialized ahead of the consumer
+*/
+#define	MAPIROPS_FXPRODUCER_WINDOW	64
+
+/**
+   \details Serialize the FastTransfer segment of one item (a message
+   for example) at the end of push. Called concurrently from the
+   producer worker threads, each call with its own push.
+ */
+typedef enum mapirops_err_code (*mapirops_fx_serialize_fn)(void *private_data, uint32_t index,
+							    struct mapirops_push *push);
+
+struct mapirops_fxproducer;
+
+/**
+   \struct mapirops_ropbuf
+   \brief ROP input or output buffer split into its parts ([MS-OXCROPS]
+   section 2.2.1)
+ */
+struct mapirops_ropbuf {
+	struct mapibuf	rops;		/*!< RopsList */
+	struct mapibuf	handles;	/*!< ServerObjectHandleTable, 4 bytes per handle */
+	uint32_t	handle_count;	/*!< Number of handles in handles */
+};
+
+/**
+   \struct mapirops_ropbuf_frame
+   \brief ROP buffer being pushed
+ */
+struct mapirops_ropbuf_frame {
+	uint32_t	start;		/*!< Offset of the RopSize in the push buffer */
+};
+
+/** \def MAPIROPS_HANDLE_INDEX_BITS
+    Number of bits of a server object handle used by the table index,
+    the remaining bits hold the generation of the entry
+*/
+#define	MAPIROPS_HANDLE_INDEX_BITS	20
+
+/** \def MAPIROPS_HANDLE_INVALID
+    Server object handle referencing no object
+*/
+#define	MAPIROPS_HANDLE_INVALID		0xFFFFFFFF
+
+struct mapirops_handles;
+
+/** \def MAPIROPS_NAMEDPROPS_FIRST_ID
+    First property ID mapped to a named property
+*/
+#define	MAPIROPS_NAMEDPROPS_FIRST_ID	0x8000
+
+/** \def MAPIROPS_NAMEDPROPS_LAST_ID
+    Last property ID mapped to a named property
+*/
+#define	MAPIROPS_NAMEDPROPS_LAST_ID	0xFFFE
+
+struct mapirops_namedprops;
+
+/** \def MAPIROPS_HEXDUMP_NAME_MAX
+    Maximum number of characters of a hexdump annotation name, longer
+    names are truncated
+*/
+#define	MAPIROPS_HEXDUMP_NAME_MAX	64
+
+/**
+   \struct mapirops_hexdump_note
+   \brief Annotation of a hexdump, printed under the byte at offset
+ */
+struct mapirops_hexdump_note {
+	uint32_t	offset;		/*!< Offset of the annotated byte */
+	const char	*name;		/*!< Field name */
+};
+
+/**
+   \struct mapirops_cache_patch
+   \brief Per-request field patched when pushing a cached response
+ */
+struct mapirops_cache_patch {
+	uint32_t	offset;		/*!< Offset of the field from the start of the cached response */
+	uint8_t		size;		/*!< Size in bytes of the field (1, 2, 4 or 8) */
+};
+
+/**
+   \struct mapirops_cache_stats
+   \brief Usage statistics of a mapirops_cache
+ */
+struct mapirops_cache_stats {
+	uint64_t	hits;		/*!< Number of lookups which found an entry */
+	uint64_t	misses;		/*!< Number of lookups which found no entry */
+	uint64_t	evictions;	/*!< Number of entries evicted to make room */
+	uint32_t	count;		/*!< Number of entries currently stored */
+	size_t		size;		/*!< Number of bytes currently used by entries */
+};
+
+struct mapirops_cache;
+
+/** \def MAPIROPS_CAPTURE_MAGIC
+    Magic number starting a capture file, "MRCP" on disk
+*/
+#define	MAPIROPS_CAPTURE_MAGIC		0x5043524D
+
+/** \def MAPIROPS_CAPTURE_VERSION
+    Version of the capture file format
+*/
+#define	MAPIROPS_CAPTURE_VERSION	1
+
+/** \def MAPIROPS_CAPTURE_HEADER_SIZE
+    Size in bytes of the capture file header
+*/
+#define	MAPIROPS_CAPTURE_HEADER_SIZE	16
+
+/** \def MAPIROPS_CAPTURE_RECORD_SIZE
+    Size in bytes of a capture record header, the ROP buffer follows
+*/
+#define	MAPIROPS_CAPTURE_RECORD_SIZE	17
+
+/** \def MAPIROPS_CAPTURE_BUFFER
+    Default size of the per-thread capture buffers
+*/
+#define	MAPIROPS_CAPTURE_BUFFER		65536
+
+/**
+   \enum mapirops_capture_direction
+   \brief Whether a captured ROP buffer was pulled or pushed
+ */
+enum mapirops_capture_direction {
+	MAPIROPS_CAPTURE_PULL = 0x0,	/*!< ROP buffer decoded from the wire */
+	MAPIROPS_CAPTURE_PUSH = 0x1	/*!< ROP buffer encoded for the wire */
 };
 
+/**
+   \struct mapirops_capture_record
+   \brief Record read from a capture file
+
+   data points into the mapped file and remains valid until the reader
+   is freed.
+ */
+struct mapirops_capture_record {
+	uint64_t	timestamp;	/*!< Nanoseconds since the Epoch */
+	uint32_t	session;	/*!< Session identifier given to the push or pull context */
+	uint8_t		direction;	/*!< One of enum mapirops_capture_direction */
+	const uint8_t	*data;		/*!< Raw ROP buffer */
+	uint32_t	length;		/*!< Size in bytes of data */
+};
+
+struct mapirops_capture;
+struct mapirops_capture_reader;
+
+/** \def MAPIROPS_ANALYZE_CLIENT
+    The analyzed captures were recorded on the client side: pulled ROP
+    buffers are responses
+*/
+#define	MAPIROPS_ANALYZE_CLIENT		(1<<0)
+
+/** \def MAPIROPS_ANALYZE_TIMING
+    Measure the decoding time of each analyzed ROP
+*/
+#define	MAPIROPS_ANALYZE_TIMING		(1<<1)
+
+/** \def MAPIROPS_ANALYZE_SIZE_BUCKETS
+    Number of buckets of the ROP size histogram: powers of two up to
+    64K and above
+*/
+#define	MAPIROPS_ANALYZE_SIZE_BUCKETS	17
+
+/**
+   \enum mapirops_analyze_direction
+   \brief Whether an analyzed ROP is a request or a response
+ */
+enum mapirops_analyze_direction {
+	MAPIROPS_ANALYZE_REQUEST = 0x0,	/*!< ROP request */
+	MAPIROPS_ANALYZE_RESPONSE = 0x1	/*!< ROP response */
+};
+
+/**
+   \struct mapirops_analyze_rop_stats
+   \brief Decoding statistics of a ROP in one direction
+ */
+struct mapirops_analyze_rop_stats {
+	uint64_t	count;		/*!< Number of decoded ROPs */
+	uint64_t	errors;		/*!< Number of ROPs which failed to decode */
+	uint64_t	bytes;		/*!< Size in bytes of the decoded ROPs */
+	uint64_t	ns;		/*!< Decoding time with MAPIROPS_ANALYZE_TIMING */
+	uint64_t	sizes[MAPIROPS_ANALYZE_SIZE_BUCKETS];	/*!< log2 histogram of the ROP sizes */
+};
+
+/**
+   \struct mapirops_analyze_stats
+   \brief Statistics of the analyzed captures
+ */
+struct mapirops_analyze_stats {
+	struct mapirops_analyze_rop_stats	rops[2][256];		/*!< Indexed by direction and RopId */
+	uint64_t				unknown[2][256];	/*!< ROPs without decoder */
+	uint64_t				records;		/*!< Number of records */
+	uint64_t				bytes;			/*!< Size in bytes of the records */
+	uint64_t				invalid;		/*!< Malformed ROP buffers */
+	uint64_t				steals;			/*!< Chunk ranges stolen between workers */
+};
+
+struct mapirops_analyze;
+
+/** \def MAPIROPS_TIMING_SUB_BITS
+    log2 of the number of linear sub-buckets per power of two in a
+    latency histogram
+*/
+#define	MAPIROPS_TIMING_SUB_BITS	3
+
+/** \def MAPIROPS_TIMING_BUCKETS
+    Number of buckets of a latency histogram, covering up to 2^32
+    nanoseconds
+*/
+#define	MAPIROPS_TIMING_BUCKETS		((32 - MAPIROPS_TIMING_SUB_BITS + 1) << MAPIROPS_TIMING_SUB_BITS)
+
+/**
+   \enum mapirops_timing_direction
+   \brief Whether a timed ROP was pulled or pushed
+ */
+enum mapirops_timing_direction {
+	MAPIROPS_TIMING_PULL = 0x0,	/*!< ROP decoded from the wire */
+	MAPIROPS_TIMING_PUSH = 0x1	/*!< ROP encoded for the wire */
+};
+
+/**
+   \struct mapirops_timing_histogram
+   \brief Log-linear latency histogram of a ROP codec
+
+   Values below 2^MAPIROPS_TIMING_SUB_BITS nanoseconds have a bucket
+   each. Above, every power of two is split in
+   2^MAPIROPS_TIMING_SUB_BITS buckets of equal width.
+ */
+struct mapirops_timing_histogram {
+	uint64_t	count;					/*!< Number of timed calls */
+	uint64_t	sum;					/*!< Total time in nanoseconds */
+	uint64_t	max;					/*!< Longest call in nanoseconds */
+	uint64_t	buckets[MAPIROPS_TIMING_BUCKETS];	/*!< Number of calls per bucket */
+};
+
+/**
+   \struct mapirops_timing_summary
+   \brief Latency percentiles of a ROP codec, in nanoseconds
+ */
+struct mapirops_timing_summary {
+	uint8_t		RopId;		/*!< ROP identifier */
+	uint8_t		direction;	/*!< One of enum mapirops_timing_direction */
+	uint64_t	count;		/*!< Number of timed calls */
+	uint64_t	mean;		/*!< Average time */
+	uint64_t	p50;		/*!< Median */
+	uint64_t	p99;		/*!< 99th percentile */
+	uint64_t	p999;		/*!< 99.9th percentile */
+	uint64_t	max;		/*!< Longest call */
+};
+
+/** \def MAPIROPS_STATS_MAGIC
+    Magic number starting a statistics file, "MRST" on disk
+*/
+#define	MAPIROPS_STATS_MAGIC		0x5453524D
+
+/** \def MAPIROPS_STATS_VERSION
+    Version of the statistics file format
+*/
+#define	MAPIROPS_STATS_VERSION		1
+
+/** \def MAPIROPS_STATS_THREADS
+    Default number of thread blocks of a statistics file
+*/
+#define	MAPIROPS_STATS_THREADS		256
+
+/** \def MAPIROPS_STATS_ERRORS
+    Number of error counters, one per enum mapirops_err_code value
+*/
+#define	MAPIROPS_STATS_ERRORS		16
+
+/**
+   \enum mapirops_stats_direction
+   \brief Whether counted data was pulled or pushed
+ */
+enum mapirops_stats_direction {
+	MAPIROPS_STATS_PULL = 0x0,	/*!< Decoded from the wire */
+	MAPIROPS_STATS_PUSH = 0x1	/*!< Encoded for the wire */
+};
+
+/**
+   \struct mapirops_stats_counters
+   \brief Counters published in a statistics file
+
+   Counters only grow while the process is running: rates are the
+   difference between two reads.
+ */
+struct mapirops_stats_counters {
+	uint64_t	bytes[2];			/*!< Bytes of ROP buffers per direction */
+	uint64_t	rops[2][256];			/*!< ROPs per direction and RopId */
+	uint64_t	errors[MAPIROPS_STATS_ERRORS];	/*!< Failed ROP codecs per mapirops_err_code */
+	uint64_t	allocs;				/*!< Push buffer growths and pulled strings */
+};
+
+struct mapirops_stats_reader;
+
 /** \cond */
 
 #define	CAREFUL_ALIGNMENT	1
@@ -318,6 +826,109 @@ struct mapirops_push {
 	}							\
 } while (0)
 
+/*
+ * USDT probes of the mapirops provider, with --enable-usdt:
+ *
+ *   push, pull (type, offset, size): primitive entry points
+ *   push_expand (offset, extra_size, length)
+ *   struct_push_entry, struct_pull_entry (name, offset)
+ *   struct_push_return, struct_pull_return (name, offset, size, retval)
+ *
+ * A probe is a single nop until a tracer attaches to it: arguments are
+ * left in registers and only read by the tracer.
+ */
+#ifdef MAPIROPS_ENABLE_USDT
+#include <sys/sdt.h>
+#define	MAPIROPS_PROBE2(name, a, b)		DTRACE_PROBE2(mapirops, name, a, b)
+#define	MAPIROPS_PROBE3(name, a, b, c)		DTRACE_PROBE3(mapirops, name, a, b, c)
+#define	MAPIROPS_PROBE4(name, a, b, c, d)	DTRACE_PROBE4(mapirops, name, a, b, c, d)
+#else
+#define	MAPIROPS_PROBE2(name, a, b)		do { } while (0)
+#define	MAPIROPS_PROBE3(name, a, b, c)		do { } while (0)
+#define	MAPIROPS_PROBE4(name, a, b, c, d)	do { } while (0)
+#endif
+
+/* Stack cursors only allocate once given a memory context */
+#define	MAPIROPS_PULL_CAN_ALLOC(pull, ctx) \
+	((ctx) != NULL || !(pull)->is_cursor)
+
+/*
+ * Sticky-error pull: the first error is recorded in the context and
+ * the cursor moves to the end of the buffer, so every following
+ * primitive reads zero instead of returning. The pull function checks
+ * the error once when it returns.
+ */
+static inline void mapirops_pull_sticky_fail(struct mapirops_pull *pull, enum mapirops_err_code err)
+{
+	if (pull->error == MAPIROPS_ERR_SUCCESS) {
+		pull->error = err;
+	}
+	pull->offset = pull->data.length;
+}
+
+static inline const uint8_t *mapirops_pull_sticky_data(struct mapirops_pull *pull, uint32_t size)
+{
+	static const uint8_t	zero[8];
+	const uint8_t		*data;
+
+	if (unlikely(pull->offset > pull->data.length || size > pull->data.length - pull->offset)) {
+		mapirops_pull_sticky_fail(pull, MAPIROPS_ERR_BUFSIZE);
+		return zero;
+	}
+	data = pull->data.data + pull->offset;
+	pull->offset += size;
+
+	return data;
+}
+
+static inline enum mapirops_err_code mapirops_pull_sticky_end(struct mapirops_pull *pull, enum mapirops_err_code err)
+{
+	if (pull->error != MAPIROPS_ERR_SUCCESS) {
+		err = pull->error;
+		pull->error = MAPIROPS_ERR_SUCCESS;
+	}
+
+	return err;
+}
+
+#define	MAPIROPS_PULL_STICKY(pull, call) do {			\
+	enum mapirops_err_code	_status;			\
+	_status = call;						\
+	if (unlikely(!MAPIROPS_ERR_CODE_IS_SUCCESS(_status))) {	\
+		mapirops_pull_sticky_fail(pull, _status);	\
+	}							\
+} while (0)
+
+#define	MAPIROPS_PULL_STICKY_VALUE(type, size, read)			\
+static inline void mapirops_pull_sticky_##type(struct mapirops_pull *pull, type##_t *v) \
+{									\
+	const uint8_t	*data = mapirops_pull_sticky_data(pull, size);	\
+									\
+	*v = (type##_t) read(data, 0);					\
+}
+
+MAPIROPS_PULL_STICKY_VALUE(uint8, 1, CVAL)
+MAPIROPS_PULL_STICKY_VALUE(int8, 1, CVAL)
+MAPIROPS_PULL_STICKY_VALUE(uint16, 2, SVAL)
+MAPIROPS_PULL_STICKY_VALUE(int16, 2, SVAL)
+MAPIROPS_PULL_STICKY_VALUE(uint32, 4, IVAL)
+MAPIROPS_PULL_STICKY_VALUE(int32, 4, IVAL)
+
+static inline void mapirops_pull_sticky_uint64(struct mapirops_pull *pull, uint64_t *v)
+{
+	const uint8_t	*data = mapirops_pull_sticky_data(pull, 8);
+
+	*v = (uint64_t) IVAL(data, 0) | (uint64_t) IVAL(data, 4) << 32;
+}
+
+static inline void mapirops_pull_sticky_int64(struct mapirops_pull *pull, int64_t *v)
+{
+	uint64_t	u;
+
+	mapirops_pull_sticky_uint64(pull, &u);
+	*v = (int64_t) u;
+}
+
 #ifndef	__BEGIN_DECLS
 #ifdef	__cplusplus
 #define	__BEGIN_DECLS	extern "C" {
@@ -333,7 +944,13 @@ __BEGIN_DECLS
 
 /* The following definitions come from mapirops.c */
 struct mapirops_push	*mapirops_push_init(TALLOC_CTX *);
+struct mapirops_push	*mapirops_push_init_static(TALLOC_CTX *, uint8_t *, uint32_t);
+enum mapirops_err_code	mapirops_push_reset(struct mapirops_push *);
 struct mapirops_pull	*mapirops_pull_init(TALLOC_CTX *);
+enum mapirops_err_code	mapirops_pull_cursor_init(struct mapirops_pull *, const uint8_t *, size_t);
+uint32_t		mapirops_push_savepoint(struct mapirops_push *);
+enum mapirops_err_code	mapirops_push_rollback(struct mapirops_push *, uint32_t);
+enum mapirops_err_code	mapirops_push_set_limit(struct mapirops_push *, uint32_t);
 enum mapirops_err_code	mapirops_push_bytes(struct mapirops_push *, const uint8_t *, uint32_t);
 enum mapirops_err_code	mapirops_pull_bytes(struct mapirops_pull *, uint8_t *, uint32_t);
 enum mapirops_err_code	mapirops_push_int8(struct mapirops_push *, int8_t);
@@ -360,9 +977,102 @@ enum mapirops_err_code	mapirops_push_utf16_string(struct mapirops_push *, int, c
 enum mapirops_err_code	mapirops_pull_utf16_string(struct mapirops_pull *, TALLOC_CTX *, int, char **, size_t);
 enum mapirops_err_code	mapirops_push_enum_MAPISTATUS(struct mapirops_push *, enum MAPISTATUS);
 enum mapirops_err_code	mapirops_pull_enum_MAPISTATUS(struct mapirops_pull *, enum MAPISTATUS *);
+enum mapirops_err_code	mapirops_push_template(struct mapirops_push *, const struct mapirops_template *, uint32_t *);
+enum mapirops_err_code	mapirops_pull_template(struct mapirops_pull *, const struct mapirops_template *, uint32_t *);
+
+/* The following definitions come from mapirops_cache.c */
+struct mapirops_cache	*mapirops_cache_init(TALLOC_CTX *, size_t);
+enum mapirops_err_code	mapirops_cache_store(struct mapirops_cache *, const struct mapibuf *, const struct mapibuf *, const struct mapirops_cache_patch *, uint32_t);
+enum mapirops_err_code	mapirops_cache_push(struct mapirops_cache *, struct mapirops_push *, const struct mapibuf *, const uint64_t *, uint32_t);
+enum mapirops_err_code	mapirops_cache_remove(struct mapirops_cache *, const struct mapibuf *);
+enum mapirops_err_code	mapirops_cache_get_stats(struct mapirops_cache *, struct mapirops_cache_stats *);
+
+/* The following definitions come from mapirops_capture.c */
+struct mapirops_capture		*mapirops_capture_init(TALLOC_CTX *, const char *, uint32_t);
+enum mapirops_err_code		mapirops_capture_record(struct mapirops_capture *, uint8_t, uint32_t, const uint8_t *, uint32_t);
+enum mapirops_err_code		mapirops_capture_flush(struct mapirops_capture *);
+enum mapirops_err_code		mapirops_push_set_capture(struct mapirops_push *, struct mapirops_capture *, uint32_t);
+enum mapirops_err_code		mapirops_pull_set_capture(struct mapirops_pull *, struct mapirops_capture *, uint32_t);
+struct mapirops_capture_reader	*mapirops_capture_reader_init(TALLOC_CTX *, const char *);
+enum mapirops_err_code		mapirops_capture_reader_next(struct mapirops_capture_reader *, struct mapirops_capture_record *);
+
+/* The following definitions come from mapirops_codepage.c */
+const struct mapirops_codepage	*mapirops_codepage_get(uint32_t);
+enum mapirops_err_code		mapirops_push_set_codepage(struct mapirops_push *, uint32_t);
+enum mapirops_err_code		mapirops_pull_set_codepage(struct mapirops_pull *, uint32_t);
+enum mapirops_err_code		mapirops_codepage_to_utf8(const struct mapirops_codepage *, const uint8_t *, size_t, char *, size_t *);
+enum mapirops_err_code		mapirops_codepage_from_utf8(const struct mapirops_codepage *, const char *, size_t, uint8_t *, size_t *);
+
+/* The following definitions come from mapirops_handles.c */
+struct mapirops_handles	*mapirops_handles_init(TALLOC_CTX *, uint32_t);
+enum mapirops_err_code	mapirops_handles_alloc(struct mapirops_handles *, void *, uint32_t *);
+void			*mapirops_handles_lookup(struct mapirops_handles *, uint32_t);
+enum mapirops_err_code	mapirops_handles_release(struct mapirops_handles *, uint32_t, void **);
+enum mapirops_err_code	mapirops_handles_resolve(struct mapirops_handles *, const struct mapirops_ropbuf *, void **);
+
+/* The following definitions come from mapirops_lzxpress.c */
+enum mapirops_err_code	mapirops_lzxpress_compress(const struct mapibuf *, struct mapibuf *);
+enum mapirops_err_code	mapirops_lzxpress_decompress(const struct mapibuf *, struct mapibuf *);
+
+/* The following definitions come from mapirops_namedprops.c */
+struct mapirops_namedprops	*mapirops_namedprops_init(TALLOC_CTX *);
+enum mapirops_err_code		mapirops_namedprops_get_ids(struct mapirops_namedprops *, const PropertyName *, uint32_t, uint8_t, uint16_t *);
+enum mapirops_err_code		mapirops_namedprops_get_names(struct mapirops_namedprops *, const uint16_t *, uint32_t, PropertyName *);
+enum mapirops_err_code		mapirops_namedprops_RopGetPropertyIdsFromNames(struct mapirops_namedprops *, TALLOC_CTX *, const struct RopGetPropertyIdsFromNames_request *, struct RopGetPropertyIdsFromNames_response *);
+enum mapirops_err_code		mapirops_namedprops_RopGetNamesFromPropertyIds(struct mapirops_namedprops *, TALLOC_CTX *, const struct RopGetNamesFromPropertyIds_request *, struct RopGetNamesFromPropertyIds_response *);
+
+/* The following definitions come from mapirops_rpcext.c */
+void			mapirops_rpcext_xor(uint8_t *, size_t);
+enum mapirops_err_code	mapirops_rpcext_pull_init(struct mapirops_rpcext_iter *, TALLOC_CTX *, const struct mapibuf *);
+enum mapirops_err_code	mapirops_rpcext_pull_next(struct mapirops_rpcext_iter *, struct mapirops_pull *);
+enum mapirops_err_code	mapirops_rpcext_push_begin(struct mapirops_push *, struct mapirops_rpcext_frame *);
+enum mapirops_err_code	mapirops_rpcext_push_end(struct mapirops_push *, struct mapirops_rpcext_frame *, uint16_t);
+
+/* The following definitions come from mapirops_dispatch.c */
+const struct mapirops_rop_dispatch	*mapirops_rop_dispatch_get(uint8_t);
+
+/* The following definitions come from mapirops_analyze.c */
+struct mapirops_analyze		*mapirops_analyze_init(TALLOC_CTX *, uint32_t);
+enum mapirops_err_code		mapirops_analyze_add(struct mapirops_analyze *, const char *);
+enum mapirops_err_code		mapirops_analyze_run(struct mapirops_analyze *, uint32_t, struct mapirops_analyze_stats *, uint32_t *);
+
+/* The following definitions come from mapirops_fxparser.c */
+struct mapirops_fxparser	*mapirops_fxparser_init(TALLOC_CTX *, const struct mapirops_fx_callbacks *, void *);
+enum mapirops_err_code		mapirops_fxparser_parse(struct mapirops_fxparser *, const uint8_t *, size_t);
+enum mapirops_err_code		mapirops_fxparser_end(struct mapirops_fxparser *);
+
+/* The following definitions come from mapirops_fxproducer.c */
+struct mapirops_fxproducer	*mapirops_fxproducer_init(TALLOC_CTX *, uint32_t, uint32_t, uint32_t, mapirops_fx_serialize_fn, void *);
+enum mapirops_err_code		mapirops_fxproducer_get_buffer(struct mapirops_fxproducer *, struct mapirops_push *, uint32_t, uint32_t *, uint8_t *);
+
+/* The following definitions come from mapirops_ropbuf.c */
+enum mapirops_err_code	mapirops_ropbuf_pull(struct mapirops_pull *, struct mapirops_ropbuf *);
+enum mapirops_err_code	mapirops_ropbuf_push_begin(struct mapirops_push *, struct mapirops_ropbuf_frame *);
+enum mapirops_err_code	mapirops_ropbuf_push_end(struct mapirops_push *, struct mapirops_ropbuf_frame *, const uint32_t *, uint32_t);
+
+/* The following definitions come from mapirops_timing.c */
+struct mapirops_timing	*mapirops_timing_init(TALLOC_CTX *);
+enum mapirops_err_code	mapirops_push_set_timing(struct mapirops_push *, struct mapirops_timing *);
+enum mapirops_err_code	mapirops_pull_set_timing(struct mapirops_pull *, struct mapirops_timing *);
+uint64_t		mapirops_timing_start(void);
+void			mapirops_timing_stop(struct mapirops_timing *, uint8_t, uint8_t, uint64_t);
+enum mapirops_err_code	mapirops_timing_merge(struct mapirops_timing *, uint8_t, uint8_t, struct mapirops_timing_histogram *);
+uint64_t		mapirops_timing_percentile(const struct mapirops_timing_histogram *, double);
+enum mapirops_err_code	mapirops_timing_export(struct mapirops_timing *, TALLOC_CTX *, struct mapirops_timing_summary **, uint32_t *);
+
+/* The following definitions come from mapirops_stats.c */
+struct mapirops_stats		*mapirops_stats_init(TALLOC_CTX *, const char *, uint32_t);
+enum mapirops_err_code		mapirops_push_set_stats(struct mapirops_push *, struct mapirops_stats *);
+enum mapirops_err_code		mapirops_pull_set_stats(struct mapirops_pull *, struct mapirops_stats *);
+void				mapirops_stats_rop(struct mapirops_stats *, uint8_t, uint8_t, enum mapirops_err_code);
+struct mapirops_stats_reader	*mapirops_stats_reader_init(TALLOC_CTX *, const char *);
+enum mapirops_err_code		mapirops_stats_read(struct mapirops_stats_reader *, struct mapirops_stats_counters *, uint32_t *);
 
 /* The following definitions come from mapirops_print.c */
-void mapirops_hexdump(const uint8_t *, int);
+size_t			mapirops_hexdump_size(uint32_t, const struct mapirops_hexdump_note *, uint32_t);
+enum mapirops_err_code	mapirops_hexdump_buf(const uint8_t *, uint32_t, const struct mapirops_hexdump_note *, uint32_t, char *, size_t, size_t *);
+enum mapirops_err_code	mapirops_hexdump_fd(int, const uint8_t *, uint32_t, const struct mapirops_hexdump_note *, uint32_t);
+void			mapirops_hexdump(const uint8_t *, int);
 
 __END_DECLS
 
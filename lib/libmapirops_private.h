@@ -29,6 +29,7 @@
 #define	__LIBMAPIROPS_PRIVATE_H__
 
 #include <sys/types.h>
+#include <pthread.h>
 
 /** \cond */
 #ifndef	__BEGIN_DECLS
@@ -40,14 +41,57 @@
 #define	__END_DECLS
 #endif
 #endif
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define	MAPIROPS_LITTLE_ENDIAN	1
+#endif
+
+/* Head of the per-thread structures of a mapirops_threads registry */
+struct mapirops_thread {
+	struct mapirops_threads	*threads;
+	struct mapirops_thread	*prev;
+	struct mapirops_thread	*next;
+};
+
+struct mapirops_threads {
+	pthread_key_t		key;
+	pthread_mutex_t		lock;		/* Protects list and the state touched by the callbacks */
+	struct mapirops_thread	*list;
+	size_t			size;
+	const char		*name;
+	enum mapirops_err_code	(*attach)(void *, struct mapirops_thread *);
+	void			(*release)(void *, struct mapirops_thread *);
+	void			*private_data;
+};
 /** \endcond */
 
 __BEGIN_DECLS
 
+/* The following definitions come from mapirops.c */
+enum mapirops_err_code	mapirops_error(enum mapirops_err_code, int, const char *, ...);
+enum mapirops_err_code	mapirops_push_expand(struct mapirops_push *, uint32_t);
+enum mapirops_err_code	mapirops_pull_cursor_iconv(struct mapirops_pull *);
+
+/* The following definitions come from mapirops_codepage.c */
+enum mapirops_err_code	mapirops_codepage_push_string8(struct mapirops_push *, const char *, size_t);
+
+/* The following definitions come from mapirops_stats.c */
+void			mapirops_stats_bytes(struct mapirops_stats *, uint8_t, uint32_t);
+void			mapirops_stats_alloc(struct mapirops_stats *);
+
+/* The following definitions come from mapirops_threads.c */
+enum mapirops_err_code	mapirops_threads_init(struct mapirops_threads *, size_t, const char *,
+					      enum mapirops_err_code (*)(void *, struct mapirops_thread *),
+					      void (*)(void *, struct mapirops_thread *), void *);
+void			mapirops_threads_free(struct mapirops_threads *);
+struct mapirops_thread	*mapirops_threads_get(struct mapirops_threads *);
+struct mapirops_thread	*mapirops_threads_peek(struct mapirops_threads *);
+
 /* The following definitions come from util.c */
 size_t	mapirops_ascii_len_n(const char *, size_t);
 size_t	mapirops_utf16_len(const void *);
 size_t	mapirops_utf16_len_n(const void *, size_t);
+size_t	mapirops_utf16_scan(const void *, size_t);
 
 __END_DECLS
 
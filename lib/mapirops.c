@@ -27,6 +27,7 @@
 #include "config.h"
 
 #include "libmapirops.h"
+#include "libmapirops_private.h"
 #include "mapirops_uuid.h"
 
 /** \def MAPIROPS_CHUNK_SIZE
@@ -42,7 +43,7 @@
 /** \cond */
 
 #define	MAPIROPS_PUSH_NEED_BYTES(mapirops, n) \
-	MAPIROPS_CHECK(mapirops_push_expand(mapirops, mapirops->data.length+(n)))
+	MAPIROPS_CHECK(mapirops_push_expand(mapirops, (n)))
 
 #define	MAPIROPS_PULL_NEED_BYTES(mapirops, n) do {					\
 	if (unlikely((n)) > mapirops->data.length ||					\
@@ -85,18 +86,34 @@ enum mapirops_err_code mapirops_error(enum mapirops_err_code errnum,
    \param extra_size The extra size to add to current buffer
 
    \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_BUFSIZE if an
-   overflow is detected, or MAPIROPS_ERR_ALLOC if realloc failed.
+   overflow is detected, MAPIROPS_ERR_BUFFER_TOO_SMALL if the push
+   limit or the capacity of a caller-provided buffer would be exceeded
+   or MAPIROPS_ERR_ALLOC if realloc failed.
  */
 enum mapirops_err_code mapirops_push_expand(struct mapirops_push *push, 
 					    uint32_t extra_size)
 {
 	uint32_t	size = extra_size + push->offset;
 
+	MAPIROPS_PROBE3(push_expand, push->offset, extra_size, push->data.length);
 	if (size < push->offset) {
 		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
 				      "Overflow in push_expand to %u", size);
 	}
 
+	/* Expected condition, the caller rolls back: don't log */
+	if (push->limit && size > push->limit) {
+		return MAPIROPS_ERR_BUFFER_TOO_SMALL;
+	}
+
+	/* Caller-provided buffer is never reallocated */
+	if (push->capacity) {
+		if (size > push->capacity) {
+			return MAPIROPS_ERR_BUFFER_TOO_SMALL;
+		}
+		return MAPIROPS_ERR_SUCCESS;
+	}
+
 	if (talloc_get_size(push->data.data) >= size) {
 		return MAPIROPS_ERR_SUCCESS;
 	}
@@ -113,6 +130,72 @@ enum mapirops_err_code mapirops_push_expand(struct mapirops_push *push,
 		return mapirops_error(MAPIROPS_ERR_ALLOC, LOG_ERR,
 				      "Failed to push_expand to %u", push->data.length);
 	}
+	if (unlikely(push->stats != NULL)) {
+		mapirops_stats_alloc(push->stats);
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Return a savepoint for the current state of the push buffer
+
+   \param push Pointer to the mapirops_push structure
+
+   \sa mapirops_push_rollback
+
+   \return Savepoint to pass to mapirops_push_rollback
+ */
+uint32_t mapirops_push_savepoint(struct mapirops_push *push)
+{
+	return push->offset;
+}
+
+/**
+   \details Discard everything pushed since a savepoint
+
+   This is used to undo a partially encoded ROP which hit the push
+   limit, so RopBufferTooSmall can be emitted in the same buffer.
+
+   \param push Pointer to the mapirops_push structure
+   \param savepoint Value previously returned by mapirops_push_savepoint
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_INVALID_VAL
+   if savepoint is past the current push offset
+ */
+enum mapirops_err_code mapirops_push_rollback(struct mapirops_push *push,
+					      uint32_t savepoint)
+{
+	if (savepoint > push->offset) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	push->offset = savepoint;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Set the maximum number of bytes the push buffer can hold
+
+   Once set, any push which would grow the buffer past limit fails
+   with MAPIROPS_ERR_BUFFER_TOO_SMALL and leaves the already pushed
+   data untouched.
+
+   \param push Pointer to the mapirops_push structure
+   \param limit Maximum size in bytes, 0 to remove the limit
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_INVALID_VAL
+   if more than limit bytes were already pushed
+ */
+enum mapirops_err_code mapirops_push_set_limit(struct mapirops_push *push,
+					       uint32_t limit)
+{
+	if (limit && limit < push->offset) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	push->limit = limit;
 
 	return MAPIROPS_ERR_SUCCESS;
 }
@@ -136,13 +219,6 @@ static enum mapirops_err_code mapirops_push_destructor(void *data)
 		}
 	}
 
-	if (push->utf8toascii) {
-		ret = iconv_close(push->utf8toascii);
-		if (ret == -1) {
-			return MAPIROPS_ERR_ICONV;
-		}
-	}
-
 	return MAPIROPS_ERR_SUCCESS;
 }
 
@@ -169,19 +245,69 @@ struct mapirops_push *mapirops_push_init(TALLOC_CTX *mem_ctx)
 		return NULL;
 	}
 
-	push->utf8toascii = iconv_open("ASCII", "UTF-8//IGNORE");
-	if (push->utf8toascii == (iconv_t)-1) {
-		talloc_free(push);
-		mapirops_error(MAPIROPS_ERR_ICONV, LOG_ERR,
-			       "Failed to open push conversion descriptor from UTF8 to ASCII");
+	talloc_set_destructor((void *)push, (int (*)(void *))mapirops_push_destructor);
+
+	return push;
+}
+
+/**
+   \details Initialize a mapirops_push data structure writing into a
+   caller-provided buffer
+
+   The buffer is never reallocated: any push which would go past
+   capacity fails with MAPIROPS_ERR_BUFFER_TOO_SMALL and leaves the
+   already pushed data untouched. The buffer must remain valid as long
+   as the context is used.
+
+   \param mem_ctx Pointer to the TALLOC memory context to use
+   \param buf Pointer to the buffer to push into
+   \param capacity Size in bytes of buf
+
+   \return Allocated mapirops_push structure on success, otherwise
+   NULL.
+ */
+struct mapirops_push *mapirops_push_init_static(TALLOC_CTX *mem_ctx, uint8_t *buf, uint32_t capacity)
+{
+	struct mapirops_push *push;
+
+	if (!buf || !capacity) {
 		return NULL;
 	}
 
-	talloc_set_destructor((void *)push, (int (*)(void *))mapirops_push_destructor);
+	push = mapirops_push_init(mem_ctx);
+	if (push == NULL) {
+		return NULL;
+	}
+
+	push->data.data = buf;
+	push->data.length = capacity;
+	push->capacity = capacity;
 
 	return push;
 }
 
+/**
+   \details Discard everything pushed and remove the push limit
+
+   The buffer is kept, so a context can be reused for the next
+   response without any allocation.
+
+   \param push Pointer to the mapirops_push structure
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_push_reset(struct mapirops_push *push)
+{
+	if (!push) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	push->offset = 0;
+	push->limit = 0;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
 /**
    \details Destructor for mapirops_pull context
    
@@ -231,6 +357,81 @@ struct mapirops_pull *mapirops_pull_init(TALLOC_CTX *mem_ctx)
 	return pull;
 }
 
+/**
+   \details Initialize a pull cursor over a buffer
+
+   A cursor is a mapirops_pull structure owned by the caller, usually
+   on the stack: it takes no memory, no iconv descriptor and needs no
+   destructor. It decodes every fixed-size primitive and generated
+   structures made of them.
+
+   Strings and dynamic arrays are only decoded once a memory context
+   is set in mem_ctx, otherwise they fail with MAPIROPS_ERR_ALLOC. The
+   UTF-16 conversion descriptor is then opened on first use and freed
+   with that memory context.
+
+   \param cursor Pointer to the mapirops_pull structure to initialize
+   \param data Pointer to the buffer to pull from
+   \param length Size in bytes of data
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_pull_cursor_init(struct mapirops_pull *cursor, const uint8_t *data, size_t length)
+{
+	if (!cursor || (length && !data)) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	memset(cursor, 0, sizeof (struct mapirops_pull));
+	cursor->data.data = (uint8_t *)data;
+	cursor->data.length = length;
+	cursor->utf16to8 = (iconv_t)-1;
+	cursor->is_cursor = 1;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static int mapirops_pull_cursor_iconv_destructor(iconv_t *cd)
+{
+	iconv_close(*cd);
+
+	return 0;
+}
+
+/**
+   \details Open the UTF-16 conversion descriptor of a cursor in its
+   memory context
+
+   \param cursor Pointer to the mapirops_pull structure
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_ALLOC if the
+   cursor has no memory context, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_pull_cursor_iconv(struct mapirops_pull *cursor)
+{
+	iconv_t	*cd;
+
+	if (cursor->mem_ctx == NULL) {
+		return mapirops_error(MAPIROPS_ERR_ALLOC, LOG_ERR,
+				      "No memory context to pull strings with a cursor");
+	}
+
+	cd = talloc(cursor->mem_ctx, iconv_t);
+	if (cd == NULL) {
+		return MAPIROPS_ERR_NO_MEMORY;
+	}
+	*cd = iconv_open("UTF-8", "UTF-16LE");
+	if (*cd == (iconv_t)-1) {
+		talloc_free(cd);
+		return mapirops_error(MAPIROPS_ERR_ICONV, LOG_ERR,
+				      "Failed to open pull conversion descriptor from UTF16 to UTF8");
+	}
+	talloc_set_destructor(cd, mapirops_pull_cursor_iconv_destructor);
+	cursor->utf16to8 = *cd;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
 
 /**
    \details Push a set of bytes
@@ -243,6 +444,7 @@ struct mapirops_pull *mapirops_pull_init(TALLOC_CTX *mem_ctx)
  */
 enum mapirops_err_code mapirops_push_bytes(struct mapirops_push *push, const uint8_t *data, uint32_t n)
 {
+	MAPIROPS_PROBE3(push, "bytes", push->offset, n);
 	MAPIROPS_PUSH_NEED_BYTES(push, n);
 	memcpy(push->data.data + push->offset, data, n);
 	push->offset += n;
@@ -263,6 +465,7 @@ enum mapirops_err_code mapirops_push_bytes(struct mapirops_push *push, const uin
  */
 enum mapirops_err_code mapirops_pull_bytes(struct mapirops_pull *pull, uint8_t *data, uint32_t n)
 {
+	MAPIROPS_PROBE3(pull, "bytes", pull->offset, n);
 	MAPIROPS_PULL_NEED_BYTES(pull, n);
 	memcpy(data, pull->data.data + pull->offset, n);
 	pull->offset += n;
@@ -282,6 +485,7 @@ enum mapirops_err_code mapirops_pull_bytes(struct mapirops_pull *pull, uint8_t *
  */
 enum mapirops_err_code mapirops_push_int8(struct mapirops_push *push, int8_t v)
 {
+	MAPIROPS_PROBE3(push, "int8", push->offset, 1);
 	MAPIROPS_PUSH_NEED_BYTES(push, 1);
 	SCVAL(push->data.data, push->offset, (uint8_t)v);
 	push->offset += 1;
@@ -301,6 +505,7 @@ enum mapirops_err_code mapirops_push_int8(struct mapirops_push *push, int8_t v)
  */
 enum mapirops_err_code mapirops_pull_int8(struct mapirops_pull *pull, int8_t *v)
 {
+	MAPIROPS_PROBE3(pull, "int8", pull->offset, 1);
 	MAPIROPS_PULL_NEED_BYTES(pull, 1);
 	*v = (int8_t)CVAL(pull->data.data, pull->offset);
 	pull->offset += 1;
@@ -319,6 +524,7 @@ enum mapirops_err_code mapirops_pull_int8(struct mapirops_pull *pull, int8_t *v)
  */
 enum mapirops_err_code mapirops_push_uint8(struct mapirops_push *push, uint8_t v)
 {
+	MAPIROPS_PROBE3(push, "uint8", push->offset, 1);
 	MAPIROPS_PUSH_NEED_BYTES(push, 1);
 	SCVAL(push->data.data, push->offset, v);
 	push->offset += 1;
@@ -338,6 +544,7 @@ enum mapirops_err_code mapirops_push_uint8(struct mapirops_push *push, uint8_t v
  */
 enum mapirops_err_code mapirops_pull_uint8(struct mapirops_pull *pull, uint8_t *v)
 {
+	MAPIROPS_PROBE3(pull, "uint8", pull->offset, 1);
 	MAPIROPS_PULL_NEED_BYTES(pull, 1);
 	*v = CVAL(pull->data.data, pull->offset);
 	pull->offset += 1;
@@ -357,6 +564,7 @@ enum mapirops_err_code mapirops_pull_uint8(struct mapirops_pull *pull, uint8_t *
 */
 enum mapirops_err_code mapirops_push_int16(struct mapirops_push *push, int16_t v)
 {
+	MAPIROPS_PROBE3(push, "int16", push->offset, 2);
 	MAPIROPS_PUSH_NEED_BYTES(push, 2);
 	SSVAL(push->data.data, push->offset, v);
 	push->offset += 2;
@@ -375,6 +583,7 @@ enum mapirops_err_code mapirops_push_int16(struct mapirops_push *push, int16_t v
  */
 enum mapirops_err_code mapirops_pull_int16(struct mapirops_pull *pull, int16_t *v)
 {
+	MAPIROPS_PROBE3(pull, "int16", pull->offset, 2);
 	MAPIROPS_PULL_NEED_BYTES(pull, 2);
 	*v = (uint16_t)SVAL(pull->data.data, pull->offset);
 	pull->offset += 2;
@@ -394,6 +603,7 @@ enum mapirops_err_code mapirops_pull_int16(struct mapirops_pull *pull, int16_t *
  */
 enum mapirops_err_code mapirops_push_uint16(struct mapirops_push *push, uint16_t v)
 {
+	MAPIROPS_PROBE3(push, "uint16", push->offset, 2);
 	MAPIROPS_PUSH_NEED_BYTES(push, 2);
 	SSVAL(push->data.data, push->offset, v);
 	push->offset += 2;
@@ -413,6 +623,7 @@ enum mapirops_err_code mapirops_push_uint16(struct mapirops_push *push, uint16_t
  */
 enum mapirops_err_code mapirops_pull_uint16(struct mapirops_pull *pull, uint16_t *v)
 {
+	MAPIROPS_PROBE3(pull, "uint16", pull->offset, 2);
 	MAPIROPS_PULL_NEED_BYTES(pull, 2);
 	*v = SVAL(pull->data.data, pull->offset);
 	pull->offset += 2;
@@ -432,6 +643,7 @@ enum mapirops_err_code mapirops_pull_uint16(struct mapirops_pull *pull, uint16_t
  */
 enum mapirops_err_code mapirops_push_int32(struct mapirops_push *push, int32_t v)
 {
+	MAPIROPS_PROBE3(push, "int32", push->offset, 4);
 	MAPIROPS_PUSH_NEED_BYTES(push, 4);
 	SIVALS(push->data.data, push->offset, v);
 	push->offset += 4;
@@ -451,6 +663,7 @@ enum mapirops_err_code mapirops_push_int32(struct mapirops_push *push, int32_t v
  */
 enum mapirops_err_code mapirops_pull_int32(struct mapirops_pull *pull, int32_t *v)
 {
+	MAPIROPS_PROBE3(pull, "int32", pull->offset, 4);
 	MAPIROPS_PULL_NEED_BYTES(pull, 4);
 	*v = IVALS(pull->data.data, pull->offset);
 	pull->offset += 4;
@@ -469,6 +682,7 @@ enum mapirops_err_code mapirops_pull_int32(struct mapirops_pull *pull, int32_t *
  */
 enum mapirops_err_code mapirops_push_uint32(struct mapirops_push *push, uint32_t v)
 {
+	MAPIROPS_PROBE3(push, "uint32", push->offset, 4);
 	MAPIROPS_PUSH_NEED_BYTES(push, 4);
 	SIVAL(push->data.data, push->offset, v);
 	push->offset += 4;
@@ -488,6 +702,7 @@ enum mapirops_err_code mapirops_push_uint32(struct mapirops_push *push, uint32_t
  */
 enum mapirops_err_code mapirops_pull_uint32(struct mapirops_pull *pull, uint32_t *v)
 {
+	MAPIROPS_PROBE3(pull, "uint32", pull->offset, 4);
 	MAPIROPS_PULL_NEED_BYTES(pull, 4);
 	*v = IVAL(pull->data.data, pull->offset);
 	pull->offset += 4;
@@ -507,6 +722,7 @@ enum mapirops_err_code mapirops_pull_uint32(struct mapirops_pull *pull, uint32_t
  */
 enum mapirops_err_code mapirops_push_int64(struct mapirops_push *push, int64_t v)
 {
+	MAPIROPS_PROBE3(push, "int64", push->offset, 8);
 	MAPIROPS_PUSH_NEED_BYTES(push, 8);
 	SIVAL(push->data.data, push->offset, (v & 0xFFFFFFFF));
 	SIVAL(push->data.data, push->offset + 4, (v >> 32));
@@ -527,6 +743,7 @@ enum mapirops_err_code mapirops_push_int64(struct mapirops_push *push, int64_t v
  */
 enum mapirops_err_code mapirops_pull_int64(struct mapirops_pull *pull, int64_t *v)
 {
+	MAPIROPS_PROBE3(pull, "int64", pull->offset, 8);
 	MAPIROPS_PULL_NEED_BYTES(pull, 8);
 	*v = IVAL(pull->data.data, pull->offset);
 	*v |= (int64_t)(IVAL(pull->data.data, pull->offset + 4)) << 32;
@@ -547,6 +764,7 @@ enum mapirops_err_code mapirops_pull_int64(struct mapirops_pull *pull, int64_t *
  */
 enum mapirops_err_code mapirops_push_uint64(struct mapirops_push *push, uint64_t v)
 {
+	MAPIROPS_PROBE3(push, "uint64", push->offset, 8);
 	MAPIROPS_PUSH_NEED_BYTES(push, 8);
 	SIVAL(push->data.data, push->offset, (v & 0xFFFFFFFF));
 	SIVAL(push->data.data, push->offset + 4, (v >> 32));
@@ -566,6 +784,7 @@ enum mapirops_err_code mapirops_push_uint64(struct mapirops_push *push, uint64_t
  */
 enum mapirops_err_code mapirops_pull_uint64(struct mapirops_pull *pull, uint64_t *v)
 {
+	MAPIROPS_PROBE3(pull, "uint64", pull->offset, 8);
 	MAPIROPS_PULL_NEED_BYTES(pull, 8);
 	*v = IVAL(pull->data.data, pull->offset);
 	*v |= (uint64_t)(IVAL(pull->data.data, pull->offset + 4)) << 32;
@@ -585,6 +804,7 @@ enum mapirops_err_code mapirops_pull_uint64(struct mapirops_pull *pull, uint64_t
  */
 enum mapirops_err_code mapirops_push_double(struct mapirops_push *push, double v)
 {
+	MAPIROPS_PROBE3(push, "double", push->offset, 8);
 	MAPIROPS_PUSH_NEED_BYTES(push, 8);
 	memcpy(push->data.data + push->offset, &v, 8);
 	push->offset += 8;
@@ -603,6 +823,7 @@ enum mapirops_err_code mapirops_push_double(struct mapirops_push *push, double v
  */
 enum mapirops_err_code mapirops_pull_double(struct mapirops_pull *pull, double *v)
 {
+	MAPIROPS_PROBE3(pull, "double", pull->offset, 8);
 	MAPIROPS_PULL_NEED_BYTES(pull, 8);
 	memcpy(v, pull->data.data + pull->offset, 8);
 	pull->offset += 8;
@@ -620,48 +841,36 @@ enum mapirops_err_code mapirops_pull_double(struct mapirops_pull *pull, double *
  */
 enum mapirops_err_code mapirops_push_ascii_string(struct mapirops_push *push, int flags, char *str)
 {
-	TALLOC_CTX		*mem_ctx;
-	size_t			ret;
 	size_t			slen;
-	size_t			inlen;
-	size_t			outlen;
-	enum mapirops_err_code	errcode;
-	char			*ascii_str = NULL;
-	char			*start = NULL;
+	size_t			term = 1;
+	size_t			i;
 
 	slen = str ? strlen(str) : 0;
+	MAPIROPS_PROBE3(push, "ascii_string", push->offset, slen);
 
 	if (flags & MAPIROPS_STR_NOTERM) {
 		flags &= ~MAPIROPS_STR_NOTERM;
-	} else {
-		slen += 1;
+		term = 0;
 	}
 
-	if (slen == 0) {
-		str = NULL;
+	if (slen + term == 0) {
 		return MAPIROPS_ERR_SUCCESS;
 	}
-        mem_ctx = talloc_named(NULL, 0, "mapirops_push_ascii");
-
-        if ((str == NULL) || (strlen(str) == 0)) {
-                start = talloc_strdup(mem_ctx, "\0");
-        } else {
-                inlen = slen;
-                outlen = slen;
 
-                ascii_str = (char *) talloc_array(mem_ctx, uint8_t, outlen);
-                start = ascii_str;
-                ret = iconv(push->utf8toascii, &str, &inlen, &ascii_str, &outlen);
-                if (ret == (size_t)-1) {
-                        talloc_free(mem_ctx);
-                        return MAPIROPS_ERR_ICONV;
-                }
-        }
-	errcode = mapirops_push_bytes(push, (const uint8_t *)start, slen);
+	if (push->codepage) {
+		MAPIROPS_CHECK(mapirops_codepage_push_string8(push, str, slen));
+		return term ? mapirops_push_uint8(push, 0) : MAPIROPS_ERR_SUCCESS;
+	}
 
-	talloc_free(mem_ctx);
+	/* No conversion required for ASCII, a subset of UTF-8 */
+	for (i = 0; i < slen; i++) {
+		if (str[i] & 0x80) {
+			return mapirops_error(MAPIROPS_ERR_ICONV, LOG_ERR,
+					      "Non-ASCII character in push_ascii");
+		}
+	}
 
-	return errcode;
+	return mapirops_push_bytes(push, (const uint8_t *)(slen ? str : ""), slen + term);
 }
 
 
@@ -673,7 +882,8 @@ enum mapirops_err_code mapirops_push_ascii_string(struct mapirops_push *push, in
    memory allocation
    \param flags Flags controlling how the string should be pulled
    \param str Pointer on pointer to the UTF-8 string to return
-   \param slen Size of the UTF-8 string to pull
+   \param slen Size of the UTF-8 string to pull, ignored with
+   MAPIROPS_STR_NOSIZE where the string ends at its termination character
 
    \note Calling function is responsible for freeing the str allocated
    string returned
@@ -683,20 +893,31 @@ enum mapirops_err_code mapirops_push_ascii_string(struct mapirops_push *push, in
 enum mapirops_err_code mapirops_pull_ascii_string(struct mapirops_pull *pull, TALLOC_CTX *mem_ctx, 
 						  int flags, char **str, size_t slen)
 {
+	const uint8_t		*start;
+	const uint8_t		*end;
+	size_t			remaining;
+	size_t			len;
 	size_t			src_len = slen;
 
+	MAPIROPS_PROBE3(pull, "ascii_string", pull->offset, slen);
+	start = pull->data.data + pull->offset;
+	remaining = (pull->offset < pull->data.length) ? pull->data.length - pull->offset : 0;
+
 	/* If no prefixing size is available, calculate the size */
 	if (flags & MAPIROPS_STR_NOSIZE) {
 		/* We can't have STR_SIZE and STR_NOTERM flags set at the same time */
 		if (flags & MAPIROPS_STR_NOTERM) {
 			return MAPIROPS_ERR_INVALID_FLAGS;
 		}
-		/* TODO: Implement parsing routine looking for \0 */
 		flags &= ~MAPIROPS_STR_NOSIZE;
-		src_len = slen;
-	}
-
-	if (flags & MAPIROPS_STR_NOTERM) {
+		end = remaining ? memchr(start, 0, remaining) : NULL;
+		if (end == NULL) {
+			return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+					      "Unterminated string in pull_ascii");
+		}
+		/* Termination character included */
+		src_len = end - start + 1;
+	} else if (flags & MAPIROPS_STR_NOTERM) {
 		flags &= ~MAPIROPS_STR_NOTERM;
 	} else {
 		/* Add termination character */
@@ -713,23 +934,46 @@ enum mapirops_err_code mapirops_pull_ascii_string(struct mapirops_pull *pull, TA
 		return MAPIROPS_ERR_SUCCESS;
 	}
 
+	if (unlikely(!MAPIROPS_PULL_CAN_ALLOC(pull, mem_ctx))) {
+		return mapirops_error(MAPIROPS_ERR_ALLOC, LOG_ERR,
+				      "No memory context to pull strings with a cursor");
+	}
+
 	/* Ensure src_len is <= remaining buffer size */
-	if (src_len >= (pull->data.length - pull->offset)) {
+	if (src_len > remaining) {
 		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR, 
-				      "Overflow in pull_ascii to %u", src_len);
+				      "Overflow in pull_ascii to %zu", src_len);
+	}
+
+	if (pull->codepage) {
+		len = strnlen((const char *)start, src_len);
+		*str = talloc_array(mem_ctx, char, MAPIROPS_CODEPAGE_UTF8_SIZE(len));
+		if (*str == NULL) {
+			return mapirops_error(MAPIROPS_ERR_ALLOC, LOG_ERR,
+					      "Failed to pull_ascii to %zu", src_len);
+		}
+		if (mapirops_codepage_to_utf8(pull->codepage, start, len, *str, &len) != MAPIROPS_ERR_SUCCESS) {
+			talloc_free(*str);
+			*str = NULL;
+			return mapirops_error(MAPIROPS_ERR_ICONV, LOG_ERR, "String not in pull codepage");
+		}
+		pull->offset += src_len;
+		if (unlikely(pull->stats != NULL)) {
+			mapirops_stats_alloc(pull->stats);
+		}
+		return MAPIROPS_ERR_SUCCESS;
 	}
 
 	/* No iconv conversion required here: ASCII is a subset of UTF-8 */
-        if (src_len > 0) {
-            *str = talloc_strndup(mem_ctx, (const char *)pull->data.data + pull->offset, src_len);
-            if (*str == NULL) {
-                    return mapirops_error(MAPIROPS_ERR_ALLOC, LOG_ERR,
-                                        "Failed to pull_ascii to %u", src_len);
-            }
-            pull->offset += src_len;
-        } else {
-            *str = NULL;
-        }
+	*str = talloc_strndup(mem_ctx, (const char *)start, src_len);
+	if (*str == NULL) {
+		return mapirops_error(MAPIROPS_ERR_ALLOC, LOG_ERR,
+				      "Failed to pull_ascii to %zu", src_len);
+	}
+	pull->offset += src_len;
+	if (unlikely(pull->stats != NULL)) {
+		mapirops_stats_alloc(pull->stats);
+	}
 
 	return MAPIROPS_ERR_SUCCESS;
 }
@@ -757,6 +1001,7 @@ enum mapirops_err_code mapirops_push_utf16_string(struct mapirops_push *push, in
 	char			*utf16_str = NULL;
 
 	slen = utf8_str ? strlen(utf8_str) : 0;
+	MAPIROPS_PROBE3(push, "utf16_string", push->offset, slen);
 	if (flags & MAPIROPS_STR_NOTERM) {
 		flags &= ~MAPIROPS_STR_NOTERM;
 		dlen = slen * 2;
@@ -779,7 +1024,8 @@ enum mapirops_err_code mapirops_push_utf16_string(struct mapirops_push *push, in
 		return MAPIROPS_ERR_ICONV;
 	}
 
-	errcode = mapirops_push_bytes(push, (const uint8_t *)start, outlen);
+	/* dlen holds the unused part of the output buffer */
+	errcode = mapirops_push_bytes(push, (const uint8_t *)start, outlen - dlen);
 
 	talloc_free(mem_ctx);
 
@@ -794,7 +1040,8 @@ enum mapirops_err_code mapirops_push_utf16_string(struct mapirops_push *push, in
    \param mem_ctx Pointer to the memory context to use for string memory allocation
    \param flags Flags controlling how the string should be pulled
    \param str Pointer on pointer to the UTF-8 converted string to return
-   \param slen Size of the UTF-16 string to pull
+   \param slen Size of the UTF-16 string to pull, ignored with
+   MAPIROPS_STR_NOSIZE where the string ends at its termination character
 
    \note Calling function is responsible for freeing the str allocated string returned
 
@@ -803,15 +1050,18 @@ enum mapirops_err_code mapirops_push_utf16_string(struct mapirops_push *push, in
 enum mapirops_err_code mapirops_pull_utf16_string(struct mapirops_pull *pull, TALLOC_CTX *mem_ctx,
 						  int flags, char **str, size_t slen)
 {
-	enum mapirops_err_code	errcode;
 	size_t			ret;
+	size_t			remaining;
 	size_t			utf16_len = 0;
 	char			*utf16_str = NULL;
 	char			*utf8_str = NULL;
 	size_t			utf8_len = 0;
 	size_t			dlen = 0;
 	char			*start = NULL;
-	char			*start_utf16 = NULL;
+
+	MAPIROPS_PROBE3(pull, "utf16_string", pull->offset, slen);
+	utf16_str = (char *)pull->data.data + pull->offset;
+	remaining = (pull->offset < pull->data.length) ? pull->data.length - pull->offset : 0;
 
 	/* If no prefixing size is available, calculate the size */
 	if (flags & MAPIROPS_STR_NOSIZE) {
@@ -819,8 +1069,12 @@ enum mapirops_err_code mapirops_pull_utf16_string(struct mapirops_pull *pull, TA
 		if (flags & MAPIROPS_STR_NOTERM) {
 			return MAPIROPS_ERR_INVALID_FLAGS;
 		}
-		/* TODO: Implement parsing routine looking for \0\0 */
-		flags &= ~ MAPIROPS_STR_NOSIZE;
+		flags &= ~MAPIROPS_STR_NOSIZE;
+		slen = mapirops_utf16_scan(utf16_str, remaining);
+		if (slen == remaining) {
+			return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+					      "Unterminated string in pull_utf16");
+		}
 	}
 
 	if (flags & MAPIROPS_STR_NOTERM) {
@@ -830,49 +1084,49 @@ enum mapirops_err_code mapirops_pull_utf16_string(struct mapirops_pull *pull, TA
 		utf16_len = slen + 2;
 	}
 
-	dlen = utf16_len / 2;
+	if (flags) {
+		return MAPIROPS_ERR_INVALID_FLAGS;
+	}
 
 	/* Ensure utf16_len is <= remaining buffer size */
-	if (utf16_len >= (pull->data.length - pull->offset)) {
+	if (utf16_len > remaining) {
 		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
-				      "Overflow in pull_utf16 to %u", utf16_len);
+				      "Overflow in pull_utf16 to %zu", utf16_len);
 	}
 
-	/* Retrieve UTF-16 string from buffer */
-	utf16_str = (char *) talloc_array(mem_ctx, uint8_t, utf16_len);
-	start_utf16 = utf16_str;
-	if (utf16_str == NULL) {
+	if (unlikely(!MAPIROPS_PULL_CAN_ALLOC(pull, mem_ctx))) {
 		return mapirops_error(MAPIROPS_ERR_ALLOC, LOG_ERR,
-				      "Failed to pull_utf16 to %u", utf16_len);
+				      "No memory context to pull strings with a cursor");
 	}
-	errcode = mapirops_pull_bytes(pull, (uint8_t *)utf16_str, utf16_len);
-	if (errcode != MAPIROPS_ERR_SUCCESS) {
-		talloc_free(utf16_str);
-		return errcode;
+
+	if (unlikely(pull->utf16to8 == (iconv_t)-1)) {
+		MAPIROPS_CHECK(mapirops_pull_cursor_iconv(pull));
 	}
 
-	/* Allocate memory for str string to be returned */
+	/* Up to 3 UTF-8 bytes per UTF-16 unit, plus termination */
+	dlen = (utf16_len / 2) * 3 + 1;
 	utf8_str = (char *) talloc_array(mem_ctx, uint8_t, dlen);
 	start = utf8_str;
 	utf8_len = dlen;
 	if (utf8_str == NULL) {
-		talloc_free(utf16_str);
 		return mapirops_error(MAPIROPS_ERR_ALLOC, LOG_ERR, 
-				      "Failed to pull_utf16 to %u", dlen);
+				      "Failed to pull_utf16 to %zu", dlen);
 	}
 
-	/* iconv conversion required */
-	ret = iconv(pull->utf16to8, &utf16_str, &utf16_len, &utf8_str, &utf8_len);
+	/* iconv conversion required, straight from the buffer */
+	dlen = utf16_len;
+	ret = iconv(pull->utf16to8, &utf16_str, &dlen, &utf8_str, &utf8_len);
 	if (ret == (size_t)-1) {
-		talloc_free(utf8_str);
-		talloc_free(utf16_str);
+		talloc_free(start);
 		return MAPIROPS_ERR_ICONV;
 	}
+	*utf8_str = '\0';
+	pull->offset += utf16_len;
+	if (unlikely(pull->stats != NULL)) {
+		mapirops_stats_alloc(pull->stats);
+	}
 
-	*str = talloc_strndup(mem_ctx, start, dlen);
-
-	talloc_free(start);
-	talloc_free(start_utf16);
+	*str = start;
 
 	return MAPIROPS_ERR_SUCCESS;
 }
@@ -887,6 +1141,7 @@ enum mapirops_err_code mapirops_pull_utf16_string(struct mapirops_pull *pull, TA
  */
 enum mapirops_err_code mapirops_push_GUID(struct mapirops_push *push, const GUID *guid)
 {
+	MAPIROPS_PROBE3(push, "GUID", push->offset, 16);
 	MAPIROPS_CHECK(mapirops_push_uint32(push, guid->Data1));
 	MAPIROPS_CHECK(mapirops_push_uint16(push, guid->Data2));
 	MAPIROPS_CHECK(mapirops_push_uint16(push, guid->Data3));
@@ -906,6 +1161,7 @@ enum mapirops_err_code mapirops_push_GUID(struct mapirops_push *push, const GUID
  */
 enum mapirops_err_code mapirops_pull_GUID(struct mapirops_pull *pull, GUID *guid)
 {
+	MAPIROPS_PROBE3(pull, "GUID", pull->offset, 16);
 	MAPIROPS_CHECK(mapirops_pull_uint32(pull, &guid->Data1));
 	MAPIROPS_CHECK(mapirops_pull_uint16(pull, &guid->Data2));
 	MAPIROPS_CHECK(mapirops_pull_uint16(pull, &guid->Data3));
@@ -925,6 +1181,7 @@ enum mapirops_err_code mapirops_pull_GUID(struct mapirops_pull *pull, GUID *guid
  */
 enum mapirops_err_code mapirops_push_enum_MAPISTATUS(struct mapirops_push *push, enum MAPISTATUS r)
 {
+	MAPIROPS_PROBE3(push, "MAPISTATUS", push->offset, 4);
 	MAPIROPS_CHECK(mapirops_push_uint32(push, r));
 	return MAPIROPS_ERR_SUCCESS;		       
 }
@@ -940,6 +1197,79 @@ enum mapirops_err_code mapirops_push_enum_MAPISTATUS(struct mapirops_push *push,
  */
 enum mapirops_err_code mapirops_pull_enum_MAPISTATUS(struct mapirops_pull *pull, enum MAPISTATUS *r)
 {
+	MAPIROPS_PROBE3(pull, "MAPISTATUS", pull->offset, 4);
 	MAPIROPS_CHECK(mapirops_pull_uint32(pull, r));
 	return MAPIROPS_ERR_SUCCESS;
 }
+
+
+/**
+   \details Copy the byte template of a structure into the push buffer
+
+   The template holds the fixed-size prefix of a structure with its
+   constant fields already encoded. Space for the whole prefix is
+   reserved once, and the caller fills the variable slots at base +
+   slot offset before moving the push offset past the prefix.
+
+   \param push Pointer to the mapirops_push structure
+   \param tmpl Pointer to the structure template
+   \param base Pointer on the returned offset of the template in the
+   push buffer
+
+   \note push->offset is left unchanged
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_push_template(struct mapirops_push *push,
+					      const struct mapirops_template *tmpl,
+					      uint32_t *base)
+{
+	MAPIROPS_PROBE3(push, "template", push->offset, tmpl->size);
+	MAPIROPS_PUSH_NEED_BYTES(push, tmpl->size);
+	memcpy(push->data.data + push->offset, tmpl->data, tmpl->size);
+	*base = push->offset;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+
+/**
+   \details Check the pull buffer against the byte template of a
+   structure
+
+   Bounds are checked once for the whole fixed-size prefix and each
+   run of constant fields is compared with the template. The caller
+   reads the variable slots at base + slot offset.
+
+   \param pull Pointer to the mapirops_pull structure
+   \param tmpl Pointer to the structure template
+   \param base Pointer on the returned offset of the template in the
+   pull buffer
+
+   \note pull->offset is left unchanged
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_INVALID_VAL
+   if a constant field does not match, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_pull_template(struct mapirops_pull *pull,
+					      const struct mapirops_template *tmpl,
+					      uint32_t *base)
+{
+	const uint8_t	*data;
+	uint32_t	i;
+
+	MAPIROPS_PROBE3(pull, "template", pull->offset, tmpl->size);
+	MAPIROPS_PULL_NEED_BYTES(pull, tmpl->size);
+
+	data = pull->data.data + pull->offset;
+	for (i = 0; i < tmpl->const_count; i++) {
+		if (memcmp(data + tmpl->consts[i].offset,
+			   tmpl->data + tmpl->consts[i].offset,
+			   tmpl->consts[i].size)) {
+			return MAPIROPS_ERR_INVALID_VAL;
+		}
+	}
+	*base = pull->offset;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
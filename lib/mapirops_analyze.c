@@ -0,0 +1,419 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_analyze.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Offline analysis of ROP capture files
+
+   The capture files are mapped and their records indexed, then split
+   in chunks of consecutive records. Each worker thread owns a range of
+   chunks and steals half of the remaining range of another worker once
+   its own is exhausted. The ROPs of every record are decoded with the
+   generated pull functions, found by RopId, into per-thread statistics
+   merged once all workers are done.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+/** \cond */
+#define	MAPIROPS_ANALYZE_CHUNK	256	/* Records per chunk */
+
+struct mapirops_analyze_worker {
+	struct mapirops_analyze		*analyze;
+	uint32_t			index;
+	pthread_t			thread;
+	uint8_t				started;
+	pthread_mutex_t			lock;		/* Protects head and tail */
+	uint32_t			head;		/* Next chunk to decode */
+	uint32_t			tail;		/* End of the chunk range */
+	struct mapirops_analyze_stats	*stats;
+};
+
+struct mapirops_analyze {
+	uint32_t			flags;
+	struct mapirops_capture_record	*records;
+	uint32_t			count;
+	uint32_t			chunks;
+	size_t				rop_size;	/* Largest ROP structure */
+	struct mapirops_analyze_worker	*workers;
+	uint32_t			worker_count;
+};
+/** \endcond */
+
+static uint32_t mapirops_analyze_bucket(uint32_t size)
+{
+	uint32_t	bucket = 0;
+
+	while (bucket < MAPIROPS_ANALYZE_SIZE_BUCKETS - 1 && size > (1U << bucket)) {
+		bucket++;
+	}
+
+	return bucket;
+}
+
+/*
+   Take the next chunk of the worker, or steal half of the chunks left
+   to another worker
+ */
+static int mapirops_analyze_next_chunk(struct mapirops_analyze_worker *worker, uint32_t *chunk)
+{
+	struct mapirops_analyze		*analyze = worker->analyze;
+	struct mapirops_analyze_worker	*victim;
+	uint32_t			head;
+	uint32_t			tail;
+	uint32_t			i;
+
+	pthread_mutex_lock(&worker->lock);
+	if (worker->head < worker->tail) {
+		*chunk = worker->head++;
+		pthread_mutex_unlock(&worker->lock);
+		return 1;
+	}
+	pthread_mutex_unlock(&worker->lock);
+
+	for (i = 1; i < analyze->worker_count; i++) {
+		victim = &analyze->workers[(worker->index + i) % analyze->worker_count];
+		pthread_mutex_lock(&victim->lock);
+		head = victim->head;
+		tail = victim->tail;
+		if (head < tail) {
+			/* Thieves take the end of the range, the owner the start */
+			head = tail - (tail - head + 1) / 2;
+			victim->tail = head;
+		}
+		pthread_mutex_unlock(&victim->lock);
+		if (head < tail) {
+			pthread_mutex_lock(&worker->lock);
+			worker->head = head + 1;
+			worker->tail = tail;
+			pthread_mutex_unlock(&worker->lock);
+			worker->stats->steals++;
+			*chunk = head;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/*
+   Decode the ROPs of a record, up to the first one which can't be
+   decoded
+ */
+static void mapirops_analyze_record(struct mapirops_analyze_worker *worker, struct mapirops_pull *pull,
+				    void *rop, const struct mapirops_capture_record *record)
+{
+	struct mapirops_analyze			*analyze = worker->analyze;
+	struct mapirops_analyze_stats		*stats = worker->stats;
+	struct mapirops_analyze_rop_stats	*rs;
+	const struct mapirops_rop_dispatch	*dispatch;
+	struct mapirops_ropbuf			ropbuf;
+	enum mapirops_err_code			retval;
+	uint64_t				start = 0;
+	uint32_t				offset;
+	uint32_t				size;
+	uint8_t					RopId;
+	int					client;
+	int					dir;
+
+	client = (analyze->flags & MAPIROPS_ANALYZE_CLIENT) != 0;
+	dir = ((record->direction == MAPIROPS_CAPTURE_PULL) == !client) ? MAPIROPS_ANALYZE_REQUEST : MAPIROPS_ANALYZE_RESPONSE;
+	stats->records++;
+	stats->bytes += record->length;
+
+	pull->data.data = (uint8_t *) record->data;
+	pull->data.length = record->length;
+	pull->offset = 0;
+	if (mapirops_ropbuf_pull(pull, &ropbuf) != MAPIROPS_ERR_SUCCESS) {
+		stats->invalid++;
+		return;
+	}
+
+	pull->data = ropbuf.rops;
+	pull->offset = 0;
+	while (pull->offset < pull->data.length) {
+		RopId = pull->data.data[pull->offset];
+		dispatch = mapirops_rop_dispatch_get(RopId);
+		if (dispatch == NULL) {
+			stats->unknown[dir][RopId]++;
+			break;
+		}
+
+		offset = pull->offset;
+		if (analyze->flags & MAPIROPS_ANALYZE_TIMING) {
+			start = mapirops_timing_start();
+		}
+		if (dir == MAPIROPS_ANALYZE_REQUEST) {
+			retval = dispatch->pull_request(pull, rop);
+		} else {
+			retval = dispatch->pull_response(pull, rop);
+		}
+		rs = &stats->rops[dir][RopId];
+		if (analyze->flags & MAPIROPS_ANALYZE_TIMING) {
+			rs->ns += mapirops_timing_start() - start;
+		}
+		rs->count++;
+		if (retval != MAPIROPS_ERR_SUCCESS) {
+			rs->errors++;
+			break;
+		}
+		size = pull->offset - offset;
+		rs->bytes += size;
+		rs->sizes[mapirops_analyze_bucket(size)]++;
+	}
+	talloc_free_children(pull->mem_ctx);
+}
+
+static void *mapirops_analyze_worker(void *data)
+{
+	struct mapirops_analyze_worker	*worker = (struct mapirops_analyze_worker *) data;
+	struct mapirops_analyze		*analyze = worker->analyze;
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_pull		*pull;
+	void				*rop;
+	uint32_t			chunk;
+	uint32_t			i;
+	uint32_t			end;
+
+	/* Own hierarchy: talloc is not shared between threads */
+	mem_ctx = talloc_named(NULL, 0, "mapirops_analyze_worker");
+	if (mem_ctx == NULL) {
+		return NULL;
+	}
+	pull = mapirops_pull_init(mem_ctx);
+	rop = talloc_size(mem_ctx, analyze->rop_size);
+	if (pull == NULL || rop == NULL) {
+		talloc_free(mem_ctx);
+		return NULL;
+	}
+	pull->mem_ctx = talloc_named(mem_ctx, 0, "mapirops_analyze_rop");
+
+	while (mapirops_analyze_next_chunk(worker, &chunk)) {
+		end = MIN((chunk + 1) * MAPIROPS_ANALYZE_CHUNK, analyze->count);
+		for (i = chunk * MAPIROPS_ANALYZE_CHUNK; i < end; i++) {
+			mapirops_analyze_record(worker, pull, rop, &analyze->records[i]);
+		}
+	}
+
+	talloc_free(mem_ctx);
+
+	return NULL;
+}
+
+static void mapirops_analyze_merge(struct mapirops_analyze_stats *total,
+				   const struct mapirops_analyze_stats *stats)
+{
+	const struct mapirops_analyze_rop_stats	*src;
+	struct mapirops_analyze_rop_stats	*dst;
+	uint32_t				dir;
+	uint32_t				i;
+	uint32_t				j;
+
+	for (dir = 0; dir < 2; dir++) {
+		for (i = 0; i < 256; i++) {
+			src = &stats->rops[dir][i];
+			dst = &total->rops[dir][i];
+			dst->count += src->count;
+			dst->errors += src->errors;
+			dst->bytes += src->bytes;
+			dst->ns += src->ns;
+			for (j = 0; j < MAPIROPS_ANALYZE_SIZE_BUCKETS; j++) {
+				dst->sizes[j] += src->sizes[j];
+			}
+			total->unknown[dir][i] += stats->unknown[dir][i];
+		}
+	}
+	total->records += stats->records;
+	total->bytes += stats->bytes;
+	total->invalid += stats->invalid;
+	total->steals += stats->steals;
+}
+
+/**
+   \details Initialize a capture analyzer
+
+   \param mem_ctx Pointer to the memory context
+   \param flags MAPIROPS_ANALYZE_CLIENT if the captures were recorded
+   on the client side, MAPIROPS_ANALYZE_TIMING to measure the decoding
+   time of each ROP
+
+   \return Allocated analyzer on success, otherwise NULL
+ */
+struct mapirops_analyze *mapirops_analyze_init(TALLOC_CTX *mem_ctx, uint32_t flags)
+{
+	struct mapirops_analyze			*analyze;
+	const struct mapirops_rop_dispatch	*dispatch;
+	uint32_t				i;
+
+	analyze = talloc_zero(mem_ctx, struct mapirops_analyze);
+	if (analyze == NULL) {
+		return NULL;
+	}
+	analyze->flags = flags;
+
+	for (i = 0; i < 256; i++) {
+		dispatch = mapirops_rop_dispatch_get(i);
+		if (dispatch) {
+			analyze->rop_size = MAX(analyze->rop_size, MAX(dispatch->request_size, dispatch->response_size));
+		}
+	}
+
+	return analyze;
+}
+
+/**
+   \details Index the records of a capture file
+
+   The file remains mapped until the analyzer is freed. A truncated
+   last record is logged and ignored.
+
+   \param analyze Pointer to the analyzer
+   \param path Path of the capture file
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_INVALID_VAL if
+   path is not a capture file, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_analyze_add(struct mapirops_analyze *analyze, const char *path)
+{
+	struct mapirops_capture_reader	*reader;
+	struct mapirops_capture_record	record;
+	struct mapirops_capture_record	*records;
+	enum mapirops_err_code		retval;
+	uint32_t			allocated;
+
+	if (!analyze || !path) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	reader = mapirops_capture_reader_init(analyze, path);
+	if (reader == NULL) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	allocated = talloc_array_length(analyze->records);
+	while ((retval = mapirops_capture_reader_next(reader, &record)) == MAPIROPS_ERR_SUCCESS) {
+		if (analyze->count == allocated) {
+			allocated = allocated ? allocated * 2 : 65536;
+			records = talloc_realloc(analyze, analyze->records, struct mapirops_capture_record, allocated);
+			if (records == NULL) {
+				return MAPIROPS_ERR_NO_MEMORY;
+			}
+			analyze->records = records;
+		}
+		analyze->records[analyze->count++] = record;
+	}
+	if (retval != MAPIROPS_ERR_NOT_FOUND) {
+		mapirops_error(retval, LOG_WARNING, "%s: ignoring truncated record", path);
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Decode every indexed record and return the merged
+   statistics
+
+   \param analyze Pointer to the analyzer
+   \param threads Number of decoding threads, 0 for one per online CPU
+   \param total Pointer to the statistics to return
+   \param workers Pointer on the returned number of threads used, may
+   be NULL
+
+   \note The calling thread decodes the chunks of any worker which
+   failed to start.
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_analyze_run(struct mapirops_analyze *analyze, uint32_t threads,
+					    struct mapirops_analyze_stats *total, uint32_t *workers)
+{
+	struct mapirops_analyze_worker	*worker;
+	long				cpus;
+	uint32_t			per;
+	uint32_t			i;
+
+	if (!analyze || !total) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	if (threads == 0) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = (cpus > 0) ? cpus : 1;
+	}
+	analyze->chunks = (analyze->count + MAPIROPS_ANALYZE_CHUNK - 1) / MAPIROPS_ANALYZE_CHUNK;
+	analyze->worker_count = MIN(threads, MAX(analyze->chunks, 1));
+	analyze->workers = talloc_zero_array(analyze, struct mapirops_analyze_worker, analyze->worker_count);
+	if (analyze->workers == NULL) {
+		return MAPIROPS_ERR_NO_MEMORY;
+	}
+
+	/* Contiguous ranges of chunks, balanced by stealing */
+	per = analyze->chunks / analyze->worker_count;
+	for (i = 0; i < analyze->worker_count; i++) {
+		worker = &analyze->workers[i];
+		worker->analyze = analyze;
+		worker->index = i;
+		worker->head = i * per;
+		worker->tail = (i == analyze->worker_count - 1) ? analyze->chunks : (i + 1) * per;
+		worker->stats = talloc_zero(analyze->workers, struct mapirops_analyze_stats);
+		if (worker->stats == NULL) {
+			talloc_free(analyze->workers);
+			analyze->workers = NULL;
+			return MAPIROPS_ERR_NO_MEMORY;
+		}
+	}
+	for (i = 0; i < analyze->worker_count; i++) {
+		pthread_mutex_init(&analyze->workers[i].lock, NULL);
+	}
+
+	for (i = 0; i < analyze->worker_count; i++) {
+		worker = &analyze->workers[i];
+		worker->started = (pthread_create(&worker->thread, NULL, mapirops_analyze_worker, worker) == 0);
+	}
+
+	/* Chunks of a worker which failed to start are stolen by the others */
+	memset(total, 0, sizeof (struct mapirops_analyze_stats));
+	for (i = 0; i < analyze->worker_count; i++) {
+		worker = &analyze->workers[i];
+		if (worker->started) {
+			pthread_join(worker->thread, NULL);
+		} else {
+			mapirops_analyze_worker(worker);
+		}
+	}
+	for (i = 0; i < analyze->worker_count; i++) {
+		mapirops_analyze_merge(total, analyze->workers[i].stats);
+		pthread_mutex_destroy(&analyze->workers[i].lock);
+	}
+	if (workers) {
+		*workers = analyze->worker_count;
+	}
+	talloc_free(analyze->workers);
+	analyze->workers = NULL;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
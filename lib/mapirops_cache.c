@@ -0,0 +1,492 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_cache.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Cache of encoded MAPI rops responses
+
+   Some responses such as public folders RopLogon are identical for
+   large groups of users except for a few per-request fields
+   (OutputHandleIndex for example). The cache stores the encoded bytes
+   of such responses under a caller defined key together with the
+   offsets of these fields, so a cache hit only copies the bytes and
+   patches the fields instead of encoding the response again.
+
+   The memory used by the cache is bounded: least recently used
+   entries are evicted when a new entry would exceed the limit.
+
+   \note A cache is not thread-safe and should either be used by a
+   single thread or protected by the caller.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+/** \def MAPIROPS_CACHE_MIN_BUCKETS
+    Initial number of buckets in the cache hash table
+*/
+#define	MAPIROPS_CACHE_MIN_BUCKETS	64
+
+/** \cond */
+
+struct mapirops_cache_entry {
+	struct mapirops_cache_entry	*hnext;		/* hash bucket chain */
+	struct mapirops_cache_entry	*prev;		/* LRU list, towards most recent */
+	struct mapirops_cache_entry	*next;		/* LRU list, towards least recent */
+	uint64_t			hash;
+	size_t				size;		/* accounted size of the entry */
+	uint32_t			key_length;
+	uint32_t			data_length;
+	uint32_t			patch_count;
+	struct mapirops_cache_patch	*patches;
+	uint8_t				*key;
+	uint8_t				*data;
+};
+
+struct mapirops_cache {
+	struct mapirops_cache_entry	**buckets;
+	uint32_t			bucket_count;
+	struct mapirops_cache_entry	*head;		/* most recently used */
+	struct mapirops_cache_entry	*tail;		/* least recently used */
+	size_t				max_size;
+	struct mapirops_cache_stats	stats;
+};
+
+/** \endcond */
+
+/**
+   \details Compute the FNV-1a hash of a cache key
+
+   \param key Pointer to the key to hash
+
+   \return 64 bits hash value
+ */
+static uint64_t mapirops_cache_hash(const struct mapibuf *key)
+{
+	uint64_t	hash = 0xcbf29ce484222325ULL;
+	size_t		i;
+
+	for (i = 0; i < key->length; i++) {
+		hash ^= key->data[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+/**
+   \details Unlink an entry from the LRU list
+
+   \param cache Pointer to the mapirops_cache structure
+   \param entry Pointer to the entry to unlink
+ */
+static void mapirops_cache_lru_unlink(struct mapirops_cache *cache,
+				      struct mapirops_cache_entry *entry)
+{
+	if (entry->prev) {
+		entry->prev->next = entry->next;
+	} else {
+		cache->head = entry->next;
+	}
+
+	if (entry->next) {
+		entry->next->prev = entry->prev;
+	} else {
+		cache->tail = entry->prev;
+	}
+
+	entry->prev = NULL;
+	entry->next = NULL;
+}
+
+/**
+   \details Insert an entry at the head (most recently used) of the
+   LRU list
+
+   \param cache Pointer to the mapirops_cache structure
+   \param entry Pointer to the entry to insert
+ */
+static void mapirops_cache_lru_insert(struct mapirops_cache *cache,
+				      struct mapirops_cache_entry *entry)
+{
+	entry->prev = NULL;
+	entry->next = cache->head;
+	if (cache->head) {
+		cache->head->prev = entry;
+	}
+	cache->head = entry;
+	if (cache->tail == NULL) {
+		cache->tail = entry;
+	}
+}
+
+/**
+   \details Find the bucket slot pointing to the entry matching key
+
+   \param cache Pointer to the mapirops_cache structure
+   \param key Pointer to the key to look up
+   \param hash Hash value of key
+
+   \return Pointer to the slot referencing the entry, or to the
+   terminating NULL slot of the bucket chain if not found
+ */
+static struct mapirops_cache_entry **mapirops_cache_find(struct mapirops_cache *cache,
+							 const struct mapibuf *key,
+							 uint64_t hash)
+{
+	struct mapirops_cache_entry	**slot;
+
+	slot = &cache->buckets[hash & (cache->bucket_count - 1)];
+	while (*slot) {
+		if ((*slot)->hash == hash && (*slot)->key_length == key->length &&
+		    memcmp((*slot)->key, key->data, key->length) == 0) {
+			return slot;
+		}
+		slot = &(*slot)->hnext;
+	}
+
+	return slot;
+}
+
+/**
+   \details Remove an entry from the cache and release its memory
+
+   \param cache Pointer to the mapirops_cache structure
+   \param slot Pointer to the bucket slot referencing the entry
+ */
+static void mapirops_cache_delete(struct mapirops_cache *cache,
+				  struct mapirops_cache_entry **slot)
+{
+	struct mapirops_cache_entry	*entry = *slot;
+
+	*slot = entry->hnext;
+	mapirops_cache_lru_unlink(cache, entry);
+	cache->stats.size -= entry->size;
+	cache->stats.count -= 1;
+	talloc_free(entry);
+}
+
+/**
+   \details Evict least recently used entries until size extra bytes
+   fit within the cache limit
+
+   \param cache Pointer to the mapirops_cache structure
+   \param size Number of bytes to make room for
+ */
+static void mapirops_cache_evict(struct mapirops_cache *cache, size_t size)
+{
+	struct mapirops_cache_entry	*entry;
+	struct mapirops_cache_entry	**slot;
+	struct mapibuf			key;
+
+	while (cache->tail && (cache->stats.size + size > cache->max_size)) {
+		entry = cache->tail;
+		key.data = entry->key;
+		key.length = entry->key_length;
+		slot = mapirops_cache_find(cache, &key, entry->hash);
+		mapirops_cache_delete(cache, slot);
+		cache->stats.evictions += 1;
+	}
+}
+
+/**
+   \details Double the number of buckets of the cache hash table
+
+   \param cache Pointer to the mapirops_cache structure
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+static enum mapirops_err_code mapirops_cache_grow(struct mapirops_cache *cache)
+{
+	struct mapirops_cache_entry	**buckets;
+	struct mapirops_cache_entry	*entry;
+	struct mapirops_cache_entry	*next;
+	uint32_t			count = cache->bucket_count * 2;
+	uint32_t			i;
+
+	buckets = talloc_zero_array(cache, struct mapirops_cache_entry *, count);
+	if (buckets == NULL) {
+		return mapirops_error(MAPIROPS_ERR_ALLOC, LOG_ERR,
+				      "Failed to grow cache to %u buckets", count);
+	}
+
+	for (i = 0; i < cache->bucket_count; i++) {
+		for (entry = cache->buckets[i]; entry; entry = next) {
+			next = entry->hnext;
+			entry->hnext = buckets[entry->hash & (count - 1)];
+			buckets[entry->hash & (count - 1)] = entry;
+		}
+	}
+
+	talloc_free(cache->buckets);
+	cache->buckets = buckets;
+	cache->bucket_count = count;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Initialize a mapirops_cache
+
+   \param mem_ctx Pointer to the TALLOC memory context to use
+   \param max_size Maximum number of bytes the cache entries can use
+
+   \return Allocated mapirops_cache structure on success, otherwise
+   NULL.
+ */
+struct mapirops_cache *mapirops_cache_init(TALLOC_CTX *mem_ctx, size_t max_size)
+{
+	struct mapirops_cache	*cache;
+
+	cache = talloc_zero(mem_ctx, struct mapirops_cache);
+	if (cache == NULL) {
+		return NULL;
+	}
+
+	cache->bucket_count = MAPIROPS_CACHE_MIN_BUCKETS;
+	cache->buckets = talloc_zero_array(cache, struct mapirops_cache_entry *,
+					   cache->bucket_count);
+	if (cache->buckets == NULL) {
+		talloc_free(cache);
+		return NULL;
+	}
+	cache->max_size = max_size;
+
+	return cache;
+}
+
+/**
+   \details Store the encoded bytes of a response in the cache
+
+   If an entry already exists for key, it is replaced. Least recently
+   used entries are evicted if the new entry does not fit.
+
+   \param cache Pointer to the mapirops_cache structure
+   \param key Pointer to the caller defined key
+   \param data Pointer to the encoded response
+   \param patches Array of per-request fields to patch on lookup
+   \param patch_count Number of elements in patches
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_INVALID_VAL
+   if a patch lies outside data, MAPIROPS_ERR_BUFSIZE if the entry is
+   larger than the cache, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_cache_store(struct mapirops_cache *cache,
+					    const struct mapibuf *key,
+					    const struct mapibuf *data,
+					    const struct mapirops_cache_patch *patches,
+					    uint32_t patch_count)
+{
+	struct mapirops_cache_entry	*entry;
+	struct mapirops_cache_entry	**slot;
+	uint64_t			hash;
+	size_t				size;
+	uint32_t			i;
+
+	if (!cache || !key || !data || (patch_count && !patches)) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	for (i = 0; i < patch_count; i++) {
+		switch (patches[i].size) {
+		case 1:
+		case 2:
+		case 4:
+		case 8:
+			break;
+		default:
+			return MAPIROPS_ERR_INVALID_VAL;
+		}
+		if ((patches[i].offset > data->length) ||
+		    (patches[i].size > data->length - patches[i].offset)) {
+			return MAPIROPS_ERR_INVALID_VAL;
+		}
+	}
+
+	size = sizeof (struct mapirops_cache_entry) + key->length + data->length +
+		patch_count * sizeof (struct mapirops_cache_patch);
+	if (size > cache->max_size) {
+		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_WARNING,
+				      "Cache entry of %zu bytes exceeds cache size", size);
+	}
+
+	hash = mapirops_cache_hash(key);
+	slot = mapirops_cache_find(cache, key, hash);
+	if (*slot) {
+		mapirops_cache_delete(cache, slot);
+	}
+	mapirops_cache_evict(cache, size);
+
+	if (cache->stats.count >= cache->bucket_count) {
+		MAPIROPS_CHECK(mapirops_cache_grow(cache));
+	}
+
+	/* Entry, patches, key and data share a single allocation */
+	entry = (struct mapirops_cache_entry *) talloc_size(cache, size);
+	if (entry == NULL) {
+		return mapirops_error(MAPIROPS_ERR_ALLOC, LOG_ERR,
+				      "Failed to allocate cache entry of %zu bytes", size);
+	}
+	memset(entry, 0, sizeof (struct mapirops_cache_entry));
+	entry->hash = hash;
+	entry->size = size;
+	entry->key_length = key->length;
+	entry->data_length = data->length;
+	entry->patch_count = patch_count;
+	entry->patches = (struct mapirops_cache_patch *)(entry + 1);
+	entry->key = (uint8_t *)(entry->patches + patch_count);
+	entry->data = entry->key + key->length;
+	if (patch_count) {
+		memcpy(entry->patches, patches, patch_count * sizeof (struct mapirops_cache_patch));
+	}
+	memcpy(entry->key, key->data, key->length);
+	memcpy(entry->data, data->data, data->length);
+
+	slot = &cache->buckets[hash & (cache->bucket_count - 1)];
+	entry->hnext = *slot;
+	*slot = entry;
+	mapirops_cache_lru_insert(cache, entry);
+
+	cache->stats.size += size;
+	cache->stats.count += 1;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Push a cached response and patch its per-request fields
+
+   The values are written little-endian at the offsets registered with
+   mapirops_cache_store(), in the same order.
+
+   \param cache Pointer to the mapirops_cache structure
+   \param push Pointer to the mapirops_push structure
+   \param key Pointer to the caller defined key
+   \param values Array of values for the per-request fields
+   \param value_count Number of elements in values
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_NOT_FOUND if
+   no entry exists for key, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_cache_push(struct mapirops_cache *cache,
+					   struct mapirops_push *push,
+					   const struct mapibuf *key,
+					   const uint64_t *values,
+					   uint32_t value_count)
+{
+	struct mapirops_cache_entry	*entry;
+	uint32_t			base;
+	uint32_t			offset;
+	uint32_t			i;
+
+	if (!cache || !push || !key || (value_count && !values)) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	entry = *mapirops_cache_find(cache, key, mapirops_cache_hash(key));
+	if (entry == NULL) {
+		cache->stats.misses += 1;
+		return MAPIROPS_ERR_NOT_FOUND;
+	}
+
+	if (value_count != entry->patch_count) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	base = push->offset;
+	MAPIROPS_CHECK(mapirops_push_bytes(push, entry->data, entry->data_length));
+
+	for (i = 0; i < entry->patch_count; i++) {
+		offset = base + entry->patches[i].offset;
+		switch (entry->patches[i].size) {
+		case 1:
+			SCVAL(push->data.data, offset, (uint8_t)values[i]);
+			break;
+		case 2:
+			SSVAL(push->data.data, offset, (uint16_t)values[i]);
+			break;
+		case 4:
+			SIVAL(push->data.data, offset, (uint32_t)values[i]);
+			break;
+		case 8:
+			SIVAL(push->data.data, offset, (values[i] & 0xFFFFFFFF));
+			SIVAL(push->data.data, offset + 4, (values[i] >> 32));
+			break;
+		}
+	}
+
+	if (entry != cache->head) {
+		mapirops_cache_lru_unlink(cache, entry);
+		mapirops_cache_lru_insert(cache, entry);
+	}
+	cache->stats.hits += 1;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Remove an entry from the cache
+
+   \param cache Pointer to the mapirops_cache structure
+   \param key Pointer to the key of the entry to remove
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_NOT_FOUND if
+   no entry exists for key
+ */
+enum mapirops_err_code mapirops_cache_remove(struct mapirops_cache *cache,
+					     const struct mapibuf *key)
+{
+	struct mapirops_cache_entry	**slot;
+
+	if (!cache || !key) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	slot = mapirops_cache_find(cache, key, mapirops_cache_hash(key));
+	if (*slot == NULL) {
+		return MAPIROPS_ERR_NOT_FOUND;
+	}
+	mapirops_cache_delete(cache, slot);
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Retrieve usage statistics of the cache
+
+   \param cache Pointer to the mapirops_cache structure
+   \param stats Pointer to the mapirops_cache_stats structure to fill
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_cache_get_stats(struct mapirops_cache *cache,
+						struct mapirops_cache_stats *stats)
+{
+	if (!cache || !stats) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	*stats = cache->stats;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
@@ -0,0 +1,545 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_capture.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Recording and replay of ROP buffers
+
+   A capture file is append-only and little-endian. It starts with a
+   header:
+
+   - Magic (4 bytes): MAPIROPS_CAPTURE_MAGIC
+   - Version (2 bytes): MAPIROPS_CAPTURE_VERSION
+   - HeaderSize (2 bytes): MAPIROPS_CAPTURE_HEADER_SIZE
+   - Reserved (8 bytes): 0
+
+   followed by records made of:
+
+   - Length (4 bytes): size of the ROP buffer
+   - Timestamp (8 bytes): nanoseconds since the Epoch
+   - SessionId (4 bytes): session identifier of the push or pull context
+   - Direction (1 byte): enum mapirops_capture_direction
+   - RopBuffer (Length bytes): RopSize, RopsList and ServerObjectHandleTable
+
+   Each recording thread fills its own buffer without taking any lock
+   and appends it to the file once full. Appending takes the lock of
+   the capture until the whole buffer is written, so the buffers of
+   concurrent threads are never interleaved and records are never split,
+   even when a write is short and has to be resumed. The lock doesn't
+   extend to other processes: each process must record to its own file.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+/** \cond */
+struct mapirops_capture_buffer {
+	struct mapirops_thread		thread;
+	uint8_t				*data;
+	uint32_t			used;
+};
+
+struct mapirops_capture {
+	int				fd;
+	pthread_mutex_t			lock;		/* Held while appending to fd */
+	uint32_t			size;		/* Size of the per-thread buffers */
+	struct mapirops_threads		threads;
+};
+
+struct mapirops_capture_reader {
+	int		fd;
+	uint8_t		*data;
+	size_t		length;
+	size_t		offset;
+};
+/** \endcond */
+
+/*
+   Write all of data to the capture file
+ */
+static enum mapirops_err_code mapirops_capture_write(int fd, const struct iovec *iov, int count)
+{
+	struct iovec	vec[2];
+	ssize_t		ret;
+	int		i;
+
+	memcpy(vec, iov, count * sizeof (struct iovec));
+	i = 0;
+	while (i < count) {
+		ret = writev(fd, &vec[i], count - i);
+		if (ret < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return mapirops_error(MAPIROPS_GENERIC_ERR, LOG_ERR,
+					      "capture write failed: %s", strerror(errno));
+		}
+		for (; i < count && (size_t)ret >= vec[i].iov_len; i++) {
+			ret -= vec[i].iov_len;
+		}
+		if (i < count) {
+			vec[i].iov_base = (uint8_t *)vec[i].iov_base + ret;
+			vec[i].iov_len -= ret;
+		}
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/*
+   Append data to the capture file, without interleaving it with the
+   data of other threads
+ */
+static enum mapirops_err_code mapirops_capture_append(struct mapirops_capture *capture,
+						      const struct iovec *iov, int count)
+{
+	enum mapirops_err_code	retval;
+
+	pthread_mutex_lock(&capture->lock);
+	retval = mapirops_capture_write(capture->fd, iov, count);
+	pthread_mutex_unlock(&capture->lock);
+
+	return retval;
+}
+
+/*
+   Append the records of a thread buffer to the capture file
+ */
+static enum mapirops_err_code mapirops_capture_buffer_flush(struct mapirops_capture *capture,
+							    struct mapirops_capture_buffer *buffer)
+{
+	struct iovec	iov;
+
+	if (!buffer->used) {
+		return MAPIROPS_ERR_SUCCESS;
+	}
+
+	iov.iov_base = buffer->data;
+	iov.iov_len = buffer->used;
+	buffer->used = 0;
+
+	return mapirops_capture_append(capture, &iov, 1);
+}
+
+static enum mapirops_err_code mapirops_capture_buffer_attach(void *private_data, struct mapirops_thread *thread)
+{
+	struct mapirops_capture		*capture = (struct mapirops_capture *) private_data;
+	struct mapirops_capture_buffer	*buffer = (struct mapirops_capture_buffer *) thread;
+
+	buffer->data = talloc_array(buffer, uint8_t, capture->size);
+	if (buffer->data == NULL) {
+		return MAPIROPS_ERR_NO_MEMORY;
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/*
+   Flush the records of a thread which exits or of every thread when
+   the capture is freed
+ */
+static void mapirops_capture_buffer_release(void *private_data, struct mapirops_thread *thread)
+{
+	mapirops_capture_buffer_flush((struct mapirops_capture *) private_data,
+				      (struct mapirops_capture_buffer *) thread);
+}
+
+static int mapirops_capture_destructor(struct mapirops_capture *capture)
+{
+	mapirops_threads_free(&capture->threads);
+	pthread_mutex_destroy(&capture->lock);
+	close(capture->fd);
+
+	return 0;
+}
+
+/*
+   Write the header of an empty capture file or check the one of an
+   existing file
+ */
+static enum mapirops_err_code mapirops_capture_header(int fd, const char *path)
+{
+	struct stat	st;
+	struct iovec	iov;
+	uint8_t		header[MAPIROPS_CAPTURE_HEADER_SIZE];
+
+	if (fstat(fd, &st) == -1) {
+		return mapirops_error(MAPIROPS_GENERIC_ERR, LOG_ERR,
+				      "Failed to stat %s: %s", path, strerror(errno));
+	}
+
+	if (st.st_size == 0) {
+		memset(header, 0, sizeof (header));
+		SIVAL(header, 0, MAPIROPS_CAPTURE_MAGIC);
+		SSVAL(header, 4, MAPIROPS_CAPTURE_VERSION);
+		SSVAL(header, 6, MAPIROPS_CAPTURE_HEADER_SIZE);
+		iov.iov_base = header;
+		iov.iov_len = sizeof (header);
+		return mapirops_capture_write(fd, &iov, 1);
+	}
+
+	if (st.st_size < MAPIROPS_CAPTURE_HEADER_SIZE ||
+	    pread(fd, header, sizeof (header), 0) != sizeof (header) ||
+	    IVAL(header, 0) != MAPIROPS_CAPTURE_MAGIC ||
+	    SVAL(header, 4) != MAPIROPS_CAPTURE_VERSION) {
+		return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+				      "%s is not a capture file", path);
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Open a capture file for recording
+
+   Records are appended to the file if it already exists.
+
+   \param mem_ctx Pointer to the memory context
+   \param path Path of the capture file
+   \param size Size in bytes of the per-thread buffers, 0 for
+   MAPIROPS_CAPTURE_BUFFER
+
+   \return Allocated mapirops_capture structure on success, otherwise
+   NULL. Freeing it flushes the records of every thread, which must
+   have stopped recording.
+ */
+struct mapirops_capture *mapirops_capture_init(TALLOC_CTX *mem_ctx, const char *path, uint32_t size)
+{
+	struct mapirops_capture	*capture;
+	int			fd;
+
+	if (!path) {
+		return NULL;
+	}
+	if (!size) {
+		size = MAPIROPS_CAPTURE_BUFFER;
+	}
+	if (size < MAPIROPS_CAPTURE_RECORD_SIZE) {
+		size = MAPIROPS_CAPTURE_RECORD_SIZE;
+	}
+
+	capture = talloc_zero(mem_ctx, struct mapirops_capture);
+	if (capture == NULL) {
+		return NULL;
+	}
+
+	fd = open(path, O_RDWR|O_CREAT|O_APPEND|O_CLOEXEC, 0644);
+	if (fd == -1) {
+		mapirops_error(MAPIROPS_GENERIC_ERR, LOG_ERR,
+			       "Failed to open %s: %s", path, strerror(errno));
+		talloc_free(capture);
+		return NULL;
+	}
+	if (mapirops_capture_header(fd, path) != MAPIROPS_ERR_SUCCESS) {
+		close(fd);
+		talloc_free(capture);
+		return NULL;
+	}
+
+	pthread_mutex_init(&capture->lock, NULL);
+	if (mapirops_threads_init(&capture->threads, sizeof (struct mapirops_capture_buffer),
+				  "struct mapirops_capture_buffer", mapirops_capture_buffer_attach,
+				  mapirops_capture_buffer_release, capture) != MAPIROPS_ERR_SUCCESS) {
+		pthread_mutex_destroy(&capture->lock);
+		close(fd);
+		talloc_free(capture);
+		return NULL;
+	}
+	capture->fd = fd;
+	capture->size = size;
+	talloc_set_destructor(capture, mapirops_capture_destructor);
+
+	return capture;
+}
+
+/**
+   \details Record a ROP buffer
+
+   The record is added to the buffer of the calling thread, which is
+   appended to the file when full, when the thread exits or with
+   mapirops_capture_flush. ROP buffers larger than the thread buffer
+   are written at once.
+
+   \param capture Pointer to the mapirops_capture structure
+   \param direction One of enum mapirops_capture_direction
+   \param session Session identifier
+   \param data Pointer to the ROP buffer
+   \param length Size in bytes of data
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_capture_record(struct mapirops_capture *capture, uint8_t direction,
+					       uint32_t session, const uint8_t *data, uint32_t length)
+{
+	struct mapirops_capture_buffer	*buffer;
+	struct timespec			ts;
+	struct iovec			iov[2];
+	uint8_t				header[MAPIROPS_CAPTURE_RECORD_SIZE];
+	uint8_t				*p;
+	uint64_t			timestamp;
+
+	if (!capture || (length && !data)) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	buffer = (struct mapirops_capture_buffer *) mapirops_threads_get(&capture->threads);
+	if (buffer == NULL) {
+		return MAPIROPS_ERR_NO_MEMORY;
+	}
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	timestamp = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+	if (capture->size - buffer->used < MAPIROPS_CAPTURE_RECORD_SIZE + length) {
+		MAPIROPS_CHECK(mapirops_capture_buffer_flush(capture, buffer));
+	}
+
+	if (capture->size < MAPIROPS_CAPTURE_RECORD_SIZE + length) {
+		p = header;
+	} else {
+		p = buffer->data + buffer->used;
+	}
+
+	SIVAL(p, 0, length);
+	SIVAL(p, 4, timestamp & 0xFFFFFFFF);
+	SIVAL(p, 8, timestamp >> 32);
+	SIVAL(p, 12, session);
+	SCVAL(p, 16, direction);
+
+	if (p == header) {
+		iov[0].iov_base = header;
+		iov[0].iov_len = sizeof (header);
+		iov[1].iov_base = (void *)data;
+		iov[1].iov_len = length;
+		return mapirops_capture_append(capture, iov, 2);
+	}
+
+	if (length) {
+		memcpy(p + MAPIROPS_CAPTURE_RECORD_SIZE, data, length);
+	}
+	buffer->used += MAPIROPS_CAPTURE_RECORD_SIZE + length;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Append the records of the calling thread to the capture
+   file
+
+   \param capture Pointer to the mapirops_capture structure
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_capture_flush(struct mapirops_capture *capture)
+{
+	struct mapirops_capture_buffer	*buffer;
+
+	if (!capture) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	buffer = (struct mapirops_capture_buffer *) mapirops_threads_peek(&capture->threads);
+	if (buffer == NULL) {
+		return MAPIROPS_ERR_SUCCESS;
+	}
+
+	return mapirops_capture_buffer_flush(capture, buffer);
+}
+
+/**
+   \details Record the ROP buffers pushed with mapirops_ropbuf_push_end
+
+   \param push Pointer to the mapirops_push structure
+   \param capture Pointer to the mapirops_capture structure, NULL to
+   stop recording
+   \param session Session identifier stored with the records
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_push_set_capture(struct mapirops_push *push,
+						 struct mapirops_capture *capture, uint32_t session)
+{
+	if (!push) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	push->capture = capture;
+	push->session = session;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Record the ROP buffers pulled with mapirops_ropbuf_pull
+
+   \param pull Pointer to the mapirops_pull structure
+   \param capture Pointer to the mapirops_capture structure, NULL to
+   stop recording
+   \param session Session identifier stored with the records
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_pull_set_capture(struct mapirops_pull *pull,
+						 struct mapirops_capture *capture, uint32_t session)
+{
+	if (!pull) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	pull->capture = capture;
+	pull->session = session;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static int mapirops_capture_reader_destructor(struct mapirops_capture_reader *reader)
+{
+	munmap(reader->data, reader->length);
+	close(reader->fd);
+
+	return 0;
+}
+
+/**
+   \details Map a capture file for reading
+
+   Records appended after this call are not seen by the reader.
+
+   \param mem_ctx Pointer to the memory context
+   \param path Path of the capture file
+
+   \return Allocated mapirops_capture_reader structure on success,
+   otherwise NULL
+ */
+struct mapirops_capture_reader *mapirops_capture_reader_init(TALLOC_CTX *mem_ctx, const char *path)
+{
+	struct mapirops_capture_reader	*reader;
+	struct stat			st;
+	void				*data;
+	int				fd;
+
+	if (!path) {
+		return NULL;
+	}
+
+	fd = open(path, O_RDONLY|O_CLOEXEC);
+	if (fd == -1) {
+		mapirops_error(MAPIROPS_GENERIC_ERR, LOG_ERR,
+			       "Failed to open %s: %s", path, strerror(errno));
+		return NULL;
+	}
+	if (fstat(fd, &st) == -1 || st.st_size < MAPIROPS_CAPTURE_HEADER_SIZE) {
+		mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR, "%s is not a capture file", path);
+		close(fd);
+		return NULL;
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (data == MAP_FAILED) {
+		mapirops_error(MAPIROPS_GENERIC_ERR, LOG_ERR,
+			       "Failed to map %s: %s", path, strerror(errno));
+		close(fd);
+		return NULL;
+	}
+	madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+	if (IVAL(data, 0) != MAPIROPS_CAPTURE_MAGIC ||
+	    SVAL(data, 4) != MAPIROPS_CAPTURE_VERSION ||
+	    SVAL(data, 6) < MAPIROPS_CAPTURE_HEADER_SIZE ||
+	    SVAL(data, 6) > st.st_size) {
+		mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR, "%s is not a capture file", path);
+		munmap(data, st.st_size);
+		close(fd);
+		return NULL;
+	}
+
+	reader = talloc_zero(mem_ctx, struct mapirops_capture_reader);
+	if (reader == NULL) {
+		munmap(data, st.st_size);
+		close(fd);
+		return NULL;
+	}
+	reader->fd = fd;
+	reader->data = (uint8_t *) data;
+	reader->length = st.st_size;
+	reader->offset = SVAL(data, 6);
+	talloc_set_destructor(reader, mapirops_capture_reader_destructor);
+
+	return reader;
+}
+
+/**
+   \details Read the next record of a capture file
+
+   Nothing is copied: record->data points into the mapped file.
+
+   \param reader Pointer to the mapirops_capture_reader structure
+   \param record Pointer to the record to fill
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_NOT_FOUND
+   after the last record, MAPIROPS_ERR_BUFSIZE if the last record is
+   truncated, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_capture_reader_next(struct mapirops_capture_reader *reader,
+						    struct mapirops_capture_record *record)
+{
+	const uint8_t	*p;
+	uint32_t	length;
+
+	if (!reader || !record) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	if (reader->offset == reader->length) {
+		return MAPIROPS_ERR_NOT_FOUND;
+	}
+	if (reader->length - reader->offset < MAPIROPS_CAPTURE_RECORD_SIZE) {
+		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+				      "Truncated capture record at offset %zu", reader->offset);
+	}
+
+	p = reader->data + reader->offset;
+	length = IVAL(p, 0);
+	if (length > reader->length - reader->offset - MAPIROPS_CAPTURE_RECORD_SIZE) {
+		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+				      "Truncated capture record at offset %zu", reader->offset);
+	}
+
+	record->length = length;
+	record->timestamp = IVAL(p, 4);
+	record->timestamp |= (uint64_t)(IVAL(p, 8)) << 32;
+	record->session = IVAL(p, 12);
+	record->direction = CVAL(p, 16);
+	record->data = p + MAPIROPS_CAPTURE_RECORD_SIZE;
+	reader->offset += MAPIROPS_CAPTURE_RECORD_SIZE + length;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
@@ -0,0 +1,535 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_codepage.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Codepages of 8-bit strings
+
+   8-bit strings (ascii_string fields and PT_STRING8 values) are
+   encoded in the codepage of the client session. Codepages are kept
+   in a process-wide registry and set up once, the first time a
+   session uses them.
+
+   Single-byte codepages are converted with two precomputed tables: the
+   UTF-8 form of every byte, and the byte of every mapped Unicode
+   character (one 256-byte page per block of the BMP in use). Converting
+   a character is a table lookup. Other codepages (cp932, cp936, ...)
+   share one iconv descriptor per direction, serialized by a mutex.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+#include <errno.h>
+#include <pthread.h>
+
+/** \cond */
+#define	MAPIROPS_CODEPAGE_UNMAPPED	0xFFFF
+
+struct mapirops_codepage {
+	struct mapirops_codepage	*next;		/* Next codepage of the registry */
+	uint32_t			cpid;
+	uint8_t				utf8;		/* UTF-8 (65001), no conversion */
+	uint8_t				single_byte;
+	/* Single-byte codepages */
+	uint16_t			to_ucs[256];	/* MAPIROPS_CODEPAGE_UNMAPPED if unmapped */
+	uint8_t				to_utf8[256][4];	/* UTF-8 form, length in [3] */
+	uint8_t				*from_ucs[256];	/* Byte of each BMP character, by block */
+	/* Other codepages */
+	pthread_mutex_t			lock;
+	iconv_t				to_utf8_cd;
+	iconv_t				from_utf8_cd;
+};
+
+static pthread_mutex_t			mapirops_codepages_lock = PTHREAD_MUTEX_INITIALIZER;
+static TALLOC_CTX			*mapirops_codepages_ctx = NULL;
+static struct mapirops_codepage		*mapirops_codepages = NULL;
+
+static const struct {
+	uint32_t	cpid;
+	const char	*charset;
+} mapirops_codepage_charsets[] = {
+	{ 20127,	"ASCII" },
+	{ 20866,	"KOI8-R" },
+	{ 21866,	"KOI8-U" },
+	{ 20932,	"EUC-JP" },
+	{ 51932,	"EUC-JP" },
+	{ 51949,	"EUC-KR" },
+	{ 50220,	"ISO-2022-JP" },
+	{ 54936,	"GB18030" },
+	{ 10000,	"MACINTOSH" },
+	{ 0,		NULL }
+};
+/** \endcond */
+
+/*
+   Fill buf with the iconv name of a codepage
+ */
+static void mapirops_codepage_charset(uint32_t cpid, char *buf, size_t size)
+{
+	uint32_t	i;
+
+	for (i = 0; mapirops_codepage_charsets[i].charset; i++) {
+		if (mapirops_codepage_charsets[i].cpid == cpid) {
+			snprintf(buf, size, "%s", mapirops_codepage_charsets[i].charset);
+			return;
+		}
+	}
+
+	if (cpid >= 28591 && cpid <= 28605) {
+		snprintf(buf, size, "ISO-8859-%u", cpid - 28590);
+	} else if (cpid < 1000) {
+		/* OEM and EBCDIC codepages */
+		snprintf(buf, size, "%s%u", (cpid == 37 || cpid == 500 || cpid == 875) ? "IBM" : "CP", cpid);
+	} else {
+		snprintf(buf, size, "CP%u", cpid);
+	}
+}
+
+/*
+   Store the UTF-8 form of a BMP character
+ */
+static void mapirops_codepage_utf8_char(uint16_t ucs, uint8_t *utf8)
+{
+	if (ucs < 0x80) {
+		utf8[0] = ucs;
+		utf8[3] = 1;
+	} else if (ucs < 0x800) {
+		utf8[0] = 0xC0 | (ucs >> 6);
+		utf8[1] = 0x80 | (ucs & 0x3F);
+		utf8[3] = 2;
+	} else {
+		utf8[0] = 0xE0 | (ucs >> 12);
+		utf8[1] = 0x80 | ((ucs >> 6) & 0x3F);
+		utf8[2] = 0x80 | (ucs & 0x3F);
+		utf8[3] = 3;
+	}
+}
+
+/*
+   Build the tables of a codepage if every byte converts on its own to
+   a single BMP character. Return 0 for multi-byte codepages.
+ */
+static int mapirops_codepage_tables(struct mapirops_codepage *cp, const char *charset)
+{
+	iconv_t		cd;
+	char		byte;
+	uint8_t		ucs[4];
+	char		*in;
+	char		*out;
+	size_t		inlen;
+	size_t		outlen;
+	uint16_t	c;
+	uint32_t	i;
+	int		single_byte = 1;
+
+	cd = iconv_open("UTF-16LE", charset);
+	if (cd == (iconv_t)-1) {
+		return 0;
+	}
+
+	for (i = 0; i < 256 && single_byte; i++) {
+		byte = (char)i;
+		in = &byte;
+		inlen = 1;
+		out = (char *)ucs;
+		outlen = sizeof (ucs);
+		iconv(cd, NULL, NULL, NULL, NULL);
+		if (iconv(cd, &in, &inlen, &out, &outlen) == (size_t)-1) {
+			/* Lead byte of a multi-byte character */
+			if (errno == EINVAL) {
+				single_byte = 0;
+			}
+			cp->to_ucs[i] = MAPIROPS_CODEPAGE_UNMAPPED;
+			continue;
+		}
+		if (outlen != 2 || (SVAL(ucs, 0) >= 0xD800 && SVAL(ucs, 0) < 0xE000) ||
+		    SVAL(ucs, 0) == MAPIROPS_CODEPAGE_UNMAPPED) {
+			/* Not a single BMP character, or stateful codepage */
+			single_byte = 0;
+			continue;
+		}
+		cp->to_ucs[i] = SVAL(ucs, 0);
+	}
+	iconv_close(cd);
+
+	if (!single_byte) {
+		return 0;
+	}
+
+	for (i = 0; i < 256; i++) {
+		c = cp->to_ucs[i];
+		if (c == MAPIROPS_CODEPAGE_UNMAPPED) {
+			continue;
+		}
+		mapirops_codepage_utf8_char(c, cp->to_utf8[i]);
+		if (cp->from_ucs[c >> 8] == NULL) {
+			cp->from_ucs[c >> 8] = talloc_zero_array(cp, uint8_t, 256);
+			if (cp->from_ucs[c >> 8] == NULL) {
+				return 0;
+			}
+		}
+		/* 0 means unmapped, except for U+0000 */
+		if (!cp->from_ucs[c >> 8][c & 0xFF]) {
+			cp->from_ucs[c >> 8][c & 0xFF] = i;
+		}
+	}
+
+	return 1;
+}
+
+/*
+   Set up a codepage, NULL if iconv doesn't know it
+ */
+static struct mapirops_codepage *mapirops_codepage_new(uint32_t cpid)
+{
+	struct mapirops_codepage	*cp;
+	char				charset[32];
+
+	cp = talloc_zero(mapirops_codepages_ctx, struct mapirops_codepage);
+	if (cp == NULL) {
+		return NULL;
+	}
+	cp->cpid = cpid;
+
+	if (cpid == MAPIROPS_CODEPAGE_UTF8) {
+		cp->utf8 = 1;
+		return cp;
+	}
+
+	mapirops_codepage_charset(cpid, charset, sizeof (charset));
+	if (mapirops_codepage_tables(cp, charset)) {
+		cp->single_byte = 1;
+		return cp;
+	}
+
+	cp->to_utf8_cd = iconv_open("UTF-8", charset);
+	if (cp->to_utf8_cd == (iconv_t)-1) {
+		talloc_free(cp);
+		return NULL;
+	}
+	cp->from_utf8_cd = iconv_open(charset, "UTF-8");
+	if (cp->from_utf8_cd == (iconv_t)-1) {
+		iconv_close(cp->to_utf8_cd);
+		talloc_free(cp);
+		return NULL;
+	}
+	pthread_mutex_init(&cp->lock, NULL);
+
+	return cp;
+}
+
+/**
+   \details Find a codepage in the registry, setting it up the first
+   time it is requested. Codepages live as long as the process.
+
+   \param cpid Codepage identifier, as sent by the client (1252, 932,
+   ...), MAPIROPS_CODEPAGE_UTF8 for UTF-8
+
+   \return Pointer to the codepage on success, NULL if the codepage is
+   not supported
+ */
+const struct mapirops_codepage *mapirops_codepage_get(uint32_t cpid)
+{
+	struct mapirops_codepage	*cp;
+
+	pthread_mutex_lock(&mapirops_codepages_lock);
+	for (cp = mapirops_codepages; cp; cp = cp->next) {
+		if (cp->cpid == cpid) {
+			break;
+		}
+	}
+	if (cp == NULL) {
+		if (mapirops_codepages_ctx == NULL) {
+			mapirops_codepages_ctx = talloc_named_const(NULL, 0, "mapirops_codepages");
+		}
+		if (mapirops_codepages_ctx) {
+			cp = mapirops_codepage_new(cpid);
+		}
+		if (cp) {
+			cp->next = mapirops_codepages;
+			mapirops_codepages = cp;
+		}
+	}
+	pthread_mutex_unlock(&mapirops_codepages_lock);
+
+	if (cp == NULL) {
+		mapirops_error(MAPIROPS_ERR_ICONV, LOG_ERR, "Unsupported codepage %u", cpid);
+	}
+
+	return cp;
+}
+
+/**
+   \details Set the codepage of the 8-bit strings pushed
+
+   \param push Pointer to the mapirops_push structure
+   \param cpid Codepage identifier, 0 for ASCII
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_ICONV if the
+   codepage is not supported, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_push_set_codepage(struct mapirops_push *push, uint32_t cpid)
+{
+	const struct mapirops_codepage	*cp = NULL;
+
+	if (!push) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	if (cpid) {
+		cp = mapirops_codepage_get(cpid);
+		if (cp == NULL) {
+			return MAPIROPS_ERR_ICONV;
+		}
+	}
+	push->codepage = cp;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Set the codepage of the 8-bit strings pulled
+
+   \param pull Pointer to the mapirops_pull structure
+   \param cpid Codepage identifier, 0 for ASCII
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_ICONV if the
+   codepage is not supported, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_pull_set_codepage(struct mapirops_pull *pull, uint32_t cpid)
+{
+	const struct mapirops_codepage	*cp = NULL;
+
+	if (!pull) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	if (cpid) {
+		cp = mapirops_codepage_get(cpid);
+		if (cp == NULL) {
+			return MAPIROPS_ERR_ICONV;
+		}
+	}
+	pull->codepage = cp;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/*
+   Convert with the shared iconv descriptor of a multi-byte codepage
+ */
+static enum mapirops_err_code mapirops_codepage_iconv(const struct mapirops_codepage *cp, iconv_t cd,
+						      const char *in, size_t len, char *out, size_t size,
+						      size_t *outlen)
+{
+	struct mapirops_codepage	*lcp = (struct mapirops_codepage *)cp;
+	char				*inp = (char *)in;
+	char				*outp = out;
+	size_t				left = size;
+	size_t				ret;
+
+	pthread_mutex_lock(&lcp->lock);
+	iconv(cd, NULL, NULL, NULL, NULL);
+	ret = iconv(cd, &inp, &len, &outp, &left);
+	if (ret != (size_t)-1) {
+		/* Back to the initial shift state */
+		ret = iconv(cd, NULL, NULL, &outp, &left);
+	}
+	pthread_mutex_unlock(&lcp->lock);
+
+	if (ret == (size_t)-1) {
+		return MAPIROPS_ERR_ICONV;
+	}
+	*outlen = outp - out;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Convert an 8-bit string from a codepage to UTF-8
+
+   \param cp Pointer to the codepage
+   \param in Pointer to the 8-bit string
+   \param len Length of the 8-bit string, null character excluded
+   \param out Pointer to the output buffer, at least
+   MAPIROPS_CODEPAGE_UTF8_SIZE(len) bytes
+   \param outlen Pointer to the length of the UTF-8 string, which is
+   null-terminated, null character excluded
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_ICONV if the
+   string doesn't belong to the codepage, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_codepage_to_utf8(const struct mapirops_codepage *cp, const uint8_t *in,
+						 size_t len, char *out, size_t *outlen)
+{
+	uint8_t		*p = (uint8_t *)out;
+	const uint8_t	*utf8;
+	size_t		i;
+
+	if (cp->utf8) {
+		memcpy(out, in, len);
+		p += len;
+	} else if (cp->single_byte) {
+		for (i = 0; i < len; i++) {
+			utf8 = cp->to_utf8[in[i]];
+			if (unlikely(!utf8[3])) {
+				return MAPIROPS_ERR_ICONV;
+			}
+			p[0] = utf8[0];
+			p[1] = utf8[1];
+			p[2] = utf8[2];
+			p += utf8[3];
+		}
+	} else {
+		MAPIROPS_CHECK(mapirops_codepage_iconv(cp, cp->to_utf8_cd, (const char *)in, len,
+						       out, MAPIROPS_CODEPAGE_UTF8_SIZE(len) - 1, outlen));
+		p += *outlen;
+	}
+	*p = '\0';
+	*outlen = p - (uint8_t *)out;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Convert a UTF-8 string to an 8-bit string of a codepage
+
+   \param cp Pointer to the codepage
+   \param in Pointer to the UTF-8 string
+   \param len Length of the UTF-8 string, null character excluded
+   \param out Pointer to the output buffer, at least
+   MAPIROPS_CODEPAGE_STRING8_SIZE(len) bytes
+   \param outlen Pointer to the length of the 8-bit string, null
+   character excluded
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_ICONV if the
+   string has characters which are not part of the codepage,
+   MAPIROPS_ERR_INVALID_VAL if it is not valid UTF-8 (overlong forms,
+   surrogates and characters past U+10FFFF included), otherwise
+   MAPIROPS error
+ */
+enum mapirops_err_code mapirops_codepage_from_utf8(const struct mapirops_codepage *cp, const char *in,
+						   size_t len, uint8_t *out, size_t *outlen)
+{
+	const uint8_t	*s = (const uint8_t *)in;
+	const uint8_t	*page;
+	uint32_t	c;
+	size_t		i;
+	size_t		n = 0;
+
+	if (cp->utf8) {
+		memcpy(out, in, len);
+		*outlen = len;
+		return MAPIROPS_ERR_SUCCESS;
+	}
+
+	if (!cp->single_byte) {
+		return mapirops_codepage_iconv(cp, cp->from_utf8_cd, in, len, (char *)out,
+					       MAPIROPS_CODEPAGE_STRING8_SIZE(len), outlen);
+	}
+
+	for (i = 0; i < len; n++) {
+		/* Decode one UTF-8 character, refusing overlong forms and surrogates */
+		c = s[i];
+		if (c < 0x80) {
+			i += 1;
+		} else if (c >= 0xC2 && c <= 0xDF && i + 1 < len && (s[i + 1] & 0xC0) == 0x80) {
+			c = ((c & 0x1F) << 6) | (s[i + 1] & 0x3F);
+			i += 2;
+		} else if ((c & 0xF0) == 0xE0 && i + 2 < len && (s[i + 1] & 0xC0) == 0x80 &&
+			   (s[i + 2] & 0xC0) == 0x80 && (c != 0xE0 || s[i + 1] >= 0xA0)) {
+			c = ((c & 0x0F) << 12) | ((s[i + 1] & 0x3F) << 6) | (s[i + 2] & 0x3F);
+			if (c >= 0xD800 && c <= 0xDFFF) {
+				return MAPIROPS_ERR_INVALID_VAL;
+			}
+			i += 3;
+		} else if (c >= 0xF0 && c <= 0xF4 && i + 3 < len && (s[i + 1] & 0xC0) == 0x80 &&
+			   (s[i + 2] & 0xC0) == 0x80 && (s[i + 3] & 0xC0) == 0x80 &&
+			   (c != 0xF0 || s[i + 1] >= 0x90)) {
+			c = ((c & 0x07) << 18) | ((s[i + 1] & 0x3F) << 12) | ((s[i + 2] & 0x3F) << 6) |
+				(s[i + 3] & 0x3F);
+			if (c > 0x10FFFF) {
+				return MAPIROPS_ERR_INVALID_VAL;
+			}
+			/* Single-byte codepages only map BMP characters */
+			return MAPIROPS_ERR_ICONV;
+		} else {
+			return MAPIROPS_ERR_INVALID_VAL;
+		}
+
+		page = cp->from_ucs[c >> 8];
+		if (unlikely(page == NULL || (!page[c & 0xFF] && c))) {
+			return MAPIROPS_ERR_ICONV;
+		}
+		out[n] = page[c & 0xFF];
+	}
+	*outlen = n;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Push a UTF-8 string converted to the codepage of the push
+   context, without null character
+
+   \param push Pointer to the mapirops_push structure, with a codepage
+   \param str Pointer to the UTF-8 string
+   \param len Length of the UTF-8 string
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_codepage_push_string8(struct mapirops_push *push, const char *str, size_t len)
+{
+	const struct mapirops_codepage	*cp = push->codepage;
+	enum mapirops_err_code		retval;
+	uint8_t				*out;
+	size_t				outlen;
+
+	if (cp->utf8 || cp->single_byte) {
+		/* One byte per character at most, straight to the buffer */
+		MAPIROPS_CHECK(mapirops_push_expand(push, len));
+		retval = mapirops_codepage_from_utf8(cp, str, len, push->data.data + push->offset, &outlen);
+		if (retval == MAPIROPS_ERR_INVALID_VAL) {
+			return mapirops_error(retval, LOG_ERR, "Invalid UTF-8 string");
+		} else if (retval != MAPIROPS_ERR_SUCCESS) {
+			return mapirops_error(retval, LOG_ERR, "String not in codepage %u", cp->cpid);
+		}
+		push->offset += outlen;
+		return MAPIROPS_ERR_SUCCESS;
+	}
+
+	out = talloc_array(push, uint8_t, MAPIROPS_CODEPAGE_STRING8_SIZE(len));
+	if (out == NULL) {
+		return MAPIROPS_ERR_NO_MEMORY;
+	}
+	retval = mapirops_codepage_from_utf8(cp, str, len, out, &outlen);
+	if (retval == MAPIROPS_ERR_SUCCESS) {
+		retval = mapirops_push_bytes(push, out, outlen);
+	} else {
+		mapirops_error(retval, LOG_ERR, "String not in codepage %u", cp->cpid);
+	}
+	talloc_free(out);
+
+	return retval;
+}
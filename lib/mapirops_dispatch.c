@@ -0,0 +1,76 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_dispatch.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief RopId dispatch of the generated ROP decoders
+
+   Every specification compiled by the mapirops generator exports the
+   table of the ROPs it defines. They are merged once into a table
+   indexed by RopId.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+#include <pthread.h>
+
+/** \cond */
+static const struct mapirops_rop_table *mapirops_rop_tables[] = {
+	&mapirops_rops_oxcstor,
+	&mapirops_rops_oxcrpc,
+	&mapirops_rops_oxcprpt
+};
+
+static const struct mapirops_rop_dispatch	*mapirops_rop_dispatch_table[256];
+static pthread_once_t				mapirops_rop_dispatch_once = PTHREAD_ONCE_INIT;
+/** \endcond */
+
+static void mapirops_rop_dispatch_init(void)
+{
+	const struct mapirops_rop_table	*table;
+	uint32_t			i;
+	uint32_t			j;
+
+	for (i = 0; i < sizeof (mapirops_rop_tables) / sizeof (mapirops_rop_tables[0]); i++) {
+		table = mapirops_rop_tables[i];
+		for (j = 0; j < table->count; j++) {
+			mapirops_rop_dispatch_table[table->rops[j].RopId] = &table->rops[j];
+		}
+	}
+}
+
+/**
+   \details Return the generated decoders of a ROP
+
+   \param RopId ROP identifier
+
+   \return Pointer to the mapirops_rop_dispatch structure of the ROP,
+   NULL if no specification defines it
+ */
+const struct mapirops_rop_dispatch *mapirops_rop_dispatch_get(uint8_t RopId)
+{
+	pthread_once(&mapirops_rop_dispatch_once, mapirops_rop_dispatch_init);
+
+	return mapirops_rop_dispatch_table[RopId];
+}
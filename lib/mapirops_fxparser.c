@@ -0,0 +1,438 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_fxparser.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Incremental FastTransfer stream parser
+
+   FastTransfer streams ([MS-OXCFXICS] section 2.2.4) are split across
+   RopFastTransferSourceGetBuffer and
+   RopFastTransferDestinationPutBuffer buffers at arbitrary byte
+   positions. The parser is fed with these buffers as they come and
+   raises marker, property and data events. Only the current partial
+   element is kept: fields of at most 16 bytes split across two
+   buffers are gathered in the parser, variable-size values are never
+   buffered and their bytes are handed to the data callback straight
+   from the caller buffers.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+/** \cond */
+enum mapirops_fxparser_state {
+	MAPIROPS_FX_TAG = 0,
+	MAPIROPS_FX_GUID,
+	MAPIROPS_FX_KIND,
+	MAPIROPS_FX_LID,
+	MAPIROPS_FX_NAME,
+	MAPIROPS_FX_COUNT,
+	MAPIROPS_FX_LENGTH,
+	MAPIROPS_FX_FIXED,
+	MAPIROPS_FX_DATA
+};
+
+struct mapirops_fxparser {
+	struct mapirops_fx_callbacks	callbacks;
+	void				*private_data;
+	enum mapirops_fxparser_state	state;
+	uint8_t				size;		/* Size of fixed-size values, 0 if variable */
+	uint8_t				mv;		/* Whether the property is multiple-valued */
+	uint8_t				buf[16];	/* Field split across buffers */
+	uint32_t			have;		/* Bytes gathered in buf */
+	uint32_t			done;		/* Bytes of the current value already handed out */
+	struct mapirops_fx_property	prop;
+	uint8_t				name[MAPIROPS_FX_NAME_MAX];
+};
+/** \endcond */
+
+/*
+   Return n (at most 16) contiguous bytes of the stream: straight from
+   the caller buffer when possible, gathered in fx->buf otherwise. NULL
+   if the buffer ends first.
+ */
+static const uint8_t *mapirops_fxparser_need(struct mapirops_fxparser *fx, const uint8_t **data,
+					     size_t *length, uint32_t n)
+{
+	const uint8_t	*p;
+	uint32_t	copy;
+
+	if (fx->have == 0 && *length >= n) {
+		p = *data;
+		*data += n;
+		*length -= n;
+		return p;
+	}
+
+	copy = MIN(n - fx->have, *length);
+	memcpy(fx->buf + fx->have, *data, copy);
+	fx->have += copy;
+	*data += copy;
+	*length -= copy;
+	if (fx->have < n) {
+		return NULL;
+	}
+
+	fx->have = 0;
+	return fx->buf;
+}
+
+/*
+   Whether tag is a marker rather than the tag of a property value
+ */
+static int mapirops_fxparser_is_marker(uint32_t tag)
+{
+	switch (tag) {
+	case NewAttach:
+	case StartEmbed:
+	case EndEmbed:
+	case StartRecip:
+	case EndToRecip:
+	case StartTopFld:
+	case StartSubFld:
+	case EndFolder:
+	case StartMessage:
+	case EndMessage:
+	case EndAttach:
+	case StartFAIMsg:
+	case IncrSyncChg:
+	case IncrSyncDel:
+	case IncrSyncEnd:
+	case IncrSyncMessage:
+	case FXErrorInfo:
+	case IncrSyncRead:
+	case IncrSyncStateBegin:
+	case IncrSyncStateEnd:
+	case IncrSyncProgressMode:
+	case IncrSyncProgressPerMsg:
+	case IncrSyncGroupInfo:
+	case IncrSyncChgPartial:
+		return 1;
+	default:
+		return 0;
+	}
+}
+
+/*
+   Set the value layout of the property fx->prop.PropertyTag. Boolean
+   values take 2 bytes in FastTransfer streams.
+ */
+static enum mapirops_err_code mapirops_fxparser_set_type(struct mapirops_fxparser *fx)
+{
+	uint16_t	type = PROP_TYPE(fx->prop.PropertyTag);
+
+	/* String8 in the code page given by the low bits */
+	if (type & 0x8000) {
+		fx->mv = 0;
+		fx->size = 0;
+		return MAPIROPS_ERR_SUCCESS;
+	}
+
+	fx->mv = (type & MV_FLAG) ? 1 : 0;
+	switch (type & ~MV_FLAG) {
+	case PT_SHORT:
+		fx->size = 2;
+		break;
+	case PT_LONG:
+	case PT_FLOAT:
+		fx->size = 4;
+		break;
+	case PT_DOUBLE:
+	case PT_CURRENCY:
+	case PT_APPTIME:
+	case PT_I8:
+	case PT_SYSTIME:
+		fx->size = 8;
+		break;
+	case PT_CLSID:
+		fx->size = 16;
+		break;
+	case PT_STRING8:
+	case PT_UNICODE:
+	case PT_BINARY:
+		fx->size = 0;
+		break;
+	case PT_BOOLEAN:
+	case PT_ERROR:
+	case PT_OBJECT:
+	case PT_SVREID:
+	case PT_SRESTRICTION:
+	case PT_ACTIONS:
+		/* Single-valued only */
+		if (fx->mv) {
+			return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+					      "Invalid property type 0x%.4x in FastTransfer stream", type);
+		}
+		fx->size = (type == PT_BOOLEAN) ? 2 : (type == PT_ERROR) ? 4 : 0;
+		break;
+	default:
+		return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+				      "Invalid property type 0x%.4x in FastTransfer stream", type);
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/*
+   Move to the first field of the values once the property tag and
+   name are known
+ */
+static void mapirops_fxparser_values(struct mapirops_fxparser *fx)
+{
+	if (fx->mv) {
+		fx->state = MAPIROPS_FX_COUNT;
+		return;
+	}
+
+	fx->prop.count = 1;
+	fx->state = fx->size ? MAPIROPS_FX_FIXED : MAPIROPS_FX_LENGTH;
+}
+
+/*
+   Move to the next value of the property, or to the next element of
+   the stream after the last one
+ */
+static void mapirops_fxparser_next_value(struct mapirops_fxparser *fx)
+{
+	fx->prop.index++;
+	fx->prop.value = NULL;
+	if (fx->prop.index < fx->prop.count) {
+		fx->state = fx->size ? MAPIROPS_FX_FIXED : MAPIROPS_FX_LENGTH;
+	} else {
+		fx->state = MAPIROPS_FX_TAG;
+	}
+}
+
+/*
+   Raise the property event for the current value
+ */
+static enum mapirops_err_code mapirops_fxparser_property(struct mapirops_fxparser *fx)
+{
+	if (fx->callbacks.property) {
+		return fx->callbacks.property(fx->private_data, &fx->prop);
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Create a FastTransfer stream parser
+
+   \param mem_ctx Pointer to the memory context
+   \param callbacks Pointer to the callbacks to raise events with,
+   copied by the parser
+   \param private_data Pointer passed as is to the callbacks
+
+   \return Allocated mapirops_fxparser structure on success, otherwise
+   NULL.
+ */
+struct mapirops_fxparser *mapirops_fxparser_init(TALLOC_CTX *mem_ctx,
+						 const struct mapirops_fx_callbacks *callbacks,
+						 void *private_data)
+{
+	struct mapirops_fxparser	*fx;
+
+	if (!callbacks) {
+		return NULL;
+	}
+
+	fx = talloc_zero(mem_ctx, struct mapirops_fxparser);
+	if (fx == NULL) {
+		return NULL;
+	}
+
+	fx->callbacks = *callbacks;
+	fx->private_data = private_data;
+	fx->state = MAPIROPS_FX_TAG;
+
+	return fx;
+}
+
+/**
+   \details Parse the next buffer of a FastTransfer stream
+
+   Events are raised for every element completed by this buffer. An
+   element left incomplete at the end of the buffer is resumed by the
+   next call. Pointers passed to the callbacks are only valid during
+   the callback.
+
+   \param fx Pointer to the mapirops_fxparser structure
+   \param data Pointer to the buffer
+   \param length Length of the buffer
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_INVALID_VAL if
+   the stream is malformed, otherwise the error returned by a callback.
+   The parser can't be used anymore after an error.
+ */
+enum mapirops_err_code mapirops_fxparser_parse(struct mapirops_fxparser *fx, const uint8_t *data,
+					       size_t length)
+{
+	const uint8_t	*p;
+	uint32_t	n;
+
+	if (!fx || (length && !data)) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	while (length) {
+		switch (fx->state) {
+		case MAPIROPS_FX_TAG:
+			if ((p = mapirops_fxparser_need(fx, &data, &length, 4)) == NULL) {
+				break;
+			}
+			if (mapirops_fxparser_is_marker(IVAL(p, 0))) {
+				if (fx->callbacks.marker) {
+					MAPIROPS_CHECK(fx->callbacks.marker(fx->private_data, IVAL(p, 0)));
+				}
+				break;
+			}
+			memset(&fx->prop, 0, sizeof (struct mapirops_fx_property));
+			fx->prop.PropertyTag = IVAL(p, 0);
+			MAPIROPS_CHECK(mapirops_fxparser_set_type(fx));
+			if ((fx->prop.PropertyTag >> 16) >= 0x8000) {
+				fx->prop.named = 1;
+				fx->state = MAPIROPS_FX_GUID;
+			} else {
+				mapirops_fxparser_values(fx);
+			}
+			break;
+		case MAPIROPS_FX_GUID:
+			if ((p = mapirops_fxparser_need(fx, &data, &length, 16)) == NULL) {
+				break;
+			}
+			fx->prop.guid.Data1 = IVAL(p, 0);
+			fx->prop.guid.Data2 = SVAL(p, 4);
+			fx->prop.guid.Data3 = SVAL(p, 6);
+			memcpy(fx->prop.guid.Data4, p + 8, 8);
+			fx->state = MAPIROPS_FX_KIND;
+			break;
+		case MAPIROPS_FX_KIND:
+			fx->prop.Kind = *data++;
+			length--;
+			if (fx->prop.Kind == 0x00) {
+				fx->state = MAPIROPS_FX_LID;
+			} else if (fx->prop.Kind == 0x01) {
+				fx->prop.name = fx->name;
+				fx->state = MAPIROPS_FX_NAME;
+			} else {
+				return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+						      "Invalid named property Kind 0x%.2x", fx->prop.Kind);
+			}
+			break;
+		case MAPIROPS_FX_LID:
+			if ((p = mapirops_fxparser_need(fx, &data, &length, 4)) == NULL) {
+				break;
+			}
+			fx->prop.lid = IVAL(p, 0);
+			mapirops_fxparser_values(fx);
+			break;
+		case MAPIROPS_FX_NAME:
+			if (fx->prop.name_length == MAPIROPS_FX_NAME_MAX) {
+				return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+						      "Named property name longer than %u bytes",
+						      MAPIROPS_FX_NAME_MAX);
+			}
+			fx->name[fx->prop.name_length++] = *data++;
+			length--;
+			if (!(fx->prop.name_length & 1) && !fx->name[fx->prop.name_length - 1] &&
+			    !fx->name[fx->prop.name_length - 2]) {
+				fx->prop.name_length -= 2;
+				mapirops_fxparser_values(fx);
+			}
+			break;
+		case MAPIROPS_FX_COUNT:
+			if ((p = mapirops_fxparser_need(fx, &data, &length, 4)) == NULL) {
+				break;
+			}
+			fx->prop.count = IVAL(p, 0);
+			if (fx->prop.count == 0) {
+				/* Still report the property */
+				MAPIROPS_CHECK(mapirops_fxparser_property(fx));
+				fx->state = MAPIROPS_FX_TAG;
+			} else {
+				fx->state = fx->size ? MAPIROPS_FX_FIXED : MAPIROPS_FX_LENGTH;
+			}
+			break;
+		case MAPIROPS_FX_LENGTH:
+			if ((p = mapirops_fxparser_need(fx, &data, &length, 4)) == NULL) {
+				break;
+			}
+			fx->prop.length = IVAL(p, 0);
+			fx->done = 0;
+			MAPIROPS_CHECK(mapirops_fxparser_property(fx));
+			if (fx->prop.length) {
+				fx->state = MAPIROPS_FX_DATA;
+			} else {
+				mapirops_fxparser_next_value(fx);
+			}
+			break;
+		case MAPIROPS_FX_FIXED:
+			if ((p = mapirops_fxparser_need(fx, &data, &length, fx->size)) == NULL) {
+				break;
+			}
+			fx->prop.value = p;
+			fx->prop.length = fx->size;
+			MAPIROPS_CHECK(mapirops_fxparser_property(fx));
+			mapirops_fxparser_next_value(fx);
+			break;
+		case MAPIROPS_FX_DATA:
+			n = MIN(length, fx->prop.length - fx->done);
+			if (fx->callbacks.data) {
+				MAPIROPS_CHECK(fx->callbacks.data(fx->private_data, &fx->prop, data, n, fx->done));
+			}
+			fx->done += n;
+			data += n;
+			length -= n;
+			if (fx->done == fx->prop.length) {
+				mapirops_fxparser_next_value(fx);
+			}
+			break;
+		}
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Check the FastTransfer stream didn't end in the middle of
+   an element
+
+   \param fx Pointer to the mapirops_fxparser structure
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_BUFSIZE if the
+   stream is truncated, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_fxparser_end(struct mapirops_fxparser *fx)
+{
+	if (!fx) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	if (fx->state != MAPIROPS_FX_TAG || fx->have) {
+		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+				      "FastTransfer stream ends inside property 0x%.8x",
+				      fx->prop.PropertyTag);
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
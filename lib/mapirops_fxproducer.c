@@ -0,0 +1,284 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_fxproducer.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Parallel FastTransfer stream producer
+
+   A FastTransfer stream for RopFastTransferSourceCopyMessages or
+   RopFastTransferSourceCopyFolder is the concatenation of independent
+   per-message segments. The producer serializes these segments on a
+   pool of worker threads and hands them out in order, cut to the
+   buffer size requested by each RopFastTransferSourceGetBuffer.
+
+   Segments live in a ring of window slots: workers never serialize
+   more than window segments ahead of the consumer, which bounds the
+   memory used when the client reads slowly. Each slot owns a
+   mapirops_push in its own talloc hierarchy, reused from one segment
+   to the next, so workers never touch a talloc hierarchy shared with
+   another thread.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+#include <pthread.h>
+#include <unistd.h>
+
+/** \cond */
+struct mapirops_fxproducer_slot {
+	struct mapirops_push	*push;		/* Segment, in its own hierarchy */
+	enum mapirops_err_code	retval;		/* Serialization status */
+	uint8_t			ready;		/* Whether the segment is complete */
+};
+
+struct mapirops_fxproducer {
+	mapirops_fx_serialize_fn	fn;
+	void				*private_data;
+	uint32_t			count;		/* Number of segments */
+	uint32_t			window;		/* Number of slots */
+	uint32_t			next;		/* Next segment to hand to a worker */
+	uint32_t			consumed;	/* Segment being read by the consumer */
+	uint32_t			offset;		/* Bytes of the consumed segment already read */
+	uint8_t				stop;
+	struct mapirops_fxproducer_slot	*slots;
+	pthread_t			*threads;
+	uint32_t			thread_count;
+	pthread_mutex_t			lock;
+	pthread_cond_t			ready_cond;	/* Signaled when a segment is complete */
+	pthread_cond_t			space_cond;	/* Signaled when a slot is released */
+};
+/** \endcond */
+
+/*
+   Worker thread: serialize segments while there is room ahead of the
+   consumer
+ */
+static void *mapirops_fxproducer_worker(void *data)
+{
+	struct mapirops_fxproducer	*fx = (struct mapirops_fxproducer *) data;
+	struct mapirops_fxproducer_slot	*slot;
+	enum mapirops_err_code		retval;
+	uint32_t			index;
+
+	pthread_mutex_lock(&fx->lock);
+	while (!fx->stop && fx->next < fx->count) {
+		if (fx->next - fx->consumed >= fx->window) {
+			pthread_cond_wait(&fx->space_cond, &fx->lock);
+			continue;
+		}
+
+		index = fx->next++;
+		slot = &fx->slots[index % fx->window];
+		pthread_mutex_unlock(&fx->lock);
+
+		mapirops_push_reset(slot->push);
+		retval = fx->fn(fx->private_data, index, slot->push);
+
+		pthread_mutex_lock(&fx->lock);
+		slot->retval = retval;
+		slot->ready = 1;
+		pthread_cond_broadcast(&fx->ready_cond);
+	}
+	pthread_mutex_unlock(&fx->lock);
+
+	return NULL;
+}
+
+/*
+   Stop and join the workers, then release the segments
+ */
+static int mapirops_fxproducer_destructor(struct mapirops_fxproducer *fx)
+{
+	uint32_t	i;
+
+	pthread_mutex_lock(&fx->lock);
+	fx->stop = 1;
+	pthread_cond_broadcast(&fx->space_cond);
+	pthread_mutex_unlock(&fx->lock);
+
+	for (i = 0; i < fx->thread_count; i++) {
+		pthread_join(fx->threads[i], NULL);
+	}
+
+	for (i = 0; i < fx->window; i++) {
+		talloc_free(fx->slots[i].push);
+	}
+
+	pthread_cond_destroy(&fx->space_cond);
+	pthread_cond_destroy(&fx->ready_cond);
+	pthread_mutex_destroy(&fx->lock);
+
+	return 0;
+}
+
+/**
+   \details Create a FastTransfer stream producer and start its
+   workers
+
+   fn is called once for every index from 0 to count - 1, from the
+   worker threads and in no particular order. It must be thread-safe
+   and must not allocate memory on a talloc context shared with
+   another thread.
+
+   \param mem_ctx Pointer to the memory context
+   \param count Number of segments in the stream
+   \param threads Number of worker threads, 0 for one per online CPU
+   \param window Maximum number of segments serialized ahead of the
+   consumer, 0 for MAPIROPS_FXPRODUCER_WINDOW
+   \param fn Function serializing a segment
+   \param private_data Pointer passed as is to fn
+
+   \return Allocated mapirops_fxproducer structure on success,
+   otherwise NULL. Freeing it stops the workers.
+ */
+struct mapirops_fxproducer *mapirops_fxproducer_init(TALLOC_CTX *mem_ctx, uint32_t count,
+						     uint32_t threads, uint32_t window,
+						     mapirops_fx_serialize_fn fn, void *private_data)
+{
+	struct mapirops_fxproducer	*fx;
+	long				cpus;
+	uint32_t			i;
+
+	if (!fn) {
+		return NULL;
+	}
+
+	if (!threads) {
+		cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = (cpus > 0) ? cpus : 1;
+	}
+	if (!window) {
+		window = MAPIROPS_FXPRODUCER_WINDOW;
+	}
+	threads = MIN(threads, MAX(count, 1));
+
+	fx = talloc_zero(mem_ctx, struct mapirops_fxproducer);
+	if (fx == NULL) {
+		return NULL;
+	}
+	fx->fn = fn;
+	fx->private_data = private_data;
+	fx->count = count;
+	fx->window = window;
+
+	fx->slots = talloc_zero_array(fx, struct mapirops_fxproducer_slot, window);
+	fx->threads = talloc_array(fx, pthread_t, threads);
+	if (!fx->slots || !fx->threads) {
+		talloc_free(fx);
+		return NULL;
+	}
+
+	for (i = 0; i < window; i++) {
+		fx->slots[i].push = mapirops_push_init(NULL);
+		if (fx->slots[i].push == NULL) {
+			for (; i > 0; i--) {
+				talloc_free(fx->slots[i - 1].push);
+			}
+			talloc_free(fx);
+			return NULL;
+		}
+	}
+
+	pthread_mutex_init(&fx->lock, NULL);
+	pthread_cond_init(&fx->ready_cond, NULL);
+	pthread_cond_init(&fx->space_cond, NULL);
+	talloc_set_destructor(fx, mapirops_fxproducer_destructor);
+
+	for (i = 0; i < threads; i++) {
+		if (pthread_create(&fx->threads[i], NULL, mapirops_fxproducer_worker, fx) != 0) {
+			break;
+		}
+		fx->thread_count++;
+	}
+	if (fx->thread_count == 0) {
+		mapirops_error(MAPIROPS_ERR_NO_MEMORY, LOG_ERR, "Failed to start FastTransfer workers");
+		talloc_free(fx);
+		return NULL;
+	}
+
+	return fx;
+}
+
+/**
+   \details Push the next bytes of the FastTransfer stream
+
+   Waits for the segments needed to fill size bytes, or to reach the
+   end of the stream, and pushes them in order.
+
+   \param fx Pointer to the mapirops_fxproducer structure
+   \param push Pointer to the mapirops_push structure, typically the
+   TransferBuffer of a RopFastTransferSourceGetBuffer response
+   \param size Maximum number of bytes to push
+   \param length Pointer to the number of bytes pushed
+   \param last Pointer set to 1 once the end of the stream was pushed,
+   0 otherwise
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise the error
+   returned by the serialization of a segment or MAPIROPS error
+ */
+enum mapirops_err_code mapirops_fxproducer_get_buffer(struct mapirops_fxproducer *fx,
+						      struct mapirops_push *push, uint32_t size,
+						      uint32_t *length, uint8_t *last)
+{
+	struct mapirops_fxproducer_slot	*slot;
+	uint32_t			n;
+
+	if (!fx || !push || !length || !last) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	*length = 0;
+	while (*length < size && fx->consumed < fx->count) {
+		slot = &fx->slots[fx->consumed % fx->window];
+
+		pthread_mutex_lock(&fx->lock);
+		while (!slot->ready) {
+			pthread_cond_wait(&fx->ready_cond, &fx->lock);
+		}
+		pthread_mutex_unlock(&fx->lock);
+
+		if (slot->retval != MAPIROPS_ERR_SUCCESS) {
+			*last = 0;
+			return slot->retval;
+		}
+
+		n = MIN(size - *length, slot->push->offset - fx->offset);
+		MAPIROPS_CHECK(mapirops_push_bytes(push, slot->push->data.data + fx->offset, n));
+		*length += n;
+		fx->offset += n;
+
+		if (fx->offset == slot->push->offset) {
+			pthread_mutex_lock(&fx->lock);
+			slot->ready = 0;
+			fx->consumed++;
+			fx->offset = 0;
+			pthread_cond_broadcast(&fx->space_cond);
+			pthread_mutex_unlock(&fx->lock);
+		}
+	}
+
+	*last = (fx->consumed == fx->count);
+
+	return MAPIROPS_ERR_SUCCESS;
+}
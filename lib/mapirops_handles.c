@@ -0,0 +1,253 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_handles.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Server object handle table
+
+   Server objects opened by ROPs are referenced by 32-bit handles in
+   the ServerObjectHandleTable. A handle is the index of its entry in
+   a contiguous array (low MAPIROPS_HANDLE_INDEX_BITS bits) tagged with
+   the generation of the entry (high bits). The generation changes
+   every time the entry is released, so a stale handle sent by a
+   client never resolves to the object now using the entry.
+
+   Released entries are chained in a free list and reused first:
+   allocation, lookup and release are O(1).
+
+   \note A handle table is not thread-safe and should either be used
+   by a single thread or protected by the caller.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+/** \def MAPIROPS_HANDLE_INDEX_MASK
+    Mask of the index part of a server object handle
+*/
+#define	MAPIROPS_HANDLE_INDEX_MASK	((1U << MAPIROPS_HANDLE_INDEX_BITS) - 1)
+
+/** \def MAPIROPS_HANDLE_GENERATION_MAX
+    Largest generation of a handle table entry
+*/
+#define	MAPIROPS_HANDLE_GENERATION_MAX	(0xFFFFFFFF >> MAPIROPS_HANDLE_INDEX_BITS)
+
+/** \cond */
+#define	MAPIROPS_HANDLE_NONE		0xFFFFFFFF
+#define	MAPIROPS_HANDLES_MIN		64
+
+struct mapirops_handle_entry {
+	void		*object;	/* NULL if the entry is free */
+	uint32_t	generation;
+	uint32_t	next;		/* Next free entry */
+};
+
+struct mapirops_handles {
+	struct mapirops_handle_entry	*entries;
+	uint32_t			count;		/* Entries ever used */
+	uint32_t			alloc;		/* Entries allocated */
+	uint32_t			max;		/* Maximum number of entries */
+	uint32_t			free;		/* Head of the free list */
+};
+/** \endcond */
+
+/**
+   \details Create a server object handle table
+
+   \param mem_ctx Pointer to the memory context
+   \param max Maximum number of objects referenced at the same time,
+   0 or values above the index range for the whole index range. The
+   last index is never used so no handle equals
+   MAPIROPS_HANDLE_INVALID.
+
+   \return Allocated mapirops_handles structure on success, otherwise
+   NULL.
+ */
+struct mapirops_handles *mapirops_handles_init(TALLOC_CTX *mem_ctx, uint32_t max)
+{
+	struct mapirops_handles	*handles;
+
+	handles = talloc_zero(mem_ctx, struct mapirops_handles);
+	if (handles == NULL) {
+		return NULL;
+	}
+
+	if (!max || max > MAPIROPS_HANDLE_INDEX_MASK) {
+		max = MAPIROPS_HANDLE_INDEX_MASK;
+	}
+	handles->max = max;
+	handles->alloc = MIN(max, MAPIROPS_HANDLES_MIN);
+	handles->free = MAPIROPS_HANDLE_NONE;
+	handles->entries = talloc_array(handles, struct mapirops_handle_entry, handles->alloc);
+	if (handles->entries == NULL) {
+		talloc_free(handles);
+		return NULL;
+	}
+
+	return handles;
+}
+
+/**
+   \details Reference an object in the handle table
+
+   \param handles Pointer to the mapirops_handles structure
+   \param object Pointer to the object, can't be NULL
+   \param handle Pointer to the handle to return
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_BUFSIZE if the
+   table is full, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_handles_alloc(struct mapirops_handles *handles, void *object,
+					      uint32_t *handle)
+{
+	struct mapirops_handle_entry	*entries;
+	uint32_t			alloc;
+	uint32_t			index;
+
+	if (!handles || !object || !handle) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	if (handles->free != MAPIROPS_HANDLE_NONE) {
+		index = handles->free;
+		handles->free = handles->entries[index].next;
+	} else {
+		if (handles->count == handles->alloc) {
+			if (handles->alloc == handles->max) {
+				return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+						      "Handle table full (%u objects)", handles->max);
+			}
+			alloc = MIN(handles->max, handles->alloc * 2);
+			entries = talloc_realloc(handles, handles->entries,
+						 struct mapirops_handle_entry, alloc);
+			if (entries == NULL) {
+				return MAPIROPS_ERR_NO_MEMORY;
+			}
+			handles->entries = entries;
+			handles->alloc = alloc;
+		}
+		index = handles->count++;
+		handles->entries[index].generation = 1;
+	}
+
+	handles->entries[index].object = object;
+	*handle = (handles->entries[index].generation << MAPIROPS_HANDLE_INDEX_BITS) | index;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Find the object referenced by a handle
+
+   \param handles Pointer to the mapirops_handles structure
+   \param handle Server object handle
+
+   \return Pointer to the object, NULL if handle doesn't reference a
+   live object
+ */
+void *mapirops_handles_lookup(struct mapirops_handles *handles, uint32_t handle)
+{
+	struct mapirops_handle_entry	*entry;
+	uint32_t			index = handle & MAPIROPS_HANDLE_INDEX_MASK;
+
+	if (unlikely(!handles || index >= handles->count)) {
+		return NULL;
+	}
+
+	entry = &handles->entries[index];
+	if (unlikely(entry->generation != (handle >> MAPIROPS_HANDLE_INDEX_BITS))) {
+		return NULL;
+	}
+
+	return entry->object;
+}
+
+/**
+   \details Release a handle, as done by RopRelease
+
+   \param handles Pointer to the mapirops_handles structure
+   \param handle Server object handle to release
+   \param object Pointer to the object which was referenced, can be
+   NULL
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_NOT_FOUND if
+   handle doesn't reference a live object, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_handles_release(struct mapirops_handles *handles, uint32_t handle,
+						void **object)
+{
+	struct mapirops_handle_entry	*entry;
+	uint32_t			index = handle & MAPIROPS_HANDLE_INDEX_MASK;
+
+	if (mapirops_handles_lookup(handles, handle) == NULL) {
+		return MAPIROPS_ERR_NOT_FOUND;
+	}
+
+	entry = &handles->entries[index];
+	if (object) {
+		*object = entry->object;
+	}
+	entry->object = NULL;
+	entry->generation = (entry->generation == MAPIROPS_HANDLE_GENERATION_MAX) ? 1 : entry->generation + 1;
+	entry->next = handles->free;
+	handles->free = index;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Resolve all the handles of a ROP buffer at once
+
+   objects[i] is set to the object referenced by the i-th handle of the
+   ServerObjectHandleTable, or NULL. Handles equal to
+   MAPIROPS_HANDLE_INVALID are expected and not reported.
+
+   \param handles Pointer to the mapirops_handles structure
+   \param ropbuf Pointer to the ROP buffer
+   \param objects Array of ropbuf->handle_count object pointers to fill
+
+   \return MAPIROPS_ERR_SUCCESS if every handle was resolved,
+   MAPIROPS_ERR_NOT_FOUND if at least one handle doesn't reference a
+   live object, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_handles_resolve(struct mapirops_handles *handles,
+						const struct mapirops_ropbuf *ropbuf, void **objects)
+{
+	enum mapirops_err_code	retval = MAPIROPS_ERR_SUCCESS;
+	uint32_t		handle;
+	uint32_t		i;
+
+	if (!handles || !ropbuf || (ropbuf->handle_count && !objects)) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	for (i = 0; i < ropbuf->handle_count; i++) {
+		handle = IVAL(ropbuf->handles.data, i * 4);
+		objects[i] = mapirops_handles_lookup(handles, handle);
+		if (objects[i] == NULL && handle != MAPIROPS_HANDLE_INVALID) {
+			retval = MAPIROPS_ERR_NOT_FOUND;
+		}
+	}
+
+	return retval;
+}
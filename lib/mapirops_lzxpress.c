@@ -0,0 +1,423 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_lzxpress.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief LZ77+DIRECT2 compression of ROP buffers
+
+   Implements the plain LZ77 format described in [MS-XCA] section
+   2.3 and used for compressed RPC_HEADER_EXT payloads in [MS-OXCRPC]
+   section 3.1.7.2. Both routines work directly on mapibuf buffers:
+   the caller provides the output buffer and its length is used as a
+   hard output limit.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+/** \cond */
+
+/* Offsets are encoded on 13 bits */
+#define	LZXPRESS_WINDOW_SIZE	8192
+#define	LZXPRESS_WINDOW_MASK	(LZXPRESS_WINDOW_SIZE - 1)
+
+#define	LZXPRESS_MIN_MATCH	3
+#define	LZXPRESS_MAX_MATCH	(0xFFFF + LZXPRESS_MIN_MATCH)
+
+/* The hash table has about one bucket per input byte, within these
+ * bounds */
+#define	LZXPRESS_HASH_MIN_BITS	8
+#define	LZXPRESS_HASH_MAX_BITS	13
+
+/* Number of previous candidates examined for each position */
+#define	LZXPRESS_CHAIN_DEPTH	32
+
+#define	LZXPRESS_HASH(p, shift) \
+	((((uint32_t)(p)[0] | ((uint32_t)(p)[1] << 8) | ((uint32_t)(p)[2] << 16)) * 2654435761U) >> (shift))
+
+#define	LZXPRESS_OUT_NEED_BYTES(n) do {			\
+	if (unlikely((n) > out_len - out_pos)) {	\
+		talloc_free(mem_ctx);			\
+		return MAPIROPS_ERR_BUFFER_TOO_SMALL;	\
+	}						\
+} while (0)
+
+#define	LZXPRESS_IN_NEED_BYTES(n) do {			\
+	if (unlikely((n) > in_len - in_pos)) {		\
+		return MAPIROPS_ERR_INVALID_VAL;	\
+	}						\
+} while (0)
+
+/** \endcond */
+
+/**
+   \details Hash chains used to find previous occurrences of the
+   bytes at the current position
+
+   Both tables are sized to the input. Only head is cleared: an entry
+   of prev is always written when its position is inserted, before
+   any chain can lead to it.
+ */
+struct lzxpress_chains {
+	uint32_t	shift;		/*!< 32 - number of hash bits */
+	uint32_t	*head;		/*!< Last position + 1 for each hash, 0 if none */
+	uint32_t	*prev;		/*!< Previous position + 1 with the same hash */
+};
+
+static inline void lzxpress_insert(struct lzxpress_chains *chains,
+				   const uint8_t *in, uint32_t pos)
+{
+	uint32_t	hash = LZXPRESS_HASH(in + pos, chains->shift);
+
+	chains->prev[pos & LZXPRESS_WINDOW_MASK] = chains->head[hash];
+	chains->head[hash] = pos + 1;
+}
+
+static inline uint32_t lzxpress_find_match(struct lzxpress_chains *chains,
+					   const uint8_t *in, uint32_t in_len,
+					   uint32_t pos, uint32_t *match_offset)
+{
+	uint32_t	candidate;
+	uint32_t	best_len = 0;
+	uint32_t	max_len;
+	uint32_t	len;
+	int		depth = LZXPRESS_CHAIN_DEPTH;
+
+	max_len = in_len - pos;
+	if (max_len > LZXPRESS_MAX_MATCH) {
+		max_len = LZXPRESS_MAX_MATCH;
+	}
+
+	candidate = chains->head[LZXPRESS_HASH(in + pos, chains->shift)];
+	while (candidate && depth--) {
+		candidate -= 1;
+		if (pos - candidate > LZXPRESS_WINDOW_SIZE) {
+			break;
+		}
+
+		/* Cheap rejection before comparing the whole match */
+		if (in[candidate + best_len] == in[pos + best_len] &&
+		    in[candidate] == in[pos]) {
+			for (len = 0; len < max_len && in[candidate + len] == in[pos + len]; len++);
+			if (len > best_len) {
+				best_len = len;
+				*match_offset = pos - candidate;
+				if (len == max_len) {
+					break;
+				}
+			}
+		}
+		candidate = chains->prev[candidate & LZXPRESS_WINDOW_MASK];
+	}
+
+	return best_len;
+}
+
+/**
+   \details Compress a buffer using LZ77+DIRECT2
+
+   \param src Pointer to the buffer to compress
+   \param dst Pointer to the output buffer. dst->length is the size of
+   the output buffer on input and is set to the compressed size on
+   success
+
+   \note Compression stops as soon as the output would not fit in
+   dst. Callers sending RPC_HEADER_EXT payloads are expected to send
+   the data uncompressed in this case.
+
+   \return MAPIROPS_ERR_SUCCESS on success,
+   MAPIROPS_ERR_BUFFER_TOO_SMALL if the compressed data doesn't fit in
+   dst, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_lzxpress_compress(const struct mapibuf *src,
+						  struct mapibuf *dst)
+{
+	TALLOC_CTX		*mem_ctx;
+	struct lzxpress_chains	chains_s;
+	struct lzxpress_chains	*chains = &chains_s;
+	const uint8_t		*in;
+	uint8_t			*out;
+	uint32_t		in_len;
+	uint32_t		out_len;
+	uint32_t		in_pos = 0;
+	uint32_t		out_pos = 0;
+	uint32_t		flags = 0;
+	uint32_t		flag_count = 0;
+	uint32_t		flag_pos;
+	uint32_t		nibble_pos = 0;
+	uint32_t		match_len;
+	uint32_t		match_offset = 0;
+	uint32_t		len;
+	uint32_t		hash_bits;
+	uint32_t		window;
+	uint32_t		i;
+
+	if (!src || !dst || (src->length && !src->data) || !dst->data) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	if (src->length > UINT32_MAX - LZXPRESS_WINDOW_SIZE) {
+		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+				      "Buffer too large for lzxpress (%zu)", src->length);
+	}
+
+	in = src->data;
+	in_len = src->length;
+	out = dst->data;
+	out_len = (dst->length > UINT32_MAX) ? UINT32_MAX : dst->length;
+
+	for (hash_bits = LZXPRESS_HASH_MIN_BITS;
+	     hash_bits < LZXPRESS_HASH_MAX_BITS && (1U << hash_bits) < in_len;
+	     hash_bits++);
+	window = (in_len < LZXPRESS_WINDOW_SIZE) ? in_len : LZXPRESS_WINDOW_SIZE;
+
+	mem_ctx = talloc_named(NULL, 0, "mapirops_lzxpress_compress");
+	chains->shift = 32 - hash_bits;
+	chains->head = talloc_array(mem_ctx, uint32_t, (1U << hash_bits) + window);
+	if (chains->head == NULL) {
+		talloc_free(mem_ctx);
+		return mapirops_error(MAPIROPS_ERR_NO_MEMORY, LOG_ERR,
+				      "No more memory for lzxpress chains");
+	}
+	memset(chains->head, 0, (1U << hash_bits) * sizeof (uint32_t));
+	chains->prev = chains->head + (1U << hash_bits);
+
+	/* Reserve the first flags word */
+	LZXPRESS_OUT_NEED_BYTES(4);
+	flag_pos = out_pos;
+	out_pos += 4;
+
+	while (in_pos < in_len) {
+		match_len = 0;
+		if (in_len - in_pos >= LZXPRESS_MIN_MATCH) {
+			match_len = lzxpress_find_match(chains, in, in_len, in_pos, &match_offset);
+		}
+
+		if (match_len < LZXPRESS_MIN_MATCH) {
+			LZXPRESS_OUT_NEED_BYTES(1);
+			out[out_pos++] = in[in_pos];
+			if (in_len - in_pos >= LZXPRESS_MIN_MATCH) {
+				lzxpress_insert(chains, in, in_pos);
+			}
+			in_pos += 1;
+			flags <<= 1;
+		} else {
+			len = match_len - LZXPRESS_MIN_MATCH;
+
+			LZXPRESS_OUT_NEED_BYTES(2);
+			if (len < 7) {
+				SSVAL(out, out_pos, ((match_offset - 1) << 3) | len);
+				out_pos += 2;
+			} else {
+				SSVAL(out, out_pos, ((match_offset - 1) << 3) | 7);
+				out_pos += 2;
+				len -= 7;
+
+				/* Length nibbles are shared by two matches */
+				if (nibble_pos == 0) {
+					LZXPRESS_OUT_NEED_BYTES(1);
+					nibble_pos = out_pos;
+					out[out_pos++] = (len < 15) ? len : 15;
+				} else {
+					out[nibble_pos] |= ((len < 15) ? len : 15) << 4;
+					nibble_pos = 0;
+				}
+
+				if (len >= 15) {
+					len -= 15;
+					LZXPRESS_OUT_NEED_BYTES(1);
+					if (len < 255) {
+						out[out_pos++] = len;
+					} else {
+						out[out_pos++] = 255;
+						len += 15 + 7;
+						LZXPRESS_OUT_NEED_BYTES(2);
+						SSVAL(out, out_pos, len);
+						out_pos += 2;
+					}
+				}
+			}
+
+			for (i = 0; i < match_len; i++) {
+				if (in_len - (in_pos + i) >= LZXPRESS_MIN_MATCH) {
+					lzxpress_insert(chains, in, in_pos + i);
+				}
+			}
+			in_pos += match_len;
+			flags = (flags << 1) | 1;
+		}
+
+		flag_count += 1;
+		if (flag_count == 32) {
+			SIVAL(out, flag_pos, flags);
+			LZXPRESS_OUT_NEED_BYTES(4);
+			flag_pos = out_pos;
+			out_pos += 4;
+			flags = 0;
+			flag_count = 0;
+		}
+	}
+
+	/* Unused flag bits are set so the decoder stops on a match
+	 * past the end of input */
+	if (flag_count) {
+		flags = (flags << (32 - flag_count)) | ((1U << (32 - flag_count)) - 1);
+	} else {
+		flags = 0xFFFFFFFF;
+	}
+	SIVAL(out, flag_pos, flags);
+
+	talloc_free(mem_ctx);
+	dst->length = out_pos;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Decompress a LZ77+DIRECT2 buffer
+
+   \param src Pointer to the compressed buffer
+   \param dst Pointer to the output buffer. dst->length is the size of
+   the output buffer on input and is set to the decompressed size on
+   success
+
+   \return MAPIROPS_ERR_SUCCESS on success,
+   MAPIROPS_ERR_BUFFER_TOO_SMALL if the decompressed data doesn't fit
+   in dst, MAPIROPS_ERR_INVALID_VAL if src is not a valid compressed
+   buffer
+ */
+enum mapirops_err_code mapirops_lzxpress_decompress(const struct mapibuf *src,
+						    struct mapibuf *dst)
+{
+	const uint8_t	*in;
+	uint8_t		*out;
+	size_t		in_len;
+	size_t		out_len;
+	size_t		in_pos = 0;
+	size_t		out_pos = 0;
+	size_t		nibble_pos = 0;
+	uint32_t	flags = 0;
+	uint32_t	flag_count = 0;
+	uint32_t	match_len;
+	uint32_t	match_offset;
+	uint16_t	token;
+
+	if (!src || !dst || (src->length && !src->data) || (dst->length && !dst->data)) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	in = src->data;
+	in_len = src->length;
+	out = dst->data;
+	out_len = dst->length;
+
+	while (1) {
+		if (flag_count == 0) {
+			if (in_len - in_pos < 4) {
+				break;
+			}
+			flags = IVAL(in, in_pos);
+			in_pos += 4;
+			flag_count = 32;
+		}
+		flag_count -= 1;
+
+		if ((flags & (1U << flag_count)) == 0) {
+			if (in_pos == in_len) {
+				break;
+			}
+			if (unlikely(out_pos == out_len)) {
+				return MAPIROPS_ERR_BUFFER_TOO_SMALL;
+			}
+			out[out_pos++] = in[in_pos++];
+			continue;
+		}
+
+		if (in_pos == in_len) {
+			break;
+		}
+
+		LZXPRESS_IN_NEED_BYTES(2);
+		token = SVAL(in, in_pos);
+		in_pos += 2;
+		match_len = token & 7;
+		match_offset = (token >> 3) + 1;
+
+		if (match_len == 7) {
+			if (nibble_pos == 0) {
+				LZXPRESS_IN_NEED_BYTES(1);
+				match_len = in[in_pos] & 0xF;
+				nibble_pos = in_pos;
+				in_pos += 1;
+			} else {
+				match_len = in[nibble_pos] >> 4;
+				nibble_pos = 0;
+			}
+
+			if (match_len == 15) {
+				LZXPRESS_IN_NEED_BYTES(1);
+				match_len = in[in_pos];
+				in_pos += 1;
+				if (match_len == 255) {
+					LZXPRESS_IN_NEED_BYTES(2);
+					match_len = SVAL(in, in_pos);
+					in_pos += 2;
+					if (match_len == 0) {
+						LZXPRESS_IN_NEED_BYTES(4);
+						match_len = IVAL(in, in_pos);
+						in_pos += 4;
+					}
+					if (match_len < 15 + 7) {
+						return MAPIROPS_ERR_INVALID_VAL;
+					}
+					match_len -= 15 + 7;
+				}
+				match_len += 15;
+			}
+			match_len += 7;
+		}
+		match_len += LZXPRESS_MIN_MATCH;
+
+		if (match_offset > out_pos) {
+			return MAPIROPS_ERR_INVALID_VAL;
+		}
+		if (unlikely(match_len > out_len - out_pos)) {
+			return MAPIROPS_ERR_BUFFER_TOO_SMALL;
+		}
+
+		if (match_offset >= match_len) {
+			memcpy(out + out_pos, out + out_pos - match_offset, match_len);
+			out_pos += match_len;
+		} else {
+			/* Overlapping copy repeats the last match_offset bytes */
+			while (match_len--) {
+				out[out_pos] = out[out_pos - match_offset];
+				out_pos++;
+			}
+		}
+	}
+
+	dst->length = out_pos;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
@@ -0,0 +1,581 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_namedprops.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Named property mapping
+
+   A mailbox maps every named property (property set GUID plus LID or
+   string name) to a 16-bit property ID in the range
+   MAPIROPS_NAMEDPROPS_FIRST_ID to MAPIROPS_NAMEDPROPS_LAST_ID
+   ([MS-OXCPRPT] section 3.2.5.8). The map serves
+   RopGetPropertyIdsFromNames and RopGetNamesFromPropertyIds for any
+   number of concurrent sessions on the mailbox.
+
+   Names are interned once: the PropertyName returned for an ID points
+   to the copy owned by the map, string names stay in their UTF-16 wire
+   form. Lookups by name go through a hash table split in
+   MAPIROPS_NAMEDPROPS_SHARDS shards, each protected by its own
+   read-write lock. Lookups by ID index a table of chunks protected by
+   a separate read-write lock. Mappings are never removed.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+#include <pthread.h>
+
+/** \cond */
+#define	MAPIROPS_NAMEDPROPS_SHARDS	16
+#define	MAPIROPS_NAMEDPROPS_BUCKETS	64
+#define	MAPIROPS_NAMEDPROPS_CHUNK	256
+#define	MAPIROPS_NAMEDPROPS_CHUNKS	((MAPIROPS_NAMEDPROPS_LAST_ID - MAPIROPS_NAMEDPROPS_FIRST_ID) / \
+					 MAPIROPS_NAMEDPROPS_CHUNK + 1)
+#define	MAPIROPS_NAMEDPROPS_BATCH	64
+
+struct mapirops_namedprops_entry {
+	struct mapirops_namedprops_entry	*next;		/* Next entry in the bucket */
+	uint32_t				hash;
+	uint16_t				id;
+	PropertyName				name;		/* String name stored after the entry */
+};
+
+struct mapirops_namedprops_shard {
+	pthread_rwlock_t			lock;
+	struct mapirops_namedprops_entry	**buckets;
+	uint32_t				bucket_count;	/* Power of 2 */
+	uint32_t				count;
+};
+
+struct mapirops_namedprops {
+	struct mapirops_namedprops_shard	*shards[MAPIROPS_NAMEDPROPS_SHARDS];
+	pthread_rwlock_t			ids_lock;
+	TALLOC_CTX				*ids_ctx;	/* Parent of the chunks, under ids_lock */
+	struct mapirops_namedprops_entry	**ids[MAPIROPS_NAMEDPROPS_CHUNKS];
+	uint32_t				next_id;
+};
+
+/* PS_MAPI property set: the property ID of a LID below
+ * MAPIROPS_NAMEDPROPS_FIRST_ID is the LID itself */
+static const GUID PS_MAPI = {
+	0x00020328, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 }
+};
+/** \endcond */
+
+/*
+   FNV-1a hash of a property name
+ */
+static uint32_t mapirops_namedprops_hash(const PropertyName *name)
+{
+	const uint8_t	*p;
+	uint32_t	hash = 2166136261U;
+	uint32_t	i;
+
+#define	FNV(b)	do { hash ^= (b); hash *= 16777619U; } while (0)
+	p = (const uint8_t *)&name->Guid;
+	for (i = 0; i < sizeof (GUID); i++) {
+		FNV(p[i]);
+	}
+	FNV(name->Kind);
+	if (name->Kind == MNID_ID) {
+		FNV(name->LID & 0xFF);
+		FNV((name->LID >> 8) & 0xFF);
+		FNV((name->LID >> 16) & 0xFF);
+		FNV(name->LID >> 24);
+	} else {
+		for (i = 0; i < name->NameSize; i++) {
+			FNV(name->Name[i]);
+		}
+	}
+#undef FNV
+
+	return hash;
+}
+
+/*
+   Whether a name can be mapped to a property ID
+ */
+static int mapirops_namedprops_valid(const PropertyName *name)
+{
+	if (name->Kind == MNID_ID) {
+		return 1;
+	}
+	return (name->Kind == MNID_STRING && (name->Name || !name->NameSize));
+}
+
+/*
+   Find the entry of a name in a shard, the shard lock must be held
+ */
+static struct mapirops_namedprops_entry *mapirops_namedprops_find(struct mapirops_namedprops_shard *shard,
+								   const PropertyName *name,
+								   uint32_t hash)
+{
+	struct mapirops_namedprops_entry	*entry;
+
+	for (entry = shard->buckets[hash & (shard->bucket_count - 1)]; entry; entry = entry->next) {
+		if (entry->hash != hash || entry->name.Kind != name->Kind ||
+		    memcmp(&entry->name.Guid, &name->Guid, sizeof (GUID))) {
+			continue;
+		}
+		if (name->Kind == MNID_ID) {
+			if (entry->name.LID == name->LID) {
+				return entry;
+			}
+		} else if (entry->name.NameSize == name->NameSize &&
+			   !memcmp(entry->name.Name, name->Name, name->NameSize)) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+/*
+   Double the number of buckets of a shard, the shard lock must be held
+   for writing
+ */
+static void mapirops_namedprops_grow(struct mapirops_namedprops_shard *shard)
+{
+	struct mapirops_namedprops_entry	**buckets;
+	struct mapirops_namedprops_entry	*entry;
+	struct mapirops_namedprops_entry	*next;
+	uint32_t				count = shard->bucket_count * 2;
+	uint32_t				i;
+
+	buckets = talloc_zero_array(shard, struct mapirops_namedprops_entry *, count);
+	if (buckets == NULL) {
+		/* Longer chains, still correct */
+		return;
+	}
+
+	for (i = 0; i < shard->bucket_count; i++) {
+		for (entry = shard->buckets[i]; entry; entry = next) {
+			next = entry->next;
+			entry->next = buckets[entry->hash & (count - 1)];
+			buckets[entry->hash & (count - 1)] = entry;
+		}
+	}
+	talloc_free(shard->buckets);
+	shard->buckets = buckets;
+	shard->bucket_count = count;
+}
+
+/*
+   Map a new name to the next property ID, the shard lock must be held
+   for writing
+ */
+static struct mapirops_namedprops_entry *mapirops_namedprops_insert(struct mapirops_namedprops *map,
+								     struct mapirops_namedprops_shard *shard,
+								     const PropertyName *name,
+								     uint32_t hash)
+{
+	struct mapirops_namedprops_entry	*entry;
+	struct mapirops_namedprops_entry	***chunk;
+	uint32_t				index;
+	uint8_t					*copy;
+
+	entry = (struct mapirops_namedprops_entry *) talloc_named_const(shard, sizeof (struct mapirops_namedprops_entry) +
+									 (name->Kind == MNID_STRING ? name->NameSize : 0),
+									 "struct mapirops_namedprops_entry");
+	if (entry == NULL) {
+		return NULL;
+	}
+	entry->hash = hash;
+	entry->name = *name;
+	if (name->Kind == MNID_STRING) {
+		copy = (uint8_t *)(entry + 1);
+		memcpy(copy, name->Name, name->NameSize);
+		entry->name.Name = copy;
+		entry->name.LID = 0;
+	} else {
+		entry->name.Name = NULL;
+		entry->name.NameSize = 0;
+	}
+
+	pthread_rwlock_wrlock(&map->ids_lock);
+	if (map->next_id > MAPIROPS_NAMEDPROPS_LAST_ID) {
+		pthread_rwlock_unlock(&map->ids_lock);
+		talloc_free(entry);
+		mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR, "Named property IDs exhausted");
+		return NULL;
+	}
+	index = map->next_id - MAPIROPS_NAMEDPROPS_FIRST_ID;
+	chunk = &map->ids[index / MAPIROPS_NAMEDPROPS_CHUNK];
+	if (*chunk == NULL) {
+		*chunk = talloc_zero_array(map->ids_ctx, struct mapirops_namedprops_entry *,
+					   MAPIROPS_NAMEDPROPS_CHUNK);
+		if (*chunk == NULL) {
+			pthread_rwlock_unlock(&map->ids_lock);
+			talloc_free(entry);
+			return NULL;
+		}
+	}
+	entry->id = map->next_id++;
+	(*chunk)[index % MAPIROPS_NAMEDPROPS_CHUNK] = entry;
+	pthread_rwlock_unlock(&map->ids_lock);
+
+	entry->next = shard->buckets[hash & (shard->bucket_count - 1)];
+	shard->buckets[hash & (shard->bucket_count - 1)] = entry;
+	if (++shard->count > shard->bucket_count) {
+		mapirops_namedprops_grow(shard);
+	}
+
+	return entry;
+}
+
+/*
+   Destroy the locks
+ */
+static int mapirops_namedprops_destructor(struct mapirops_namedprops *map)
+{
+	uint32_t	i;
+
+	for (i = 0; i < MAPIROPS_NAMEDPROPS_SHARDS; i++) {
+		pthread_rwlock_destroy(&map->shards[i]->lock);
+	}
+	pthread_rwlock_destroy(&map->ids_lock);
+
+	return 0;
+}
+
+/**
+   \details Create an empty named property map
+
+   \param mem_ctx Pointer to the memory context
+
+   \return Allocated mapirops_namedprops structure on success,
+   otherwise NULL.
+ */
+struct mapirops_namedprops *mapirops_namedprops_init(TALLOC_CTX *mem_ctx)
+{
+	struct mapirops_namedprops		*map;
+	struct mapirops_namedprops_shard	*shard;
+	uint32_t				i;
+
+	map = talloc_zero(mem_ctx, struct mapirops_namedprops);
+	if (map == NULL) {
+		return NULL;
+	}
+
+	map->next_id = MAPIROPS_NAMEDPROPS_FIRST_ID;
+	map->ids_ctx = talloc_new(map);
+	if (map->ids_ctx == NULL) {
+		talloc_free(map);
+		return NULL;
+	}
+
+	for (i = 0; i < MAPIROPS_NAMEDPROPS_SHARDS; i++) {
+		shard = talloc_zero(map, struct mapirops_namedprops_shard);
+		if (shard == NULL) {
+			talloc_free(map);
+			return NULL;
+		}
+		shard->bucket_count = MAPIROPS_NAMEDPROPS_BUCKETS;
+		shard->buckets = talloc_zero_array(shard, struct mapirops_namedprops_entry *,
+						   shard->bucket_count);
+		if (shard->buckets == NULL) {
+			talloc_free(map);
+			return NULL;
+		}
+		map->shards[i] = shard;
+	}
+
+	for (i = 0; i < MAPIROPS_NAMEDPROPS_SHARDS; i++) {
+		pthread_rwlock_init(&map->shards[i]->lock, NULL);
+	}
+	pthread_rwlock_init(&map->ids_lock, NULL);
+	talloc_set_destructor(map, mapirops_namedprops_destructor);
+
+	return map;
+}
+
+/**
+   \details Map a batch of property names to property IDs
+
+   Names are resolved shard by shard, each shard lock is taken once per
+   MAPIROPS_NAMEDPROPS_BATCH names. PS_MAPI names with a LID below
+   MAPIROPS_NAMEDPROPS_FIRST_ID map to the LID itself.
+
+   \param map Pointer to the mapirops_namedprops structure
+   \param names Array of count property names
+   \param count Number of names
+   \param create Whether unknown names are mapped to new property IDs
+   \param ids Array of count property IDs to return, 0 for the names
+   which couldn't be mapped
+
+   \return MAPIROPS_ERR_SUCCESS if all the names were mapped,
+   MAPIROPS_ERR_NOT_FOUND if at least one wasn't, otherwise MAPIROPS
+   error
+ */
+enum mapirops_err_code mapirops_namedprops_get_ids(struct mapirops_namedprops *map, const PropertyName *names,
+						   uint32_t count, uint8_t create, uint16_t *ids)
+{
+	struct mapirops_namedprops_shard	*shard;
+	struct mapirops_namedprops_entry	*entry;
+	const PropertyName			*name;
+	uint32_t				hash[MAPIROPS_NAMEDPROPS_BATCH];
+	uint8_t					shard_of[MAPIROPS_NAMEDPROPS_BATCH];
+	uint32_t				missing = 0;
+	uint32_t				pending;
+	uint32_t				unknown;
+	uint32_t				start;
+	uint32_t				n;
+	uint32_t				i;
+	uint32_t				s;
+
+	if (!map || (count && (!names || !ids))) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	for (start = 0; start < count; start += n) {
+		n = MIN(count - start, MAPIROPS_NAMEDPROPS_BATCH);
+
+		/* Bit s of pending is set if names of the batch hash to shard s */
+		pending = 0;
+		for (i = 0; i < n; i++) {
+			name = &names[start + i];
+			ids[start + i] = 0;
+			shard_of[i] = MAPIROPS_NAMEDPROPS_SHARDS;
+			if (!mapirops_namedprops_valid(name)) {
+				missing++;
+			} else if (name->Kind == MNID_ID && name->LID && name->LID < MAPIROPS_NAMEDPROPS_FIRST_ID &&
+				   !memcmp(&name->Guid, &PS_MAPI, sizeof (GUID))) {
+				ids[start + i] = name->LID;
+			} else {
+				hash[i] = mapirops_namedprops_hash(name);
+				shard_of[i] = hash[i] >> 28;
+				pending |= 1U << shard_of[i];
+			}
+		}
+
+		for (s = 0; s < MAPIROPS_NAMEDPROPS_SHARDS; s++) {
+			if (!(pending & (1U << s))) continue;
+			shard = map->shards[s];
+
+			unknown = 0;
+			pthread_rwlock_rdlock(&shard->lock);
+			for (i = 0; i < n; i++) {
+				if (shard_of[i] != s) continue;
+				entry = mapirops_namedprops_find(shard, &names[start + i], hash[i]);
+				if (entry) {
+					ids[start + i] = entry->id;
+				} else {
+					unknown++;
+				}
+			}
+			pthread_rwlock_unlock(&shard->lock);
+
+			if (unknown && create) {
+				/* Another session may have mapped the name meanwhile */
+				pthread_rwlock_wrlock(&shard->lock);
+				for (i = 0; i < n; i++) {
+					if (shard_of[i] != s || ids[start + i]) continue;
+					entry = mapirops_namedprops_find(shard, &names[start + i], hash[i]);
+					if (entry == NULL) {
+						entry = mapirops_namedprops_insert(map, shard, &names[start + i], hash[i]);
+					}
+					if (entry) {
+						ids[start + i] = entry->id;
+						unknown--;
+					}
+				}
+				pthread_rwlock_unlock(&shard->lock);
+			}
+			missing += unknown;
+		}
+	}
+
+	return missing ? MAPIROPS_ERR_NOT_FOUND : MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Find the names of a batch of property IDs
+
+   \param map Pointer to the mapirops_namedprops structure
+   \param ids Array of count property IDs
+   \param count Number of property IDs
+   \param names Array of count property names to return. String names
+   point to the copy owned by the map, valid as long as the map. IDs
+   without name get Kind MNID_NONE.
+
+   \return MAPIROPS_ERR_SUCCESS if all the IDs have a name,
+   MAPIROPS_ERR_NOT_FOUND if at least one hasn't, otherwise MAPIROPS
+   error
+ */
+enum mapirops_err_code mapirops_namedprops_get_names(struct mapirops_namedprops *map, const uint16_t *ids,
+						     uint32_t count, PropertyName *names)
+{
+	struct mapirops_namedprops_entry	**chunk;
+	struct mapirops_namedprops_entry	*entry;
+	uint32_t				missing = 0;
+	uint32_t				index;
+	uint32_t				i;
+
+	if (!map || (count && (!ids || !names))) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	pthread_rwlock_rdlock(&map->ids_lock);
+	for (i = 0; i < count; i++) {
+		if (ids[i] < MAPIROPS_NAMEDPROPS_FIRST_ID) {
+			memset(&names[i], 0, sizeof (PropertyName));
+			names[i].Kind = MNID_ID;
+			names[i].Guid = PS_MAPI;
+			names[i].LID = ids[i];
+			continue;
+		}
+
+		entry = NULL;
+		if (ids[i] < map->next_id) {
+			index = ids[i] - MAPIROPS_NAMEDPROPS_FIRST_ID;
+			chunk = map->ids[index / MAPIROPS_NAMEDPROPS_CHUNK];
+			entry = chunk[index % MAPIROPS_NAMEDPROPS_CHUNK];
+		}
+		if (entry) {
+			names[i] = entry->name;
+		} else {
+			memset(&names[i], 0, sizeof (PropertyName));
+			names[i].Kind = MNID_NONE;
+			missing++;
+		}
+	}
+	pthread_rwlock_unlock(&map->ids_lock);
+
+	return missing ? MAPIROPS_ERR_NOT_FOUND : MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Build the RopGetPropertyIdsFromNames response for a request
+
+   All the names of the request are resolved in one call. Without
+   names, the response lists the property IDs of every named property
+   of the map ([MS-OXCPRPT] section 3.2.5.8).
+
+   \param map Pointer to the mapirops_namedprops structure
+   \param mem_ctx Pointer to the memory context of the response
+   \param request Pointer to the request
+   \param response Pointer to the response to fill
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_namedprops_RopGetPropertyIdsFromNames(struct mapirops_namedprops *map,
+								      TALLOC_CTX *mem_ctx,
+								      const struct RopGetPropertyIdsFromNames_request *request,
+								      struct RopGetPropertyIdsFromNames_response *response)
+{
+	struct RopGetPropertyIdsFromNames_success	*success;
+	enum mapirops_err_code				retval;
+	uint32_t					i;
+
+	if (!map || !request || !response) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	memset(response, 0, sizeof (struct RopGetPropertyIdsFromNames_response));
+	response->RopId = RopGetPropertyIdsFromNames;
+	response->InputHandleIndex = request->InputHandleIndex;
+	success = &response->ResponseType.success;
+
+	if (request->PropertyNameCount == 0) {
+		pthread_rwlock_rdlock(&map->ids_lock);
+		success->PropertyIdCount = map->next_id - MAPIROPS_NAMEDPROPS_FIRST_ID;
+		pthread_rwlock_unlock(&map->ids_lock);
+		success->PropertyIds = talloc_array(mem_ctx, uint16_t, success->PropertyIdCount);
+		if (success->PropertyIds == NULL) {
+			return MAPIROPS_ERR_NO_MEMORY;
+		}
+		for (i = 0; i < success->PropertyIdCount; i++) {
+			success->PropertyIds[i] = MAPIROPS_NAMEDPROPS_FIRST_ID + i;
+		}
+		response->ReturnValue = ecNone;
+		return MAPIROPS_ERR_SUCCESS;
+	}
+
+	success->PropertyIdCount = request->PropertyNameCount;
+	success->PropertyIds = talloc_array(mem_ctx, uint16_t, success->PropertyIdCount);
+	if (success->PropertyIds == NULL) {
+		return MAPIROPS_ERR_NO_MEMORY;
+	}
+
+	retval = mapirops_namedprops_get_ids(map, request->PropertyNames, request->PropertyNameCount,
+					     (request->Flags & GetPropertyIdsFromNames_Create) ? 1 : 0,
+					     success->PropertyIds);
+	if (retval == MAPIROPS_ERR_SUCCESS) {
+		response->ReturnValue = ecNone;
+	} else if (retval == MAPIROPS_ERR_NOT_FOUND) {
+		response->ReturnValue = ecWarnWithErrors;
+	} else {
+		return retval;
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Build the RopGetNamesFromPropertyIds response for a request
+
+   All the property IDs of the request are resolved in one call. The
+   string names of the response point to the copies owned by the map.
+
+   \param map Pointer to the mapirops_namedprops structure
+   \param mem_ctx Pointer to the memory context of the response
+   \param request Pointer to the request
+   \param response Pointer to the response to fill
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_namedprops_RopGetNamesFromPropertyIds(struct mapirops_namedprops *map,
+								      TALLOC_CTX *mem_ctx,
+								      const struct RopGetNamesFromPropertyIds_request *request,
+								      struct RopGetNamesFromPropertyIds_response *response)
+{
+	struct RopGetNamesFromPropertyIds_success	*success;
+	enum mapirops_err_code				retval;
+
+	if (!map || !request || !response) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	memset(response, 0, sizeof (struct RopGetNamesFromPropertyIds_response));
+	response->RopId = RopGetNamesFromPropertyIds;
+	response->InputHandleIndex = request->InputHandleIndex;
+	success = &response->ResponseType.success;
+
+	success->PropertyNameCount = request->PropertyIdCount;
+	success->PropertyNames = talloc_array(mem_ctx, PropertyName, success->PropertyNameCount);
+	if (success->PropertyNames == NULL) {
+		return MAPIROPS_ERR_NO_MEMORY;
+	}
+
+	retval = mapirops_namedprops_get_names(map, request->PropertyIds, request->PropertyIdCount,
+					       success->PropertyNames);
+	if (retval == MAPIROPS_ERR_SUCCESS) {
+		response->ReturnValue = ecNone;
+	} else if (retval == MAPIROPS_ERR_NOT_FOUND) {
+		response->ReturnValue = ecWarnWithErrors;
+	} else {
+		return retval;
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
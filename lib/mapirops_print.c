@@ -7,30 +7,365 @@
    it under the terms of the GNU General Public License as published by
    the Free Software Foundation; either version 3 of the License, or
    (at your option) any later version.
-   
+
    This program is distributed in the hope that it will be useful,
    but WITHOUT ANY WARRANTY; without even the implied warranty of
    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
    GNU General Public License for more details.
-   
+
    You should have received a copy of the GNU General Public License
    along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "config.h"
+
 #include "libmapirops.h"
+#include "libmapirops_private.h"
+
+#include <errno.h>
+#include <unistd.h>
 
 #ifndef	MIN
 #define MIN(a,b) (((a)<(b))?(a):(b))
 #endif
 
+/** \cond */
+#define	HEXDUMP_CHUNK		8192
+
+#define	HEXDUMP_ROW(h)	h "0" h "1" h "2" h "3" h "4" h "5" h "6" h "7" \
+			h "8" h "9" h "A" h "B" h "C" h "D" h "E" h "F"
+
+static const char hexdump_hex[] =
+	HEXDUMP_ROW("0") HEXDUMP_ROW("1") HEXDUMP_ROW("2") HEXDUMP_ROW("3")
+	HEXDUMP_ROW("4") HEXDUMP_ROW("5") HEXDUMP_ROW("6") HEXDUMP_ROW("7")
+	HEXDUMP_ROW("8") HEXDUMP_ROW("9") HEXDUMP_ROW("A") HEXDUMP_ROW("B")
+	HEXDUMP_ROW("C") HEXDUMP_ROW("D") HEXDUMP_ROW("E") HEXDUMP_ROW("F");
+
+#define	HEXDUMP_ASC(c)	(((c) >= 0x20 && (c) < 0x7F) ? (char)(c) : '.')
+
+struct hexdump_state {
+	const uint8_t				*buf;
+	uint32_t				len;
+	uint32_t				offset;	/* Start of the next line */
+	uint32_t				line;	/* Start of the last line printed */
+	const struct mapirops_hexdump_note	*notes;
+	uint32_t				count;
+	uint32_t				note;	/* Next note to print */
+};
+/** \endcond */
+
+/*
+   Number of characters of the "[%04X] " line prefix
+ */
+static uint32_t hexdump_prefix_size(uint32_t offset)
+{
+	uint32_t	digits = 4;
+
+	while (digits < 8 && (offset >> (digits * 4))) {
+		digits++;
+	}
+
+	return digits + 3;
+}
+
+/*
+   Number of characters of the line of n bytes at offset
+ */
+static size_t hexdump_line_size(uint32_t offset, uint32_t n)
+{
+	size_t	size;
+
+	size = hexdump_prefix_size(offset) + 3 * n + (n >= 8 ? 2 : 0);
+	if (n == 16) {
+		size += 2;
+	} else {
+		size += 1 + (n < 8 ? 1 : 0) + 3 * (16 - n);
+	}
+
+	return size + n + 2;
+}
+
+/*
+   Column of the byte at offset in the line starting at line
+ */
+static size_t hexdump_note_column(uint32_t line, uint32_t offset)
+{
+	uint32_t	k = offset - line;
+
+	return hexdump_prefix_size(line) + 3 * k + (k >= 8 ? 2 : 0);
+}
+
+/*
+   Number of characters of the annotation line of note
+ */
+static size_t hexdump_note_size(uint32_t line, const struct mapirops_hexdump_note *note)
+{
+	size_t	len = note->name ? strnlen(note->name, MAPIROPS_HEXDUMP_NAME_MAX) : 0;
+
+	return hexdump_note_column(line, note->offset) + 2 + len + 1;
+}
+
+/*
+   Format the line of n bytes at offset, the same way as printf used to
+ */
+static char *hexdump_line(char *p, uint32_t offset, const uint8_t *buf, uint32_t n)
+{
+	uint32_t	digits = hexdump_prefix_size(offset) - 3;
+	uint32_t	i;
+
+	*p++ = '[';
+	for (i = digits; i > 0; i--) {
+		*p++ = hexdump_hex[2 * ((offset >> ((i - 1) * 4)) & 0xF) + 1];
+	}
+	*p++ = ']';
+	*p++ = ' ';
+
+	if (n == 16) {
+		/* Fixed layout of a complete line */
+		memset(p, ' ', 70);
+		for (i = 0; i < 8; i++) {
+			memcpy(p + 3 * i, &hexdump_hex[2 * buf[i]], 2);
+			memcpy(p + 26 + 3 * i, &hexdump_hex[2 * buf[8 + i]], 2);
+			p[52 + i] = HEXDUMP_ASC(buf[i]);
+			p[61 + i] = HEXDUMP_ASC(buf[8 + i]);
+		}
+		p[69] = '\n';
+		return p + 70;
+	}
+
+	for (i = 0; i < n; i++) {
+		memcpy(p, &hexdump_hex[2 * buf[i]], 2);
+		p[2] = ' ';
+		p += 3;
+		if (i == 7) {
+			p[0] = ' ';
+			p[1] = ' ';
+			p += 2;
+		}
+	}
+	*p++ = ' ';
+	if (n < 8) {
+		*p++ = ' ';
+	}
+	memset(p, ' ', 3 * (16 - n));
+	p += 3 * (16 - n);
+
+	for (i = 0; i < n; i++) {
+		if (i == 8) {
+			*p++ = ' ';
+		}
+		*p++ = HEXDUMP_ASC(buf[i]);
+	}
+	if (n <= 8) {
+		*p++ = ' ';
+	}
+	*p++ = '\n';
+
+	return p;
+}
+
+/*
+   Format the annotation line of note, a caret under the byte followed
+   by the name
+ */
+static char *hexdump_note(char *p, uint32_t line, const struct mapirops_hexdump_note *note)
+{
+	size_t	column = hexdump_note_column(line, note->offset);
+	size_t	len = note->name ? strnlen(note->name, MAPIROPS_HEXDUMP_NAME_MAX) : 0;
+
+	memset(p, ' ', column);
+	p += column;
+	*p++ = '^';
+	*p++ = ' ';
+	if (len) {
+		memcpy(p, note->name, len);
+		p += len;
+	}
+	*p++ = '\n';
+
+	return p;
+}
+
+/*
+   Whether the whole buffer and its annotations were formatted
+ */
+static int hexdump_done(const struct hexdump_state *st)
+{
+	return (st->offset >= st->len &&
+		(st->note == st->count || st->notes[st->note].offset >= st->len));
+}
+
+/*
+   Format as many complete lines as fit in size characters
+
+   Annotations are printed after the line holding their byte, notes
+   for a byte of a line already printed are skipped.
+ */
+static size_t hexdump_fill(struct hexdump_state *st, char *out, size_t size)
+{
+	const struct mapirops_hexdump_note	*note;
+	char					*p = out;
+	uint32_t				n;
+
+	for (;;) {
+		while (st->note < st->count && st->notes[st->note].offset < st->offset) {
+			note = &st->notes[st->note];
+			if (note->offset >= st->line) {
+				if ((size_t)(out + size - p) < hexdump_note_size(st->line, note)) {
+					return p - out;
+				}
+				p = hexdump_note(p, st->line, note);
+			}
+			st->note++;
+		}
+
+		if (st->offset >= st->len) {
+			break;
+		}
+		n = MIN(16, st->len - st->offset);
+		if ((size_t)(out + size - p) < hexdump_line_size(st->offset, n)) {
+			break;
+		}
+		p = hexdump_line(p, st->offset, st->buf + st->offset, n);
+		st->line = st->offset;
+		st->offset += n;
+	}
+
+	return p - out;
+}
+
+static void hexdump_init(struct hexdump_state *st, const uint8_t *buf, uint32_t len,
+			 const struct mapirops_hexdump_note *notes, uint32_t count)
+{
+	memset(st, 0, sizeof (struct hexdump_state));
+	st->buf = buf;
+	st->len = len;
+	st->notes = notes;
+	st->count = notes ? count : 0;
+}
+
 /**
+   \details Compute the size of the buffer needed by
+   mapirops_hexdump_buf
+
+   \param len Length of the uint8_t array
+   \param notes Array of count annotations sorted by offset, can be NULL
+   \param count Number of annotations
+
+   \return Number of characters of the hexdump, terminating null
+   character included
  */
-static void mapirops_print_asc(const uint8_t *buf, int len)
+size_t mapirops_hexdump_size(uint32_t len, const struct mapirops_hexdump_note *notes, uint32_t count)
 {
-	int i;
+	size_t		size = 1;
+	uint32_t	offset;
+	uint32_t	line = 0;
+	uint32_t	note = 0;
+	uint32_t	n;
 
-	for (i = 0; i < len; i++)
-		printf("%c", isprint(buf[i]) ? buf[i] : '.');
+	if (!notes) {
+		count = 0;
+	}
+
+	for (offset = 0; offset < len; offset += n) {
+		n = MIN(16, len - offset);
+		size += hexdump_line_size(offset, n);
+		line = offset;
+		for (; note < count && notes[note].offset < offset + n; note++) {
+			if (notes[note].offset >= line) {
+				size += hexdump_note_size(line, &notes[note]);
+			}
+		}
+	}
+
+	return size;
+}
+
+/**
+   \details Format the hexdump of an array of uint8_t into a buffer
+
+   The output is the one of mapirops_hexdump. Each annotation adds a
+   line under the line of its byte, with a caret under the byte followed
+   by the annotation name.
+
+   \param buf Pointer to the uint8_t array to hexdump
+   \param len Length of the uint8_t array
+   \param notes Array of count annotations sorted by offset, can be NULL
+   \param count Number of annotations
+   \param out Pointer to the output buffer
+   \param size Size of the output buffer, see mapirops_hexdump_size
+   \param written Pointer to the number of characters written,
+   terminating null character excluded, can be NULL
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_BUFFER_TOO_SMALL
+   if out only holds the first lines, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_hexdump_buf(const uint8_t *buf, uint32_t len,
+					    const struct mapirops_hexdump_note *notes, uint32_t count,
+					    char *out, size_t size, size_t *written)
+{
+	struct hexdump_state	st;
+	size_t			n;
+
+	if ((len && !buf) || !out || !size) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	hexdump_init(&st, buf, len, notes, count);
+	n = hexdump_fill(&st, out, size - 1);
+	out[n] = '\0';
+	if (written) {
+		*written = n;
+	}
+
+	return hexdump_done(&st) ? MAPIROPS_ERR_SUCCESS : MAPIROPS_ERR_BUFFER_TOO_SMALL;
+}
+
+/**
+   \details Write the hexdump of an array of uint8_t to a file
+   descriptor
+
+   The hexdump is formatted in chunks of HEXDUMP_CHUNK characters on
+   the stack, each written with a single write call.
+
+   \param fd File descriptor to write to
+   \param buf Pointer to the uint8_t array to hexdump
+   \param len Length of the uint8_t array
+   \param notes Array of count annotations sorted by offset, can be NULL
+   \param count Number of annotations
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_hexdump_fd(int fd, const uint8_t *buf, uint32_t len,
+					   const struct mapirops_hexdump_note *notes, uint32_t count)
+{
+	struct hexdump_state	st;
+	char			chunk[HEXDUMP_CHUNK];
+	size_t			n;
+	size_t			done;
+	ssize_t			ret;
+
+	if (fd < 0 || (len && !buf)) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	hexdump_init(&st, buf, len, notes, count);
+	while (!hexdump_done(&st)) {
+		n = hexdump_fill(&st, chunk, sizeof (chunk));
+		for (done = 0; done < n; done += ret) {
+			ret = write(fd, chunk + done, n - done);
+			if (ret < 0) {
+				if (errno == EINTR) {
+					ret = 0;
+					continue;
+				}
+				return mapirops_error(MAPIROPS_GENERIC_ERR, LOG_ERR,
+						      "hexdump write failed: %s", strerror(errno));
+			}
+		}
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
 }
 
 /**
@@ -42,32 +377,17 @@ static void mapirops_print_asc(const uint8_t *buf, int len)
  */
 void mapirops_hexdump(const uint8_t *buf, int len)
 {
-	int i = 0;
+	struct hexdump_state	st;
+	char			chunk[HEXDUMP_CHUNK];
+	size_t			n;
 
-	for (i=0;i<len;) {
-		if (i%16 == 0 && i < len) {
-			printf("[%04X] ",i);
-		}
-
-		printf("%02X ",(int)buf[i]);
-		i++;
-		if (i % 8 == 0) printf("  ");
-		if (i%16 == 0) {
-			mapirops_print_asc(&buf[i-16],8); printf(" ");
-			mapirops_print_asc(&buf[i-8],8); printf("\n");
-		}
+	if (len <= 0 || !buf) {
+		return;
 	}
 
-	if (i%16) {
-		int n;
-		n = 16 - (i%16);
-		printf(" ");
-		if (n>8) printf(" ");
-		while (n--) printf("   ");
-		n = MIN(8,i%16);
-		mapirops_print_asc(&buf[i-(i%16)],n); printf(" ");
-		n = (i%16) - n;
-		if (n>0) mapirops_print_asc(&buf[i-n], n);
-		printf("\n");
+	hexdump_init(&st, buf, len, NULL, 0);
+	while (!hexdump_done(&st)) {
+		n = hexdump_fill(&st, chunk, sizeof (chunk));
+		fwrite(chunk, 1, n, stdout);
 	}
 }
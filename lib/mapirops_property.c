@@ -0,0 +1,935 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_property.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief PropertyValue, TypedPropertyValue and TaggedPropertyValue
+   codec
+
+   The property type indexes a table describing how values of this
+   type are stored. Fixed-size values have the same layout in memory
+   and on the wire on little-endian hosts: single values and whole
+   multiple-valued arrays are copied with a single memcpy. Only
+   variable-size values (strings and binaries) go through a per-type
+   handler.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+/** \cond */
+typedef enum mapirops_err_code (*mapirops_property_push_fn)(struct mapirops_push *, const void *);
+typedef enum mapirops_err_code (*mapirops_property_pull_fn)(struct mapirops_pull *, TALLOC_CTX *, void *);
+
+struct mapirops_proptype {
+	uint8_t				size;	/* Wire size of fixed-size values, 0 if variable */
+	uint8_t				mv;	/* Whether the multiple-valued type exists */
+	uint8_t				elem;	/* Memory size of variable-size values */
+	mapirops_property_push_fn	push;	/* Push a variable-size value */
+	mapirops_property_pull_fn	pull;	/* Pull a variable-size value */
+};
+
+#define	MAPIROPS_PROPTYPE_MAX	(PT_BINARY + 1)
+
+/* At most 3 UTF-8 bytes per UTF-16 code unit, plus the null character */
+#define	MAPIROPS_PROPERTY_UTF8_SIZE(len)	(((len) / 2) * 3 + 1)
+/** \endcond */
+
+static enum mapirops_err_code mapirops_property_push_null(struct mapirops_push *push, const void *v)
+{
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static enum mapirops_err_code mapirops_property_pull_null(struct mapirops_pull *pull, TALLOC_CTX *mem_ctx, void *v)
+{
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static enum mapirops_err_code mapirops_property_push_string8(struct mapirops_push *push, const void *v)
+{
+	return mapirops_push_ascii_string(push, 0, *(char * const *)v);
+}
+
+static enum mapirops_err_code mapirops_property_pull_string8(struct mapirops_pull *pull, TALLOC_CTX *mem_ctx, void *v)
+{
+	const uint8_t	*start;
+	const uint8_t	*end = NULL;
+	char		*str;
+	size_t		len;
+	size_t		outlen;
+
+	start = pull->data.data + pull->offset;
+	if (pull->offset < pull->data.length) {
+		end = memchr(start, 0, pull->data.length - pull->offset);
+	}
+	if (end == NULL) {
+		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR, "Unterminated PT_STRING8 value");
+	}
+
+	len = end - start;
+	if (pull->codepage) {
+		str = talloc_array(mem_ctx, char, MAPIROPS_CODEPAGE_UTF8_SIZE(len));
+	} else {
+		str = talloc_strndup(mem_ctx, (const char *)start, len);
+	}
+	if (str == NULL) {
+		return mapirops_error(MAPIROPS_ERR_ALLOC, LOG_ERR,
+				      "Failed to pull PT_STRING8 value of %zu bytes", len);
+	}
+	if (pull->codepage) {
+		if (mapirops_codepage_to_utf8(pull->codepage, start, len, str, &outlen) != MAPIROPS_ERR_SUCCESS) {
+			talloc_free(str);
+			return mapirops_error(MAPIROPS_ERR_ICONV, LOG_ERR, "PT_STRING8 value not in pull codepage");
+		}
+	}
+	*(char **)v = str;
+	pull->offset += len + 1;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static enum mapirops_err_code mapirops_property_push_unicode(struct mapirops_push *push, const void *v)
+{
+	char	*str = *(char * const *)v;
+
+	return mapirops_push_utf16_string(push, 0, str ? str : (char *)"");
+}
+
+/*
+   Return in len the size in bytes of the null-terminated UTF-16 string
+   at the current offset, null character excluded
+ */
+static enum mapirops_err_code mapirops_property_utf16_len(struct mapirops_pull *pull, size_t *len)
+{
+	size_t		remaining;
+	size_t		i;
+
+	remaining = (pull->offset < pull->data.length) ? pull->data.length - pull->offset : 0;
+	i = mapirops_utf16_scan(pull->data.data + pull->offset, remaining);
+	if (i == remaining) {
+		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR, "Unterminated PT_UNICODE value");
+	}
+	*len = i;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/*
+   Convert len bytes of UTF-16 at the current offset to a
+   null-terminated UTF-8 string in out, which must hold at least
+   MAPIROPS_PROPERTY_UTF8_SIZE(len) bytes, and skip the UTF-16 null
+   character. Return in outlen the size of the UTF-8 string, null
+   character excluded.
+ */
+static enum mapirops_err_code mapirops_property_utf16_to_utf8(struct mapirops_pull *pull, size_t len,
+							      char *out, size_t *outlen)
+{
+	char	*in;
+	char	*start = out;
+	size_t	inlen = len;
+	size_t	left = MAPIROPS_PROPERTY_UTF8_SIZE(len);
+
+	if (unlikely(pull->utf16to8 == (iconv_t)-1)) {
+		MAPIROPS_CHECK(mapirops_pull_cursor_iconv(pull));
+	}
+
+	in = (char *)pull->data.data + pull->offset;
+	if (iconv(pull->utf16to8, &in, &inlen, &out, &left) == (size_t)-1) {
+		return MAPIROPS_ERR_ICONV;
+	}
+	*out = '\0';
+	*outlen = out - start;
+	pull->offset += len + 2;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static enum mapirops_err_code mapirops_property_pull_unicode(struct mapirops_pull *pull, TALLOC_CTX *mem_ctx, void *v)
+{
+	enum mapirops_err_code	retval;
+	size_t			len = 0;
+	size_t			outlen;
+	char			*str;
+
+	MAPIROPS_CHECK(mapirops_property_utf16_len(pull, &len));
+
+	str = talloc_array(mem_ctx, char, MAPIROPS_PROPERTY_UTF8_SIZE(len));
+	if (str == NULL) {
+		return mapirops_error(MAPIROPS_ERR_ALLOC, LOG_ERR,
+				      "Failed to pull PT_UNICODE value of %zu bytes", len);
+	}
+
+	retval = mapirops_property_utf16_to_utf8(pull, len, str, &outlen);
+	if (retval != MAPIROPS_ERR_SUCCESS) {
+		talloc_free(str);
+		return retval;
+	}
+	*(char **)v = str;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static enum mapirops_err_code mapirops_property_push_binary(struct mapirops_push *push, const void *v)
+{
+	const BinaryValue	*bin = (const BinaryValue *)v;
+
+	if (bin->cb && bin->lpb == NULL) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	MAPIROPS_CHECK(mapirops_push_uint16(push, bin->cb));
+	if (bin->cb) {
+		MAPIROPS_CHECK(mapirops_push_bytes(push, bin->lpb, bin->cb));
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static enum mapirops_err_code mapirops_property_pull_binary(struct mapirops_pull *pull, TALLOC_CTX *mem_ctx, void *v)
+{
+	BinaryValue	*bin = (BinaryValue *)v;
+
+	MAPIROPS_CHECK(mapirops_pull_uint16(pull, &bin->cb));
+	bin->lpb = NULL;
+	if (bin->cb == 0) {
+		return MAPIROPS_ERR_SUCCESS;
+	}
+
+	if (bin->cb > pull->data.length - pull->offset) {
+		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+				      "Binary value of %u bytes past end of buffer", bin->cb);
+	}
+
+	bin->lpb = talloc_memdup(mem_ctx, pull->data.data + pull->offset, bin->cb);
+	if (bin->lpb == NULL) {
+		return mapirops_error(MAPIROPS_ERR_ALLOC, LOG_ERR,
+				      "Failed to pull binary value of %u bytes", bin->cb);
+	}
+	pull->offset += bin->cb;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/*
+   Indexed by property type without MV_FLAG. Entries left empty are
+   property types which can't be serialized in ROP buffers.
+ */
+static const struct mapirops_proptype mapirops_proptypes[MAPIROPS_PROPTYPE_MAX] = {
+	[PT_NULL]	= { 0, 0, 0, mapirops_property_push_null, mapirops_property_pull_null },
+	[PT_SHORT]	= { 2, 1, 0, NULL, NULL },
+	[PT_LONG]	= { 4, 1, 0, NULL, NULL },
+	[PT_FLOAT]	= { 4, 1, 0, NULL, NULL },
+	[PT_DOUBLE]	= { 8, 1, 0, NULL, NULL },
+	[PT_CURRENCY]	= { 8, 1, 0, NULL, NULL },
+	[PT_APPTIME]	= { 8, 1, 0, NULL, NULL },
+	[PT_ERROR]	= { 4, 0, 0, NULL, NULL },
+	[PT_BOOLEAN]	= { 1, 0, 0, NULL, NULL },
+	[PT_OBJECT]	= { 4, 0, 0, NULL, NULL },
+	[PT_I8]		= { 8, 1, 0, NULL, NULL },
+	[PT_STRING8]	= { 0, 1, sizeof (char *), mapirops_property_push_string8, mapirops_property_pull_string8 },
+	[PT_UNICODE]	= { 0, 1, sizeof (char *), mapirops_property_push_unicode, mapirops_property_pull_unicode },
+	[PT_SYSTIME]	= { 8, 1, 0, NULL, NULL },
+	[PT_CLSID]	= { 16, 1, 0, NULL, NULL },
+	[PT_SVREID]	= { 0, 0, sizeof (BinaryValue), mapirops_property_push_binary, mapirops_property_pull_binary },
+	[PT_BINARY]	= { 0, 1, sizeof (BinaryValue), mapirops_property_push_binary, mapirops_property_pull_binary }
+};
+
+static const struct mapirops_proptype *mapirops_proptype_get(uint16_t type)
+{
+	const struct mapirops_proptype	*pt;
+	uint16_t			base = type & ~MV_FLAG;
+
+	if (base >= MAPIROPS_PROPTYPE_MAX) {
+		return NULL;
+	}
+
+	pt = &mapirops_proptypes[base];
+	if (!pt->size && !pt->pull) {
+		return NULL;
+	}
+	if ((type & MV_FLAG) && !pt->mv) {
+		return NULL;
+	}
+
+	return pt;
+}
+
+#ifndef	MAPIROPS_LITTLE_ENDIAN
+static void mapirops_property_reverse(uint8_t *p, uint8_t n)
+{
+	uint8_t	i;
+	uint8_t	c;
+
+	for (i = 0; i < n / 2; i++) {
+		c = p[i];
+		p[i] = p[n - 1 - i];
+		p[n - 1 - i] = c;
+	}
+}
+
+/*
+   Convert fixed-size values between wire and host byte order. GUID
+   are made of a 32-bit, two 16-bit fields and 8 bytes.
+ */
+static void mapirops_property_swap(uint8_t *data, uint8_t size, uint32_t count)
+{
+	uint32_t	i;
+
+	for (i = 0; i < count; i++, data += size) {
+		if (size == 16) {
+			mapirops_property_reverse(data, 4);
+			mapirops_property_reverse(data + 4, 2);
+			mapirops_property_reverse(data + 6, 2);
+		} else {
+			mapirops_property_reverse(data, size);
+		}
+	}
+}
+#endif
+
+static enum mapirops_err_code mapirops_property_push_fixed(struct mapirops_push *push, uint8_t size,
+							   const void *values, uint32_t count)
+{
+#ifdef	MAPIROPS_LITTLE_ENDIAN
+	if (count > UINT32_MAX / size) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+	return mapirops_push_bytes(push, (const uint8_t *)values, size * count);
+#else
+	const uint8_t	*p = (const uint8_t *)values;
+	uint8_t		v[16];
+	uint32_t	i;
+
+	for (i = 0; i < count; i++, p += size) {
+		memcpy(v, p, size);
+		mapirops_property_swap(v, size, 1);
+		MAPIROPS_CHECK(mapirops_push_bytes(push, v, size));
+	}
+	return MAPIROPS_ERR_SUCCESS;
+#endif
+}
+
+static enum mapirops_err_code mapirops_property_pull_fixed(struct mapirops_pull *pull, uint8_t size,
+							   void *values, uint32_t count)
+{
+	MAPIROPS_CHECK(mapirops_pull_bytes(pull, (uint8_t *)values, size * count));
+#ifndef	MAPIROPS_LITTLE_ENDIAN
+	mapirops_property_swap((uint8_t *)values, size, count);
+#endif
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static enum mapirops_err_code mapirops_property_push_mv(struct mapirops_push *push,
+							const struct mapirops_proptype *pt,
+							const MultiValue *mv)
+{
+	const uint8_t	*p;
+	uint32_t	i;
+
+	if (mv->cValues && mv->lpv == NULL) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	MAPIROPS_CHECK(mapirops_push_uint32(push, mv->cValues));
+	if (pt->size) {
+		return mapirops_property_push_fixed(push, pt->size, mv->lpv, mv->cValues);
+	}
+
+	p = (const uint8_t *)mv->lpv;
+	for (i = 0; i < mv->cValues; i++, p += pt->elem) {
+		MAPIROPS_CHECK(pt->push(push, p));
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static enum mapirops_err_code mapirops_property_pull_mv(struct mapirops_pull *pull, TALLOC_CTX *mem_ctx,
+							const struct mapirops_proptype *pt,
+							MultiValue *mv)
+{
+	enum mapirops_err_code	retval;
+	uint32_t		count;
+	uint32_t		remaining;
+	uint32_t		i;
+	uint8_t			*p;
+
+	MAPIROPS_CHECK(mapirops_pull_uint32(pull, &count));
+	mv->cValues = 0;
+	mv->lpv = NULL;
+
+	/* Every value takes at least one byte: don't trust count further */
+	remaining = pull->data.length - pull->offset;
+	if (count > remaining || (pt->size && count > remaining / pt->size)) {
+		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+				      "%u values past end of buffer", count);
+	}
+	if (count == 0) {
+		return MAPIROPS_ERR_SUCCESS;
+	}
+
+	mv->lpv = talloc_array_size(mem_ctx, pt->size ? pt->size : pt->elem, count);
+	if (mv->lpv == NULL) {
+		return mapirops_error(MAPIROPS_ERR_ALLOC, LOG_ERR,
+				      "Failed to allocate %u values", count);
+	}
+
+	if (pt->size) {
+		retval = mapirops_property_pull_fixed(pull, pt->size, mv->lpv, count);
+	} else {
+		retval = MAPIROPS_ERR_SUCCESS;
+		p = (uint8_t *)mv->lpv;
+		for (i = 0; i < count && retval == MAPIROPS_ERR_SUCCESS; i++, p += pt->elem) {
+			retval = pt->pull(pull, mv->lpv, p);
+		}
+	}
+
+	if (retval != MAPIROPS_ERR_SUCCESS) {
+		talloc_free(mv->lpv);
+		mv->lpv = NULL;
+		return retval;
+	}
+	mv->cValues = count;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Push a property value
+
+   \param push Pointer to the mapirops_push structure
+   \param type Property type of the value
+   \param value Pointer to the property value to push
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_INVALID_VAL
+   if type can't be serialized, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_push_PropertyValue(struct mapirops_push *push, uint16_t type,
+						   const PropertyValue *value)
+{
+	const struct mapirops_proptype	*pt;
+
+	if (!push || !value) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	pt = mapirops_proptype_get(type);
+	if (pt == NULL) {
+		return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+				      "Unsupported property type 0x%.4x", type);
+	}
+
+	if (type & MV_FLAG) {
+		return mapirops_property_push_mv(push, pt, &value->MV);
+	}
+	if (pt->size) {
+		return mapirops_property_push_fixed(push, pt->size, value, 1);
+	}
+	return pt->push(push, value);
+}
+
+/**
+   \details Pull a property value
+
+   \param pull Pointer to the mapirops_pull structure
+   \param mem_ctx Pointer to the memory context to use for strings,
+   binaries and arrays allocation
+   \param type Property type of the value
+   \param value Pointer to the property value to return
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_INVALID_VAL
+   if type can't be serialized, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_pull_PropertyValue(struct mapirops_pull *pull, TALLOC_CTX *mem_ctx,
+						   uint16_t type, PropertyValue *value)
+{
+	const struct mapirops_proptype	*pt;
+
+	if (!pull || !value) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	pt = mapirops_proptype_get(type);
+	if (pt == NULL) {
+		return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+				      "Unsupported property type 0x%.4x", type);
+	}
+
+	if (type & MV_FLAG) {
+		return mapirops_property_pull_mv(pull, mem_ctx, pt, &value->MV);
+	}
+	if (pt->size) {
+		return mapirops_property_pull_fixed(pull, pt->size, value, 1);
+	}
+	return pt->pull(pull, mem_ctx, value);
+}
+
+/**
+   \details Push a TypedPropertyValue structure
+
+   \param push Pointer to the mapirops_push structure
+   \param r Pointer to the TypedPropertyValue to push
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_push_TypedPropertyValue(struct mapirops_push *push,
+							const TypedPropertyValue *r)
+{
+	if (!r) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	MAPIROPS_CHECK(mapirops_push_uint16(push, r->PropertyType));
+	MAPIROPS_CHECK(mapirops_push_PropertyValue(push, r->PropertyType, &r->Value));
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Pull a TypedPropertyValue structure
+
+   \param pull Pointer to the mapirops_pull structure
+   \param mem_ctx Pointer to the memory context to use for value
+   allocation
+   \param r Pointer to the TypedPropertyValue to return
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_pull_TypedPropertyValue(struct mapirops_pull *pull, TALLOC_CTX *mem_ctx,
+							TypedPropertyValue *r)
+{
+	if (!r) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	MAPIROPS_CHECK(mapirops_pull_uint16(pull, &r->PropertyType));
+	MAPIROPS_CHECK(mapirops_pull_PropertyValue(pull, mem_ctx, r->PropertyType, &r->Value));
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Push a TaggedPropertyValue structure
+
+   \param push Pointer to the mapirops_push structure
+   \param r Pointer to the TaggedPropertyValue to push
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_push_TaggedPropertyValue(struct mapirops_push *push,
+							 const TaggedPropertyValue *r)
+{
+	if (!r) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	MAPIROPS_CHECK(mapirops_push_uint32(push, r->PropertyTag));
+	MAPIROPS_CHECK(mapirops_push_PropertyValue(push, PROP_TYPE(r->PropertyTag), &r->Value));
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Pull a TaggedPropertyValue structure
+
+   \param pull Pointer to the mapirops_pull structure
+   \param mem_ctx Pointer to the memory context to use for value
+   allocation
+   \param r Pointer to the TaggedPropertyValue to return
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_pull_TaggedPropertyValue(struct mapirops_pull *pull, TALLOC_CTX *mem_ctx,
+							 TaggedPropertyValue *r)
+{
+	if (!r) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	MAPIROPS_CHECK(mapirops_pull_uint32(pull, &r->PropertyTag));
+	MAPIROPS_CHECK(mapirops_pull_PropertyValue(pull, mem_ctx, PROP_TYPE(r->PropertyTag), &r->Value));
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Push a PropertyName structure
+
+   \param push Pointer to the mapirops_push structure
+   \param r Pointer to the PropertyName to push
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_push_PropertyName(struct mapirops_push *push, const PropertyName *r)
+{
+	if (!r) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	/* The GUID is always on the wire, only what follows depends on Kind */
+	MAPIROPS_CHECK(mapirops_push_uint8(push, r->Kind));
+	MAPIROPS_CHECK(mapirops_push_GUID(push, &r->Guid));
+
+	switch (r->Kind) {
+	case MNID_NONE:
+		break;
+	case MNID_ID:
+		MAPIROPS_CHECK(mapirops_push_uint32(push, r->LID));
+		break;
+	case MNID_STRING:
+		if (r->NameSize && !r->Name) {
+			return MAPIROPS_ERR_INVALID_VAL;
+		}
+		MAPIROPS_CHECK(mapirops_push_uint8(push, r->NameSize));
+		MAPIROPS_CHECK(mapirops_push_bytes(push, r->Name, r->NameSize));
+		break;
+	default:
+		return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+				      "Invalid PropertyName Kind 0x%x", r->Kind);
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Pull a PropertyName structure
+
+   \param pull Pointer to the mapirops_pull structure
+   \param mem_ctx Pointer to the memory context to use for the name
+   allocation
+   \param r Pointer to the PropertyName to return
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_pull_PropertyName(struct mapirops_pull *pull, TALLOC_CTX *mem_ctx,
+						  PropertyName *r)
+{
+	uint8_t	*name;
+
+	if (!r) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	memset(r, 0, sizeof (PropertyName));
+	MAPIROPS_CHECK(mapirops_pull_uint8(pull, &r->Kind));
+	MAPIROPS_CHECK(mapirops_pull_GUID(pull, &r->Guid));
+
+	switch (r->Kind) {
+	case MNID_NONE:
+		break;
+	case MNID_ID:
+		MAPIROPS_CHECK(mapirops_pull_uint32(pull, &r->LID));
+		break;
+	case MNID_STRING:
+		MAPIROPS_CHECK(mapirops_pull_uint8(pull, &r->NameSize));
+		if (r->NameSize % 2) {
+			return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+					      "Odd PropertyName NameSize %u", r->NameSize);
+		}
+		name = talloc_array(mem_ctx, uint8_t, r->NameSize);
+		if (r->NameSize && name == NULL) {
+			return MAPIROPS_ERR_NO_MEMORY;
+		}
+		MAPIROPS_CHECK(mapirops_pull_bytes(pull, name, r->NameSize));
+		r->Name = name;
+		break;
+	default:
+		return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+				      "Invalid PropertyName Kind 0x%x", r->Kind);
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/*
+   Reserve n bytes at the end of the rowset blob
+ */
+static uint8_t *mapirops_rowset_reserve(struct mapirops_rowset *rowset, size_t n)
+{
+	uint8_t	*blob;
+	size_t	alloc;
+
+	if (n > UINT32_MAX - rowset->blob_size) {
+		return NULL;
+	}
+
+	if (rowset->blob_size + n > rowset->blob_alloc) {
+		alloc = rowset->blob_alloc ? rowset->blob_alloc : 256;
+		while (alloc < rowset->blob_size + n) {
+			alloc *= 2;
+		}
+		if (alloc > UINT32_MAX) {
+			alloc = UINT32_MAX;
+		}
+
+		blob = talloc_realloc(rowset, rowset->blob, uint8_t, alloc);
+		if (blob == NULL) {
+			return NULL;
+		}
+		rowset->blob = blob;
+		rowset->blob_alloc = alloc;
+	}
+
+	return rowset->blob + rowset->blob_size;
+}
+
+/*
+   Pull a string or binary value and append it to the rowset blob
+ */
+static enum mapirops_err_code mapirops_rowset_pull_cell(struct mapirops_pull *pull,
+							struct mapirops_rowset *rowset,
+							uint16_t type,
+							struct mapirops_rowset_cell *cell)
+{
+	const uint8_t	*start;
+	const uint8_t	*end = NULL;
+	uint8_t		*dst;
+	size_t		len = 0;
+	size_t		outlen;
+	uint16_t	cb;
+
+	cell->offset = rowset->blob_size;
+
+	switch (type) {
+	case PT_STRING8:
+		start = pull->data.data + pull->offset;
+		if (pull->offset < pull->data.length) {
+			end = memchr(start, 0, pull->data.length - pull->offset);
+		}
+		if (end == NULL) {
+			return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR, "Unterminated PT_STRING8 value");
+		}
+		len = end - start;
+		if (pull->codepage) {
+			dst = mapirops_rowset_reserve(rowset, MAPIROPS_CODEPAGE_UTF8_SIZE(len));
+			if (dst == NULL) {
+				return MAPIROPS_ERR_NO_MEMORY;
+			}
+			if (mapirops_codepage_to_utf8(pull->codepage, start, len, (char *)dst, &outlen) != MAPIROPS_ERR_SUCCESS) {
+				return mapirops_error(MAPIROPS_ERR_ICONV, LOG_ERR, "PT_STRING8 value not in pull codepage");
+			}
+			pull->offset += len + 1;
+			cell->length = outlen;
+			len = outlen + 1;
+			break;
+		}
+		dst = mapirops_rowset_reserve(rowset, len + 1);
+		if (dst == NULL) {
+			return MAPIROPS_ERR_NO_MEMORY;
+		}
+		memcpy(dst, start, len + 1);
+		pull->offset += len + 1;
+		cell->length = len;
+		len += 1;
+		break;
+	case PT_UNICODE:
+		MAPIROPS_CHECK(mapirops_property_utf16_len(pull, &len));
+		dst = mapirops_rowset_reserve(rowset, MAPIROPS_PROPERTY_UTF8_SIZE(len));
+		if (dst == NULL) {
+			return MAPIROPS_ERR_NO_MEMORY;
+		}
+		MAPIROPS_CHECK(mapirops_property_utf16_to_utf8(pull, len, (char *)dst, &outlen));
+		cell->length = outlen;
+		len = outlen + 1;
+		break;
+	default:
+		MAPIROPS_CHECK(mapirops_pull_uint16(pull, &cb));
+		if (cb > pull->data.length - pull->offset) {
+			return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+					      "Binary value of %u bytes past end of buffer", cb);
+		}
+		cell->length = cb;
+		if (cb == 0) {
+			return MAPIROPS_ERR_SUCCESS;
+		}
+		dst = mapirops_rowset_reserve(rowset, cb);
+		if (dst == NULL) {
+			return MAPIROPS_ERR_NO_MEMORY;
+		}
+		memcpy(dst, pull->data.data + pull->offset, cb);
+		pull->offset += cb;
+		len = cb;
+		break;
+	}
+
+	rowset->blob_size += len;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static enum mapirops_err_code mapirops_rowset_pull_rows(struct mapirops_pull *pull,
+							struct mapirops_rowset *rowset)
+{
+	struct mapirops_rowset_column	*column;
+	uint32_t			row;
+	uint32_t			i;
+	uint32_t			error;
+	uint8_t				flag;
+	uint8_t				value_flag;
+
+	for (row = 0; row < rowset->row_count; row++) {
+		MAPIROPS_CHECK(mapirops_pull_uint8(pull, &flag));
+		if (flag != PROPERTY_ROW_STANDARD && flag != PROPERTY_ROW_FLAGGED) {
+			return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+					      "Invalid PropertyRow flag 0x%.2x", flag);
+		}
+
+		for (i = 0; i < rowset->column_count; i++) {
+			column = &rowset->columns[i];
+
+			value_flag = 0x0;
+			if (flag == PROPERTY_ROW_FLAGGED) {
+				MAPIROPS_CHECK(mapirops_pull_uint8(pull, &value_flag));
+			}
+
+			switch (value_flag) {
+			case 0x0:
+				if (column->size) {
+					MAPIROPS_CHECK(mapirops_property_pull_fixed(pull, column->size,
+										    column->values + row * column->size, 1));
+				} else {
+					MAPIROPS_CHECK(mapirops_rowset_pull_cell(pull, rowset, PROP_TYPE(column->PropertyTag),
+										 &column->cells[row]));
+				}
+				continue;
+			case 0x1:
+				column->null[row >> 3] |= 1 << (row & 7);
+				break;
+			case 0xA:
+				MAPIROPS_CHECK(mapirops_pull_uint32(pull, &error));
+				if (column->errors == NULL) {
+					column->errors = talloc_zero_array(rowset, uint32_t, rowset->row_count);
+					if (column->errors == NULL) {
+						return MAPIROPS_ERR_NO_MEMORY;
+					}
+				}
+				column->errors[row] = error;
+				column->error[row >> 3] |= 1 << (row & 7);
+				break;
+			default:
+				return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+						      "Invalid FlaggedPropertyValue flag 0x%.2x", value_flag);
+			}
+
+			/* No value for this row */
+			if (column->size) {
+				memset(column->values + row * column->size, 0, column->size);
+			} else {
+				column->cells[row].offset = rowset->blob_size;
+				column->cells[row].length = 0;
+			}
+		}
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Pull a PropertyRowSet into per-column arrays
+
+   Rows are decoded over a fixed column set as returned by
+   RopQueryRows after RopSetColumns. Each column gets one contiguous
+   array: fixed-size values are packed, strings and binaries are
+   copied into a single blob and located by offset and length. Values
+   missing from or failing in a FlaggedPropertyRow are recorded in the
+   column null and error bitmaps.
+
+   \param pull Pointer to the mapirops_pull structure
+   \param mem_ctx Pointer to the memory context to allocate the rowset
+   \param tags Array of column property tags
+   \param tag_count Number of columns
+   \param row_count Number of rows to pull
+   \param _rowset Pointer on pointer to the rowset to return
+
+   \note Multiple-valued columns and columns of PT_UNSPECIFIED type
+   are not supported
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_pull_PropertyRowSet_columns(struct mapirops_pull *pull, TALLOC_CTX *mem_ctx,
+							    const uint32_t *tags, uint32_t tag_count,
+							    uint32_t row_count, struct mapirops_rowset **_rowset)
+{
+	enum mapirops_err_code		retval;
+	const struct mapirops_proptype	*pt;
+	struct mapirops_rowset		*rowset;
+	struct mapirops_rowset_column	*column;
+	uint32_t			bitmap_size;
+	uint32_t			i;
+
+	if (!pull || !_rowset || (tag_count && !tags) || pull->offset > pull->data.length) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	/* Every row takes at least its flag and one byte per column */
+	if ((uint64_t)row_count * (1 + (uint64_t)tag_count) > pull->data.length - pull->offset) {
+		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+				      "%u rows past end of buffer", row_count);
+	}
+
+	rowset = talloc_zero(mem_ctx, struct mapirops_rowset);
+	if (rowset == NULL) {
+		return MAPIROPS_ERR_NO_MEMORY;
+	}
+	rowset->row_count = row_count;
+	rowset->column_count = tag_count;
+	rowset->columns = talloc_zero_array(rowset, struct mapirops_rowset_column, tag_count + 1);
+	if (rowset->columns == NULL) {
+		talloc_free(rowset);
+		return MAPIROPS_ERR_NO_MEMORY;
+	}
+
+	bitmap_size = (row_count + 7) / 8 + 1;
+	for (i = 0; i < tag_count; i++) {
+		pt = mapirops_proptype_get(PROP_TYPE(tags[i]));
+		if (pt == NULL || (tags[i] & MV_FLAG) || (!pt->size && !pt->elem)) {
+			talloc_free(rowset);
+			return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+					      "Column 0x%.8x can't be pulled by columns", tags[i]);
+		}
+
+		column = &rowset->columns[i];
+		column->PropertyTag = tags[i];
+		column->size = pt->size;
+		if (pt->size) {
+			column->values = talloc_array(rowset, uint8_t, (size_t)row_count * pt->size + 1);
+		} else {
+			column->cells = talloc_array(rowset, struct mapirops_rowset_cell, row_count + 1);
+		}
+		column->null = talloc_zero_array(rowset, uint8_t, bitmap_size);
+		column->error = talloc_zero_array(rowset, uint8_t, bitmap_size);
+		if ((!column->values && !column->cells) || !column->null || !column->error) {
+			talloc_free(rowset);
+			return MAPIROPS_ERR_NO_MEMORY;
+		}
+	}
+
+	retval = mapirops_rowset_pull_rows(pull, rowset);
+	if (retval != MAPIROPS_ERR_SUCCESS) {
+		talloc_free(rowset);
+		return retval;
+	}
+
+	*_rowset = rowset;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
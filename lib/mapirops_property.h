@@ -0,0 +1,336 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_property.h
+   \author The OpenChange Project
+   \version 0.1
+   \brief Property values as defined in [MS-OXCDATA] section 2.11
+ */
+
+#ifndef	__MAPIROPS_PROPERTY_H__
+#define	__MAPIROPS_PROPERTY_H__
+
+#include <sys/types.h>
+
+#include <talloc.h>
+
+#include <mapirops_uuid.h>
+
+/**
+   \enum PropertyType
+   \brief Property data types ([MS-OXCDATA] section 2.11.1)
+ */
+enum PropertyType {
+	PT_UNSPECIFIED		= 0x0000,
+	PT_NULL			= 0x0001,
+	PT_SHORT		= 0x0002,
+	PT_LONG			= 0x0003,
+	PT_FLOAT		= 0x0004,
+	PT_DOUBLE		= 0x0005,
+	PT_CURRENCY		= 0x0006,
+	PT_APPTIME		= 0x0007,
+	PT_ERROR		= 0x000A,
+	PT_BOOLEAN		= 0x000B,
+	PT_OBJECT		= 0x000D,
+	PT_I8			= 0x0014,
+	PT_STRING8		= 0x001E,
+	PT_UNICODE		= 0x001F,
+	PT_SYSTIME		= 0x0040,
+	PT_CLSID		= 0x0048,
+	PT_SVREID		= 0x00FB,
+	PT_SRESTRICTION		= 0x00FD,
+	PT_ACTIONS		= 0x00FE,
+	PT_BINARY		= 0x0102,
+	PT_MV_SHORT		= 0x1002,
+	PT_MV_LONG		= 0x1003,
+	PT_MV_FLOAT		= 0x1004,
+	PT_MV_DOUBLE		= 0x1005,
+	PT_MV_CURRENCY		= 0x1006,
+	PT_MV_APPTIME		= 0x1007,
+	PT_MV_I8		= 0x1014,
+	PT_MV_STRING8		= 0x101E,
+	PT_MV_UNICODE		= 0x101F,
+	PT_MV_SYSTIME		= 0x1040,
+	PT_MV_CLSID		= 0x1048,
+	PT_MV_BINARY		= 0x1102
+};
+
+/** \def MV_FLAG
+    Multiple-valued bit of a property type
+*/
+#define	MV_FLAG		0x1000
+
+/** \def PROP_TYPE
+    Property type of a property tag
+*/
+#define	PROP_TYPE(tag)	((uint16_t)((tag) & 0xFFFF))
+
+/**
+   \struct _BinaryValue
+   \sa BinaryValue
+ */
+/**
+   \var BinaryValue
+   \brief PT_BINARY and PT_SVREID value
+ */
+typedef struct _BinaryValue {
+	uint16_t	cb;		/*!< Number of bytes */
+	uint8_t		*lpb;		/*!< Bytes */
+} BinaryValue;
+
+/**
+   \struct _MultiValue
+   \sa MultiValue
+ */
+/**
+   \var MultiValue
+   \brief Layout shared by all the multiple-valued property values
+ */
+typedef struct _MultiValue {
+	uint32_t	cValues;	/*!< Number of values */
+	void		*lpv;		/*!< Array of values */
+} MultiValue;
+
+/** \cond */
+typedef struct _ShortArray {
+	uint32_t	cValues;
+	uint16_t	*lpi;
+} ShortArray;
+
+typedef struct _LongArray {
+	uint32_t	cValues;
+	uint32_t	*lpl;
+} LongArray;
+
+typedef struct _FloatArray {
+	uint32_t	cValues;
+	float		*lpflt;
+} FloatArray;
+
+typedef struct _DoubleArray {
+	uint32_t	cValues;
+	double		*lpdbl;
+} DoubleArray;
+
+typedef struct _LongLongArray {
+	uint32_t	cValues;
+	uint64_t	*lpi8;
+} LongLongArray;
+
+typedef struct _StringArray {
+	uint32_t	cValues;
+	char		**lppsz;
+} StringArray;
+
+typedef struct _GUIDArray {
+	uint32_t	cValues;
+	GUID		*lpguid;
+} GUIDArray;
+
+typedef struct _BinaryArray {
+	uint32_t	cValues;
+	BinaryValue	*lpbin;
+} BinaryArray;
+/** \endcond */
+
+/**
+   \union _PropertyValue
+   \sa PropertyValue
+ */
+/**
+   \var PropertyValue
+   \brief Property value without type information ([MS-OXCDATA]
+   section 2.11.2.1). The member in use depends on the property type.
+
+   Strings are always stored as UTF-8.
+ */
+typedef union _PropertyValue {
+	uint16_t	i;		/*!< PT_SHORT */
+	uint32_t	l;		/*!< PT_LONG */
+	float		flt;		/*!< PT_FLOAT */
+	double		dbl;		/*!< PT_DOUBLE, PT_APPTIME */
+	uint64_t	d;		/*!< PT_CURRENCY, PT_I8, PT_SYSTIME */
+	uint8_t		b;		/*!< PT_BOOLEAN */
+	uint32_t	err;		/*!< PT_ERROR */
+	uint32_t	object;		/*!< PT_OBJECT */
+	char		*lpszA;		/*!< PT_STRING8 */
+	char		*lpszW;		/*!< PT_UNICODE */
+	GUID		guid;		/*!< PT_CLSID */
+	BinaryValue	bin;		/*!< PT_BINARY, PT_SVREID */
+	ShortArray	MVi;		/*!< PT_MV_SHORT */
+	LongArray	MVl;		/*!< PT_MV_LONG */
+	FloatArray	MVflt;		/*!< PT_MV_FLOAT */
+	DoubleArray	MVdbl;		/*!< PT_MV_DOUBLE, PT_MV_APPTIME */
+	LongLongArray	MVi8;		/*!< PT_MV_CURRENCY, PT_MV_I8, PT_MV_SYSTIME */
+	StringArray	MVszA;		/*!< PT_MV_STRING8 */
+	StringArray	MVszW;		/*!< PT_MV_UNICODE */
+	GUIDArray	MVguid;		/*!< PT_MV_CLSID */
+	BinaryArray	MVbin;		/*!< PT_MV_BINARY */
+	MultiValue	MV;		/*!< Any multiple-valued type */
+} PropertyValue;
+
+/**
+   \struct _TypedPropertyValue
+   \sa TypedPropertyValue
+ */
+/**
+   \var TypedPropertyValue
+   \brief Property value prefixed with its type ([MS-OXCDATA] section
+   2.11.3)
+ */
+typedef struct _TypedPropertyValue {
+	uint16_t	PropertyType;	/*!< Property type */
+	PropertyValue	Value;		/*!< Property value */
+} TypedPropertyValue;
+
+/**
+   \struct _TaggedPropertyValue
+   \sa TaggedPropertyValue
+ */
+/**
+   \var TaggedPropertyValue
+   \brief Property value prefixed with its property tag ([MS-OXCDATA]
+   section 2.11.4)
+ */
+typedef struct _TaggedPropertyValue {
+	uint32_t	PropertyTag;	/*!< Property tag */
+	PropertyValue	Value;		/*!< Property value */
+} TaggedPropertyValue;
+
+/**
+   \enum PropertyNameKind
+   \brief Kind of a PropertyName ([MS-OXCDATA] section 2.6.1)
+ */
+enum PropertyNameKind {
+	MNID_ID			= 0x00,	/*!< Named by a 32-bit LID */
+	MNID_STRING		= 0x01,	/*!< Named by a UTF-16 string */
+	MNID_NONE		= 0xFF	/*!< The property has no name */
+};
+
+/**
+   \struct _PropertyName
+   \sa PropertyName
+ */
+/**
+   \var PropertyName
+   \brief Name of a named property ([MS-OXCDATA] section 2.6.1)
+
+   String names are kept as they are on the wire: UTF-16LE including
+   the terminating null character.
+ */
+typedef struct _PropertyName {
+	uint8_t		Kind;		/*!< MNID_ID, MNID_STRING or MNID_NONE */
+	GUID		Guid;		/*!< Property set */
+	uint32_t	LID;		/*!< Identifier when Kind is MNID_ID */
+	uint8_t		NameSize;	/*!< Size in bytes of Name when Kind is MNID_STRING */
+	const uint8_t	*Name;		/*!< UTF-16LE name when Kind is MNID_STRING */
+} PropertyName;
+
+/** \def PROPERTY_ROW_STANDARD
+    PropertyRow holding values only ([MS-OXCDATA] section 2.8.1.1)
+*/
+#define	PROPERTY_ROW_STANDARD	0x00
+
+/** \def PROPERTY_ROW_FLAGGED
+    PropertyRow holding FlaggedPropertyValue ([MS-OXCDATA] section
+    2.8.1.2)
+*/
+#define	PROPERTY_ROW_FLAGGED	0x01
+
+/** \def MAPIROPS_ROWSET_BIT
+    Test the bit of row in a mapirops_rowset_column bitmap
+*/
+#define	MAPIROPS_ROWSET_BIT(bitmap, row)	(((bitmap)[(row) >> 3] >> ((row) & 7)) & 1)
+
+/**
+   \struct mapirops_rowset_cell
+   \brief Location of a string or binary value in the rowset blob
+ */
+struct mapirops_rowset_cell {
+	uint32_t	offset;		/*!< Offset of the value in the blob */
+	uint32_t	length;		/*!< Size in bytes of the value, null character excluded */
+};
+
+/**
+   \struct mapirops_rowset_column
+   \brief Values of one column for all the rows of a rowset
+
+   Fixed-size values are packed in values, string and binary values
+   are located by cells. Rows without value are flagged in the null
+   bitmap, rows with an error code in the error bitmap.
+ */
+struct mapirops_rowset_column {
+	uint32_t			PropertyTag;	/*!< Property tag of the column */
+	uint8_t				size;		/*!< Size of a fixed-size value, 0 for strings and binaries */
+	uint8_t				*values;	/*!< Fixed-size values, size bytes per row */
+	struct mapirops_rowset_cell	*cells;		/*!< String and binary values, one cell per row */
+	uint8_t				*null;		/*!< Bitmap of rows without value */
+	uint8_t				*error;		/*!< Bitmap of rows with an error code */
+	uint32_t			*errors;	/*!< Error code per row, NULL if no row has one */
+};
+
+/**
+   \struct mapirops_rowset
+   \brief PropertyRowSet decoded column by column
+
+   Strings are stored null-terminated and converted to UTF-8 in
+   blob.
+ */
+struct mapirops_rowset {
+	uint32_t			row_count;	/*!< Number of rows */
+	uint32_t			column_count;	/*!< Number of columns */
+	struct mapirops_rowset_column	*columns;	/*!< Columns in property tag array order */
+	uint8_t				*blob;		/*!< String and binary values */
+	uint32_t			blob_size;	/*!< Bytes used in blob */
+	uint32_t			blob_alloc;	/*!< Bytes allocated for blob */
+};
+
+/** \cond */
+#ifndef	__BEGIN_DECLS
+#ifdef	__cplusplus
+#define	__BEGIN_DECLS	extern "C" {
+#define	__END_DECLS	}
+#else
+#define	__BEGIN_DECLS
+#define	__END_DECLS
+#endif
+#endif
+
+struct mapirops_push;
+struct mapirops_pull;
+
+/** \endcond */
+
+__BEGIN_DECLS
+
+/* The following definitions come from mapirops_property.c */
+enum mapirops_err_code	mapirops_push_PropertyValue(struct mapirops_push *, uint16_t, const PropertyValue *);
+enum mapirops_err_code	mapirops_pull_PropertyValue(struct mapirops_pull *, TALLOC_CTX *, uint16_t, PropertyValue *);
+enum mapirops_err_code	mapirops_push_TypedPropertyValue(struct mapirops_push *, const TypedPropertyValue *);
+enum mapirops_err_code	mapirops_pull_TypedPropertyValue(struct mapirops_pull *, TALLOC_CTX *, TypedPropertyValue *);
+enum mapirops_err_code	mapirops_push_TaggedPropertyValue(struct mapirops_push *, const TaggedPropertyValue *);
+enum mapirops_err_code	mapirops_pull_TaggedPropertyValue(struct mapirops_pull *, TALLOC_CTX *, TaggedPropertyValue *);
+enum mapirops_err_code	mapirops_push_PropertyName(struct mapirops_push *, const PropertyName *);
+enum mapirops_err_code	mapirops_pull_PropertyName(struct mapirops_pull *, TALLOC_CTX *, PropertyName *);
+enum mapirops_err_code	mapirops_pull_PropertyRowSet_columns(struct mapirops_pull *, TALLOC_CTX *, const uint32_t *, uint32_t, uint32_t, struct mapirops_rowset **);
+
+__END_DECLS
+
+#endif /* ! __MAPIROPS_PROPERTY_H__ */
@@ -0,0 +1,407 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_restriction.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Restriction codec
+
+   Restrictions are trees whose nodes are serialized in preorder. They
+   are decoded without recursion: the nodes are appended to a single
+   array in wire order while an explicit stack, allocated once, counts
+   the children still expected by each open And, Or, Not,
+   SubRestriction, Comment and Count restriction. Nesting and node
+   count are bounded so a hostile buffer can neither exhaust memory
+   nor make decoding more than linear in its size.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+/** \cond */
+struct mapirops_restriction_frame {
+	uint32_t	node;		/* Index of the open restriction */
+	uint32_t	remaining;	/* Children still to pull */
+};
+/** \endcond */
+
+/*
+   Check the number of children against the restriction type
+ */
+static int mapirops_restriction_check_node(const struct mapirops_restriction_node *node)
+{
+	switch (node->RestrictType) {
+	case RES_AND:
+	case RES_OR:
+		return node->children <= UINT16_MAX;
+	case RES_NOT:
+	case RES_SUBRESTRICTION:
+	case RES_COUNT:
+		return node->children == 1;
+	case RES_COMMENT:
+		if (node->u.Comment.TaggedValuesCount && !node->u.Comment.TaggedValues) {
+			return 0;
+		}
+		return node->children <= 1;
+	case RES_CONTENT:
+	case RES_PROPERTY:
+	case RES_COMPAREPROPS:
+	case RES_BITMASK:
+	case RES_SIZE:
+	case RES_EXIST:
+		return node->children == 0;
+	default:
+		return 0;
+	}
+}
+
+/*
+   Push the fields of a single restriction, children excluded
+ */
+static enum mapirops_err_code mapirops_restriction_push_node(struct mapirops_push *push,
+							     const struct mapirops_restriction_node *node)
+{
+	uint8_t	i;
+
+	MAPIROPS_CHECK(mapirops_push_uint8(push, node->RestrictType));
+
+	switch (node->RestrictType) {
+	case RES_AND:
+	case RES_OR:
+		MAPIROPS_CHECK(mapirops_push_uint16(push, (uint16_t) node->children));
+		break;
+	case RES_NOT:
+		break;
+	case RES_CONTENT:
+		MAPIROPS_CHECK(mapirops_push_uint16(push, node->u.Content.FuzzyLevelLow));
+		MAPIROPS_CHECK(mapirops_push_uint16(push, node->u.Content.FuzzyLevelHigh));
+		MAPIROPS_CHECK(mapirops_push_uint32(push, node->u.Content.PropertyTag));
+		MAPIROPS_CHECK(mapirops_push_TaggedPropertyValue(push, &node->u.Content.TaggedValue));
+		break;
+	case RES_PROPERTY:
+		MAPIROPS_CHECK(mapirops_push_uint8(push, node->u.Property.RelOp));
+		MAPIROPS_CHECK(mapirops_push_uint32(push, node->u.Property.PropTag));
+		MAPIROPS_CHECK(mapirops_push_TaggedPropertyValue(push, &node->u.Property.TaggedValue));
+		break;
+	case RES_COMPAREPROPS:
+		MAPIROPS_CHECK(mapirops_push_uint8(push, node->u.CompareProps.RelOp));
+		MAPIROPS_CHECK(mapirops_push_uint32(push, node->u.CompareProps.PropTag1));
+		MAPIROPS_CHECK(mapirops_push_uint32(push, node->u.CompareProps.PropTag2));
+		break;
+	case RES_BITMASK:
+		MAPIROPS_CHECK(mapirops_push_uint8(push, node->u.Bitmask.BitmapRelOp));
+		MAPIROPS_CHECK(mapirops_push_uint32(push, node->u.Bitmask.PropTag));
+		MAPIROPS_CHECK(mapirops_push_uint32(push, node->u.Bitmask.Mask));
+		break;
+	case RES_SIZE:
+		MAPIROPS_CHECK(mapirops_push_uint8(push, node->u.Size.RelOp));
+		MAPIROPS_CHECK(mapirops_push_uint32(push, node->u.Size.PropTag));
+		MAPIROPS_CHECK(mapirops_push_uint32(push, node->u.Size.Size));
+		break;
+	case RES_EXIST:
+		MAPIROPS_CHECK(mapirops_push_uint32(push, node->u.Exist.PropTag));
+		break;
+	case RES_SUBRESTRICTION:
+		MAPIROPS_CHECK(mapirops_push_uint32(push, node->u.SubObject.Subobject));
+		break;
+	case RES_COMMENT:
+		MAPIROPS_CHECK(mapirops_push_uint8(push, node->u.Comment.TaggedValuesCount));
+		for (i = 0; i < node->u.Comment.TaggedValuesCount; i++) {
+			MAPIROPS_CHECK(mapirops_push_TaggedPropertyValue(push, &node->u.Comment.TaggedValues[i]));
+		}
+		MAPIROPS_CHECK(mapirops_push_uint8(push, node->children ? 0x01 : 0x00));
+		break;
+	case RES_COUNT:
+		MAPIROPS_CHECK(mapirops_push_uint32(push, node->u.Count.Count));
+		break;
+	default:
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/*
+   Pull the fields of a single restriction and set the number of
+   children which follow it on the wire
+ */
+static enum mapirops_err_code mapirops_restriction_pull_node(struct mapirops_pull *pull, TALLOC_CTX *mem_ctx,
+							     struct mapirops_restriction_node *node)
+{
+	uint16_t	count;
+	uint8_t		present;
+	uint8_t		i;
+
+	memset(node, 0, sizeof (struct mapirops_restriction_node));
+	MAPIROPS_CHECK(mapirops_pull_uint8(pull, &node->RestrictType));
+
+	switch (node->RestrictType) {
+	case RES_AND:
+	case RES_OR:
+		MAPIROPS_CHECK(mapirops_pull_uint16(pull, &count));
+		node->children = count;
+		break;
+	case RES_NOT:
+		node->children = 1;
+		break;
+	case RES_CONTENT:
+		MAPIROPS_CHECK(mapirops_pull_uint16(pull, &node->u.Content.FuzzyLevelLow));
+		MAPIROPS_CHECK(mapirops_pull_uint16(pull, &node->u.Content.FuzzyLevelHigh));
+		MAPIROPS_CHECK(mapirops_pull_uint32(pull, &node->u.Content.PropertyTag));
+		MAPIROPS_CHECK(mapirops_pull_TaggedPropertyValue(pull, mem_ctx, &node->u.Content.TaggedValue));
+		break;
+	case RES_PROPERTY:
+		MAPIROPS_CHECK(mapirops_pull_uint8(pull, &node->u.Property.RelOp));
+		MAPIROPS_CHECK(mapirops_pull_uint32(pull, &node->u.Property.PropTag));
+		MAPIROPS_CHECK(mapirops_pull_TaggedPropertyValue(pull, mem_ctx, &node->u.Property.TaggedValue));
+		break;
+	case RES_COMPAREPROPS:
+		MAPIROPS_CHECK(mapirops_pull_uint8(pull, &node->u.CompareProps.RelOp));
+		MAPIROPS_CHECK(mapirops_pull_uint32(pull, &node->u.CompareProps.PropTag1));
+		MAPIROPS_CHECK(mapirops_pull_uint32(pull, &node->u.CompareProps.PropTag2));
+		break;
+	case RES_BITMASK:
+		MAPIROPS_CHECK(mapirops_pull_uint8(pull, &node->u.Bitmask.BitmapRelOp));
+		MAPIROPS_CHECK(mapirops_pull_uint32(pull, &node->u.Bitmask.PropTag));
+		MAPIROPS_CHECK(mapirops_pull_uint32(pull, &node->u.Bitmask.Mask));
+		break;
+	case RES_SIZE:
+		MAPIROPS_CHECK(mapirops_pull_uint8(pull, &node->u.Size.RelOp));
+		MAPIROPS_CHECK(mapirops_pull_uint32(pull, &node->u.Size.PropTag));
+		MAPIROPS_CHECK(mapirops_pull_uint32(pull, &node->u.Size.Size));
+		break;
+	case RES_EXIST:
+		MAPIROPS_CHECK(mapirops_pull_uint32(pull, &node->u.Exist.PropTag));
+		break;
+	case RES_SUBRESTRICTION:
+		MAPIROPS_CHECK(mapirops_pull_uint32(pull, &node->u.SubObject.Subobject));
+		node->children = 1;
+		break;
+	case RES_COMMENT:
+		MAPIROPS_CHECK(mapirops_pull_uint8(pull, &node->u.Comment.TaggedValuesCount));
+		if (node->u.Comment.TaggedValuesCount) {
+			/* Every TaggedPropertyValue takes at least its property tag */
+			if ((uint32_t)node->u.Comment.TaggedValuesCount * 4 > pull->data.length - pull->offset) {
+				return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+						      "%u comment values past end of buffer",
+						      node->u.Comment.TaggedValuesCount);
+			}
+			node->u.Comment.TaggedValues = talloc_array(mem_ctx, TaggedPropertyValue,
+								    node->u.Comment.TaggedValuesCount);
+			if (node->u.Comment.TaggedValues == NULL) {
+				return MAPIROPS_ERR_NO_MEMORY;
+			}
+			for (i = 0; i < node->u.Comment.TaggedValuesCount; i++) {
+				MAPIROPS_CHECK(mapirops_pull_TaggedPropertyValue(pull, mem_ctx,
+										 &node->u.Comment.TaggedValues[i]));
+			}
+		}
+		MAPIROPS_CHECK(mapirops_pull_uint8(pull, &present));
+		if (present > 0x01) {
+			return MAPIROPS_ERR_INVALID_VAL;
+		}
+		node->children = present;
+		break;
+	case RES_COUNT:
+		MAPIROPS_CHECK(mapirops_pull_uint32(pull, &node->u.Count.Count));
+		node->children = 1;
+		break;
+	default:
+		return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+				      "Unknown restriction type 0x%.2x", node->RestrictType);
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/*
+   Pull the restriction tree into restriction->nodes using stack to
+   track open restrictions
+ */
+static enum mapirops_err_code mapirops_restriction_pull_nodes(struct mapirops_pull *pull,
+							      struct mapirops_restriction *restriction,
+							      struct mapirops_restriction_frame *stack,
+							      uint32_t max_depth, uint32_t max_nodes)
+{
+	struct mapirops_restriction_node	*nodes;
+	struct mapirops_restriction_node	*node;
+	uint32_t				alloc;
+	uint32_t				sp = 0;
+	uint32_t				n;
+
+	alloc = MIN(max_nodes, 16);
+	restriction->nodes = talloc_array(restriction, struct mapirops_restriction_node, alloc);
+	if (restriction->nodes == NULL) {
+		return MAPIROPS_ERR_NO_MEMORY;
+	}
+
+	for (;;) {
+		if (restriction->node_count == max_nodes) {
+			return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+					      "Restriction has more than %u nodes", max_nodes);
+		}
+
+		if (restriction->node_count == alloc) {
+			alloc = MIN(max_nodes, (uint64_t)alloc * 2);
+			nodes = talloc_realloc(restriction, restriction->nodes,
+					       struct mapirops_restriction_node, alloc);
+			if (nodes == NULL) {
+				return MAPIROPS_ERR_NO_MEMORY;
+			}
+			restriction->nodes = nodes;
+		}
+
+		n = restriction->node_count++;
+		node = &restriction->nodes[n];
+		MAPIROPS_CHECK(mapirops_restriction_pull_node(pull, restriction, node));
+
+		if (sp + 1 > restriction->depth) {
+			restriction->depth = sp + 1;
+		}
+
+		if (node->children) {
+			if (sp + 1 >= max_depth) {
+				return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+						      "Restriction nested deeper than %u", max_depth);
+			}
+			if (node->children > pull->data.length - pull->offset) {
+				return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+						      "%u restrictions past end of buffer", node->children);
+			}
+			stack[sp].node = n;
+			stack[sp].remaining = node->children;
+			sp++;
+			continue;
+		}
+
+		/* Leaf: close every restriction it completes */
+		node->end = restriction->node_count;
+		while (sp && --stack[sp - 1].remaining == 0) {
+			sp--;
+			restriction->nodes[stack[sp].node].end = restriction->node_count;
+		}
+
+		if (sp == 0) {
+			return MAPIROPS_ERR_SUCCESS;
+		}
+	}
+}
+
+/**
+   \details Push a restriction tree
+
+   The tree is checked before anything is pushed: every node must
+   have a number of children matching its type and the children counts
+   must describe exactly node_count nodes. The end member of the nodes
+   is ignored.
+
+   \param push Pointer to the mapirops_push structure
+   \param restriction Pointer to the restriction tree to push
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_INVALID_VAL if
+   the tree is malformed, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_push_restriction(struct mapirops_push *push,
+						 const struct mapirops_restriction *restriction)
+{
+	uint64_t	pending = 1;
+	uint32_t	i;
+
+	if (!push || !restriction || !restriction->node_count || !restriction->nodes) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	for (i = 0; i < restriction->node_count; i++) {
+		if (pending == 0 || !mapirops_restriction_check_node(&restriction->nodes[i])) {
+			return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+					      "Invalid restriction node %u", i);
+		}
+		pending = pending - 1 + restriction->nodes[i].children;
+	}
+	if (pending) {
+		return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+				      "Restriction children exceed %u nodes", restriction->node_count);
+	}
+
+	for (i = 0; i < restriction->node_count; i++) {
+		MAPIROPS_CHECK(mapirops_restriction_push_node(push, &restriction->nodes[i]));
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Pull a restriction tree
+
+   \param pull Pointer to the mapirops_pull structure
+   \param mem_ctx Pointer to the memory context to use for allocation
+   \param max_depth Maximum nesting of restrictions, 0 for
+   MAPIROPS_RESTRICTION_MAX_DEPTH
+   \param max_nodes Maximum number of restrictions, 0 for
+   MAPIROPS_RESTRICTION_MAX_NODES
+   \param _restriction Pointer on pointer to the restriction tree to
+   return
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_INVALID_VAL if
+   the tree is malformed or exceeds a limit, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_pull_restriction(struct mapirops_pull *pull, TALLOC_CTX *mem_ctx,
+						 uint32_t max_depth, uint32_t max_nodes,
+						 struct mapirops_restriction **_restriction)
+{
+	enum mapirops_err_code			retval;
+	struct mapirops_restriction		*restriction;
+	struct mapirops_restriction_frame	*stack;
+
+	if (!pull || !_restriction || pull->offset > pull->data.length) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	if (!max_depth) {
+		max_depth = MAPIROPS_RESTRICTION_MAX_DEPTH;
+	}
+	if (!max_nodes) {
+		max_nodes = MAPIROPS_RESTRICTION_MAX_NODES;
+	}
+
+	restriction = talloc_zero(mem_ctx, struct mapirops_restriction);
+	if (restriction == NULL) {
+		return MAPIROPS_ERR_NO_MEMORY;
+	}
+
+	stack = talloc_array(restriction, struct mapirops_restriction_frame, max_depth);
+	if (stack == NULL) {
+		talloc_free(restriction);
+		return MAPIROPS_ERR_NO_MEMORY;
+	}
+
+	retval = mapirops_restriction_pull_nodes(pull, restriction, stack, max_depth, max_nodes);
+	talloc_free(stack);
+	if (retval != MAPIROPS_ERR_SUCCESS) {
+		talloc_free(restriction);
+		return retval;
+	}
+
+	*_restriction = restriction;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
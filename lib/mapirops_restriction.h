@@ -0,0 +1,157 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_restriction.h
+   \author The OpenChange Project
+   \version 0.1
+   \brief Restrictions as defined in [MS-OXCDATA] section 2.12
+ */
+
+#ifndef	__MAPIROPS_RESTRICTION_H__
+#define	__MAPIROPS_RESTRICTION_H__
+
+#include <sys/types.h>
+
+#include <talloc.h>
+
+#include <mapirops_property.h>
+
+/**
+   \enum RestrictionType
+   \brief Restriction types ([MS-OXCDATA] section 2.12)
+ */
+enum RestrictionType {
+	RES_AND			= 0x00,
+	RES_OR			= 0x01,
+	RES_NOT			= 0x02,
+	RES_CONTENT		= 0x03,
+	RES_PROPERTY		= 0x04,
+	RES_COMPAREPROPS	= 0x05,
+	RES_BITMASK		= 0x06,
+	RES_SIZE		= 0x07,
+	RES_EXIST		= 0x08,
+	RES_SUBRESTRICTION	= 0x09,
+	RES_COMMENT		= 0x0A,
+	RES_COUNT		= 0x0B
+};
+
+/** \def MAPIROPS_RESTRICTION_MAX_DEPTH
+    Default maximum nesting of restrictions accepted by the decoder
+*/
+#define	MAPIROPS_RESTRICTION_MAX_DEPTH	64
+
+/** \def MAPIROPS_RESTRICTION_MAX_NODES
+    Default maximum number of restrictions accepted by the decoder
+*/
+#define	MAPIROPS_RESTRICTION_MAX_NODES	4096
+
+/**
+   \struct mapirops_restriction_node
+   \brief One restriction of a restriction tree
+
+   The member of u in use depends on RestrictType. And, Or and Not
+   restrictions have no member of their own.
+ */
+struct mapirops_restriction_node {
+	uint8_t		RestrictType;	/*!< Restriction type */
+	uint32_t	children;	/*!< Number of child restrictions */
+	uint32_t	end;		/*!< Index of the first node following this subtree */
+	union {
+		struct {
+			uint16_t		FuzzyLevelLow;
+			uint16_t		FuzzyLevelHigh;
+			uint32_t		PropertyTag;
+			TaggedPropertyValue	TaggedValue;
+		} Content;		/*!< RES_CONTENT */
+		struct {
+			uint8_t			RelOp;
+			uint32_t		PropTag;
+			TaggedPropertyValue	TaggedValue;
+		} Property;		/*!< RES_PROPERTY */
+		struct {
+			uint8_t			RelOp;
+			uint32_t		PropTag1;
+			uint32_t		PropTag2;
+		} CompareProps;		/*!< RES_COMPAREPROPS */
+		struct {
+			uint8_t			BitmapRelOp;
+			uint32_t		PropTag;
+			uint32_t		Mask;
+		} Bitmask;		/*!< RES_BITMASK */
+		struct {
+			uint8_t			RelOp;
+			uint32_t		PropTag;
+			uint32_t		Size;
+		} Size;			/*!< RES_SIZE */
+		struct {
+			uint32_t		PropTag;
+		} Exist;		/*!< RES_EXIST */
+		struct {
+			uint32_t		Subobject;
+		} SubObject;		/*!< RES_SUBRESTRICTION */
+		struct {
+			uint8_t			TaggedValuesCount;
+			TaggedPropertyValue	*TaggedValues;
+		} Comment;		/*!< RES_COMMENT */
+		struct {
+			uint32_t		Count;
+		} Count;		/*!< RES_COUNT */
+	} u;
+};
+
+/**
+   \struct mapirops_restriction
+   \brief Restriction tree laid out as a contiguous node array
+
+   Nodes are stored in wire order (preorder): nodes[0] is the root and
+   the first child of node i, if any, is node i + 1. The next sibling
+   of a child c is node nodes[c].end.
+ */
+struct mapirops_restriction {
+	uint32_t				node_count;	/*!< Number of nodes */
+	uint32_t				depth;		/*!< Nesting of the deepest node, 1 for a single restriction */
+	struct mapirops_restriction_node	*nodes;		/*!< Nodes in preorder */
+};
+
+/** \cond */
+#ifndef	__BEGIN_DECLS
+#ifdef	__cplusplus
+#define	__BEGIN_DECLS	extern "C" {
+#define	__END_DECLS	}
+#else
+#define	__BEGIN_DECLS
+#define	__END_DECLS
+#endif
+#endif
+
+struct mapirops_push;
+struct mapirops_pull;
+
+/** \endcond */
+
+__BEGIN_DECLS
+
+/* The following definitions come from mapirops_restriction.c */
+enum mapirops_err_code	mapirops_push_restriction(struct mapirops_push *, const struct mapirops_restriction *);
+enum mapirops_err_code	mapirops_pull_restriction(struct mapirops_pull *, TALLOC_CTX *, uint32_t, uint32_t, struct mapirops_restriction **);
+
+__END_DECLS
+
+#endif /* ! __MAPIROPS_RESTRICTION_H__ */
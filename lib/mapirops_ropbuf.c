@@ -0,0 +1,166 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_ropbuf.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief ROP input and output buffer framing
+
+   A ROP buffer is a RopSize, the RopsList it covers and the
+   ServerObjectHandleTable filling the rest of the buffer ([MS-OXCROPS]
+   section 2.2.1). The InputHandleIndex and OutputHandleIndex of the
+   ROPs are indexes in this table.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+/**
+   \details Split the ROP buffer at the current offset into its
+   RopsList and ServerObjectHandleTable
+
+   The ROP buffer extends to the end of the pull buffer, typically the
+   payload of an extended buffer. Nothing is copied: ropbuf points
+   into pull->data. The ROP buffer is recorded if a capture is set on
+   pull.
+
+   \param pull Pointer to the mapirops_pull structure
+   \param ropbuf Pointer to the mapirops_ropbuf structure to fill
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_BUFSIZE if
+   RopSize is past the end of the buffer, MAPIROPS_ERR_INVALID_VAL if
+   the ServerObjectHandleTable is malformed, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_ropbuf_pull(struct mapirops_pull *pull, struct mapirops_ropbuf *ropbuf)
+{
+	uint32_t	start;
+	uint16_t	size;
+
+	if (!pull || !ropbuf) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	start = pull->offset;
+	MAPIROPS_CHECK(mapirops_pull_uint16(pull, &size));
+	if (size < sizeof (uint16_t) || size > pull->data.length - start) {
+		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+				      "RopSize %u past end of buffer", size);
+	}
+
+	ropbuf->rops.data = pull->data.data + pull->offset;
+	ropbuf->rops.length = size - sizeof (uint16_t);
+	ropbuf->handles.data = pull->data.data + start + size;
+	ropbuf->handles.length = pull->data.length - start - size;
+	if (ropbuf->handles.length % sizeof (uint32_t)) {
+		return mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR,
+				      "ServerObjectHandleTable of %zu bytes", ropbuf->handles.length);
+	}
+	ropbuf->handle_count = ropbuf->handles.length / sizeof (uint32_t);
+	pull->offset = pull->data.length;
+
+	if (unlikely(pull->stats != NULL)) {
+		mapirops_stats_bytes(pull->stats, MAPIROPS_STATS_PULL, pull->data.length - start);
+	}
+
+	/* Recording is best effort, a failure is logged by the recorder */
+	if (unlikely(pull->capture != NULL)) {
+		mapirops_capture_record(pull->capture, MAPIROPS_CAPTURE_PULL, pull->session,
+					pull->data.data + start, pull->data.length - start);
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Open a ROP buffer in the push buffer
+
+   Room for the RopSize is reserved. ROP requests or responses are then
+   pushed directly after it.
+
+   \param push Pointer to the mapirops_push structure
+   \param frame Pointer to the frame to initialize
+
+   \sa mapirops_ropbuf_push_end
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_ropbuf_push_begin(struct mapirops_push *push,
+						  struct mapirops_ropbuf_frame *frame)
+{
+	if (!push || !frame) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	frame->start = push->offset;
+	MAPIROPS_CHECK(mapirops_push_uint16(push, 0));
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Close a ROP buffer opened with mapirops_ropbuf_push_begin
+
+   The RopSize is written and the ServerObjectHandleTable is pushed
+   after the RopsList. The ROP buffer is recorded if a capture is set
+   on push.
+
+   \param push Pointer to the mapirops_push structure
+   \param frame Pointer to the frame to close
+   \param handles Array of server object handles
+   \param count Number of elements in handles
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_BUFSIZE if the
+   RopsList doesn't fit in RopSize, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_ropbuf_push_end(struct mapirops_push *push,
+						struct mapirops_ropbuf_frame *frame,
+						const uint32_t *handles, uint32_t count)
+{
+	uint32_t	size;
+	uint32_t	i;
+
+	if (!push || !frame || (count && !handles) ||
+	    frame->start + sizeof (uint16_t) > push->offset) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	size = push->offset - frame->start;
+	if (size > UINT16_MAX) {
+		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+				      "RopsList of %u bytes doesn't fit in RopSize", size);
+	}
+	SSVAL(push->data.data, frame->start, size);
+
+	for (i = 0; i < count; i++) {
+		MAPIROPS_CHECK(mapirops_push_uint32(push, handles[i]));
+	}
+
+	if (unlikely(push->stats != NULL)) {
+		mapirops_stats_bytes(push->stats, MAPIROPS_STATS_PUSH, push->offset - frame->start);
+	}
+	if (unlikely(push->capture != NULL)) {
+		mapirops_capture_record(push->capture, MAPIROPS_CAPTURE_PUSH, push->session,
+					push->data.data + frame->start, push->offset - frame->start);
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
@@ -0,0 +1,323 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_rpcext.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief RPC_HEADER_EXT framing of ROP buffers
+
+   rgbIn and rgbOut buffers of EcDoRpcExt2 are made of one or more
+   extended buffers, each one prefixed with a RPC_HEADER_EXT and
+   optionally compressed and/or obfuscated ([MS-OXCRPC] section
+   3.1.7). The pull side walks the chain in place and hands each
+   payload to a mapirops_pull. The push side frames ROPs which were
+   pushed directly in the output buffer.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+#ifdef	__SSE2__
+#include <emmintrin.h>
+#endif
+
+/** \def MAPIROPS_RPCEXT_XOR_MAGIC
+    Byte value used for the XorMagic obfuscation
+*/
+#define	MAPIROPS_RPCEXT_XOR_MAGIC	0xA5
+
+/**
+   \details Apply (or remove) the XorMagic obfuscation in place
+
+   \param data Pointer to the payload
+   \param length Length of the payload
+ */
+void mapirops_rpcext_xor(uint8_t *data, size_t length)
+{
+	size_t		i = 0;
+#ifdef	__SSE2__
+	const __m128i	magic = _mm_set1_epi8((char)MAPIROPS_RPCEXT_XOR_MAGIC);
+	__m128i		a, b, c, d;
+
+	for (; i + 64 <= length; i += 64) {
+		a = _mm_loadu_si128((const __m128i *)(data + i));
+		b = _mm_loadu_si128((const __m128i *)(data + i + 16));
+		c = _mm_loadu_si128((const __m128i *)(data + i + 32));
+		d = _mm_loadu_si128((const __m128i *)(data + i + 48));
+		_mm_storeu_si128((__m128i *)(data + i), _mm_xor_si128(a, magic));
+		_mm_storeu_si128((__m128i *)(data + i + 16), _mm_xor_si128(b, magic));
+		_mm_storeu_si128((__m128i *)(data + i + 32), _mm_xor_si128(c, magic));
+		_mm_storeu_si128((__m128i *)(data + i + 48), _mm_xor_si128(d, magic));
+	}
+	for (; i + 16 <= length; i += 16) {
+		a = _mm_loadu_si128((const __m128i *)(data + i));
+		_mm_storeu_si128((__m128i *)(data + i), _mm_xor_si128(a, magic));
+	}
+#else
+	const uint64_t	magic = 0xA5A5A5A5A5A5A5A5ULL;
+	uint64_t	v;
+
+	for (; i + 8 <= length; i += 8) {
+		memcpy(&v, data + i, 8);
+		v ^= magic;
+		memcpy(data + i, &v, 8);
+	}
+#endif
+	for (; i < length; i++) {
+		data[i] ^= MAPIROPS_RPCEXT_XOR_MAGIC;
+	}
+}
+
+/**
+   \details Initialize an iterator over chained extended buffers
+
+   \param iter Pointer to the iterator to initialize
+   \param mem_ctx Pointer to the memory context used for decompressed
+   payloads
+   \param data Pointer to the chained extended buffers
+
+   \note XorMagic payloads are de-obfuscated in place: data must be
+   writable and is modified by mapirops_rpcext_pull_next
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_rpcext_pull_init(struct mapirops_rpcext_iter *iter,
+						 TALLOC_CTX *mem_ctx,
+						 const struct mapibuf *data)
+{
+	if (!iter || !data || (data->length && !data->data)) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	memset(iter, 0, sizeof (struct mapirops_rpcext_iter));
+	iter->data = *data;
+	iter->mem_ctx = mem_ctx;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Move to the next extended buffer and set pull on its
+   payload
+
+   Uncompressed payloads are not copied: pull->data points into the
+   iterator buffer. Compressed payloads are decompressed in a buffer
+   owned by the iterator and reused by the next call.
+
+   \param iter Pointer to the iterator
+   \param pull Pointer to the mapirops_pull structure receiving the
+   payload
+
+   \note pull must be initialized, by mapirops_pull_init() or
+   mapirops_pull_cursor_init(): only its data and offset are set here,
+   the other fields are used by the RPC_HEADER_EXT codec
+
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_NOT_FOUND
+   once the extended buffer flagged Last was returned,
+   MAPIROPS_ERR_INVALID_VAL if the chain is malformed, otherwise
+   MAPIROPS error
+ */
+enum mapirops_err_code mapirops_rpcext_pull_next(struct mapirops_rpcext_iter *iter,
+						 struct mapirops_pull *pull)
+{
+	struct RPC_HEADER_EXT	header;
+	struct mapibuf		payload;
+	struct mapibuf		inflate;
+
+	if (!iter || !pull) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	if (iter->flags & RHEF_Last) {
+		return MAPIROPS_ERR_NOT_FOUND;
+	}
+
+	/* The chain ended without an extended buffer flagged Last */
+	if (iter->offset == iter->data.length) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	pull->data = iter->data;
+	pull->offset = iter->offset;
+	MAPIROPS_CHECK(mapirops_pull_struct_RPC_HEADER_EXT(pull, &header));
+
+	if (header.Size > iter->data.length - pull->offset) {
+		return mapirops_error(MAPIROPS_ERR_BUFSIZE, LOG_ERR,
+				      "RPC_HEADER_EXT Size %u past end of buffer", header.Size);
+	}
+
+	payload.data = iter->data.data + pull->offset;
+	payload.length = header.Size;
+	iter->offset = pull->offset + header.Size;
+
+	if (header.Flags & RHEF_XorMagic) {
+		mapirops_rpcext_xor(payload.data, payload.length);
+		/* Don't obfuscate the payload again if walked twice */
+		header.Flags &= ~RHEF_XorMagic;
+		SSVAL(iter->data.data, pull->offset - 6, header.Flags);
+	}
+
+	if (header.Flags & RHEF_Compressed) {
+		if (iter->inflate.length < header.SizeActual) {
+			iter->inflate.data = talloc_realloc(iter->mem_ctx, iter->inflate.data,
+							    uint8_t, header.SizeActual);
+			if (iter->inflate.data == NULL) {
+				iter->inflate.length = 0;
+				return mapirops_error(MAPIROPS_ERR_NO_MEMORY, LOG_ERR,
+						      "No more memory to decompress %u bytes",
+						      header.SizeActual);
+			}
+			iter->inflate.length = header.SizeActual;
+		}
+
+		inflate.data = iter->inflate.data;
+		inflate.length = header.SizeActual;
+		MAPIROPS_CHECK(mapirops_lzxpress_decompress(&payload, &inflate));
+		if (inflate.length != header.SizeActual) {
+			return MAPIROPS_ERR_INVALID_VAL;
+		}
+		payload = inflate;
+	} else if (header.Size != header.SizeActual) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	iter->flags = header.Flags;
+	pull->data = payload;
+	pull->offset = 0;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Open a new extended buffer in the push buffer
+
+   Room for the RPC_HEADER_EXT is reserved and the push limit is
+   lowered so the payload can't grow past
+   MAPIROPS_RPCEXT_MAX_PAYLOAD. ROPs are then pushed directly after
+   the header. A ROP failing with MAPIROPS_ERR_BUFFER_TOO_SMALL should
+   be rolled back and pushed again in the next extended buffer.
+
+   \param push Pointer to the mapirops_push structure
+   \param frame Pointer to the frame to initialize
+
+   \sa mapirops_rpcext_push_end
+
+   \return MAPIROPS_ERR_SUCCESS on success,
+   MAPIROPS_ERR_BUFFER_TOO_SMALL if no room is left for another
+   extended buffer, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_rpcext_push_begin(struct mapirops_push *push,
+						  struct mapirops_rpcext_frame *frame)
+{
+	const uint8_t	header[MAPIROPS_RPCEXT_HEADER_SIZE] = { 0 };
+	uint32_t	limit;
+
+	if (!push || !frame) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	frame->header = push->offset;
+	frame->limit = push->limit;
+	MAPIROPS_CHECK(mapirops_push_bytes(push, header, MAPIROPS_RPCEXT_HEADER_SIZE));
+
+	limit = push->offset + MAPIROPS_RPCEXT_MAX_PAYLOAD;
+	if (!push->limit || push->limit > limit) {
+		push->limit = limit;
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Close an extended buffer opened with
+   mapirops_rpcext_push_begin
+
+   The payload is compressed in place if RHEF_Compressed is requested
+   and compression makes it smaller, then obfuscated if
+   RHEF_XorMagic is requested. The RPC_HEADER_EXT is written last and
+   the push limit in effect before the frame was opened is restored.
+
+   \param push Pointer to the mapirops_push structure
+   \param frame Pointer to the frame to close
+   \param flags RHEF flags requested for this extended buffer
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_rpcext_push_end(struct mapirops_push *push,
+						struct mapirops_rpcext_frame *frame,
+						uint16_t flags)
+{
+	enum mapirops_err_code	retval;
+	struct RPC_HEADER_EXT	header;
+	struct mapibuf		payload;
+	struct mapibuf		deflate;
+	uint32_t		offset;
+
+	if (!push || !frame || frame->header + MAPIROPS_RPCEXT_HEADER_SIZE > push->offset) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	payload.data = push->data.data + frame->header + MAPIROPS_RPCEXT_HEADER_SIZE;
+	payload.length = push->offset - frame->header - MAPIROPS_RPCEXT_HEADER_SIZE;
+	if (payload.length > MAPIROPS_RPCEXT_MAX_PAYLOAD) {
+		return MAPIROPS_ERR_BUFFER_TOO_SMALL;
+	}
+
+	header.Version = 0x0;
+	header.Flags = flags;
+	header.SizeActual = payload.length;
+
+	if ((flags & RHEF_Compressed) && payload.length) {
+		deflate.length = payload.length - 1;
+		deflate.data = talloc_array(NULL, uint8_t, payload.length);
+		if (deflate.data == NULL) {
+			return mapirops_error(MAPIROPS_ERR_NO_MEMORY, LOG_ERR,
+					      "No more memory to compress %zu bytes", payload.length);
+		}
+
+		retval = mapirops_lzxpress_compress(&payload, &deflate);
+		if (retval == MAPIROPS_ERR_SUCCESS) {
+			memcpy(payload.data, deflate.data, deflate.length);
+			payload.length = deflate.length;
+		} else {
+			/* Not worth it: send the payload as is */
+			header.Flags &= ~RHEF_Compressed;
+		}
+		talloc_free(deflate.data);
+	} else {
+		header.Flags &= ~RHEF_Compressed;
+	}
+
+	if (header.Flags & RHEF_XorMagic) {
+		mapirops_rpcext_xor(payload.data, payload.length);
+	}
+
+	header.Size = payload.length;
+	offset = frame->header + MAPIROPS_RPCEXT_HEADER_SIZE + payload.length;
+
+	push->limit = frame->limit;
+	push->offset = frame->header;
+	retval = mapirops_push_struct_RPC_HEADER_EXT(push, &header);
+	push->offset = offset;
+
+	return retval;
+}
@@ -0,0 +1,547 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_stats.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Statistics published in a shared memory file
+
+   The counters of a process are mapped in a file other processes can
+   map to monitor it. The file is in host byte order and starts with a
+   header of MAPIROPS_STATS_HEADER_SIZE bytes:
+
+   - Magic (4 bytes): MAPIROPS_STATS_MAGIC
+   - Version (2 bytes): MAPIROPS_STATS_VERSION
+   - HeaderSize (2 bytes): MAPIROPS_STATS_HEADER_SIZE
+   - BlockSize (4 bytes): size of a thread block
+   - BlockCount (4 bytes): number of thread blocks
+   - BlockUsed (4 bytes): number of blocks claimed so far
+   - Pid (4 bytes): process publishing the statistics
+
+   followed by BlockCount thread blocks, each made of a sequence
+   number and a mapirops_stats_counters structure.
+
+   Each thread claims a block on first use and is its only writer. The
+   sequence number is odd while the thread updates the block, so
+   readers retry until they copy the block between two identical even
+   sequence numbers: the writer never waits. The block of an exited
+   thread, counters included, is handed over to the next new thread.
+   Threads beyond BlockCount are not counted.
+
+   When the library is configured with --enable-stats, the generated
+   push and pull functions of every Rop*_request and Rop*_response
+   structure count themselves and their errors. Bytes are counted when
+   ROP buffers are framed, allocations when push buffers grow and when
+   strings are pulled.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/** \cond */
+#define	MAPIROPS_STATS_HEADER_SIZE	64
+#define	MAPIROPS_STATS_RETRIES		1000	/* Reads of a block before accepting a torn copy */
+
+struct mapirops_stats_header {
+	uint32_t	magic;
+	uint16_t	version;
+	uint16_t	header_size;
+	uint32_t	block_size;
+	uint32_t	block_count;
+	uint32_t	used;
+	uint32_t	pid;
+	uint8_t		reserved[40];
+};
+
+struct mapirops_stats_block {
+	uint32_t			seq;		/* Odd while the counters are updated */
+	uint32_t			reserved;
+	struct mapirops_stats_counters	counters;
+};
+
+#define	MAPIROPS_STATS_BLOCK_SIZE	((sizeof (struct mapirops_stats_block) + 63) & ~63)
+
+struct mapirops_stats_thread {
+	struct mapirops_thread		thread;
+	uint32_t			index;
+	struct mapirops_stats_block	*block;		/* NULL if every block is taken */
+};
+
+struct mapirops_stats {
+	int				fd;
+	uint8_t				*data;
+	size_t				length;
+	struct mapirops_stats_header	*header;
+	struct mapirops_threads		threads;	/* Its lock protects free */
+	uint32_t			*free;		/* Blocks of the exited threads */
+	uint32_t			free_count;
+};
+
+struct mapirops_stats_reader {
+	int		fd;
+	uint8_t		*data;
+	size_t		length;
+	uint32_t	block_size;
+	uint32_t	block_count;
+};
+/** \endcond */
+
+static inline struct mapirops_stats_block *mapirops_stats_block_at(uint8_t *data, uint32_t block_size,
+								    uint32_t index)
+{
+	return (struct mapirops_stats_block *)(data + MAPIROPS_STATS_HEADER_SIZE + (size_t)index * block_size);
+}
+
+/*
+   Seqlock write side: the counters are only stored between begin and
+   end, by the thread owning the block
+ */
+static inline void mapirops_stats_begin(struct mapirops_stats_block *block)
+{
+	__atomic_store_n(&block->seq, block->seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void mapirops_stats_add(uint64_t *counter, uint64_t value)
+{
+	__atomic_store_n(counter, *counter + value, __ATOMIC_RELAXED);
+}
+
+static inline void mapirops_stats_end(struct mapirops_stats_block *block)
+{
+	__atomic_store_n(&block->seq, block->seq + 1, __ATOMIC_RELEASE);
+}
+
+/*
+   Claim a free block, or a new one while some are left
+ */
+static enum mapirops_err_code mapirops_stats_thread_attach(void *private_data, struct mapirops_thread *thread)
+{
+	struct mapirops_stats		*stats = (struct mapirops_stats *) private_data;
+	struct mapirops_stats_header	*header = stats->header;
+	struct mapirops_stats_thread	*st = (struct mapirops_stats_thread *) thread;
+
+	if (stats->free_count) {
+		st->index = stats->free[--stats->free_count];
+		st->block = mapirops_stats_block_at(stats->data, header->block_size, st->index);
+	} else if (header->used < header->block_count) {
+		st->index = header->used;
+		st->block = mapirops_stats_block_at(stats->data, header->block_size, st->index);
+		/* Readers scan the blocks claimed so far */
+		__atomic_store_n(&header->used, header->used + 1, __ATOMIC_RELEASE);
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/*
+   Hand the block over to the next new thread
+ */
+static void mapirops_stats_thread_release(void *private_data, struct mapirops_thread *thread)
+{
+	struct mapirops_stats		*stats = (struct mapirops_stats *) private_data;
+	struct mapirops_stats_thread	*st = (struct mapirops_stats_thread *) thread;
+
+	if (st->block) {
+		stats->free[stats->free_count++] = st->index;
+	}
+}
+
+/*
+   Return the block of the calling thread, NULL if every block is taken
+ */
+static struct mapirops_stats_block *mapirops_stats_block_get(struct mapirops_stats *stats)
+{
+	struct mapirops_stats_thread	*st;
+
+	st = (struct mapirops_stats_thread *) mapirops_threads_get(&stats->threads);
+	if (st == NULL) {
+		return NULL;
+	}
+
+	return st->block;
+}
+
+static int mapirops_stats_destructor(struct mapirops_stats *stats)
+{
+	mapirops_threads_free(&stats->threads);
+	munmap(stats->data, stats->length);
+	close(stats->fd);
+
+	return 0;
+}
+
+/**
+   \details Create a statistics file and publish the counters of the
+   process in it
+
+   The file is truncated if it already exists. It is left in place
+   once the statistics are freed, for the monitoring tools to read the
+   last values.
+
+   \param mem_ctx Pointer to the memory context
+   \param path Path of the statistics file
+   \param threads Number of thread blocks, 0 for MAPIROPS_STATS_THREADS
+
+   \return Allocated mapirops_stats structure on success, otherwise
+   NULL. Every thread must have stopped counting before it is freed.
+ */
+struct mapirops_stats *mapirops_stats_init(TALLOC_CTX *mem_ctx, const char *path, uint32_t threads)
+{
+	struct mapirops_stats		*stats;
+	struct mapirops_stats_header	*header;
+	size_t				length;
+	void				*data;
+	int				fd;
+
+	if (!path) {
+		return NULL;
+	}
+	if (!threads) {
+		threads = MAPIROPS_STATS_THREADS;
+	}
+	length = MAPIROPS_STATS_HEADER_SIZE + (size_t)threads * MAPIROPS_STATS_BLOCK_SIZE;
+
+	stats = talloc_zero(mem_ctx, struct mapirops_stats);
+	if (stats == NULL) {
+		return NULL;
+	}
+	stats->free = talloc_array(stats, uint32_t, threads);
+	if (stats->free == NULL) {
+		talloc_free(stats);
+		return NULL;
+	}
+
+	fd = open(path, O_RDWR|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+	if (fd == -1) {
+		mapirops_error(MAPIROPS_GENERIC_ERR, LOG_ERR,
+			       "Failed to open %s: %s", path, strerror(errno));
+		talloc_free(stats);
+		return NULL;
+	}
+	if (ftruncate(fd, length) == -1) {
+		mapirops_error(MAPIROPS_GENERIC_ERR, LOG_ERR,
+			       "Failed to resize %s: %s", path, strerror(errno));
+		close(fd);
+		talloc_free(stats);
+		return NULL;
+	}
+	data = mmap(NULL, length, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		mapirops_error(MAPIROPS_GENERIC_ERR, LOG_ERR,
+			       "Failed to map %s: %s", path, strerror(errno));
+		close(fd);
+		talloc_free(stats);
+		return NULL;
+	}
+
+	if (mapirops_threads_init(&stats->threads, sizeof (struct mapirops_stats_thread),
+				  "struct mapirops_stats_thread", mapirops_stats_thread_attach,
+				  mapirops_stats_thread_release, stats) != MAPIROPS_ERR_SUCCESS) {
+		munmap(data, length);
+		close(fd);
+		talloc_free(stats);
+		return NULL;
+	}
+	stats->fd = fd;
+	stats->data = (uint8_t *) data;
+	stats->length = length;
+	talloc_set_destructor(stats, mapirops_stats_destructor);
+
+	/* Readers check the magic number last */
+	header = (struct mapirops_stats_header *) data;
+	header->version = MAPIROPS_STATS_VERSION;
+	header->header_size = MAPIROPS_STATS_HEADER_SIZE;
+	header->block_size = MAPIROPS_STATS_BLOCK_SIZE;
+	header->block_count = threads;
+	header->pid = getpid();
+	__atomic_store_n(&header->magic, MAPIROPS_STATS_MAGIC, __ATOMIC_RELEASE);
+	stats->header = header;
+
+	return stats;
+}
+
+/**
+   \details Publish the statistics of a push context
+
+   \param push Pointer to the mapirops_push structure
+   \param stats Pointer to the mapirops_stats structure, NULL to stop
+   counting
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_push_set_stats(struct mapirops_push *push, struct mapirops_stats *stats)
+{
+	if (!push) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	push->stats = stats;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Publish the statistics of a pull context
+
+   \param pull Pointer to the mapirops_pull structure
+   \param stats Pointer to the mapirops_stats structure, NULL to stop
+   counting
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_pull_set_stats(struct mapirops_pull *pull, struct mapirops_stats *stats)
+{
+	if (!pull) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	pull->stats = stats;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Count a ROP pushed or pulled and its error, if any
+
+   \param stats Pointer to the mapirops_stats structure
+   \param direction One of enum mapirops_stats_direction
+   \param RopId ROP identifier
+   \param retval Value returned by the ROP codec
+ */
+void mapirops_stats_rop(struct mapirops_stats *stats, uint8_t direction, uint8_t RopId,
+			enum mapirops_err_code retval)
+{
+	struct mapirops_stats_block	*block;
+
+	if (!stats || direction > MAPIROPS_STATS_PUSH) {
+		return;
+	}
+
+	block = mapirops_stats_block_get(stats);
+	if (block == NULL) {
+		return;
+	}
+
+	mapirops_stats_begin(block);
+	mapirops_stats_add(&block->counters.rops[direction][RopId], 1);
+	if (retval != MAPIROPS_ERR_SUCCESS) {
+		mapirops_stats_add(&block->counters.errors[MIN((uint32_t) retval, MAPIROPS_STATS_ERRORS - 1)], 1);
+	}
+	mapirops_stats_end(block);
+}
+
+/*
+   Count the bytes of a ROP buffer
+ */
+void mapirops_stats_bytes(struct mapirops_stats *stats, uint8_t direction, uint32_t bytes)
+{
+	struct mapirops_stats_block	*block;
+
+	if (!stats || direction > MAPIROPS_STATS_PUSH) {
+		return;
+	}
+
+	block = mapirops_stats_block_get(stats);
+	if (block == NULL) {
+		return;
+	}
+
+	mapirops_stats_begin(block);
+	mapirops_stats_add(&block->counters.bytes[direction], bytes);
+	mapirops_stats_end(block);
+}
+
+/*
+   Count a memory allocation
+ */
+void mapirops_stats_alloc(struct mapirops_stats *stats)
+{
+	struct mapirops_stats_block	*block;
+
+	if (!stats) {
+		return;
+	}
+
+	block = mapirops_stats_block_get(stats);
+	if (block == NULL) {
+		return;
+	}
+
+	mapirops_stats_begin(block);
+	mapirops_stats_add(&block->counters.allocs, 1);
+	mapirops_stats_end(block);
+}
+
+static int mapirops_stats_reader_destructor(struct mapirops_stats_reader *reader)
+{
+	munmap(reader->data, reader->length);
+	close(reader->fd);
+
+	return 0;
+}
+
+/**
+   \details Map a statistics file for reading
+
+   \param mem_ctx Pointer to the memory context
+   \param path Path of the statistics file
+
+   \return Allocated mapirops_stats_reader structure on success,
+   otherwise NULL
+ */
+struct mapirops_stats_reader *mapirops_stats_reader_init(TALLOC_CTX *mem_ctx, const char *path)
+{
+	struct mapirops_stats_reader	*reader;
+	struct mapirops_stats_header	*header;
+	struct stat			st;
+	void				*data;
+	int				fd;
+
+	if (!path) {
+		return NULL;
+	}
+
+	fd = open(path, O_RDONLY|O_CLOEXEC);
+	if (fd == -1) {
+		mapirops_error(MAPIROPS_GENERIC_ERR, LOG_ERR,
+			       "Failed to open %s: %s", path, strerror(errno));
+		return NULL;
+	}
+	if (fstat(fd, &st) == -1 || st.st_size < MAPIROPS_STATS_HEADER_SIZE) {
+		mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR, "%s is not a statistics file", path);
+		close(fd);
+		return NULL;
+	}
+
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		mapirops_error(MAPIROPS_GENERIC_ERR, LOG_ERR,
+			       "Failed to map %s: %s", path, strerror(errno));
+		close(fd);
+		return NULL;
+	}
+
+	header = (struct mapirops_stats_header *) data;
+	if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != MAPIROPS_STATS_MAGIC ||
+	    header->version != MAPIROPS_STATS_VERSION ||
+	    header->header_size != MAPIROPS_STATS_HEADER_SIZE ||
+	    header->block_size < sizeof (struct mapirops_stats_block) ||
+	    header->block_size % sizeof (uint64_t) ||
+	    header->block_count > (st.st_size - MAPIROPS_STATS_HEADER_SIZE) / header->block_size) {
+		mapirops_error(MAPIROPS_ERR_INVALID_VAL, LOG_ERR, "%s is not a statistics file", path);
+		munmap(data, st.st_size);
+		close(fd);
+		return NULL;
+	}
+
+	reader = talloc_zero(mem_ctx, struct mapirops_stats_reader);
+	if (reader == NULL) {
+		munmap(data, st.st_size);
+		close(fd);
+		return NULL;
+	}
+	reader->fd = fd;
+	reader->data = (uint8_t *) data;
+	reader->length = st.st_size;
+	reader->block_size = header->block_size;
+	reader->block_count = header->block_count;
+	talloc_set_destructor(reader, mapirops_stats_reader_destructor);
+
+	return reader;
+}
+
+/**
+   \details Sum the counters of every thread of the published process
+
+   The process keeps counting while its counters are read. Each thread
+   block is copied consistently, blocks are not copied at the same
+   time.
+
+   \param reader Pointer to the mapirops_stats_reader structure
+   \param counters Pointer to the counters to fill
+   \param threads Pointer to the number of thread blocks in use, may
+   be NULL
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_stats_read(struct mapirops_stats_reader *reader,
+					   struct mapirops_stats_counters *counters,
+					   uint32_t *threads)
+{
+	struct mapirops_stats_header	*header;
+	struct mapirops_stats_block	*block;
+	struct mapirops_stats_counters	copy;
+	const uint64_t			*src;
+	uint64_t			*dst;
+	uint64_t			*total;
+	uint32_t			used;
+	uint32_t			seq;
+	uint32_t			retries;
+	uint32_t			i;
+	uint32_t			j;
+
+	if (!reader || !counters) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	memset(counters, 0, sizeof (struct mapirops_stats_counters));
+
+	header = (struct mapirops_stats_header *) reader->data;
+	used = MIN(__atomic_load_n(&header->used, __ATOMIC_ACQUIRE), reader->block_count);
+	for (i = 0; i < used; i++) {
+		block = mapirops_stats_block_at(reader->data, reader->block_size, i);
+		src = (const uint64_t *) &block->counters;
+		dst = (uint64_t *) &copy;
+		for (retries = 1; ; retries++) {
+			seq = __atomic_load_n(&block->seq, __ATOMIC_ACQUIRE);
+			for (j = 0; j < sizeof (copy) / sizeof (uint64_t); j++) {
+				dst[j] = __atomic_load_n(&src[j], __ATOMIC_RELAXED);
+			}
+			__atomic_thread_fence(__ATOMIC_ACQUIRE);
+			if (!(seq & 1) && __atomic_load_n(&block->seq, __ATOMIC_RELAXED) == seq) {
+				break;
+			}
+			/* The writer died while updating the block */
+			if (retries == MAPIROPS_STATS_RETRIES) {
+				break;
+			}
+		}
+
+		total = (uint64_t *) counters;
+		for (j = 0; j < sizeof (copy) / sizeof (uint64_t); j++) {
+			total[j] += dst[j];
+		}
+	}
+
+	if (threads) {
+		*threads = used;
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
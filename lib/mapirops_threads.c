@@ -0,0 +1,192 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_threads.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Registry of per-thread state
+
+   Recording hooks such as the capture keep per-thread state so that
+   recording never takes a lock. A registry embedded in their structure
+   owns this state:
+
+   - The state of a thread is created on its first use, in its own
+     talloc hierarchy since talloc is not shared between threads, and
+     linked in the registry. The attach callback runs at that time.
+   - When the thread exits, its state is released: the release callback
+     hands whatever must outlive the thread over to the owner, then
+     the state is unlinked and freed.
+   - When the registry is freed, the state of the threads still alive
+     is released the same way. No thread may use the registry anymore
+     at that point, which is why the owners require every thread to
+     have stopped before they are freed.
+
+   Both callbacks run with the registry lock held. Owners take the same
+   lock to walk the state of every thread.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+/*
+   Release the state of a thread. The registry lock is held.
+ */
+static void mapirops_threads_release(struct mapirops_thread *thread)
+{
+	struct mapirops_threads	*threads = thread->threads;
+
+	threads->release(threads->private_data, thread);
+
+	if (thread->prev) {
+		thread->prev->next = thread->next;
+	} else {
+		threads->list = thread->next;
+	}
+	if (thread->next) {
+		thread->next->prev = thread->prev;
+	}
+	talloc_free(thread);
+}
+
+static void mapirops_threads_exit(void *data)
+{
+	struct mapirops_thread	*thread = (struct mapirops_thread *) data;
+	struct mapirops_threads	*threads = thread->threads;
+
+	pthread_mutex_lock(&threads->lock);
+	mapirops_threads_release(thread);
+	pthread_mutex_unlock(&threads->lock);
+}
+
+/**
+   \details Initialize a registry of per-thread state
+
+   \param threads Pointer to the registry to initialize
+   \param size Size of the per-thread structure, starting with a
+   struct mapirops_thread
+   \param name talloc name of the per-thread structure
+   \param attach Called when the state of a thread is created, may be
+   NULL
+   \param release Called before the state of a thread is freed
+   \param private_data Pointer passed to the callbacks
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_threads_init(struct mapirops_threads *threads, size_t size, const char *name,
+					     enum mapirops_err_code (*attach)(void *, struct mapirops_thread *),
+					     void (*release)(void *, struct mapirops_thread *),
+					     void *private_data)
+{
+	if (!threads || size < sizeof (struct mapirops_thread) || !release) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	memset(threads, 0, sizeof (struct mapirops_threads));
+	if (pthread_key_create(&threads->key, mapirops_threads_exit) != 0) {
+		return mapirops_error(MAPIROPS_GENERIC_ERR, LOG_ERR, "No more thread-specific keys");
+	}
+	pthread_mutex_init(&threads->lock, NULL);
+	threads->size = size;
+	threads->name = name;
+	threads->attach = attach;
+	threads->release = release;
+	threads->private_data = private_data;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Release the state of every thread and free the registry
+
+   \param threads Pointer to the registry
+ */
+void mapirops_threads_free(struct mapirops_threads *threads)
+{
+	pthread_key_delete(threads->key);
+
+	pthread_mutex_lock(&threads->lock);
+	while (threads->list) {
+		mapirops_threads_release(threads->list);
+	}
+	pthread_mutex_unlock(&threads->lock);
+	pthread_mutex_destroy(&threads->lock);
+}
+
+/**
+   \details Return the state of the calling thread, created on first
+   use
+
+   \param threads Pointer to the registry
+
+   \return Pointer to the state of the calling thread on success,
+   otherwise NULL
+ */
+struct mapirops_thread *mapirops_threads_get(struct mapirops_threads *threads)
+{
+	struct mapirops_thread	*thread;
+
+	thread = (struct mapirops_thread *) pthread_getspecific(threads->key);
+	if (likely(thread != NULL)) {
+		return thread;
+	}
+
+	thread = (struct mapirops_thread *) talloc_named_const(NULL, threads->size, threads->name);
+	if (thread == NULL) {
+		return NULL;
+	}
+	memset(thread, 0, threads->size);
+	thread->threads = threads;
+
+	pthread_mutex_lock(&threads->lock);
+	if (threads->attach && threads->attach(threads->private_data, thread) != MAPIROPS_ERR_SUCCESS) {
+		pthread_mutex_unlock(&threads->lock);
+		talloc_free(thread);
+		return NULL;
+	}
+	if (pthread_setspecific(threads->key, thread) != 0) {
+		threads->release(threads->private_data, thread);
+		pthread_mutex_unlock(&threads->lock);
+		talloc_free(thread);
+		return NULL;
+	}
+	thread->next = threads->list;
+	if (thread->next) {
+		thread->next->prev = thread;
+	}
+	threads->list = thread;
+	pthread_mutex_unlock(&threads->lock);
+
+	return thread;
+}
+
+/**
+   \details Return the state of the calling thread if it was created
+
+   \param threads Pointer to the registry
+
+   \return Pointer to the state of the calling thread, NULL if the
+   thread did not use the registry yet
+ */
+struct mapirops_thread *mapirops_threads_peek(struct mapirops_threads *threads)
+{
+	return (struct mapirops_thread *) pthread_getspecific(threads->key);
+}
@@ -0,0 +1,436 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file mapirops_timing.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Latency histograms of the generated ROP codecs
+
+   When the library is configured with --enable-timing, the generated
+   push and pull functions of every Rop*_request and Rop*_response
+   structure time themselves into the mapirops_timing structure of
+   their context, if any.
+
+   Each thread records into its own histograms, one per RopId and
+   direction, allocated on first use. A histogram only has one writer
+   and is read with relaxed atomics when merged, so recording never
+   takes a lock.
+ */
+
+#include "config.h"
+
+#include "libmapirops.h"
+#include "libmapirops_private.h"
+
+#include <time.h>
+
+/** \cond */
+#define	MAPIROPS_TIMING_SUB_COUNT	(1 << MAPIROPS_TIMING_SUB_BITS)
+
+struct mapirops_timing_thread {
+	struct mapirops_thread			thread;
+	struct mapirops_timing_histogram	*histograms[2][256];
+};
+
+struct mapirops_timing {
+	struct mapirops_threads			threads;	/* Its lock protects retired */
+	struct mapirops_timing_histogram	*retired[2][256];	/* Histograms of the exited threads */
+};
+/** \endcond */
+
+/*
+   Return the bucket of a value in nanoseconds
+ */
+static inline uint32_t mapirops_timing_bucket(uint64_t value)
+{
+	uint32_t	msb;
+
+	if (value < MAPIROPS_TIMING_SUB_COUNT) {
+		return value;
+	}
+	if (value >> 32) {
+		return MAPIROPS_TIMING_BUCKETS - 1;
+	}
+
+	msb = 31 - __builtin_clz((uint32_t)value);
+	return ((msb - MAPIROPS_TIMING_SUB_BITS + 1) << MAPIROPS_TIMING_SUB_BITS) +
+		((value >> (msb - MAPIROPS_TIMING_SUB_BITS)) & (MAPIROPS_TIMING_SUB_COUNT - 1));
+}
+
+/*
+   Return the highest value in nanoseconds of a bucket
+ */
+static uint64_t mapirops_timing_bucket_max(uint32_t bucket)
+{
+	uint32_t	shift;
+	uint64_t	base;
+
+	if (bucket < MAPIROPS_TIMING_SUB_COUNT) {
+		return bucket;
+	}
+
+	shift = (bucket >> MAPIROPS_TIMING_SUB_BITS) - 1;
+	base = (uint64_t)(MAPIROPS_TIMING_SUB_COUNT + (bucket & (MAPIROPS_TIMING_SUB_COUNT - 1))) << shift;
+
+	return base + ((uint64_t)1 << shift) - 1;
+}
+
+/*
+   Add a histogram to another one. src may be updated concurrently by
+   its thread.
+ */
+static void mapirops_timing_add(struct mapirops_timing_histogram *dst,
+				struct mapirops_timing_histogram *src)
+{
+	uint64_t	max;
+	uint32_t	i;
+
+	dst->count += __atomic_load_n(&src->count, __ATOMIC_RELAXED);
+	dst->sum += __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+	max = __atomic_load_n(&src->max, __ATOMIC_RELAXED);
+	if (max > dst->max) {
+		dst->max = max;
+	}
+	for (i = 0; i < MAPIROPS_TIMING_BUCKETS; i++) {
+		dst->buckets[i] += __atomic_load_n(&src->buckets[i], __ATOMIC_RELAXED);
+	}
+}
+
+/*
+   Move the histograms of a thread to the retired ones
+ */
+static void mapirops_timing_thread_release(void *private_data, struct mapirops_thread *thread)
+{
+	struct mapirops_timing		*timing = (struct mapirops_timing *) private_data;
+	struct mapirops_timing_thread	*tt = (struct mapirops_timing_thread *) thread;
+	uint32_t			direction;
+	uint32_t			RopId;
+
+	for (direction = 0; direction < 2; direction++) {
+		for (RopId = 0; RopId < 256; RopId++) {
+			if (tt->histograms[direction][RopId] == NULL) {
+				continue;
+			}
+			if (timing->retired[direction][RopId] == NULL) {
+				timing->retired[direction][RopId] = talloc_steal(timing, tt->histograms[direction][RopId]);
+			} else {
+				mapirops_timing_add(timing->retired[direction][RopId], tt->histograms[direction][RopId]);
+			}
+		}
+	}
+}
+
+static int mapirops_timing_destructor(struct mapirops_timing *timing)
+{
+	mapirops_threads_free(&timing->threads);
+
+	return 0;
+}
+
+/**
+   \details Create an empty set of latency histograms
+
+   \param mem_ctx Pointer to the memory context
+
+   \return Allocated mapirops_timing structure on success, otherwise
+   NULL. Every thread must have stopped timing before it is freed.
+ */
+struct mapirops_timing *mapirops_timing_init(TALLOC_CTX *mem_ctx)
+{
+	struct mapirops_timing	*timing;
+
+	timing = talloc_zero(mem_ctx, struct mapirops_timing);
+	if (timing == NULL) {
+		return NULL;
+	}
+
+	if (mapirops_threads_init(&timing->threads, sizeof (struct mapirops_timing_thread),
+				  "struct mapirops_timing_thread", NULL,
+				  mapirops_timing_thread_release, timing) != MAPIROPS_ERR_SUCCESS) {
+		talloc_free(timing);
+		return NULL;
+	}
+	talloc_set_destructor(timing, mapirops_timing_destructor);
+
+	return timing;
+}
+
+/**
+   \details Time the ROPs pushed with a push context
+
+   \param push Pointer to the mapirops_push structure
+   \param timing Pointer to the mapirops_timing structure, NULL to
+   stop timing
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_push_set_timing(struct mapirops_push *push, struct mapirops_timing *timing)
+{
+	if (!push) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	push->timing = timing;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Time the ROPs pulled with a pull context
+
+   \param pull Pointer to the mapirops_pull structure
+   \param timing Pointer to the mapirops_timing structure, NULL to
+   stop timing
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_pull_set_timing(struct mapirops_pull *pull, struct mapirops_timing *timing)
+{
+	if (!pull) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	pull->timing = timing;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Return the start time of a timed call
+
+   \return Monotonic time in nanoseconds
+ */
+uint64_t mapirops_timing_start(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+   \details Record the time elapsed since mapirops_timing_start
+
+   The call is silently dropped if the histogram of the calling thread
+   cannot be allocated.
+
+   \param timing Pointer to the mapirops_timing structure
+   \param direction One of enum mapirops_timing_direction
+   \param RopId ROP identifier
+   \param start Value returned by mapirops_timing_start
+ */
+void mapirops_timing_stop(struct mapirops_timing *timing, uint8_t direction, uint8_t RopId, uint64_t start)
+{
+	struct mapirops_timing_thread		*thread;
+	struct mapirops_timing_histogram	*histogram;
+	uint64_t				elapsed;
+	uint32_t				bucket;
+
+	elapsed = mapirops_timing_start() - start;
+	if (!timing || direction > MAPIROPS_TIMING_PUSH) {
+		return;
+	}
+
+	thread = (struct mapirops_timing_thread *) mapirops_threads_get(&timing->threads);
+	if (thread == NULL) {
+		return;
+	}
+
+	histogram = thread->histograms[direction][RopId];
+	if (unlikely(histogram == NULL)) {
+		histogram = talloc_zero(thread, struct mapirops_timing_histogram);
+		if (histogram == NULL) {
+			return;
+		}
+		__atomic_store_n(&thread->histograms[direction][RopId], histogram, __ATOMIC_RELEASE);
+	}
+
+	/* Only this thread writes the histogram */
+	bucket = mapirops_timing_bucket(elapsed);
+	__atomic_store_n(&histogram->buckets[bucket], histogram->buckets[bucket] + 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&histogram->count, histogram->count + 1, __ATOMIC_RELAXED);
+	__atomic_store_n(&histogram->sum, histogram->sum + elapsed, __ATOMIC_RELAXED);
+	if (elapsed > histogram->max) {
+		__atomic_store_n(&histogram->max, elapsed, __ATOMIC_RELAXED);
+	}
+}
+
+/**
+   \details Merge the histograms of every thread for a ROP
+
+   Threads may keep timing while histograms are merged.
+
+   \param timing Pointer to the mapirops_timing structure
+   \param direction One of enum mapirops_timing_direction
+   \param RopId ROP identifier
+   \param histogram Pointer to the histogram to fill
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_timing_merge(struct mapirops_timing *timing, uint8_t direction,
+					     uint8_t RopId, struct mapirops_timing_histogram *histogram)
+{
+	struct mapirops_thread			*thread;
+	struct mapirops_timing_thread		*tt;
+	struct mapirops_timing_histogram	*src;
+
+	if (!timing || !histogram || direction > MAPIROPS_TIMING_PUSH) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	memset(histogram, 0, sizeof (struct mapirops_timing_histogram));
+
+	pthread_mutex_lock(&timing->threads.lock);
+	if (timing->retired[direction][RopId]) {
+		mapirops_timing_add(histogram, timing->retired[direction][RopId]);
+	}
+	for (thread = timing->threads.list; thread; thread = thread->next) {
+		tt = (struct mapirops_timing_thread *) thread;
+		src = __atomic_load_n(&tt->histograms[direction][RopId], __ATOMIC_ACQUIRE);
+		if (src) {
+			mapirops_timing_add(histogram, src);
+		}
+	}
+	pthread_mutex_unlock(&timing->threads.lock);
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Return a percentile of a histogram
+
+   The value is the upper bound of the bucket holding the percentile,
+   which overestimates it by less than 1/2^MAPIROPS_TIMING_SUB_BITS,
+   and never exceeds the longest call.
+
+   \param histogram Pointer to the histogram
+   \param percentile Percentile between 0 and 1, e.g. 0.999
+
+   \return Percentile in nanoseconds, 0 if the histogram is empty
+ */
+uint64_t mapirops_timing_percentile(const struct mapirops_timing_histogram *histogram, double percentile)
+{
+	uint64_t	rank;
+	uint64_t	total;
+	uint64_t	value;
+	uint32_t	i;
+
+	if (!histogram) {
+		return 0;
+	}
+
+	/* Counters are read one by one, so count may lag the buckets */
+	total = 0;
+	for (i = 0; i < MAPIROPS_TIMING_BUCKETS; i++) {
+		total += histogram->buckets[i];
+	}
+	if (!total) {
+		return 0;
+	}
+
+	if (percentile < 0) {
+		percentile = 0;
+	}
+	rank = (uint64_t)(percentile * total);
+	if (rank < percentile * total || !rank) {
+		rank++;
+	}
+	if (rank > total) {
+		rank = total;
+	}
+
+	for (i = 0; i < MAPIROPS_TIMING_BUCKETS; i++) {
+		if (histogram->buckets[i] >= rank) {
+			break;
+		}
+		rank -= histogram->buckets[i];
+	}
+
+	value = mapirops_timing_bucket_max(i);
+	if (histogram->max && value > histogram->max) {
+		value = histogram->max;
+	}
+
+	return value;
+}
+
+/**
+   \details Merge the histograms of every thread and summarize each
+   timed ROP
+
+   \param timing Pointer to the mapirops_timing structure
+   \param mem_ctx Pointer to the memory context
+   \param summary Pointer on the talloc'ed array of summaries to
+   return, ordered by direction and RopId
+   \param count Pointer on the number of summaries to return
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_timing_export(struct mapirops_timing *timing, TALLOC_CTX *mem_ctx,
+					      struct mapirops_timing_summary **summary, uint32_t *count)
+{
+	struct mapirops_timing_histogram	*histogram;
+	struct mapirops_timing_summary		*entries;
+	uint32_t				direction;
+	uint32_t				RopId;
+	uint32_t				n;
+
+	if (!timing || !summary || !count) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	histogram = talloc_zero(mem_ctx, struct mapirops_timing_histogram);
+	entries = talloc_array(mem_ctx, struct mapirops_timing_summary, 2 * 256);
+	if (histogram == NULL || entries == NULL) {
+		talloc_free(histogram);
+		talloc_free(entries);
+		return MAPIROPS_ERR_NO_MEMORY;
+	}
+
+	n = 0;
+	for (direction = 0; direction < 2; direction++) {
+		for (RopId = 0; RopId < 256; RopId++) {
+			mapirops_timing_merge(timing, direction, RopId, histogram);
+			if (!histogram->count) {
+				continue;
+			}
+			entries[n].RopId = RopId;
+			entries[n].direction = direction;
+			entries[n].count = histogram->count;
+			entries[n].mean = histogram->sum / histogram->count;
+			entries[n].p50 = mapirops_timing_percentile(histogram, 0.5);
+			entries[n].p99 = mapirops_timing_percentile(histogram, 0.99);
+			entries[n].p999 = mapirops_timing_percentile(histogram, 0.999);
+			entries[n].max = histogram->max;
+			n++;
+		}
+	}
+	talloc_free(histogram);
+
+	*summary = talloc_realloc(mem_ctx, entries, struct mapirops_timing_summary, n);
+	if (n && *summary == NULL) {
+		talloc_free(entries);
+		return MAPIROPS_ERR_NO_MEMORY;
+	}
+	*count = n;
+
+	return MAPIROPS_ERR_SUCCESS;
+}
@@ -60,6 +60,12 @@ typedef struct _MAPIGUID {
 	uint8_t		ab[16];		/*!< Array of 16 bytes containing flat GUID */
 } MAPIGUID;
 
+/** \def MAPIROPS_GUID_STRING_SIZE
+    Size of the buffer needed to format a GUID, including the
+    terminating NULL character
+*/
+#define	MAPIROPS_GUID_STRING_SIZE	37
+
 /** \cond */
 #ifndef	__BEGIN_DECLS
 #ifdef	__cplusplus
@@ -83,7 +89,11 @@ enum mapirops_err_code	mapirops_push_GUID(struct mapirops_push *, const GUID *);
 enum mapirops_err_code	mapirops_pull_GUID(struct mapirops_pull *, GUID *);
 
 /* The following definitions come from uuid.c */
+enum mapirops_err_code mapirops_GUID_parse(const char *, size_t, GUID *);
 enum mapirops_err_code mapirops_GUID_from_string(const char *, GUID *);
+enum mapirops_err_code mapirops_GUID_parse_array(const char * const *, uint32_t, GUID *);
+char *mapirops_GUID_format(const GUID *, char *);
+enum mapirops_err_code mapirops_GUID_format_array(const GUID *, uint32_t, char *);
 char *mapirops_GUID_to_string(TALLOC_CTX *, GUID *);
 
 __END_DECLS
@@ -102,6 +102,9 @@ enum MAPISTATUS {
 	SYNC_E_UNSYNCHRONIZED		=	0x80040805,	/*!< NotSynchronized: Sync operation did not take place, possibly due to conflicting change */
 	MAPI_E_NAMED_PROP_QUOTA_EXCEEDED=	0x80040900,	/*!< NamedPropertyQuota: Store object cannot store any more named property */
 	MAPI_E_NOT_IMPLEMENTED		=	0x80040FFF,	/*!< NotImplemented: Server does not implement this method call */
+
+	/* Warning codes */
+	MAPI_W_ERRORS_RETURNED		=	0x00040380,	/*!< ErrorsReturned: The call succeeded but failed for some of the individual items */
 	
 	/* Additional error codes */
 	ecProfileNotConfigured		=	0x0000011C,	/*!< ProfileNotConfigured: Profile is not configured */
@@ -372,5 +375,6 @@ enum MAPISTATUS {
 #define	ecAmbiguousRecip		MAPI_E_AMBIGUOUS_RECIP		/*!< Alternate name for MAPI_E_AMBIGUOUS_RECIP */
 #define	ecNPQuotaExceeded		MAPI_E_NAMED_PROP_QUOTA_EXCEEDED/*!< Alternate name for MAPI_E_NAMED_PROP_QUOTA_EXCEEDED */
 #define	ecServerOOM			ecMemory			/*!< Alternate name for ecMemory */
+#define	ecWarnWithErrors		MAPI_W_ERRORS_RETURNED		/*!< Alternate name for MAPI_W_ERRORS_RETURNED */
 
 #endif /*!__MAPISTATUS_H__ */
@@ -0,0 +1,191 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/**
+   \file stats.c
+   \author The OpenChange Project
+   \version 0.1
+   \brief Live monitor of the statistics published by a process
+
+   The statistics file is mapped read-only and read at each interval.
+   Rates are the difference between two reads: the monitored process
+   is never stopped nor slowed down.
+ */
+
+#include "libmapirops.h"
+
+#include <popt.h>
+#include <time.h>
+#include <unistd.h>
+
+/** \cond */
+static const char *stats_errors[MAPIROPS_STATS_ERRORS] = {
+	"SUCCESS", "BUFFER_TOO_SMALL", "BUFSIZE", "NO_MEMORY", "ALLOC", "ICONV",
+	"INVALID_FLAGS", "INVALID_VAL", "INVALID_EC", "GENERIC_ERR", "NOT_FOUND"
+};
+/** \endcond */
+
+static uint64_t stats_now(void)
+{
+	struct timespec	ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static double stats_rate(uint64_t cur, uint64_t prev, double elapsed)
+{
+	return (cur >= prev) ? (cur - prev) / elapsed : 0.0;
+}
+
+static void stats_report(const struct mapirops_stats_counters *cur,
+			 const struct mapirops_stats_counters *prev,
+			 uint32_t threads, double elapsed, int rops)
+{
+	const struct mapirops_rop_dispatch	*dispatch;
+	const char				*dirname[2] = { "pull", "push" };
+	uint64_t				count[2] = { 0, 0 };
+	uint64_t				last[2] = { 0, 0 };
+	uint64_t				errors = 0;
+	uint64_t				last_errors = 0;
+	uint32_t				dir;
+	uint32_t				i;
+
+	for (dir = 0; dir < 2; dir++) {
+		for (i = 0; i < 256; i++) {
+			count[dir] += cur->rops[dir][i];
+			last[dir] += prev->rops[dir][i];
+		}
+	}
+	for (i = 0; i < MAPIROPS_STATS_ERRORS; i++) {
+		errors += cur->errors[i];
+		last_errors += prev->errors[i];
+	}
+
+	printf("Threads: %u  In: %.1f KB/s  Out: %.1f KB/s  ROPs pulled: %.1f/s  pushed: %.1f/s  "
+	       "Errors: %.1f/s  Allocs: %.1f/s\n", threads,
+	       stats_rate(cur->bytes[MAPIROPS_STATS_PULL], prev->bytes[MAPIROPS_STATS_PULL], elapsed) / 1024.0,
+	       stats_rate(cur->bytes[MAPIROPS_STATS_PUSH], prev->bytes[MAPIROPS_STATS_PUSH], elapsed) / 1024.0,
+	       stats_rate(count[MAPIROPS_STATS_PULL], last[MAPIROPS_STATS_PULL], elapsed),
+	       stats_rate(count[MAPIROPS_STATS_PUSH], last[MAPIROPS_STATS_PUSH], elapsed),
+	       stats_rate(errors, last_errors, elapsed),
+	       stats_rate(cur->allocs, prev->allocs, elapsed));
+
+	if (!rops) {
+		return;
+	}
+
+	for (dir = 0; dir < 2; dir++) {
+		for (i = 0; i < 256; i++) {
+			if (cur->rops[dir][i] == prev->rops[dir][i]) {
+				continue;
+			}
+			dispatch = mapirops_rop_dispatch_get(i);
+			printf("  %-4s 0x%.2X  %-28s %10.1f/s\n", dirname[dir], i,
+			       dispatch ? dispatch->name : "(unknown)",
+			       stats_rate(cur->rops[dir][i], prev->rops[dir][i], elapsed));
+		}
+	}
+	for (i = 1; i < MAPIROPS_STATS_ERRORS; i++) {
+		if (cur->errors[i] != prev->errors[i]) {
+			printf("  %-4s %-34s %10.1f/s\n", "err", stats_errors[i] ? stats_errors[i] : "(unknown)",
+			       stats_rate(cur->errors[i], prev->errors[i], elapsed));
+		}
+	}
+}
+
+int main(int argc, const char *argv[])
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_stats_reader	*reader;
+	struct mapirops_stats_counters	*cur;
+	struct mapirops_stats_counters	*prev;
+	struct mapirops_stats_counters	*tmp;
+	struct timespec			delay;
+	poptContext			pc;
+	const char			*path;
+	uint64_t			start;
+	uint64_t			now;
+	uint32_t			threads;
+	int				opt;
+	int				interval = 1;
+	int				count = 0;
+	int				rops = 0;
+	int				i;
+
+	struct poptOption	long_options[] = {
+		POPT_AUTOHELP
+		{"interval", 'i', POPT_ARG_INT, &interval, 0, "Seconds between two reports, 1 by default", "SECONDS"},
+		{"count", 'c', POPT_ARG_INT, &count, 0, "Number of reports, until interrupted by default", "COUNT"},
+		{"rops", 'r', POPT_ARG_NONE, &rops, 0, "Report the rate of each ROP and error", NULL},
+		{ NULL, 0, 0, NULL, 0, NULL, NULL }
+	};
+
+	pc = poptGetContext("mapirops_stats", argc, argv, long_options, 0);
+	poptSetOtherOptionHelp(pc, "[OPTION...] STATS");
+	while ((opt = poptGetNextOpt(pc)) != -1) {
+		if (opt < -1) {
+			fprintf(stderr, "%s: %s\n", poptBadOption(pc, POPT_BADOPTION_NOALIAS),
+				poptStrerror(opt));
+			poptFreeContext(pc);
+			return EXIT_FAILURE;
+		}
+	}
+
+	path = poptGetArg(pc);
+	if (path == NULL || interval <= 0) {
+		poptPrintUsage(pc, stderr, 0);
+		poptFreeContext(pc);
+		return EXIT_FAILURE;
+	}
+
+	mem_ctx = talloc_named(NULL, 0, "mapirops_stats");
+	reader = mapirops_stats_reader_init(mem_ctx, path);
+	cur = talloc_zero(mem_ctx, struct mapirops_stats_counters);
+	prev = talloc_zero(mem_ctx, struct mapirops_stats_counters);
+	if (reader == NULL || cur == NULL || prev == NULL) {
+		fprintf(stderr, "%s: can't read statistics\n", path);
+		poptFreeContext(pc);
+		talloc_free(mem_ctx);
+		return EXIT_FAILURE;
+	}
+	poptFreeContext(pc);
+
+	mapirops_stats_read(reader, prev, &threads);
+	start = stats_now();
+	for (i = 0; !count || i < count; i++) {
+		delay.tv_sec = interval;
+		delay.tv_nsec = 0;
+		nanosleep(&delay, NULL);
+
+		mapirops_stats_read(reader, cur, &threads);
+		now = stats_now();
+		stats_report(cur, prev, threads, (now - start) / 1e9, rops);
+		fflush(stdout);
+
+		tmp = prev;
+		prev = cur;
+		cur = tmp;
+		start = now;
+	}
+
+	talloc_free(mem_ctx);
+
+	return EXIT_SUCCESS;
+}
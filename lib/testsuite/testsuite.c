@@ -19,6 +19,8 @@
 
 #include "testsuite.h"
 
+#include <unistd.h>
+
 START_TEST (test_push_init)
 {
 	TALLOC_CTX		*mem_ctx;
@@ -227,6 +229,47 @@ START_TEST (test_ascii_noterm)
 }
 END_TEST
 
+START_TEST (test_ascii_nosize)
+{
+	TALLOC_CTX		*mem_ctx;
+	enum mapirops_err_code	errval;
+	struct mapirops_push	*push;
+	struct mapirops_pull	*pull;
+	char			*in = "IPM.Note";
+	char			*out = NULL;
+
+	COMMON_TEST_START(ascii_nosize);
+
+	errval = mapirops_push_ascii_string(push, 0, in);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	errval = mapirops_push_ascii_string(push, 0, "");
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+
+	/* Strings ending at the end of the buffer */
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	errval = mapirops_pull_ascii_string(pull, mem_ctx, MAPIROPS_STR_NOSIZE, &out, 0);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(strcmp(in, out));
+	fail_if(pull->offset != strlen(in) + 1);
+	errval = mapirops_pull_ascii_string(pull, mem_ctx, MAPIROPS_STR_NOSIZE, &out, 0);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(strcmp(out, ""));
+	fail_if(pull->offset != push->offset);
+
+	/* Unterminated string */
+	pull->offset = 0;
+	pull->data.length = strlen(in);
+	errval = mapirops_pull_ascii_string(pull, mem_ctx, MAPIROPS_STR_NOSIZE, &out, 0);
+	fail_if(errval != MAPIROPS_ERR_BUFSIZE);
+	fail_if(pull->offset != 0);
+	errval = mapirops_pull_ascii_string(pull, mem_ctx, MAPIROPS_STR_NOSIZE|MAPIROPS_STR_NOTERM, &out, 0);
+	fail_if(errval != MAPIROPS_ERR_INVALID_FLAGS);
+
+	COMMON_TEST_END();
+}
+END_TEST
+
 START_TEST (test_utf16)
 {
 	TALLOC_CTX		*mem_ctx;
@@ -280,6 +323,57 @@ START_TEST (test_utf16_noterm)
 }
 END_TEST
 
+START_TEST (test_utf16_nosize)
+{
+	TALLOC_CTX		*mem_ctx;
+	enum mapirops_err_code	errval;
+	struct mapirops_push	*push;
+	struct mapirops_pull	*pull;
+	char			*in = "Caf\xc3\xa9 \xe2\x82\xac, a string long enough for the vector loops";
+	char			*out = NULL;
+	size_t			utf16len;
+
+	COMMON_TEST_START(utf16_nosize);
+
+	/* Odd offset: unaligned 16-bit units */
+	errval = mapirops_push_uint8(push, 0x27);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	errval = mapirops_push_utf16_string(push, 0, in);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	utf16len = push->offset - 1;
+	errval = mapirops_push_utf16_string(push, 0, "A");
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	pull->offset = 1;
+	errval = mapirops_pull_utf16_string(pull, mem_ctx, MAPIROPS_STR_NOSIZE, &out, 0);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(strcmp(in, out));
+	fail_if(pull->offset != 1 + utf16len);
+	errval = mapirops_pull_utf16_string(pull, mem_ctx, MAPIROPS_STR_NOSIZE, &out, 0);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(strcmp(out, "A"));
+	fail_if(pull->offset != push->offset);
+
+	/* A zero byte is not a termination */
+	pull->offset = 1;
+	pull->data.length = utf16len;
+	errval = mapirops_pull_utf16_string(pull, mem_ctx, MAPIROPS_STR_NOSIZE, &out, 0);
+	fail_if(errval != MAPIROPS_ERR_BUFSIZE);
+	fail_if(pull->offset != 1);
+
+	/* Sized string ending at the end of the buffer */
+	pull->offset = 1;
+	pull->data.length = 1 + utf16len;
+	errval = mapirops_pull_utf16_string(pull, mem_ctx, 0, &out, utf16len - 2);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(strcmp(in, out));
+
+	COMMON_TEST_END();
+}
+END_TEST
+
 START_TEST (test_bytes)
 {
 	TALLOC_CTX		*mem_ctx;
@@ -377,6 +471,43 @@ START_TEST (test_GUID)
 }
 END_TEST
 
+START_TEST (test_GUID_string)
+{
+	GUID			guid;
+	GUID			guids[2];
+	char			buf[MAPIROPS_GUID_STRING_SIZE];
+	char			array[2 * MAPIROPS_GUID_STRING_SIZE];
+	const char		*strings[2];
+
+	fail_if(mapirops_GUID_from_string(TEST_PS_MAPI_38, &guid) != MAPIROPS_ERR_SUCCESS);
+	fail_if(guid.Data1 != 0x00020328 || guid.Data2 != 0 || guid.Data3 != 0);
+	fail_if(guid.Data4[0] != 0xc0 || guid.Data4[7] != 0x46);
+	fail_if(strcmp(mapirops_GUID_format(&guid, buf), TEST_PS_MAPI_36));
+
+	/* Upper case digits, and a string not NULL terminated */
+	fail_if(mapirops_GUID_parse("C4F1AE21-0A3B-4A1E-9C2D-40C4B1F1A7E5}}}", 36, &guid) != MAPIROPS_ERR_SUCCESS);
+	fail_if(guid.Data1 != 0xc4f1ae21 || guid.Data2 != 0x0a3b || guid.Data3 != 0x4a1e);
+	fail_if(strcmp(mapirops_GUID_format(&guid, buf), "c4f1ae21-0a3b-4a1e-9c2d-40c4b1f1a7e5"));
+
+	/* Invalid strings */
+	fail_if(mapirops_GUID_from_string(NULL, &guid) == MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_GUID_from_string("00020328-0000-0000-c000-00000000004", &guid) == MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_GUID_from_string("00020328-0000-0000-c000-00000000004g", &guid) == MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_GUID_from_string("00020328-0000-0000-c000+000000000046", &guid) == MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_GUID_from_string("{00020328-0000-0000-c000-000000000046)", &guid) == MAPIROPS_ERR_SUCCESS);
+
+	/* Arrays */
+	strings[0] = TEST_PS_MAPI_36;
+	strings[1] = "{c4f1ae21-0a3b-4a1e-9c2d-40c4b1f1a7e5}";
+	fail_if(mapirops_GUID_parse_array(strings, 2, guids) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_GUID_format_array(guids, 2, array) != MAPIROPS_ERR_SUCCESS);
+	fail_if(strcmp(array, TEST_PS_MAPI_36));
+	fail_if(strcmp(array + MAPIROPS_GUID_STRING_SIZE, "c4f1ae21-0a3b-4a1e-9c2d-40c4b1f1a7e5"));
+	strings[1] = "c4f1ae21";
+	fail_if(mapirops_GUID_parse_array(strings, 2, guids) == MAPIROPS_ERR_SUCCESS);
+}
+END_TEST
+
 START_TEST (test_MAPISTATUS)
 {
 	TALLOC_CTX		*mem_ctx;
@@ -399,6 +530,316 @@ START_TEST (test_MAPISTATUS)
 }
 END_TEST
 
+START_TEST (test_savepoint)
+{
+	TALLOC_CTX		*mem_ctx;
+	enum mapirops_err_code	errval;
+	struct mapirops_push	*push;
+	struct mapirops_pull	*pull;
+	uint32_t		savepoint;
+	size_t			length;
+	int			i;
+
+	COMMON_TEST_START(test_savepoint);
+
+	errval = mapirops_push_uint32(push, 0xdeadbeef);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+
+	/* Small pushes don't grow the buffer every time */
+	length = push->data.length;
+	for (i = 0; i < 16; i++) {
+		errval = mapirops_push_uint8(push, i);
+		fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	}
+	fail_if(push->data.length != length);
+
+	/* Limit below what was already pushed */
+	errval = mapirops_push_set_limit(push, 4);
+	fail_if(errval != MAPIROPS_ERR_INVALID_VAL);
+
+	errval = mapirops_push_set_limit(push, 30);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+
+	/* A rop which doesn't fit is rolled back */
+	savepoint = mapirops_push_savepoint(push);
+	fail_if(savepoint != 20);
+	errval = mapirops_push_uint64(push, 0x1);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	errval = mapirops_push_uint32(push, 0x2);
+	fail_if(errval != MAPIROPS_ERR_BUFFER_TOO_SMALL);
+	fail_if(push->offset != 28);
+
+	errval = mapirops_push_rollback(push, savepoint);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != 20);
+
+	errval = mapirops_push_uint8(push, RopBufferTooSmall);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->data.data[20] != RopBufferTooSmall);
+
+	/* Savepoint past the current offset */
+	errval = mapirops_push_rollback(push, 64);
+	fail_if(errval != MAPIROPS_ERR_INVALID_VAL);
+
+	/* Removing the limit */
+	errval = mapirops_push_set_limit(push, 0);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	errval = mapirops_push_uint64(push, 0x1);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+
+	COMMON_TEST_END();
+}
+END_TEST
+
+START_TEST (test_push_static)
+{
+	TALLOC_CTX		*mem_ctx;
+	struct mapirops_push	*push;
+	enum mapirops_err_code	errval;
+	uint8_t			buf[12];
+
+	mem_ctx = talloc_named(NULL, 0, "test_push_static");
+	fail_if(mem_ctx == NULL);
+
+	fail_if(mapirops_push_init_static(mem_ctx, NULL, sizeof (buf)) != NULL);
+	fail_if(mapirops_push_init_static(mem_ctx, buf, 0) != NULL);
+	push = mapirops_push_init_static(mem_ctx, buf, sizeof (buf));
+	fail_if(push == NULL);
+
+	/* Pushed straight into the caller buffer */
+	errval = mapirops_push_uint64(push, 0x0102030405060708ULL);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->data.data != buf || IVAL(buf, 0) != 0x05060708);
+
+	/* Capacity reached, nothing is reallocated */
+	errval = mapirops_push_uint64(push, 0x1);
+	fail_if(errval != MAPIROPS_ERR_BUFFER_TOO_SMALL);
+	fail_if(push->offset != 8 || push->data.data != buf);
+	errval = mapirops_push_uint32(push, 0xdeadbeef);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != sizeof (buf) || IVAL(buf, 8) != 0xdeadbeef);
+	errval = mapirops_push_uint8(push, 0x1);
+	fail_if(errval != MAPIROPS_ERR_BUFFER_TOO_SMALL);
+
+	/* A lower limit still applies */
+	errval = mapirops_push_reset(push);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != 0);
+	errval = mapirops_push_set_limit(push, 2);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	errval = mapirops_push_uint32(push, 0x1);
+	fail_if(errval != MAPIROPS_ERR_BUFFER_TOO_SMALL);
+	errval = mapirops_push_reset(push);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	errval = mapirops_push_uint32(push, 0x1);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+
+	/* The caller buffer is not freed with the context */
+	talloc_free(mem_ctx);
+	buf[0] = 0;
+}
+END_TEST
+
+START_TEST (test_pull_cursor)
+{
+	TALLOC_CTX				*mem_ctx;
+	struct mapirops_push			*push;
+	struct mapirops_pull			*pull;
+	struct mapirops_pull			cursor;
+	struct RopLogon_response		response;
+	struct RopGetReceiveFolder_request	request;
+	enum mapirops_err_code			errval;
+	const uint8_t				data[] = { 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07 };
+	uint16_t				u16;
+	uint32_t				u32;
+	char					*str;
+
+	COMMON_TEST_START(test_pull_cursor);
+
+	/* Fixed-size primitives */
+	fail_if(mapirops_pull_cursor_init(&cursor, NULL, 1) != MAPIROPS_ERR_INVALID_VAL);
+	errval = mapirops_pull_cursor_init(&cursor, data, sizeof (data));
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_pull_uint16(&cursor, &u16) != MAPIROPS_ERR_SUCCESS || u16 != 0x0201);
+	fail_if(mapirops_pull_uint32(&cursor, &u32) != MAPIROPS_ERR_SUCCESS || u32 != 0x06050403);
+	fail_if(mapirops_pull_uint16(&cursor, &u16) != MAPIROPS_ERR_BUFSIZE);
+	fail_if(cursor.offset != 6);
+
+	/* Generated structure without strings */
+	response.RopId = RopLogon;
+	response.OutputHandleIndex = 0x3;
+	response.ReturnValue = ecLoginFailure;
+	errval = mapirops_push_struct_RopLogon_response(push, &response);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	mapirops_pull_cursor_init(&cursor, push->data.data, push->offset);
+	memset(&response, 0, sizeof (response));
+	errval = mapirops_pull_struct_RopLogon_response(&cursor, &response);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(response.OutputHandleIndex != 0x3 || response.ReturnValue != ecLoginFailure);
+	fail_if(cursor.offset != push->offset);
+
+	/* Strings need a memory context */
+	push->offset = 0;
+	request.LogonId = 0x1;
+	request.InputHandleIndex = 0x2;
+	request.MessageClass = "IPM.Note";
+	errval = mapirops_push_struct_RopGetReceiveFolder_request(push, &request);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	errval = mapirops_push_utf16_string(push, 0, "IPM.Note");
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+
+	mapirops_pull_cursor_init(&cursor, push->data.data, push->offset);
+	errval = mapirops_pull_struct_RopGetReceiveFolder_request(&cursor, &request);
+	fail_if(errval != MAPIROPS_ERR_ALLOC);
+	cursor.offset = push->offset - 18;
+	errval = mapirops_pull_utf16_string(&cursor, NULL, MAPIROPS_STR_NOSIZE, &str, 0);
+	fail_if(errval != MAPIROPS_ERR_ALLOC);
+
+	/* The memory context of the cursor doesn't allow NULL ones */
+	cursor.mem_ctx = mem_ctx;
+	errval = mapirops_pull_utf16_string(&cursor, NULL, MAPIROPS_STR_NOSIZE, &str, 0);
+	fail_if(errval != MAPIROPS_ERR_ALLOC);
+	fail_if(cursor.utf16to8 != (iconv_t)-1);
+	fail_if(cursor.offset != push->offset - 18);
+
+	cursor.offset = 0;
+	errval = mapirops_pull_struct_RopGetReceiveFolder_request(&cursor, &request);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(strcmp(request.MessageClass, "IPM.Note"));
+	errval = mapirops_pull_utf16_string(&cursor, mem_ctx, MAPIROPS_STR_NOSIZE, &str, 0);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(strcmp(str, "IPM.Note"));
+	fail_if(cursor.offset != push->offset);
+
+	/* Still a cursor once the descriptor is open */
+	fail_if(cursor.utf16to8 == (iconv_t)-1);
+	cursor.offset = push->offset - 18;
+	errval = mapirops_pull_utf16_string(&cursor, NULL, MAPIROPS_STR_NOSIZE, &str, 0);
+	fail_if(errval != MAPIROPS_ERR_ALLOC);
+	errval = mapirops_pull_utf16_string(&cursor, NULL, MAPIROPS_STR_NOSIZE, &str, 0);
+	fail_if(errval != MAPIROPS_ERR_ALLOC);
+	fail_if(cursor.offset != push->offset - 18);
+
+	COMMON_TEST_END();
+}
+END_TEST
+
+START_TEST (test_pull_sticky)
+{
+	TALLOC_CTX					*mem_ctx;
+	struct mapirops_push				*push;
+	struct mapirops_pull				*pull;
+	struct mapirops_pull				cursor;
+	struct RopGetNamesFromPropertyIds_request	request;
+	enum mapirops_err_code				errval;
+	const uint8_t					data[] = { 0x01, 0x02, 0x03, 0x04, 0x05 };
+	uint16_t					ids[3] = { 0x8501, 0x8502, 0x8503 };
+	uint16_t					u16;
+	uint32_t					u32;
+	uint64_t					u64;
+	uint32_t					length;
+
+	COMMON_TEST_START(test_pull_sticky);
+
+	/* Primitives read zeroes past the first error */
+	mapirops_pull_cursor_init(&cursor, data, sizeof (data));
+	mapirops_pull_sticky_uint16(&cursor, &u16);
+	fail_if(u16 != 0x0201 || cursor.error != MAPIROPS_ERR_SUCCESS);
+	mapirops_pull_sticky_uint64(&cursor, &u64);
+	fail_if(u64 != 0 || cursor.error != MAPIROPS_ERR_BUFSIZE);
+	fail_if(cursor.offset != sizeof (data));
+	mapirops_pull_sticky_uint16(&cursor, &u16);
+	fail_if(u16 != 0);
+	mapirops_pull_sticky_fail(&cursor, MAPIROPS_ERR_INVALID_VAL);
+	fail_if(mapirops_pull_sticky_end(&cursor, MAPIROPS_ERR_SUCCESS) != MAPIROPS_ERR_BUFSIZE);
+	fail_if(cursor.error != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_pull_sticky_end(&cursor, MAPIROPS_ERR_ALLOC) != MAPIROPS_ERR_ALLOC);
+
+	cursor.offset = 1;
+	mapirops_pull_sticky_uint32(&cursor, &u32);
+	fail_if(u32 != 0x05040302 || cursor.offset != sizeof (data));
+	fail_if(mapirops_pull_sticky_end(&cursor, MAPIROPS_ERR_SUCCESS) != MAPIROPS_ERR_SUCCESS);
+
+	/* Generated structures decode the same in both modes */
+	memset(&request, 0, sizeof (request));
+	request.RopId = RopGetNamesFromPropertyIds;
+	request.InputHandleIndex = 0x1;
+	request.PropertyIdCount = 3;
+	request.PropertyIds = ids;
+	errval = mapirops_push_struct_RopGetNamesFromPropertyIds_request(push, &request);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	memset(&request, 0, sizeof (request));
+	errval = mapirops_pull_struct_RopGetNamesFromPropertyIds_request(pull, &request);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(request.InputHandleIndex != 0x1 || request.PropertyIdCount != 3);
+	fail_if(request.PropertyIds[2] != 0x8503);
+	fail_if(pull->offset != push->offset || pull->error != MAPIROPS_ERR_SUCCESS);
+
+	/* Truncated buffers fail without leaving an error behind */
+	for (length = 0; length < push->offset; length++) {
+		pull->data.length = length;
+		pull->offset = 0;
+		errval = mapirops_pull_struct_RopGetNamesFromPropertyIds_request(pull, &request);
+		fail_if(errval != MAPIROPS_ERR_BUFSIZE);
+		fail_if(pull->error != MAPIROPS_ERR_SUCCESS);
+	}
+
+	COMMON_TEST_END();
+}
+END_TEST
+
+START_TEST (test_hexdump)
+{
+	const uint8_t			data[] = "RopLogon\x00\x01\xfe\x7f" "ABCDEFGH";
+	struct mapirops_hexdump_note	notes[3];
+	char				out[512];
+	size_t				size;
+	size_t				written;
+	int				fd[2];
+
+	/* Same output as the previous printf based hexdump */
+	fail_if(mapirops_hexdump_buf(data, 20, NULL, 0, out, sizeof (out), &written) != MAPIROPS_ERR_SUCCESS);
+	fail_if(strcmp(out,
+		       "[0000] 52 6F 70 4C 6F 67 6F 6E   00 01 FE 7F 41 42 43 44   RopLogon ....ABCD\n"
+		       "[0010] 45 46 47 48                                       EFGH \n"));
+	fail_if(written + 1 != mapirops_hexdump_size(20, NULL, 0));
+	fail_if(mapirops_hexdump_buf(data, 12, NULL, 0, out, sizeof (out), NULL) != MAPIROPS_ERR_SUCCESS);
+	fail_if(strcmp(out, "[0000] 52 6F 70 4C 6F 67 6F 6E   00 01 FE 7F              RopLogon ....\n"));
+
+	/* Annotations */
+	notes[0].offset = 1;
+	notes[0].name = "LogonId";
+	notes[1].offset = 17;
+	notes[1].name = "Flags";
+	notes[2].offset = 20;
+	notes[2].name = "Past the end";
+	size = mapirops_hexdump_size(20, notes, 3);
+	fail_if(mapirops_hexdump_buf(data, 20, notes, 3, out, size, &written) != MAPIROPS_ERR_SUCCESS);
+	fail_if(written + 1 != size);
+	fail_if(strcmp(out,
+		       "[0000] 52 6F 70 4C 6F 67 6F 6E   00 01 FE 7F 41 42 43 44   RopLogon ....ABCD\n"
+		       "          ^ LogonId\n"
+		       "[0010] 45 46 47 48                                       EFGH \n"
+		       "          ^ Flags\n"));
+
+	/* Output buffer too small: complete lines only */
+	fail_if(mapirops_hexdump_buf(data, 20, notes, 3, out, size - 1, &written) != MAPIROPS_ERR_BUFFER_TOO_SMALL);
+	fail_if(written != size - 1 - strlen("          ^ Flags\n"));
+	fail_if(mapirops_hexdump_buf(data, 20, notes, 3, out, 0, NULL) != MAPIROPS_ERR_INVALID_VAL);
+
+	/* File descriptor */
+	fail_if(pipe(fd) != 0);
+	fail_if(mapirops_hexdump_fd(fd[1], data, 20, notes, 3) != MAPIROPS_ERR_SUCCESS);
+	close(fd[1]);
+	fail_if(read(fd[0], out, sizeof (out)) != (ssize_t)(size - 1));
+	close(fd[0]);
+	fail_if(strncmp(out, "[0000] 52 6F", 12));
+}
+END_TEST
+
 static Suite *primitives_suite(void)
 {
 	Suite	*s;
@@ -420,11 +861,19 @@ static Suite *primitives_suite(void)
 	tcase_add_test(tc, test_double);
 	tcase_add_test(tc, test_ascii);
 	tcase_add_test(tc, test_ascii_noterm);
+	tcase_add_test(tc, test_ascii_nosize);
 	tcase_add_test(tc, test_utf16);
 	tcase_add_test(tc, test_utf16_noterm);
+	tcase_add_test(tc, test_utf16_nosize);
 	tcase_add_test(tc, test_bytes);
 	tcase_add_test(tc, test_GUID);
+	tcase_add_test(tc, test_GUID_string);
 	tcase_add_test(tc, test_MAPISTATUS);
+	tcase_add_test(tc, test_savepoint);
+	tcase_add_test(tc, test_push_static);
+	tcase_add_test(tc, test_pull_cursor);
+	tcase_add_test(tc, test_pull_sticky);
+	tcase_add_test(tc, test_hexdump);
 
 	return s;
 }
@@ -442,6 +891,20 @@ int main(int argc, const char *argv[])
 	int		nf;
 	Suite		*s;
 	Suite		*oxcstor;
+	Suite		*cache;
+	Suite		*lzxpress;
+	Suite		*rpcext;
+	Suite		*property;
+	Suite		*restriction;
+	Suite		*fxparser;
+	Suite		*fxproducer;
+	Suite		*handles;
+	Suite		*dispatch;
+	Suite		*namedprops;
+	Suite		*codepage;
+	Suite		*capture;
+	Suite		*timing;
+	Suite		*stats;
 	SRunner		*sr;
 
 	enum { OPT_REFS=1000 };
@@ -472,6 +935,48 @@ int main(int argc, const char *argv[])
 	oxcstor = oxcstor_suite();
 	srunner_add_suite(sr, oxcstor);
 
+	cache = cache_suite();
+	srunner_add_suite(sr, cache);
+
+	lzxpress = lzxpress_suite();
+	srunner_add_suite(sr, lzxpress);
+
+	rpcext = rpcext_suite();
+	srunner_add_suite(sr, rpcext);
+
+	property = property_suite();
+	srunner_add_suite(sr, property);
+
+	restriction = restriction_suite();
+	srunner_add_suite(sr, restriction);
+
+	fxparser = fxparser_suite();
+	srunner_add_suite(sr, fxparser);
+
+	fxproducer = fxproducer_suite();
+	srunner_add_suite(sr, fxproducer);
+
+	handles = handles_suite();
+	srunner_add_suite(sr, handles);
+
+	dispatch = dispatch_suite();
+	srunner_add_suite(sr, dispatch);
+
+	namedprops = namedprops_suite();
+	srunner_add_suite(sr, namedprops);
+
+	codepage = codepage_suite();
+	srunner_add_suite(sr, codepage);
+
+	capture = capture_suite();
+	srunner_add_suite(sr, capture);
+
+	timing = timing_suite();
+	srunner_add_suite(sr, timing);
+
+	stats = stats_suite();
+	srunner_add_suite(sr, stats);
+
 	srunner_run_all(sr, CK_NORMAL);
 	nf = srunner_ntests_failed(sr);
 	srunner_free(sr);
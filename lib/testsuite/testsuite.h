@@ -24,6 +24,7 @@
 
 #include <popt.h>
 #include <check.h>
+#include <pthread.h>
 
 /** \cond */
 
@@ -55,6 +56,13 @@
 #define	COMMON_TEST_END()				\
 	talloc_free(mem_ctx);
 
+#define	TESTSUITE_THREADS_MAX	8
+
+struct testsuite_threads {
+	pthread_t	ids[TESTSUITE_THREADS_MAX];
+	uint32_t	count;
+};
+
 #ifndef	__BEGIN_DECLS
 #ifdef	__cplusplus
 #define	__BEGIN_DECLS	extern "C" {
@@ -69,6 +77,24 @@
 __BEGIN_DECLS
 Suite *oxcstor_suite(void);
 void oxcstor_suite_references(void);
+Suite *cache_suite(void);
+Suite *lzxpress_suite(void);
+Suite *rpcext_suite(void);
+Suite *property_suite(void);
+Suite *restriction_suite(void);
+Suite *fxparser_suite(void);
+Suite *fxproducer_suite(void);
+Suite *handles_suite(void);
+Suite *dispatch_suite(void);
+Suite *namedprops_suite(void);
+Suite *codepage_suite(void);
+Suite *capture_suite(void);
+Suite *timing_suite(void);
+Suite *stats_suite(void);
+
+void testsuite_tmpfile(char *, size_t, const char *);
+void testsuite_threads_start(struct testsuite_threads *, uint32_t, void *(*)(void *), void *, size_t);
+void testsuite_threads_join(struct testsuite_threads *);
 __END_DECLS
 
 #endif /*! __TESTSUITE_H__ */
@@ -0,0 +1,273 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testsuite.h"
+
+static void cache_fill_publicfolders(struct RopLogon_response *response,
+				     uint8_t OutputHandleIndex)
+{
+	struct RopLogon_publicfolders	*pf;
+	int				i;
+
+	memset(response, 0, sizeof (struct RopLogon_response));
+	response->RopId = RopLogon;
+	response->OutputHandleIndex = OutputHandleIndex;
+	response->ReturnValue = MAPI_E_SUCCESS;
+	response->ResponseType.success.LogonFlags = 0;
+
+	pf = &response->ResponseType.success.LogonType.publicfolders;
+	pf->Root = 0x0100000000000001ULL;
+	pf->IPMSubtree = 0x0200000000000001ULL;
+	pf->NonIPMSubtree = 0x0300000000000001ULL;
+	pf->EFormsRegistry = 0x0400000000000001ULL;
+	pf->FreeBusy = 0x0500000000000001ULL;
+	pf->OAB = 0x0600000000000001ULL;
+	pf->LocaleEFormsRegistry = 0x0700000000000001ULL;
+	pf->LocalFreeBusy = 0x0800000000000001ULL;
+	pf->LocalOAB = 0x0900000000000001ULL;
+	pf->NNTPArticleIndex = 0x0A00000000000001ULL;
+	for (i = 0; i < 3; i++) {
+		pf->_Empty[i] = 0;
+	}
+	pf->ReplId = 0x1;
+	mapirops_GUID_from_string("c4f1ae21-0a3b-4a1e-9c2d-40c4b1f1a7e5", &pf->ReplGuid);
+	mapirops_GUID_from_string("{2f5d0a3c-8b1e-4e6a-a2c4-7d1c0e6f9b21}", &pf->PerUserGuid);
+}
+
+START_TEST (test_cache_hit)
+{
+	TALLOC_CTX			*mem_ctx;
+	enum mapirops_err_code		errval;
+	struct mapirops_push		*push;
+	struct mapirops_push		*ref;
+	struct mapirops_cache		*cache;
+	struct mapirops_cache_stats	stats;
+	struct RopLogon_response	response;
+	struct mapirops_cache_patch	patch;
+	struct mapibuf			key;
+	struct mapibuf			data;
+	uint64_t			handle;
+
+	mem_ctx = talloc_named(NULL, 0, "test_cache_hit");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	ref = mapirops_push_init(mem_ctx);
+	fail_if(ref == NULL);
+	cache = mapirops_cache_init(mem_ctx, 4096);
+	fail_if(cache == NULL);
+
+	key.data = (uint8_t *) "publicfolders";
+	key.length = strlen("publicfolders");
+
+	/* Miss, then encode and store */
+	handle = 0x1;
+	errval = mapirops_cache_push(cache, push, &key, &handle, 1);
+	fail_if(errval != MAPIROPS_ERR_NOT_FOUND);
+	fail_if(push->offset != 0);
+
+	cache_fill_publicfolders(&response, 0x1);
+	errval = mapirops_push_struct_RopLogon_response(push, &response);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+
+	data.data = push->data.data;
+	data.length = push->offset;
+	patch.offset = 1;
+	patch.size = 1;
+	errval = mapirops_cache_store(cache, &key, &data, &patch, 1);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+
+	/* Hit with a different OutputHandleIndex */
+	handle = 0x7;
+	errval = mapirops_cache_push(cache, push, &key, &handle, 1);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != 2 * data.length);
+
+	cache_fill_publicfolders(&response, 0x7);
+	errval = mapirops_push_struct_RopLogon_response(ref, &response);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(ref->offset != data.length);
+	fail_if(memcmp(push->data.data + data.length, ref->data.data, ref->offset));
+
+	/* Wrong number of values */
+	errval = mapirops_cache_push(cache, push, &key, NULL, 0);
+	fail_if(errval != MAPIROPS_ERR_INVALID_VAL);
+
+	errval = mapirops_cache_get_stats(cache, &stats);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(stats.hits != 1);
+	fail_if(stats.misses != 1);
+	fail_if(stats.count != 1);
+
+	errval = mapirops_cache_remove(cache, &key);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	errval = mapirops_cache_push(cache, push, &key, &handle, 1);
+	fail_if(errval != MAPIROPS_ERR_NOT_FOUND);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_cache_invalid_patch)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_cache		*cache;
+	struct mapirops_cache_patch	patch;
+	struct mapibuf			key;
+	struct mapibuf			data;
+	uint8_t				bytes[4] = { 0xFE, 0x00, 0x00, 0x00 };
+
+	mem_ctx = talloc_named(NULL, 0, "test_cache_invalid_patch");
+	fail_if(mem_ctx == NULL);
+	cache = mapirops_cache_init(mem_ctx, 4096);
+	fail_if(cache == NULL);
+
+	key.data = bytes;
+	key.length = 1;
+	data.data = bytes;
+	data.length = sizeof (bytes);
+
+	/* Patch past the end of data */
+	patch.offset = 2;
+	patch.size = 4;
+	fail_if(mapirops_cache_store(cache, &key, &data, &patch, 1) != MAPIROPS_ERR_INVALID_VAL);
+
+	/* Unsupported patch size */
+	patch.offset = 0;
+	patch.size = 3;
+	fail_if(mapirops_cache_store(cache, &key, &data, &patch, 1) != MAPIROPS_ERR_INVALID_VAL);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_cache_lru)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_push		*push;
+	struct mapirops_cache		*cache;
+	struct mapirops_cache_stats	stats;
+	struct mapibuf			key;
+	struct mapibuf			data;
+	uint8_t				bytes[256];
+	uint8_t				k;
+
+	mem_ctx = talloc_named(NULL, 0, "test_cache_lru");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+
+	memset(bytes, 0xAB, sizeof (bytes));
+	data.data = bytes;
+	data.length = sizeof (bytes);
+	key.data = &k;
+	key.length = 1;
+
+	/* Room for three entries but not four */
+	cache = mapirops_cache_init(mem_ctx, 3 * (sizeof (bytes) + 128));
+	fail_if(cache == NULL);
+
+	for (k = 0; k < 3; k++) {
+		fail_if(mapirops_cache_store(cache, &key, &data, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+	}
+
+	/* Touch entry 0 so entry 1 becomes the least recently used */
+	k = 0;
+	fail_if(mapirops_cache_push(cache, push, &key, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+
+	k = 3;
+	fail_if(mapirops_cache_store(cache, &key, &data, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+
+	k = 1;
+	fail_if(mapirops_cache_push(cache, push, &key, NULL, 0) != MAPIROPS_ERR_NOT_FOUND);
+	k = 0;
+	fail_if(mapirops_cache_push(cache, push, &key, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+	k = 2;
+	fail_if(mapirops_cache_push(cache, push, &key, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+	k = 3;
+	fail_if(mapirops_cache_push(cache, push, &key, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+
+	fail_if(mapirops_cache_get_stats(cache, &stats) != MAPIROPS_ERR_SUCCESS);
+	fail_if(stats.evictions != 1);
+	fail_if(stats.count != 3);
+	fail_if(stats.size > 3 * (sizeof (bytes) + 128));
+
+	/* An entry larger than the whole cache is rejected */
+	data.length = sizeof (bytes);
+	cache = mapirops_cache_init(mem_ctx, sizeof (bytes));
+	fail_if(mapirops_cache_store(cache, &key, &data, NULL, 0) != MAPIROPS_ERR_BUFSIZE);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_cache_many)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_push		*push;
+	struct mapirops_cache		*cache;
+	struct mapirops_cache_stats	stats;
+	struct mapibuf			key;
+	struct mapibuf			data;
+	uint32_t			i;
+
+	mem_ctx = talloc_named(NULL, 0, "test_cache_many");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	cache = mapirops_cache_init(mem_ctx, 1024 * 1024);
+	fail_if(cache == NULL);
+
+	/* Force the hash table to grow several times */
+	key.data = (uint8_t *)&i;
+	key.length = sizeof (i);
+	data.data = (uint8_t *)&i;
+	data.length = sizeof (i);
+	for (i = 0; i < 1000; i++) {
+		fail_if(mapirops_cache_store(cache, &key, &data, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+	}
+	for (i = 0; i < 1000; i++) {
+		push->offset = 0;
+		fail_if(mapirops_cache_push(cache, push, &key, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+		fail_if(IVAL(push->data.data, 0) != i);
+	}
+
+	fail_if(mapirops_cache_get_stats(cache, &stats) != MAPIROPS_ERR_SUCCESS);
+	fail_if(stats.count != 1000);
+	fail_if(stats.evictions != 0);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+Suite *cache_suite(void)
+{
+	Suite	*s;
+	TCase	*tc;
+
+	s = suite_create("MAPIROPS response cache");
+	tc = tcase_create("[OC-CACHE]");
+	suite_add_tcase(s, tc);
+	tcase_add_test(tc, test_cache_hit);
+	tcase_add_test(tc, test_cache_invalid_patch);
+	tcase_add_test(tc, test_cache_lru);
+	tcase_add_test(tc, test_cache_many);
+
+	return s;
+}
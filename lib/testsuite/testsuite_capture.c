@@ -0,0 +1,190 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testsuite.h"
+
+#include <unistd.h>
+
+#define	CAPTURE_THREADS		4
+#define	CAPTURE_RECORDS		1000
+
+START_TEST (test_capture_ropbuf)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_push		*push;
+	struct mapirops_pull		*pull;
+	struct mapirops_capture		*capture;
+	struct mapirops_capture_reader	*reader;
+	struct mapirops_capture_record	record;
+	struct mapirops_ropbuf_frame	frame;
+	struct mapirops_ropbuf		ropbuf;
+	uint32_t			table[1] = { 0x12345678 };
+	uint8_t				large[200];
+	char				path[32];
+
+	COMMON_TEST_START(capture_ropbuf);
+	testsuite_tmpfile(path, sizeof (path), "capture");
+	memset(large, 0xAB, sizeof (large));
+
+	/* Buffer smaller than the large record */
+	capture = mapirops_capture_init(mem_ctx, path, 64);
+	fail_if(capture == NULL);
+	fail_if(mapirops_push_set_capture(push, capture, 7) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_pull_set_capture(pull, capture, 7) != MAPIROPS_ERR_SUCCESS);
+
+	fail_if(mapirops_ropbuf_push_begin(push, &frame) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint8(push, 0x01) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint8(push, 0x00) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint8(push, 0x00) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_ropbuf_push_end(push, &frame, table, 1) != MAPIROPS_ERR_SUCCESS);
+
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	fail_if(mapirops_ropbuf_pull(pull, &ropbuf) != MAPIROPS_ERR_SUCCESS);
+
+	fail_if(mapirops_capture_record(capture, MAPIROPS_CAPTURE_PULL, 8, large, sizeof (large)) != MAPIROPS_ERR_SUCCESS);
+	talloc_free(capture);
+
+	/* Records are appended to an existing capture */
+	capture = mapirops_capture_init(mem_ctx, path, 0);
+	fail_if(capture == NULL);
+	fail_if(mapirops_capture_record(capture, MAPIROPS_CAPTURE_PUSH, 9, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_capture_flush(capture) != MAPIROPS_ERR_SUCCESS);
+	talloc_free(capture);
+
+	reader = mapirops_capture_reader_init(mem_ctx, path);
+	fail_if(reader == NULL);
+
+	fail_if(mapirops_capture_reader_next(reader, &record) != MAPIROPS_ERR_SUCCESS);
+	fail_if(record.direction != MAPIROPS_CAPTURE_PUSH || record.session != 7);
+	fail_if(record.length != push->offset || memcmp(record.data, push->data.data, push->offset));
+	fail_if(record.timestamp == 0);
+
+	fail_if(mapirops_capture_reader_next(reader, &record) != MAPIROPS_ERR_SUCCESS);
+	fail_if(record.direction != MAPIROPS_CAPTURE_PULL || record.session != 7);
+	fail_if(record.length != push->offset || memcmp(record.data, push->data.data, push->offset));
+
+	fail_if(mapirops_capture_reader_next(reader, &record) != MAPIROPS_ERR_SUCCESS);
+	fail_if(record.session != 8);
+	fail_if(record.length != sizeof (large) || memcmp(record.data, large, sizeof (large)));
+
+	fail_if(mapirops_capture_reader_next(reader, &record) != MAPIROPS_ERR_SUCCESS);
+	fail_if(record.direction != MAPIROPS_CAPTURE_PUSH || record.session != 9 || record.length != 0);
+
+	fail_if(mapirops_capture_reader_next(reader, &record) != MAPIROPS_ERR_NOT_FOUND);
+	talloc_free(reader);
+
+	/* Truncated record */
+	fail_if(truncate(path, MAPIROPS_CAPTURE_HEADER_SIZE + MAPIROPS_CAPTURE_RECORD_SIZE + 1) != 0);
+	reader = mapirops_capture_reader_init(mem_ctx, path);
+	fail_if(reader == NULL);
+	fail_if(mapirops_capture_reader_next(reader, &record) != MAPIROPS_ERR_BUFSIZE);
+	talloc_free(reader);
+
+	/* Not a capture file */
+	fail_if(truncate(path, 4) != 0);
+	fail_if(mapirops_capture_reader_init(mem_ctx, path) != NULL);
+	fail_if(mapirops_capture_init(mem_ctx, path, 0) != NULL);
+
+	unlink(path);
+	COMMON_TEST_END();
+}
+END_TEST
+
+struct capture_thread {
+	struct mapirops_capture	*capture;
+	uint32_t		session;
+};
+
+/* Record CAPTURE_RECORDS sequence numbers */
+static void *capture_thread(void *data)
+{
+	struct capture_thread	*thread = (struct capture_thread *) data;
+	uint8_t			seq[4];
+	uint32_t		i;
+
+	for (i = 0; i < CAPTURE_RECORDS; i++) {
+		SIVAL(seq, 0, i);
+		if (mapirops_capture_record(thread->capture, MAPIROPS_CAPTURE_PULL,
+					    thread->session, seq, sizeof (seq))) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+START_TEST (test_capture_threads)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_capture_reader	*reader;
+	struct mapirops_capture_record	record;
+	struct capture_thread		t[CAPTURE_THREADS];
+	struct testsuite_threads	threads;
+	uint32_t			next[CAPTURE_THREADS];
+	struct mapirops_capture		*capture;
+	char				path[32];
+	uint32_t			i;
+
+	mem_ctx = talloc_named(NULL, 0, "test_capture_threads");
+	fail_if(mem_ctx == NULL);
+	testsuite_tmpfile(path, sizeof (path), "capture");
+
+	/* Small buffers to flush often */
+	capture = mapirops_capture_init(mem_ctx, path, 256);
+	fail_if(capture == NULL);
+	for (i = 0; i < CAPTURE_THREADS; i++) {
+		t[i].capture = capture;
+		t[i].session = i;
+		next[i] = 0;
+	}
+	testsuite_threads_start(&threads, CAPTURE_THREADS, capture_thread, t, sizeof (t[0]));
+	testsuite_threads_join(&threads);
+	talloc_free(capture);
+
+	/* Records of a thread are in order and never split */
+	reader = mapirops_capture_reader_init(mem_ctx, path);
+	fail_if(reader == NULL);
+	while (mapirops_capture_reader_next(reader, &record) == MAPIROPS_ERR_SUCCESS) {
+		fail_if(record.session >= CAPTURE_THREADS || record.length != 4);
+		fail_if(IVAL(record.data, 0) != next[record.session]);
+		next[record.session]++;
+	}
+	for (i = 0; i < CAPTURE_THREADS; i++) {
+		fail_if(next[i] != CAPTURE_RECORDS);
+	}
+
+	unlink(path);
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+Suite *capture_suite(void)
+{
+	Suite	*s;
+	TCase	*tc;
+
+	s = suite_create("MAPIROPS ROP capture");
+	tc = tcase_create("[OC-CAPTURE]");
+	suite_add_tcase(s, tc);
+	tcase_add_test(tc, test_capture_ropbuf);
+	tcase_add_test(tc, test_capture_threads);
+
+	return s;
+}
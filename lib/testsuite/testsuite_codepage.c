@@ -0,0 +1,211 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testsuite.h"
+
+/* "Café €" and "日本ｱ" in UTF-8 */
+#define	TEST_CP1252_UTF8	"Caf\xc3\xa9 \xe2\x82\xac"
+#define	TEST_CP1252_STRING8	"Caf\xe9 \x80"
+#define	TEST_CP932_UTF8		"\xe6\x97\xa5\xe6\x9c\xac\xef\xbd\xb1"
+#define	TEST_CP932_STRING8	"\x93\xfa\x96\x7b\xb1"
+
+START_TEST (test_codepage_registry)
+{
+	TALLOC_CTX		*mem_ctx;
+	struct mapirops_push	*push;
+	struct mapirops_pull	*pull;
+
+	COMMON_TEST_START(codepage_registry);
+
+	fail_if(mapirops_codepage_get(1252) == NULL);
+	fail_if(mapirops_codepage_get(1252) != mapirops_codepage_get(1252));
+	fail_if(mapirops_codepage_get(932) == NULL);
+	fail_if(mapirops_codepage_get(MAPIROPS_CODEPAGE_UTF8) == NULL);
+	fail_if(mapirops_codepage_get(12345) != NULL);
+
+	fail_if(mapirops_push_set_codepage(push, 1252) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->codepage != mapirops_codepage_get(1252));
+	fail_if(mapirops_push_set_codepage(push, 12345) != MAPIROPS_ERR_ICONV);
+	fail_if(push->codepage != mapirops_codepage_get(1252));
+	fail_if(mapirops_push_set_codepage(push, 0) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->codepage != NULL);
+	fail_if(mapirops_pull_set_codepage(pull, 932) != MAPIROPS_ERR_SUCCESS);
+	fail_if(pull->codepage != mapirops_codepage_get(932));
+
+	COMMON_TEST_END();
+}
+END_TEST
+
+START_TEST (test_codepage_string8)
+{
+	TALLOC_CTX		*mem_ctx;
+	struct mapirops_push	*push;
+	struct mapirops_pull	*pull;
+	char			*out;
+
+	COMMON_TEST_START(codepage_string8);
+
+	/* Default is ASCII */
+	fail_if(mapirops_push_ascii_string(push, 0, TEST_CP1252_UTF8) != MAPIROPS_ERR_ICONV);
+	fail_if(push->offset != 0);
+
+	/* Single-byte codepage */
+	fail_if(mapirops_push_set_codepage(push, 1252) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_ascii_string(push, 0, TEST_CP1252_UTF8) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != sizeof (TEST_CP1252_STRING8));
+	fail_if(memcmp(push->data.data, TEST_CP1252_STRING8, sizeof (TEST_CP1252_STRING8)));
+	fail_if(mapirops_push_ascii_string(push, 0, TEST_CP932_UTF8) != MAPIROPS_ERR_ICONV);
+	fail_if(push->offset != sizeof (TEST_CP1252_STRING8));
+
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	fail_if(mapirops_pull_set_codepage(pull, 1252) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_pull_ascii_string(pull, mem_ctx, MAPIROPS_STR_NOSIZE, &out, 0) != MAPIROPS_ERR_SUCCESS);
+	fail_if(strcmp(out, TEST_CP1252_UTF8));
+	fail_if(pull->offset != push->offset);
+
+	/* 0x81 is not part of cp1252 */
+	push->data.data[0] = 0x81;
+	pull->offset = 0;
+	fail_if(mapirops_pull_ascii_string(pull, mem_ctx, MAPIROPS_STR_NOSIZE, &out, 0) != MAPIROPS_ERR_ICONV);
+
+	/* Multi-byte codepage */
+	push->offset = 0;
+	fail_if(mapirops_push_set_codepage(push, 932) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_ascii_string(push, 0, TEST_CP932_UTF8) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != sizeof (TEST_CP932_STRING8));
+	fail_if(memcmp(push->data.data, TEST_CP932_STRING8, sizeof (TEST_CP932_STRING8)));
+
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	pull->offset = 0;
+	fail_if(mapirops_pull_set_codepage(pull, 932) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_pull_ascii_string(pull, mem_ctx, 0, &out, sizeof (TEST_CP932_STRING8) - 1) != MAPIROPS_ERR_SUCCESS);
+	fail_if(strcmp(out, TEST_CP932_UTF8));
+
+	/* UTF-8 */
+	push->offset = 0;
+	fail_if(mapirops_push_set_codepage(push, MAPIROPS_CODEPAGE_UTF8) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_ascii_string(push, MAPIROPS_STR_NOTERM, TEST_CP932_UTF8) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != strlen(TEST_CP932_UTF8));
+
+	COMMON_TEST_END();
+}
+END_TEST
+
+START_TEST (test_codepage_utf8_invalid)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_push		*push;
+	struct mapirops_pull		*pull;
+	const struct mapirops_codepage	*cp;
+	uint8_t				string8[MAPIROPS_CODEPAGE_STRING8_SIZE(8)];
+	size_t				len;
+	uint32_t			i;
+	const char			*invalid[] = {
+		"A\xc0\x80" "B",		/* Overlong U+0000 */
+		"\xc1\xbf",			/* Overlong U+007F */
+		"\xe0\x80\x80",		/* Overlong U+0000 */
+		"\xe0\x9f\xbf",		/* Overlong U+07FF */
+		"\xed\xa0\x80",		/* U+D800 */
+		"\xed\xbf\xbf",		/* U+DFFF */
+		"\xf0\x80\x80\x80",	/* Overlong U+0000 */
+		"\xf0\x8f\xbf\xbf",	/* Overlong U+FFFF */
+		"\xf4\x90\x80\x80",	/* U+110000 */
+		"\xf5\x80\x80\x80",	/* Past U+10FFFF */
+		"\x80",			/* Continuation byte */
+		"\xc3",			/* Truncated sequence */
+		NULL
+	};
+
+	COMMON_TEST_START(codepage_utf8_invalid);
+
+	cp = mapirops_codepage_get(1252);
+	fail_if(cp == NULL);
+	for (i = 0; invalid[i]; i++) {
+		fail_if(mapirops_codepage_from_utf8(cp, invalid[i], strlen(invalid[i]),
+						    string8, &len) != MAPIROPS_ERR_INVALID_VAL);
+	}
+
+	/* Well-formed characters which are not part of cp1252 */
+	fail_if(mapirops_codepage_from_utf8(cp, "\xe0\xa0\x80", 3, string8, &len) != MAPIROPS_ERR_ICONV);
+	fail_if(mapirops_codepage_from_utf8(cp, "\xf0\x9f\x98\x80", 4, string8, &len) != MAPIROPS_ERR_ICONV);
+	fail_if(mapirops_codepage_from_utf8(cp, "\xf4\x8f\xbf\xbf", 4, string8, &len) != MAPIROPS_ERR_ICONV);
+
+	/* No NUL byte reaches the string8 */
+	fail_if(mapirops_push_set_codepage(push, 1252) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_ascii_string(push, 0, "A\xc0\x80" "B") != MAPIROPS_ERR_INVALID_VAL);
+	fail_if(push->offset != 0);
+
+	COMMON_TEST_END();
+}
+END_TEST
+
+/* Convert back and forth with the shared cp932 converters */
+static void *codepage_thread(void *data)
+{
+	const struct mapirops_codepage	*cp = mapirops_codepage_get(932);
+	uint8_t				string8[MAPIROPS_CODEPAGE_STRING8_SIZE(sizeof (TEST_CP932_UTF8))];
+	char				utf8[MAPIROPS_CODEPAGE_UTF8_SIZE(sizeof (TEST_CP932_STRING8))];
+	size_t				len;
+	uint32_t			i;
+
+	for (i = 0; i < 2000; i++) {
+		if (mapirops_codepage_from_utf8(cp, TEST_CP932_UTF8, strlen(TEST_CP932_UTF8), string8, &len) ||
+		    len != strlen(TEST_CP932_STRING8) ||
+		    mapirops_codepage_to_utf8(cp, string8, len, utf8, &len) ||
+		    strcmp(utf8, TEST_CP932_UTF8)) {
+			*(int *)data = 1;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+START_TEST (test_codepage_threads)
+{
+	struct testsuite_threads	threads;
+	int				failed[4];
+	uint32_t			i;
+
+	memset(failed, 0, sizeof (failed));
+	testsuite_threads_start(&threads, 4, codepage_thread, failed, sizeof (failed[0]));
+	testsuite_threads_join(&threads);
+	for (i = 0; i < 4; i++) {
+		fail_if(failed[i]);
+	}
+}
+END_TEST
+
+Suite *codepage_suite(void)
+{
+	Suite	*s;
+	TCase	*tc;
+
+	s = suite_create("MAPIROPS Codepages");
+	tc = tcase_create("[MS-OXCDATA] 2.11.1");
+	suite_add_tcase(s, tc);
+	tcase_add_test(tc, test_codepage_registry);
+	tcase_add_test(tc, test_codepage_string8);
+	tcase_add_test(tc, test_codepage_utf8_invalid);
+	tcase_add_test(tc, test_codepage_threads);
+
+	return s;
+}
@@ -0,0 +1,214 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testsuite.h"
+
+#include <unistd.h>
+
+#define	DISPATCH_RECORDS	1031
+
+START_TEST (test_dispatch_get)
+{
+	TALLOC_CTX					*mem_ctx;
+	struct mapirops_push				*push;
+	struct mapirops_pull				*pull;
+	const struct mapirops_rop_dispatch		*rop;
+	struct RopGetNamesFromPropertyIds_request	request;
+	struct RopGetNamesFromPropertyIds_request	*request_out;
+	uint16_t					ids[2] = { 0x8501, 0x8502 };
+
+	COMMON_TEST_START(dispatch_get);
+
+	rop = mapirops_rop_dispatch_get(RopGetNamesFromPropertyIds);
+	fail_if(rop == NULL);
+	fail_if(rop->RopId != RopGetNamesFromPropertyIds);
+	fail_if(strcmp(rop->name, "RopGetNamesFromPropertyIds"));
+	fail_if(rop->request_size != sizeof (struct RopGetNamesFromPropertyIds_request));
+	fail_if(mapirops_rop_dispatch_get(RopGetPropertyIdsFromNames) == NULL);
+
+	/* RopRelease has no generated decoder */
+	fail_if(mapirops_rop_dispatch_get(0x01) != NULL);
+
+	memset(&request, 0, sizeof (request));
+	request.RopId = RopGetNamesFromPropertyIds;
+	request.InputHandleIndex = 2;
+	request.PropertyIdCount = 2;
+	request.PropertyIds = ids;
+	fail_if(mapirops_push_struct_RopGetNamesFromPropertyIds_request(push, &request) != MAPIROPS_ERR_SUCCESS);
+
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	request_out = talloc_zero_size(mem_ctx, rop->request_size);
+	fail_if(request_out == NULL);
+	fail_if(rop->pull_request(pull, request_out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(pull->offset != push->offset);
+	fail_if(request_out->InputHandleIndex != 2 || request_out->PropertyIdCount != 2);
+	fail_if(request_out->PropertyIds[1] != 0x8502);
+
+	COMMON_TEST_END();
+}
+END_TEST
+
+START_TEST (test_dispatch_analyze)
+{
+	TALLOC_CTX					*mem_ctx;
+	struct mapirops_push				*push;
+	struct mapirops_pull				*pull;
+	struct mapirops_push				*truncated;
+	struct mapirops_push				*response;
+	struct mapirops_ropbuf_frame			frame;
+	struct mapirops_capture				*capture;
+	struct mapirops_analyze				*analyze;
+	struct mapirops_analyze_stats			*total;
+	const struct mapirops_analyze_rop_stats		*rs;
+	struct RopGetNamesFromPropertyIds_request	request;
+	uint16_t					ids[2] = { 0x8501, 0x8502 };
+	const uint8_t					invalid[1] = { 0x00 };
+	const uint32_t					threads[3] = { 1, 3, 4 };
+	char						path[64];
+	uint64_t					bytes = 0;
+	uint32_t					requests = 0;
+	uint32_t					errors = 0;
+	uint32_t					responses = 0;
+	uint32_t					invalids = 0;
+	uint32_t					workers;
+	uint32_t					i;
+
+	COMMON_TEST_START(dispatch_analyze);
+
+	/* Valid request */
+	memset(&request, 0, sizeof (request));
+	request.RopId = RopGetNamesFromPropertyIds;
+	request.PropertyIdCount = 2;
+	request.PropertyIds = ids;
+	fail_if(mapirops_ropbuf_push_begin(push, &frame) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_struct_RopGetNamesFromPropertyIds_request(push, &request) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_ropbuf_push_end(push, &frame, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+
+	/* Request announcing two PropertyIds and carrying one */
+	truncated = mapirops_push_init(mem_ctx);
+	fail_if(truncated == NULL);
+	fail_if(mapirops_ropbuf_push_begin(truncated, &frame) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint8(truncated, RopGetNamesFromPropertyIds) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint8(truncated, 0x0) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint8(truncated, 0x0) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint16(truncated, 2) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint16(truncated, 0x8501) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_ropbuf_push_end(truncated, &frame, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+
+	/* Failed response: no ResponseType body */
+	response = mapirops_push_init(mem_ctx);
+	fail_if(response == NULL);
+	fail_if(mapirops_ropbuf_push_begin(response, &frame) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint8(response, RopGetNamesFromPropertyIds) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint8(response, 0x0) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint32(response, 0x8004010F) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_ropbuf_push_end(response, &frame, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+
+	testsuite_tmpfile(path, sizeof (path), "dispatch");
+
+	capture = mapirops_capture_init(mem_ctx, path, 0);
+	fail_if(capture == NULL);
+	for (i = 0; i < DISPATCH_RECORDS; i++) {
+		switch (i % 5) {
+		case 0:
+			fail_if(mapirops_capture_record(capture, MAPIROPS_CAPTURE_PUSH, i, response->data.data,
+							response->offset) != MAPIROPS_ERR_SUCCESS);
+			bytes += response->offset;
+			responses++;
+			break;
+		case 1:
+			fail_if(mapirops_capture_record(capture, MAPIROPS_CAPTURE_PULL, i, truncated->data.data,
+							truncated->offset) != MAPIROPS_ERR_SUCCESS);
+			bytes += truncated->offset;
+			requests++;
+			errors++;
+			break;
+		case 2:
+			fail_if(mapirops_capture_record(capture, MAPIROPS_CAPTURE_PULL, i, invalid,
+							sizeof (invalid)) != MAPIROPS_ERR_SUCCESS);
+			bytes += sizeof (invalid);
+			invalids++;
+			break;
+		default:
+			fail_if(mapirops_capture_record(capture, MAPIROPS_CAPTURE_PULL, i, push->data.data,
+							push->offset) != MAPIROPS_ERR_SUCCESS);
+			bytes += push->offset;
+			requests++;
+			break;
+		}
+	}
+	fail_if(mapirops_capture_flush(capture) != MAPIROPS_ERR_SUCCESS);
+	talloc_free(capture);
+
+	analyze = mapirops_analyze_init(mem_ctx, 0);
+	fail_if(analyze == NULL);
+	fail_if(mapirops_analyze_add(analyze, path) != MAPIROPS_ERR_SUCCESS);
+	total = talloc_zero(mem_ctx, struct mapirops_analyze_stats);
+	fail_if(total == NULL);
+
+	/* Merged counts don't depend on the number of workers */
+	for (i = 0; i < 3; i++) {
+		fail_if(mapirops_analyze_run(analyze, threads[i], total, &workers) != MAPIROPS_ERR_SUCCESS);
+		fail_if(workers != threads[i]);
+		fail_if(total->records != DISPATCH_RECORDS);
+		fail_if(total->bytes != bytes);
+		fail_if(total->invalid != invalids);
+
+		rs = &total->rops[MAPIROPS_ANALYZE_REQUEST][RopGetNamesFromPropertyIds];
+		fail_if(rs->count != requests);
+		fail_if(rs->errors != errors);
+		fail_if(rs->bytes != (uint64_t)(requests - errors) * (push->offset - 2));
+
+		rs = &total->rops[MAPIROPS_ANALYZE_RESPONSE][RopGetNamesFromPropertyIds];
+		fail_if(rs->count != responses);
+		fail_if(rs->errors != 0);
+		fail_if(rs->bytes != (uint64_t)responses * 6);
+	}
+
+	/* Client side: pulled buffers are responses */
+	talloc_free(analyze);
+	analyze = mapirops_analyze_init(mem_ctx, MAPIROPS_ANALYZE_CLIENT);
+	fail_if(analyze == NULL);
+	fail_if(mapirops_analyze_add(analyze, path) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_analyze_run(analyze, 2, total, &workers) != MAPIROPS_ERR_SUCCESS);
+	fail_if(workers != 2);
+	fail_if(total->rops[MAPIROPS_ANALYZE_REQUEST][RopGetNamesFromPropertyIds].count != responses);
+	fail_if(total->rops[MAPIROPS_ANALYZE_RESPONSE][RopGetNamesFromPropertyIds].count != requests);
+
+	fail_if(mapirops_analyze_add(analyze, "/nonexistent/mapirops_dispatch") != MAPIROPS_ERR_INVALID_VAL);
+
+	unlink(path);
+	COMMON_TEST_END();
+}
+END_TEST
+
+Suite *dispatch_suite(void)
+{
+	Suite	*s;
+	TCase	*tc;
+
+	s = suite_create("MAPIROPS ROP dispatch");
+	tc = tcase_create("[MS-OXCROPS] 2.2");
+	suite_add_tcase(s, tc);
+	tcase_add_test(tc, test_dispatch_get);
+	tcase_add_test(tc, test_dispatch_analyze);
+
+	return s;
+}
@@ -0,0 +1,240 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testsuite.h"
+
+/* Serialized events, identical whatever the buffer boundaries */
+struct fx_log {
+	uint8_t		*data;
+	size_t		length;
+	uint32_t	markers;
+	uint32_t	properties;
+	uint32_t	fragments;
+	const uint8_t	*fragment;
+};
+
+static void fx_log_append(struct fx_log *log, const void *data, size_t length)
+{
+	log->data = talloc_realloc(NULL, log->data, uint8_t, log->length + length);
+	memcpy(log->data + log->length, data, length);
+	log->length += length;
+}
+
+static enum mapirops_err_code fx_log_marker(void *private_data, uint32_t marker)
+{
+	struct fx_log	*log = (struct fx_log *) private_data;
+
+	log->markers++;
+	fx_log_append(log, "M", 1);
+	fx_log_append(log, &marker, 4);
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static enum mapirops_err_code fx_log_property(void *private_data, const struct mapirops_fx_property *prop)
+{
+	struct fx_log	*log = (struct fx_log *) private_data;
+
+	log->properties++;
+	fx_log_append(log, "P", 1);
+	fx_log_append(log, &prop->PropertyTag, 4);
+	fx_log_append(log, &prop->index, 4);
+	fx_log_append(log, &prop->count, 4);
+	fx_log_append(log, &prop->length, 4);
+	if (prop->named) {
+		fx_log_append(log, &prop->guid, sizeof (GUID));
+		fx_log_append(log, &prop->lid, 4);
+		fx_log_append(log, prop->name, prop->name_length);
+	}
+	if (prop->value) {
+		fx_log_append(log, prop->value, prop->length);
+	}
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static enum mapirops_err_code fx_log_data(void *private_data, const struct mapirops_fx_property *prop,
+					  const uint8_t *data, uint32_t length, uint32_t offset)
+{
+	struct fx_log	*log = (struct fx_log *) private_data;
+
+	log->fragments++;
+	log->fragment = data;
+	fx_log_append(log, data, length);
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+static const struct mapirops_fx_callbacks fx_log_callbacks = {
+	.marker = fx_log_marker,
+	.property = fx_log_property,
+	.data = fx_log_data
+};
+
+START_TEST (test_fxparser_chunks)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_push		*push;
+	struct mapirops_fxparser	*fx;
+	struct fx_log			ref;
+	struct fx_log			log;
+	GUID				guid;
+	const uint32_t			chunks[] = { 1, 2, 3, 5, 7, 16, 17, 100, 4096 };
+	uint32_t			big;
+	uint32_t			i;
+	size_t				offset;
+	size_t				n;
+
+	mem_ctx = talloc_named(NULL, 0, "test_fxparser_chunks");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	/* PS_PUBLIC_STRINGS */
+	memset(&guid, 0, sizeof (guid));
+	guid.Data1 = 0x00020329;
+	guid.Data4[0] = 0xC0;
+	guid.Data4[7] = 0x46;
+
+	mapirops_push_uint32(push, StartMessage);
+	mapirops_push_uint32(push, 0x0E070003);
+	mapirops_push_uint32(push, 0x12);
+	mapirops_push_uint32(push, 0x0E1B000B);
+	mapirops_push_uint16(push, 1);
+	/* Named properties, by LID and by name */
+	mapirops_push_uint32(push, 0x8001001F);
+	mapirops_push_GUID(push, &guid);
+	mapirops_push_uint8(push, 0x00);
+	mapirops_push_uint32(push, 0x8501);
+	mapirops_push_uint32(push, 6);
+	mapirops_push_bytes(push, (const uint8_t *) "A\0B\0\0\0", 6);
+	mapirops_push_uint32(push, 0x80020003);
+	mapirops_push_GUID(push, &guid);
+	mapirops_push_uint8(push, 0x01);
+	mapirops_push_bytes(push, (const uint8_t *) "X\0-\0I\0d\0\0\0", 10);
+	mapirops_push_uint32(push, 7);
+	/* Multiple-valued properties */
+	mapirops_push_uint32(push, 0x68021003);
+	mapirops_push_uint32(push, 3);
+	for (i = 1; i <= 3; i++) {
+		mapirops_push_uint32(push, i);
+	}
+	mapirops_push_uint32(push, 0x68031102);
+	mapirops_push_uint32(push, 2);
+	mapirops_push_uint32(push, 3);
+	mapirops_push_bytes(push, (const uint8_t *) "abc", 3);
+	mapirops_push_uint32(push, 0);
+	mapirops_push_uint32(push, 0x68041003);
+	mapirops_push_uint32(push, 0);
+	/* Large binary value */
+	mapirops_push_uint32(push, 0x10090102);
+	mapirops_push_uint32(push, 5000);
+	big = push->offset;
+	for (i = 0; i < 5000; i++) {
+		mapirops_push_uint8(push, (uint8_t)(i * 31));
+	}
+	mapirops_push_uint32(push, EndMessage);
+
+	/* Whole stream at once */
+	memset(&ref, 0, sizeof (ref));
+	fx = mapirops_fxparser_init(mem_ctx, &fx_log_callbacks, &ref);
+	fail_if(fx == NULL);
+	fail_if(mapirops_fxparser_parse(fx, push->data.data, push->offset) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_fxparser_end(fx) != MAPIROPS_ERR_SUCCESS);
+	fail_if(ref.markers != 2);
+	fail_if(ref.properties != 11);
+	fail_if(ref.fragments != 3);
+	/* Not copied */
+	fail_if(ref.fragment != push->data.data + big);
+	talloc_free(fx);
+
+	for (i = 0; i < sizeof (chunks) / sizeof (chunks[0]); i++) {
+		memset(&log, 0, sizeof (log));
+		fx = mapirops_fxparser_init(mem_ctx, &fx_log_callbacks, &log);
+		fail_if(fx == NULL);
+		for (offset = 0; offset < push->offset; offset += n) {
+			n = MIN(chunks[i], push->offset - offset);
+			fail_if(mapirops_fxparser_parse(fx, push->data.data + offset, n) != MAPIROPS_ERR_SUCCESS);
+		}
+		fail_if(mapirops_fxparser_end(fx) != MAPIROPS_ERR_SUCCESS);
+		fail_if(log.length != ref.length);
+		fail_if(memcmp(log.data, ref.data, ref.length));
+		talloc_free(log.data);
+		talloc_free(fx);
+	}
+
+	talloc_free(ref.data);
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_fxparser_invalid)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_fxparser	*fx;
+	struct mapirops_fx_callbacks	callbacks;
+	uint8_t				wire[32];
+	uint8_t				name[MAPIROPS_FX_NAME_MAX + 2];
+
+	mem_ctx = talloc_named(NULL, 0, "test_fxparser_invalid");
+	fail_if(mem_ctx == NULL);
+	memset(&callbacks, 0, sizeof (callbacks));
+	memset(wire, 0, sizeof (wire));
+
+	/* Stream ending inside a property */
+	fx = mapirops_fxparser_init(mem_ctx, &callbacks, NULL);
+	SIVAL(wire, 0, 0x0E070003);
+	fail_if(mapirops_fxparser_parse(fx, wire, 6) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_fxparser_end(fx) != MAPIROPS_ERR_BUFSIZE);
+	talloc_free(fx);
+
+	/* Multiple-valued boolean */
+	fx = mapirops_fxparser_init(mem_ctx, &callbacks, NULL);
+	SIVAL(wire, 0, 0x0E1B100B);
+	fail_if(mapirops_fxparser_parse(fx, wire, 4) != MAPIROPS_ERR_INVALID_VAL);
+	talloc_free(fx);
+
+	/* Unknown named property Kind */
+	fx = mapirops_fxparser_init(mem_ctx, &callbacks, NULL);
+	SIVAL(wire, 0, 0x80010003);
+	wire[20] = 0x02;
+	fail_if(mapirops_fxparser_parse(fx, wire, 21) != MAPIROPS_ERR_INVALID_VAL);
+	talloc_free(fx);
+
+	/* Name without null character */
+	fx = mapirops_fxparser_init(mem_ctx, &callbacks, NULL);
+	wire[20] = 0x01;
+	fail_if(mapirops_fxparser_parse(fx, wire, 21) != MAPIROPS_ERR_SUCCESS);
+	memset(name, 'a', sizeof (name));
+	fail_if(mapirops_fxparser_parse(fx, name, sizeof (name)) != MAPIROPS_ERR_INVALID_VAL);
+	talloc_free(fx);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+Suite *fxparser_suite(void)
+{
+	Suite	*s;
+	TCase	*tc;
+
+	s = suite_create("MAPIROPS FastTransfer parser");
+	tc = tcase_create("[MS-OXCFXICS] 2.2.4");
+	suite_add_tcase(s, tc);
+	tcase_add_test(tc, test_fxparser_chunks);
+	tcase_add_test(tc, test_fxparser_invalid);
+
+	return s;
+}
@@ -0,0 +1,138 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testsuite.h"
+
+/* Message index fails to serialize if equal to fail */
+static enum mapirops_err_code fx_message(void *private_data, uint32_t index, struct mapirops_push *push)
+{
+	uint32_t	fail = *(uint32_t *) private_data;
+	uint32_t	i;
+
+	if (index == fail) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	MAPIROPS_CHECK(mapirops_push_uint32(push, StartMessage));
+	MAPIROPS_CHECK(mapirops_push_uint32(push, 0x67480014));
+	MAPIROPS_CHECK(mapirops_push_uint64(push, index));
+	/* Messages of varying size, some larger than a buffer */
+	MAPIROPS_CHECK(mapirops_push_uint32(push, 0x10090102));
+	MAPIROPS_CHECK(mapirops_push_uint32(push, (index % 13) * 300));
+	for (i = 0; i < (index % 13) * 300; i++) {
+		MAPIROPS_CHECK(mapirops_push_uint8(push, (uint8_t)(index + i)));
+	}
+	MAPIROPS_CHECK(mapirops_push_uint32(push, EndMessage));
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+START_TEST (test_fxproducer_order)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_push		*ref;
+	struct mapirops_push		*push;
+	struct mapirops_fxproducer	*fx;
+	const uint32_t			count = 500;
+	uint32_t			fail = UINT32_MAX;
+	uint32_t			length;
+	uint32_t			i;
+	uint8_t				last = 0;
+
+	mem_ctx = talloc_named(NULL, 0, "test_fxproducer_order");
+	fail_if(mem_ctx == NULL);
+	ref = mapirops_push_init(mem_ctx);
+	fail_if(ref == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+
+	for (i = 0; i < count; i++) {
+		fail_if(fx_message(&fail, i, ref) != MAPIROPS_ERR_SUCCESS);
+	}
+
+	/* Small window: workers wait for the consumer */
+	fx = mapirops_fxproducer_init(mem_ctx, count, 4, 3, fx_message, &fail);
+	fail_if(fx == NULL);
+	while (!last) {
+		fail_if(mapirops_fxproducer_get_buffer(fx, push, 1000, &length, &last) != MAPIROPS_ERR_SUCCESS);
+		fail_if(length > 1000);
+		fail_if(!last && length != 1000);
+	}
+	talloc_free(fx);
+	fail_if(push->offset != ref->offset);
+	fail_if(memcmp(push->data.data, ref->data.data, ref->offset));
+
+	/* Nothing to produce */
+	fx = mapirops_fxproducer_init(mem_ctx, 0, 0, 0, fx_message, &fail);
+	fail_if(fx == NULL);
+	fail_if(mapirops_fxproducer_get_buffer(fx, push, 1000, &length, &last) != MAPIROPS_ERR_SUCCESS);
+	fail_if(length != 0 || !last);
+	talloc_free(fx);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_fxproducer_error)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_push		*push;
+	struct mapirops_fxproducer	*fx;
+	uint32_t			fail = 50;
+	uint32_t			length;
+	uint8_t				last;
+	enum mapirops_err_code		retval;
+
+	mem_ctx = talloc_named(NULL, 0, "test_fxproducer_error");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+
+	fx = mapirops_fxproducer_init(mem_ctx, 200, 4, 0, fx_message, &fail);
+	fail_if(fx == NULL);
+	do {
+		retval = mapirops_fxproducer_get_buffer(fx, push, 4096, &length, &last);
+	} while (retval == MAPIROPS_ERR_SUCCESS && !last);
+	fail_if(retval != MAPIROPS_ERR_INVALID_VAL);
+	fail_if(last);
+	fail_if(mapirops_fxproducer_get_buffer(fx, push, 4096, &length, &last) != MAPIROPS_ERR_INVALID_VAL);
+
+	/* Freed while workers are blocked on the window */
+	talloc_free(fx);
+	fx = mapirops_fxproducer_init(mem_ctx, 10000, 4, 2, fx_message, &fail);
+	fail_if(fx == NULL);
+	talloc_free(fx);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+Suite *fxproducer_suite(void)
+{
+	Suite	*s;
+	TCase	*tc;
+
+	s = suite_create("MAPIROPS FastTransfer producer");
+	tc = tcase_create("[MS-OXCFXICS] 2.2.3.1.1.5");
+	suite_add_tcase(s, tc);
+	tcase_add_test(tc, test_fxproducer_order);
+	tcase_add_test(tc, test_fxproducer_error);
+
+	return s;
+}
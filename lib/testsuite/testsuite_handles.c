@@ -0,0 +1,160 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testsuite.h"
+
+START_TEST (test_handles_table)
+{
+	TALLOC_CTX		*mem_ctx;
+	struct mapirops_handles	*handles;
+	uint32_t		objects[200];
+	uint32_t		handle[200];
+	uint32_t		stale;
+	void			*object;
+	uint32_t		i;
+
+	mem_ctx = talloc_named(NULL, 0, "test_handles_table");
+	fail_if(mem_ctx == NULL);
+	handles = mapirops_handles_init(mem_ctx, 0);
+	fail_if(handles == NULL);
+
+	/* Grows past the initial allocation */
+	for (i = 0; i < 200; i++) {
+		fail_if(mapirops_handles_alloc(handles, &objects[i], &handle[i]) != MAPIROPS_ERR_SUCCESS);
+		fail_if(handle[i] == MAPIROPS_HANDLE_INVALID);
+	}
+	for (i = 0; i < 200; i++) {
+		fail_if(mapirops_handles_lookup(handles, handle[i]) != &objects[i]);
+	}
+	fail_if(mapirops_handles_alloc(handles, NULL, &stale) != MAPIROPS_ERR_INVALID_VAL);
+	fail_if(mapirops_handles_lookup(handles, MAPIROPS_HANDLE_INVALID) != NULL);
+
+	/* Released entry is reused with a new generation */
+	stale = handle[10];
+	fail_if(mapirops_handles_release(handles, stale, &object) != MAPIROPS_ERR_SUCCESS);
+	fail_if(object != &objects[10]);
+	fail_if(mapirops_handles_lookup(handles, stale) != NULL);
+	fail_if(mapirops_handles_release(handles, stale, NULL) != MAPIROPS_ERR_NOT_FOUND);
+	fail_if(mapirops_handles_alloc(handles, &objects[10], &handle[10]) != MAPIROPS_ERR_SUCCESS);
+	fail_if(handle[10] == stale);
+	fail_if((handle[10] & 0xFFFFF) != (stale & 0xFFFFF));
+	fail_if(mapirops_handles_lookup(handles, stale) != NULL);
+	fail_if(mapirops_handles_lookup(handles, handle[10]) != &objects[10]);
+
+	/* Generation wraps around without reaching 0 */
+	for (i = 0; i < 5000; i++) {
+		fail_if(mapirops_handles_release(handles, handle[20], NULL) != MAPIROPS_ERR_SUCCESS);
+		fail_if(mapirops_handles_alloc(handles, &objects[20], &handle[20]) != MAPIROPS_ERR_SUCCESS);
+		fail_if((handle[20] >> MAPIROPS_HANDLE_INDEX_BITS) == 0);
+	}
+	fail_if(mapirops_handles_lookup(handles, handle[20]) != &objects[20]);
+	talloc_free(handles);
+
+	/* Full table */
+	handles = mapirops_handles_init(mem_ctx, 100);
+	fail_if(handles == NULL);
+	for (i = 0; i < 100; i++) {
+		fail_if(mapirops_handles_alloc(handles, &objects[i], &handle[i]) != MAPIROPS_ERR_SUCCESS);
+	}
+	fail_if(mapirops_handles_alloc(handles, &objects[100], &handle[100]) != MAPIROPS_ERR_BUFSIZE);
+	fail_if(mapirops_handles_release(handles, handle[50], NULL) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_handles_alloc(handles, &objects[100], &handle[100]) != MAPIROPS_ERR_SUCCESS);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_handles_ropbuf)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_handles		*handles;
+	struct mapirops_push		*push;
+	struct mapirops_pull		*pull;
+	struct mapirops_ropbuf_frame	frame;
+	struct mapirops_ropbuf		ropbuf;
+	uint32_t			objects[3];
+	uint32_t			table[4];
+	void				*resolved[4];
+
+	mem_ctx = talloc_named(NULL, 0, "test_handles_ropbuf");
+	fail_if(mem_ctx == NULL);
+	handles = mapirops_handles_init(mem_ctx, 0);
+	fail_if(handles == NULL);
+	fail_if(mapirops_handles_alloc(handles, &objects[0], &table[0]) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_handles_alloc(handles, &objects[1], &table[1]) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_handles_alloc(handles, &objects[2], &table[3]) != MAPIROPS_ERR_SUCCESS);
+	table[2] = MAPIROPS_HANDLE_INVALID;
+
+	/* RopRelease followed by an unknown ROP */
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	fail_if(mapirops_ropbuf_push_begin(push, &frame) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint8(push, 0x01) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint8(push, 0x00) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint8(push, 0x01) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_ropbuf_push_end(push, &frame, table, 4) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != 2 + 3 + 4 * 4);
+	fail_if(SVAL(push->data.data, 0) != 5);
+
+	pull = mapirops_pull_init(mem_ctx);
+	fail_if(pull == NULL);
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	fail_if(mapirops_ropbuf_pull(pull, &ropbuf) != MAPIROPS_ERR_SUCCESS);
+	fail_if(ropbuf.rops.length != 3 || ropbuf.rops.data[0] != 0x01 || ropbuf.rops.data[2] != 0x01);
+	fail_if(ropbuf.handle_count != 4);
+	fail_if(pull->offset != push->offset);
+
+	fail_if(mapirops_handles_resolve(handles, &ropbuf, resolved) != MAPIROPS_ERR_SUCCESS);
+	fail_if(resolved[0] != &objects[0] || resolved[1] != &objects[1]);
+	fail_if(resolved[2] != NULL || resolved[3] != &objects[2]);
+
+	/* Stale handle */
+	fail_if(mapirops_handles_release(handles, table[1], NULL) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_handles_resolve(handles, &ropbuf, resolved) != MAPIROPS_ERR_NOT_FOUND);
+	fail_if(resolved[0] != &objects[0] || resolved[1] != NULL || resolved[3] != &objects[2]);
+
+	/* Truncated ServerObjectHandleTable */
+	pull->offset = 0;
+	pull->data.length = push->offset - 1;
+	fail_if(mapirops_ropbuf_pull(pull, &ropbuf) != MAPIROPS_ERR_INVALID_VAL);
+
+	/* RopSize past the end of the buffer */
+	SSVAL(push->data.data, 0, 0x100);
+	pull->offset = 0;
+	pull->data.length = push->offset;
+	fail_if(mapirops_ropbuf_pull(pull, &ropbuf) != MAPIROPS_ERR_BUFSIZE);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+Suite *handles_suite(void)
+{
+	Suite	*s;
+	TCase	*tc;
+
+	s = suite_create("MAPIROPS Server object handles");
+	tc = tcase_create("[MS-OXCROPS] 2.2.1");
+	suite_add_tcase(s, tc);
+	tcase_add_test(tc, test_handles_table);
+	tcase_add_test(tc, test_handles_ropbuf);
+
+	return s;
+}
@@ -0,0 +1,186 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testsuite.h"
+
+/* [MS-XCA] section 3.1 examples */
+static const uint8_t lzxpress_abc_compressed[] = {
+	0xff, 0xff, 0xff, 0x1f, 0x61, 0x62, 0x63, 0x17,
+	0x00, 0x0f, 0xff, 0x26, 0x01
+};
+
+#define	LZXPRESS_ALPHABET	"abcdefghijklmnopqrstuvwxyz"
+
+START_TEST (test_lzxpress_vectors)
+{
+	enum mapirops_err_code	errval;
+	struct mapibuf		src;
+	struct mapibuf		dst;
+	uint8_t			in[300];
+	uint8_t			out[512];
+	int			i;
+
+	/* abc repeated 100 times */
+	for (i = 0; i < 300; i++) {
+		in[i] = 'a' + (i % 3);
+	}
+	src.data = in;
+	src.length = sizeof (in);
+	dst.data = out;
+	dst.length = sizeof (out);
+	errval = mapirops_lzxpress_compress(&src, &dst);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(dst.length != sizeof (lzxpress_abc_compressed));
+	fail_if(memcmp(out, lzxpress_abc_compressed, dst.length));
+
+	src.data = (uint8_t *)lzxpress_abc_compressed;
+	src.length = sizeof (lzxpress_abc_compressed);
+	dst.data = out;
+	dst.length = sizeof (out);
+	errval = mapirops_lzxpress_decompress(&src, &dst);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(dst.length != sizeof (in));
+	fail_if(memcmp(out, in, sizeof (in)));
+
+	/* No match at all: 26 literals */
+	src.data = (uint8_t *)LZXPRESS_ALPHABET;
+	src.length = strlen(LZXPRESS_ALPHABET);
+	dst.data = out;
+	dst.length = sizeof (out);
+	errval = mapirops_lzxpress_compress(&src, &dst);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(dst.length != 4 + strlen(LZXPRESS_ALPHABET));
+	fail_if(IVAL(out, 0) != 0x3f);
+	fail_if(memcmp(out + 4, LZXPRESS_ALPHABET, strlen(LZXPRESS_ALPHABET)));
+}
+END_TEST
+
+START_TEST (test_lzxpress_roundtrip)
+{
+	TALLOC_CTX		*mem_ctx;
+	enum mapirops_err_code	errval;
+	struct mapirops_push	*push;
+	struct mapibuf		src;
+	struct mapibuf		dst;
+	struct mapibuf		cmp;
+	uint32_t		seed = 0x2a;
+	uint32_t		i;
+
+	mem_ctx = talloc_named(NULL, 0, "test_lzxpress_roundtrip");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+
+	/* Property-like payload: repeated tags, folder ids and strings */
+	for (i = 0; i < 2000; i++) {
+		fail_if(mapirops_push_uint32(push, 0x3001001F) != MAPIROPS_ERR_SUCCESS);
+		fail_if(mapirops_push_utf16_string(push, 0, "Inbox") != MAPIROPS_ERR_SUCCESS);
+		fail_if(mapirops_push_uint64(push, 0x0100000000000001ULL + i) != MAPIROPS_ERR_SUCCESS);
+		seed = seed * 1103515245 + 12345;
+		fail_if(mapirops_push_uint8(push, seed >> 24) != MAPIROPS_ERR_SUCCESS);
+	}
+
+	src.data = push->data.data;
+	src.length = push->offset;
+	dst.length = src.length + src.length / 8 + 8;
+	dst.data = talloc_array(mem_ctx, uint8_t, dst.length);
+	fail_if(dst.data == NULL);
+	errval = mapirops_lzxpress_compress(&src, &dst);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(dst.length >= src.length);
+
+	cmp.length = src.length;
+	cmp.data = talloc_array(mem_ctx, uint8_t, cmp.length);
+	fail_if(cmp.data == NULL);
+	errval = mapirops_lzxpress_decompress(&dst, &cmp);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(cmp.length != src.length);
+	fail_if(memcmp(cmp.data, src.data, src.length));
+
+	/* Output limits */
+	cmp.length = src.length - 1;
+	errval = mapirops_lzxpress_decompress(&dst, &cmp);
+	fail_if(errval != MAPIROPS_ERR_BUFFER_TOO_SMALL);
+
+	dst.length = 64;
+	errval = mapirops_lzxpress_compress(&src, &dst);
+	fail_if(errval != MAPIROPS_ERR_BUFFER_TOO_SMALL);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_lzxpress_invalid)
+{
+	enum mapirops_err_code	errval;
+	struct mapibuf		src;
+	struct mapibuf		dst;
+	uint8_t			out[64];
+	/* Match before any literal */
+	uint8_t			bad_offset[] = { 0xff, 0xff, 0xff, 0xff, 0x08, 0x00 };
+	/* Truncated extended length */
+	uint8_t			truncated[] = { 0xff, 0xff, 0xff, 0x7f, 0x61, 0x07 };
+
+	src.data = bad_offset;
+	src.length = sizeof (bad_offset);
+	dst.data = out;
+	dst.length = sizeof (out);
+	errval = mapirops_lzxpress_decompress(&src, &dst);
+	fail_if(errval != MAPIROPS_ERR_INVALID_VAL);
+
+	src.data = truncated;
+	src.length = sizeof (truncated);
+	dst.data = out;
+	dst.length = sizeof (out);
+	errval = mapirops_lzxpress_decompress(&src, &dst);
+	fail_if(errval != MAPIROPS_ERR_INVALID_VAL);
+
+	/* Empty input */
+	src.data = NULL;
+	src.length = 0;
+	dst.data = out;
+	dst.length = sizeof (out);
+	errval = mapirops_lzxpress_compress(&src, &dst);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(dst.length != 4);
+
+	src.data = out;
+	src.length = dst.length;
+	dst.data = out + 4;
+	dst.length = sizeof (out) - 4;
+	errval = mapirops_lzxpress_decompress(&src, &dst);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(dst.length != 0);
+}
+END_TEST
+
+Suite *lzxpress_suite(void)
+{
+	Suite	*s;
+	TCase	*tc;
+
+	s = suite_create("MAPIROPS LZ77 compression");
+	tc = tcase_create("[MS-XCA] LZ77+DIRECT2");
+	suite_add_tcase(s, tc);
+	tcase_add_test(tc, test_lzxpress_vectors);
+	tcase_add_test(tc, test_lzxpress_roundtrip);
+	tcase_add_test(tc, test_lzxpress_invalid);
+
+	return s;
+}
@@ -0,0 +1,406 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testsuite.h"
+
+/* PS_PUBLIC_STRINGS */
+static const GUID ps_public_strings = {
+	0x00020329, 0x0000, 0x0000, { 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46 }
+};
+
+/* Set name to the string name s, stored as UTF-16LE in buf */
+static void namedprops_string(PropertyName *name, const char *s, uint8_t *buf)
+{
+	size_t	i;
+
+	memset(name, 0, sizeof (PropertyName));
+	name->Kind = MNID_STRING;
+	name->Guid = ps_public_strings;
+	for (i = 0; i <= strlen(s); i++) {
+		buf[2 * i] = s[i];
+		buf[2 * i + 1] = 0;
+	}
+	name->NameSize = 2 * i;
+	name->Name = buf;
+}
+
+/* Set name to the LID lid in the PS_PUBLIC_STRINGS property set */
+static void namedprops_lid(PropertyName *name, uint32_t lid)
+{
+	memset(name, 0, sizeof (PropertyName));
+	name->Kind = MNID_ID;
+	name->Guid = ps_public_strings;
+	name->LID = lid;
+}
+
+START_TEST (test_namedprops_map)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_namedprops	*map;
+	PropertyName			names[200];
+	PropertyName			out[200];
+	uint8_t				buf[2][32];
+	uint16_t			ids[200];
+	uint16_t			again[200];
+	uint32_t			i;
+
+	mem_ctx = talloc_named(NULL, 0, "test_namedprops_map");
+	fail_if(mem_ctx == NULL);
+	map = mapirops_namedprops_init(mem_ctx);
+	fail_if(map == NULL);
+
+	namedprops_string(&names[0], "Keywords", buf[0]);
+	namedprops_string(&names[1], "keywords", buf[1]);
+	for (i = 2; i < 200; i++) {
+		namedprops_lid(&names[i], 0x8500 + i);
+	}
+
+	/* Nothing mapped yet */
+	fail_if(mapirops_namedprops_get_ids(map, names, 200, 0, ids) != MAPIROPS_ERR_NOT_FOUND);
+	for (i = 0; i < 200; i++) {
+		fail_if(ids[i] != 0);
+	}
+
+	/* Batch larger than MAPIROPS_NAMEDPROPS_BATCH, spread over shards */
+	fail_if(mapirops_namedprops_get_ids(map, names, 200, 1, ids) != MAPIROPS_ERR_SUCCESS);
+	for (i = 0; i < 200; i++) {
+		fail_if(ids[i] < MAPIROPS_NAMEDPROPS_FIRST_ID || ids[i] >= MAPIROPS_NAMEDPROPS_FIRST_ID + 200);
+	}
+	fail_if(ids[0] == ids[1]);
+	fail_if(mapirops_namedprops_get_ids(map, names, 200, 0, again) != MAPIROPS_ERR_SUCCESS);
+	fail_if(memcmp(ids, again, sizeof (ids)));
+
+	/* Names are interned */
+	fail_if(mapirops_namedprops_get_names(map, ids, 200, out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(out[0].Kind != MNID_STRING || out[0].NameSize != 18);
+	fail_if(out[0].Name == buf[0] || memcmp(out[0].Name, buf[0], 18));
+	fail_if(memcmp(&out[0].Guid, &ps_public_strings, sizeof (GUID)));
+	for (i = 2; i < 200; i++) {
+		fail_if(out[i].Kind != MNID_ID || out[i].LID != 0x8500 + i);
+	}
+
+	/* PS_MAPI names map to their LID */
+	names[2].Guid.Data1 = 0x00020328;
+	names[2].LID = 0x3001;
+	names[3].Kind = 0x7;
+	fail_if(mapirops_namedprops_get_ids(map, names, 4, 0, ids) != MAPIROPS_ERR_NOT_FOUND);
+	fail_if(ids[2] != 0x3001 || ids[3] != 0);
+
+	ids[0] = 0x3001;
+	ids[1] = MAPIROPS_NAMEDPROPS_FIRST_ID + 200;
+	fail_if(mapirops_namedprops_get_names(map, ids, 2, out) != MAPIROPS_ERR_NOT_FOUND);
+	fail_if(out[0].Kind != MNID_ID || out[0].LID != 0x3001 || out[0].Guid.Data1 != 0x00020328);
+	fail_if(out[1].Kind != MNID_NONE);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+struct namedprops_thread {
+	struct mapirops_namedprops	*map;
+	uint32_t			seed;
+	uint16_t			ids[1000];
+	enum mapirops_err_code		retval;
+};
+
+/* Map the same 1000 LIDs as the other threads, in a different order */
+static void *namedprops_thread(void *data)
+{
+	struct namedprops_thread	*t = (struct namedprops_thread *) data;
+	PropertyName			name;
+	uint32_t			i;
+	uint32_t			lid;
+
+	for (i = 0; i < 1000 && t->retval == MAPIROPS_ERR_SUCCESS; i++) {
+		lid = (i * 7 + t->seed) % 1000;
+		namedprops_lid(&name, lid);
+		t->retval = mapirops_namedprops_get_ids(t->map, &name, 1, 1, &t->ids[lid]);
+	}
+
+	return NULL;
+}
+
+START_TEST (test_namedprops_threads)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_namedprops	*map;
+	struct namedprops_thread	t[4];
+	struct testsuite_threads	threads;
+	uint8_t				seen[1000];
+	uint32_t			i;
+
+	mem_ctx = talloc_named(NULL, 0, "test_namedprops_threads");
+	fail_if(mem_ctx == NULL);
+	map = mapirops_namedprops_init(mem_ctx);
+	fail_if(map == NULL);
+
+	for (i = 0; i < 4; i++) {
+		t[i].map = map;
+		t[i].seed = i * 250;
+		t[i].retval = MAPIROPS_ERR_SUCCESS;
+	}
+	testsuite_threads_start(&threads, 4, namedprops_thread, t, sizeof (t[0]));
+	testsuite_threads_join(&threads);
+	for (i = 0; i < 4; i++) {
+		fail_if(t[i].retval != MAPIROPS_ERR_SUCCESS);
+	}
+
+	/* Every thread got the same IDs, allocated without gaps */
+	memset(seen, 0, sizeof (seen));
+	for (i = 0; i < 1000; i++) {
+		fail_if(t[0].ids[i] != t[1].ids[i] || t[0].ids[i] != t[2].ids[i] || t[0].ids[i] != t[3].ids[i]);
+		fail_if(t[0].ids[i] < MAPIROPS_NAMEDPROPS_FIRST_ID || t[0].ids[i] >= MAPIROPS_NAMEDPROPS_FIRST_ID + 1000);
+		fail_if(seen[t[0].ids[i] - MAPIROPS_NAMEDPROPS_FIRST_ID]);
+		seen[t[0].ids[i] - MAPIROPS_NAMEDPROPS_FIRST_ID] = 1;
+	}
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_namedprops_rops)
+{
+	TALLOC_CTX					*mem_ctx;
+	struct mapirops_namedprops			*map;
+	struct mapirops_push				*push;
+	struct mapirops_pull				*pull;
+	PropertyName					names[3];
+	uint8_t						buf[32];
+	uint16_t					ids[3];
+	struct RopGetPropertyIdsFromNames_request	ids_request;
+	struct RopGetPropertyIdsFromNames_request	ids_request_out;
+	struct RopGetPropertyIdsFromNames_response	ids_response;
+	struct RopGetPropertyIdsFromNames_response	ids_response_out;
+	struct RopGetNamesFromPropertyIds_request	names_request;
+	struct RopGetNamesFromPropertyIds_response	names_response;
+	struct RopGetNamesFromPropertyIds_response	names_response_out;
+	PropertyName					*name;
+
+	mem_ctx = talloc_named(NULL, 0, "test_namedprops_rops");
+	fail_if(mem_ctx == NULL);
+	map = mapirops_namedprops_init(mem_ctx);
+	fail_if(map == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	pull = mapirops_pull_init(mem_ctx);
+	fail_if(pull == NULL);
+
+	namedprops_string(&names[0], "Keywords", buf);
+	namedprops_lid(&names[1], 0x8501);
+	namedprops_lid(&names[2], 0x8502);
+
+	/* Request goes through the wire */
+	memset(&ids_request, 0, sizeof (ids_request));
+	ids_request.RopId = RopGetPropertyIdsFromNames;
+	ids_request.InputHandleIndex = 1;
+	ids_request.Flags = GetPropertyIdsFromNames_Create;
+	ids_request.PropertyNameCount = 2;
+	ids_request.PropertyNames = names;
+	fail_if(mapirops_push_struct_RopGetPropertyIdsFromNames_request(push, &ids_request) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != 6 + (1 + 16 + 1 + 18) + (1 + 16 + 4));
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	fail_if(mapirops_pull_struct_RopGetPropertyIdsFromNames_request(pull, &ids_request_out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(ids_request_out.PropertyNameCount != 2);
+	fail_if(ids_request_out.PropertyNames[0].NameSize != 18);
+	fail_if(memcmp(ids_request_out.PropertyNames[0].Name, buf, 18));
+	fail_if(ids_request_out.PropertyNames[1].LID != 0x8501);
+
+	fail_if(mapirops_namedprops_RopGetPropertyIdsFromNames(map, mem_ctx, &ids_request_out, &ids_response) != MAPIROPS_ERR_SUCCESS);
+	fail_if(ids_response.ReturnValue != ecNone);
+	fail_if(ids_response.InputHandleIndex != 1);
+	fail_if(ids_response.ResponseType.success.PropertyIdCount != 2);
+
+	push->offset = 0;
+	fail_if(mapirops_push_struct_RopGetPropertyIdsFromNames_response(push, &ids_response) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != 6 + 2 + 2 * 2);
+	pull->data.length = push->offset;
+	pull->offset = 0;
+	fail_if(mapirops_pull_struct_RopGetPropertyIdsFromNames_response(pull, &ids_response_out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(memcmp(ids_response_out.ResponseType.success.PropertyIds,
+		       ids_response.ResponseType.success.PropertyIds, 2 * sizeof (uint16_t)));
+
+	/* Unknown name without the create flag */
+	ids_request.Flags = 0;
+	ids_request.PropertyNameCount = 3;
+	fail_if(mapirops_namedprops_RopGetPropertyIdsFromNames(map, mem_ctx, &ids_request, &ids_response) != MAPIROPS_ERR_SUCCESS);
+	fail_if(ids_response.ReturnValue != ecWarnWithErrors);
+	fail_if(ids_response.ResponseType.success.PropertyIds[2] != 0);
+
+	/* No name: every mapped property ID */
+	ids_request.PropertyNameCount = 0;
+	fail_if(mapirops_namedprops_RopGetPropertyIdsFromNames(map, mem_ctx, &ids_request, &ids_response) != MAPIROPS_ERR_SUCCESS);
+	fail_if(ids_response.ResponseType.success.PropertyIdCount != 2);
+	fail_if(ids_response.ResponseType.success.PropertyIds[1] != MAPIROPS_NAMEDPROPS_FIRST_ID + 1);
+
+	/* Back to the names */
+	ids[0] = ids_response_out.ResponseType.success.PropertyIds[1];
+	ids[1] = 0x9000;
+	ids[2] = ids_response_out.ResponseType.success.PropertyIds[0];
+	memset(&names_request, 0, sizeof (names_request));
+	names_request.RopId = RopGetNamesFromPropertyIds;
+	names_request.PropertyIdCount = 3;
+	names_request.PropertyIds = ids;
+	fail_if(mapirops_namedprops_RopGetNamesFromPropertyIds(map, mem_ctx, &names_request, &names_response) != MAPIROPS_ERR_SUCCESS);
+	fail_if(names_response.ReturnValue != ecWarnWithErrors);
+
+	push->offset = 0;
+	fail_if(mapirops_push_struct_RopGetNamesFromPropertyIds_response(push, &names_response) != MAPIROPS_ERR_SUCCESS);
+	pull->data.length = push->offset;
+	pull->offset = 0;
+	fail_if(mapirops_pull_struct_RopGetNamesFromPropertyIds_response(pull, &names_response_out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(pull->offset != push->offset);
+	fail_if(names_response_out.ResponseType.success.PropertyNameCount != 3);
+	name = names_response_out.ResponseType.success.PropertyNames;
+	fail_if(name[0].Kind != MNID_ID || name[0].LID != 0x8501);
+	fail_if(name[1].Kind != MNID_NONE);
+	fail_if(name[2].Kind != MNID_STRING || name[2].NameSize != 18 || memcmp(name[2].Name, buf, 18));
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_namedprops_counts)
+{
+	TALLOC_CTX					*mem_ctx;
+	struct mapirops_pull				*pull;
+	struct RopGetNamesFromPropertyIds_request	names_request;
+	struct RopGetPropertyIdsFromNames_request	ids_request;
+	uint8_t						names_buf[] = {
+		0x55, 0x00, 0x01, 0x02, 0x00, 0x01, 0x80, 0x02, 0x80
+	};
+	uint8_t						ids_buf[] = {
+		0x56, 0x00, 0x01, 0x02, 0xFF, 0xFF, 0x00
+	};
+	/* Two names announced, room for a single MNID_ID one */
+	uint8_t						short_buf[6 + 1 + 16 + 4] = {
+		0x56, 0x00, 0x01, 0x02, 0x02, 0x00, MNID_ID
+	};
+	struct mapirops_pull				cursor;
+
+	mem_ctx = talloc_named(NULL, 0, "test_namedprops_counts");
+	fail_if(mem_ctx == NULL);
+	pull = mapirops_pull_init(mem_ctx);
+	fail_if(pull == NULL);
+
+	/* Property IDs are decoded in bulk */
+	pull->data.data = names_buf;
+	pull->data.length = sizeof (names_buf);
+	fail_if(mapirops_pull_struct_RopGetNamesFromPropertyIds_request(pull, &names_request) != MAPIROPS_ERR_SUCCESS);
+	fail_if(pull->offset != sizeof (names_buf));
+	fail_if(names_request.PropertyIdCount != 2);
+	fail_if(names_request.PropertyIds[0] != 0x8001 || names_request.PropertyIds[1] != 0x8002);
+
+	/* One more ID than the bytes left */
+	names_buf[3] = 0x03;
+	pull->offset = 0;
+	fail_if(mapirops_pull_struct_RopGetNamesFromPropertyIds_request(pull, &names_request) != MAPIROPS_ERR_BUFSIZE);
+
+	/* Hostile count is rejected before allocating */
+	names_buf[3] = 0xFF;
+	names_buf[4] = 0xFF;
+	pull->offset = 0;
+	fail_if(mapirops_pull_struct_RopGetNamesFromPropertyIds_request(pull, &names_request) != MAPIROPS_ERR_BUFSIZE);
+
+	pull->data.data = ids_buf;
+	pull->data.length = sizeof (ids_buf);
+	pull->offset = 0;
+	fail_if(mapirops_pull_struct_RopGetPropertyIdsFromNames_request(pull, &ids_request) != MAPIROPS_ERR_BUFSIZE);
+
+	/* Names are checked against their own minimum size, not one byte */
+	fail_if(mapirops_pull_cursor_init(&cursor, short_buf, sizeof (short_buf)) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_pull_struct_RopGetPropertyIdsFromNames_request(&cursor, &ids_request) != MAPIROPS_ERR_BUFSIZE);
+	short_buf[4] = 0x01;
+	cursor.offset = 0;
+	fail_if(mapirops_pull_struct_RopGetPropertyIdsFromNames_request(&cursor, &ids_request) != MAPIROPS_ERR_ALLOC);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_namedprops_none)
+{
+	TALLOC_CTX					*mem_ctx;
+	struct mapirops_namedprops			*map;
+	struct mapirops_push				*push;
+	struct mapirops_pull				*pull;
+	struct RopGetNamesFromPropertyIds_request	names_request;
+	struct RopGetNamesFromPropertyIds_response	names_response;
+	struct RopGetNamesFromPropertyIds_response	names_response_out;
+	PropertyName					*name;
+	uint16_t					ids[1] = { 0x9000 };
+	/* [MS-OXCDATA] 2.6.1: Kind then the GUID, nothing else for MNID_NONE */
+	const uint8_t					expected[] = {
+		0x55, 0x00, 0x80, 0x03, 0x04, 0x00, 0x01, 0x00, 0xFF,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+	};
+
+	mem_ctx = talloc_named(NULL, 0, "test_namedprops_none");
+	fail_if(mem_ctx == NULL);
+	map = mapirops_namedprops_init(mem_ctx);
+	fail_if(map == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	pull = mapirops_pull_init(mem_ctx);
+	fail_if(pull == NULL);
+
+	memset(&names_request, 0, sizeof (names_request));
+	names_request.RopId = RopGetNamesFromPropertyIds;
+	names_request.PropertyIdCount = 1;
+	names_request.PropertyIds = ids;
+	fail_if(mapirops_namedprops_RopGetNamesFromPropertyIds(map, mem_ctx, &names_request, &names_response) != MAPIROPS_ERR_SUCCESS);
+	fail_if(names_response.ReturnValue != ecWarnWithErrors);
+
+	fail_if(mapirops_push_struct_RopGetNamesFromPropertyIds_response(push, &names_response) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != sizeof (expected));
+	fail_if(memcmp(push->data.data, expected, sizeof (expected)));
+
+	pull->data.data = (uint8_t *) expected;
+	pull->data.length = sizeof (expected);
+	fail_if(mapirops_pull_struct_RopGetNamesFromPropertyIds_response(pull, &names_response_out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(pull->offset != sizeof (expected));
+	name = names_response_out.ResponseType.success.PropertyNames;
+	fail_if(name[0].Kind != MNID_NONE);
+
+	/* The GUID is required */
+	pull->data.length--;
+	pull->offset = 0;
+	fail_if(mapirops_pull_struct_RopGetNamesFromPropertyIds_response(pull, &names_response_out) != MAPIROPS_ERR_BUFSIZE);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+Suite *namedprops_suite(void)
+{
+	Suite	*s;
+	TCase	*tc;
+
+	s = suite_create("MAPIROPS Named properties");
+	tc = tcase_create("[MS-OXCPRPT] 3.2.5.8");
+	suite_add_tcase(s, tc);
+	tcase_add_test(tc, test_namedprops_map);
+	tcase_add_test(tc, test_namedprops_threads);
+	tcase_add_test(tc, test_namedprops_rops);
+	tcase_add_test(tc, test_namedprops_counts);
+	tcase_add_test(tc, test_namedprops_none);
+
+	return s;
+}
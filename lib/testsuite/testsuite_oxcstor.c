@@ -216,6 +216,69 @@ START_TEST (test_RopLogon_request)
 }
 END_TEST
 
+START_TEST (test_RopLogon_request_template)
+{
+	TALLOC_CTX		*mem_ctx;
+	enum mapirops_err_code	errval;
+	struct mapirops_push	*push;
+	struct mapirops_pull	*pull;
+	struct RopLogon_request	request;
+	struct RopLogon_request	orequest;
+
+	fail_if(mapirops_template_RopLogon_request.size != 14);
+	fail_if(mapirops_template_RopLogon_request.slot_count != 5);
+	fail_if(mapirops_template_RopLogon_request.const_count != 2);
+
+	request.RopId = RopLogon;
+	request.LogonId = 0x1;
+	request.OutputHandleIndex = 0x2;
+	request.LogonFlags = LogonFlags_Ghosted;
+	request.OpenFlags = OpenFlags_PUBLIC|OpenFlags_HOME_LOGON;
+	request.StoreState = 0x00000000;
+	request.EssDn = "";
+	request.EssDnSize = strlen(request.EssDn) + 1;
+
+	COMMON_TEST_START(RopLogon_request_template);
+
+	errval = mapirops_push_struct_RopLogon_request(push, &request);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != 15);
+	fail_if(CVAL(push->data.data, 0) != RopLogon);
+	fail_if(CVAL(push->data.data, 2) != 0x2);
+	fail_if(IVAL(push->data.data, 4) != (OpenFlags_PUBLIC|OpenFlags_HOME_LOGON));
+
+	pull->mem_ctx = mem_ctx;
+	pull->data = push->data;
+	errval = mapirops_pull_struct_RopLogon_request(pull, &orequest);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(orequest.RopId != RopLogon);
+	fail_if(request.OutputHandleIndex != orequest.OutputHandleIndex);
+	fail_if(request.OpenFlags != orequest.OpenFlags);
+
+	/* Wrong RopId */
+	SCVAL(push->data.data, 0, RopGetReceiveFolder);
+	pull->offset = 0;
+	errval = mapirops_pull_struct_RopLogon_request(pull, &orequest);
+	fail_if(errval != MAPIROPS_ERR_INVALID_VAL);
+
+	/* Non zero StoreState */
+	SCVAL(push->data.data, 0, RopLogon);
+	SIVAL(push->data.data, 8, 0x1);
+	pull->offset = 0;
+	errval = mapirops_pull_struct_RopLogon_request(pull, &orequest);
+	fail_if(errval != MAPIROPS_ERR_INVALID_VAL);
+
+	/* Truncated buffer */
+	SIVAL(push->data.data, 8, 0x0);
+	pull->offset = 0;
+	pull->data.length = 13;
+	errval = mapirops_pull_struct_RopLogon_request(pull, &orequest);
+	fail_if(errval != MAPIROPS_ERR_BUFSIZE);
+
+	COMMON_TEST_END()
+}
+END_TEST
+
 START_TEST (test_RopLogon_LogonTime)
 {
 	TALLOC_CTX		*mem_ctx;
@@ -308,6 +371,44 @@ START_TEST (test_RopLogon_response_Redirect)
 }
 END_TEST
 
+START_TEST (test_RopGetReceiveFolder_request)
+{
+	TALLOC_CTX				*mem_ctx;
+	enum mapirops_err_code			errval;
+	struct mapirops_push			*push;
+	struct mapirops_pull			*pull;
+	struct RopGetReceiveFolder_request	request;
+	struct RopGetReceiveFolder_request	orequest;
+
+	COMMON_TEST_START(RopGetReceiveFolder_request);
+
+	request.LogonId = 0x1;
+	request.InputHandleIndex = 0x2;
+	request.MessageClass = "IPM.Note";
+	errval = mapirops_push_struct_RopGetReceiveFolder_request(push, &request);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != 3 + strlen(request.MessageClass) + 1);
+
+	/* MessageClass has no size and ends the buffer */
+	pull->mem_ctx = mem_ctx;
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	errval = mapirops_pull_struct_RopGetReceiveFolder_request(pull, &orequest);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(orequest.InputHandleIndex != request.InputHandleIndex);
+	fail_if(strcmp(orequest.MessageClass, request.MessageClass));
+	fail_if(pull->offset != push->offset);
+
+	/* Unterminated MessageClass */
+	pull->offset = 0;
+	pull->data.length = push->offset - 1;
+	errval = mapirops_pull_struct_RopGetReceiveFolder_request(pull, &orequest);
+	fail_if(errval != MAPIROPS_ERR_BUFSIZE);
+
+	COMMON_TEST_END()
+}
+END_TEST
+
 Suite *oxcstor_suite(void)
 {
 	Suite	*s;
@@ -321,12 +422,17 @@ Suite *oxcstor_suite(void)
 	tcase_add_test(TRopLogon, test_RopLogon_LogonFlags);
 	tcase_add_test(TRopLogon, test_RopLogon_OpenFlags);
 	tcase_add_test(TRopLogon, test_RopLogon_request);
+	tcase_add_test(TRopLogon, test_RopLogon_request_template);
 	tcase_add_test(TRopLogon, test_RopLogon_LogonTime);
 	tcase_add_test(TRopLogon, test_RopLogon_request);
 	tcase_add_test(TRopLogon, test_RopLogon_response_OK);
 	tcase_add_test(TRopLogon, test_RopLogon_response_Failure);
 	tcase_add_test(TRopLogon, test_RopLogon_response_Redirect);
 
+	TRopGetReceiveFolder = tcase_create("[MS-OXCSTOR] RopGetReceiveFolder");
+	suite_add_tcase(s, TRopGetReceiveFolder);
+	tcase_add_test(TRopGetReceiveFolder, test_RopGetReceiveFolder_request);
+
         return s;
 }
 
@@ -0,0 +1,466 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testsuite.h"
+
+START_TEST (test_PropertyValue_fixed)
+{
+	TALLOC_CTX		*mem_ctx;
+	struct mapirops_push	*push;
+	struct mapirops_pull	*pull;
+	TaggedPropertyValue	in[6];
+	TaggedPropertyValue	out;
+	const uint8_t		wire[] = {
+		0x02, 0x00, 0x0B, 0x00, 0x34, 0x12,
+		0x03, 0x00, 0x07, 0x36, 0x78, 0x56, 0x34, 0x12,
+		0x14, 0x00, 0x48, 0x67, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01,
+		0x0B, 0x00, 0x1B, 0x0E, 0x01,
+		0x0A, 0x00, 0x07, 0x36, 0x0F, 0x01, 0x04, 0x80,
+		0x48, 0x00, 0x01, 0x68, 0x21, 0xAE, 0xF1, 0xC4, 0x3B, 0x0A, 0x1E, 0x4A,
+		0x9C, 0x2D, 0x40, 0xC4, 0xB1, 0xF1, 0xA7, 0xE5
+	};
+	int			i;
+
+	mem_ctx = talloc_named(NULL, 0, "test_PropertyValue_fixed");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	pull = mapirops_pull_init(mem_ctx);
+	fail_if(pull == NULL);
+
+	in[0].PropertyTag = 0x000B0002;
+	in[0].Value.i = 0x1234;
+	in[1].PropertyTag = 0x36070003;
+	in[1].Value.l = 0x12345678;
+	in[2].PropertyTag = 0x67480014;
+	in[2].Value.d = 0x0100000000000001ULL;
+	in[3].PropertyTag = 0x0E1B000B;
+	in[3].Value.b = 1;
+	in[4].PropertyTag = 0x3607000A;
+	in[4].Value.err = MAPI_E_NOT_FOUND;
+	in[5].PropertyTag = 0x68010048;
+	mapirops_GUID_from_string("c4f1ae21-0a3b-4a1e-9c2d-40c4b1f1a7e5", &in[5].Value.guid);
+
+	for (i = 0; i < 6; i++) {
+		fail_if(mapirops_push_TaggedPropertyValue(push, &in[i]) != MAPIROPS_ERR_SUCCESS);
+	}
+	fail_if(push->offset != sizeof (wire));
+	fail_if(memcmp(push->data.data, wire, sizeof (wire)));
+
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	pull->offset = 0;
+	for (i = 0; i < 6; i++) {
+		memset(&out, 0, sizeof (out));
+		fail_if(mapirops_pull_TaggedPropertyValue(pull, mem_ctx, &out) != MAPIROPS_ERR_SUCCESS);
+		fail_if(out.PropertyTag != in[i].PropertyTag);
+	}
+	fail_if(pull->offset != sizeof (wire));
+	fail_if(out.Value.guid.Data1 != 0xc4f1ae21);
+	fail_if(memcmp(out.Value.guid.Data4, in[5].Value.guid.Data4, 8));
+
+	/* Truncated value */
+	pull->data.length = sizeof (wire) - 1;
+	pull->offset = 39;
+	fail_if(mapirops_pull_TaggedPropertyValue(pull, mem_ctx, &out) != MAPIROPS_ERR_BUFSIZE);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_PropertyValue_variable)
+{
+	TALLOC_CTX		*mem_ctx;
+	struct mapirops_push	*push;
+	struct mapirops_pull	*pull;
+	TypedPropertyValue	in;
+	TypedPropertyValue	out;
+	uint8_t			bytes[3] = { 0xDE, 0xAD, 0x00 };
+	const uint8_t		wire[] = {
+		0x1F, 0x00, 'I', 0x00, 'n', 0x00, 0xE9, 0x00, 0x00, 0x00,
+		0x1E, 0x00, 'O', 'u', 't', 0x00,
+		0x02, 0x01, 0x03, 0x00, 0xDE, 0xAD, 0x00,
+		0x01, 0x00
+	};
+
+	mem_ctx = talloc_named(NULL, 0, "test_PropertyValue_variable");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	pull = mapirops_pull_init(mem_ctx);
+	fail_if(pull == NULL);
+
+	in.PropertyType = PT_UNICODE;
+	in.Value.lpszW = "In\xc3\xa9";
+	fail_if(mapirops_push_TypedPropertyValue(push, &in) != MAPIROPS_ERR_SUCCESS);
+	in.PropertyType = PT_STRING8;
+	in.Value.lpszA = "Out";
+	fail_if(mapirops_push_TypedPropertyValue(push, &in) != MAPIROPS_ERR_SUCCESS);
+	in.PropertyType = PT_BINARY;
+	in.Value.bin.cb = sizeof (bytes);
+	in.Value.bin.lpb = bytes;
+	fail_if(mapirops_push_TypedPropertyValue(push, &in) != MAPIROPS_ERR_SUCCESS);
+	in.PropertyType = PT_NULL;
+	fail_if(mapirops_push_TypedPropertyValue(push, &in) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != sizeof (wire));
+	fail_if(memcmp(push->data.data, wire, sizeof (wire)));
+
+	pull->data.data = (uint8_t *)wire;
+	pull->data.length = sizeof (wire);
+	fail_if(mapirops_pull_TypedPropertyValue(pull, mem_ctx, &out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(out.PropertyType != PT_UNICODE);
+	fail_if(strcmp(out.Value.lpszW, "In\xc3\xa9"));
+	fail_if(mapirops_pull_TypedPropertyValue(pull, mem_ctx, &out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(strcmp(out.Value.lpszA, "Out"));
+	fail_if(mapirops_pull_TypedPropertyValue(pull, mem_ctx, &out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(out.Value.bin.cb != sizeof (bytes));
+	fail_if(memcmp(out.Value.bin.lpb, bytes, sizeof (bytes)));
+	fail_if(mapirops_pull_TypedPropertyValue(pull, mem_ctx, &out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(out.PropertyType != PT_NULL);
+	fail_if(pull->offset != sizeof (wire));
+
+	/* Unterminated strings */
+	pull->data.length = 9;
+	pull->offset = 0;
+	fail_if(mapirops_pull_TypedPropertyValue(pull, mem_ctx, &out) != MAPIROPS_ERR_BUFSIZE);
+	pull->data.length = 15;
+	pull->offset = 10;
+	fail_if(mapirops_pull_TypedPropertyValue(pull, mem_ctx, &out) != MAPIROPS_ERR_BUFSIZE);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_PropertyValue_mv)
+{
+	TALLOC_CTX		*mem_ctx;
+	struct mapirops_push	*push;
+	struct mapirops_pull	*pull;
+	PropertyValue		in;
+	PropertyValue		out;
+	uint32_t		longs[300];
+	char			*strings[] = { "a", "", "bc" };
+	BinaryValue		bins[2];
+	uint32_t		i;
+
+	mem_ctx = talloc_named(NULL, 0, "test_PropertyValue_mv");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	pull = mapirops_pull_init(mem_ctx);
+	fail_if(pull == NULL);
+
+	for (i = 0; i < 300; i++) {
+		longs[i] = i * 0x01010101;
+	}
+	in.MVl.cValues = 300;
+	in.MVl.lpl = longs;
+	fail_if(mapirops_push_PropertyValue(push, PT_MV_LONG, &in) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != 4 + 300 * 4);
+	fail_if(IVAL(push->data.data, 0) != 300);
+	fail_if(IVAL(push->data.data, 4 + 299 * 4) != 299 * 0x01010101U);
+
+	in.MVszW.cValues = 3;
+	in.MVszW.lppsz = strings;
+	fail_if(mapirops_push_PropertyValue(push, PT_MV_UNICODE, &in) != MAPIROPS_ERR_SUCCESS);
+
+	bins[0].cb = 0;
+	bins[0].lpb = NULL;
+	bins[1].cb = 2;
+	bins[1].lpb = (uint8_t *)"xy";
+	in.MVbin.cValues = 2;
+	in.MVbin.lpbin = bins;
+	fail_if(mapirops_push_PropertyValue(push, PT_MV_BINARY, &in) != MAPIROPS_ERR_SUCCESS);
+
+	in.MVi.cValues = 0;
+	in.MVi.lpi = NULL;
+	fail_if(mapirops_push_PropertyValue(push, PT_MV_SHORT, &in) != MAPIROPS_ERR_SUCCESS);
+
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	fail_if(mapirops_pull_PropertyValue(pull, mem_ctx, PT_MV_LONG, &out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(out.MVl.cValues != 300);
+	fail_if(memcmp(out.MVl.lpl, longs, sizeof (longs)));
+	fail_if(mapirops_pull_PropertyValue(pull, mem_ctx, PT_MV_UNICODE, &out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(out.MVszW.cValues != 3);
+	for (i = 0; i < 3; i++) {
+		fail_if(strcmp(out.MVszW.lppsz[i], strings[i]));
+	}
+	fail_if(mapirops_pull_PropertyValue(pull, mem_ctx, PT_MV_BINARY, &out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(out.MVbin.cValues != 2);
+	fail_if(out.MVbin.lpbin[0].cb != 0);
+	fail_if(out.MVbin.lpbin[1].cb != 2 || memcmp(out.MVbin.lpbin[1].lpb, "xy", 2));
+	fail_if(mapirops_pull_PropertyValue(pull, mem_ctx, PT_MV_SHORT, &out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(out.MVi.cValues != 0);
+	fail_if(pull->offset != push->offset);
+
+	/* Count larger than the remaining bytes */
+	pull->offset = 0;
+	pull->data.length = 4 + 299 * 4;
+	fail_if(mapirops_pull_PropertyValue(pull, mem_ctx, PT_MV_LONG, &out) != MAPIROPS_ERR_BUFSIZE);
+	fail_if(out.MVl.lpl != NULL);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_PropertyValue_invalid)
+{
+	TALLOC_CTX		*mem_ctx;
+	struct mapirops_push	*push;
+	struct mapirops_pull	*pull;
+	PropertyValue		value;
+	uint8_t			wire[8] = { 0 };
+
+	mem_ctx = talloc_named(NULL, 0, "test_PropertyValue_invalid");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	pull = mapirops_pull_init(mem_ctx);
+	fail_if(pull == NULL);
+	pull->data.data = wire;
+	pull->data.length = sizeof (wire);
+
+	memset(&value, 0, sizeof (value));
+	fail_if(mapirops_push_PropertyValue(push, PT_UNSPECIFIED, &value) != MAPIROPS_ERR_INVALID_VAL);
+	fail_if(mapirops_push_PropertyValue(push, PT_SRESTRICTION, &value) != MAPIROPS_ERR_INVALID_VAL);
+	fail_if(mapirops_push_PropertyValue(push, MV_FLAG|PT_BOOLEAN, &value) != MAPIROPS_ERR_INVALID_VAL);
+	fail_if(mapirops_push_PropertyValue(push, 0x2003, &value) != MAPIROPS_ERR_INVALID_VAL);
+	fail_if(mapirops_pull_PropertyValue(pull, mem_ctx, 0x0009, &value) != MAPIROPS_ERR_INVALID_VAL);
+	fail_if(mapirops_pull_PropertyValue(pull, mem_ctx, 0xFFFF, &value) != MAPIROPS_ERR_INVALID_VAL);
+	fail_if(push->offset != 0);
+	fail_if(pull->offset != 0);
+
+	/* Array count without array */
+	value.MVl.cValues = 1;
+	fail_if(mapirops_push_PropertyValue(push, PT_MV_LONG, &value) != MAPIROPS_ERR_INVALID_VAL);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_PropertyValue_rops)
+{
+	TALLOC_CTX				*mem_ctx;
+	struct mapirops_push			*push;
+	struct mapirops_pull			*pull;
+	struct RopSetProperties_request		request;
+	struct RopSetProperties_request		request_out;
+	struct RopGetPropertiesAll_response	response;
+	struct RopGetPropertiesAll_response	response_out;
+	TaggedPropertyValue			values[3];
+	uint8_t					bytes[2] = { 0xDE, 0xAD };
+	const uint8_t				wire[] = {
+		0x0A, 0x00, 0x01, 0x1C, 0x00, 0x03, 0x00,
+		0x03, 0x00, 0x07, 0x36, 0x78, 0x56, 0x34, 0x12,
+		0x1F, 0x00, 0x01, 0x30, 'I', 0x00, 'n', 0x00, 0x00, 0x00,
+		0x02, 0x01, 0xFF, 0x0F, 0x02, 0x00, 0xDE, 0xAD
+	};
+
+	mem_ctx = talloc_named(NULL, 0, "test_PropertyValue_rops");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	pull = mapirops_pull_init(mem_ctx);
+	fail_if(pull == NULL);
+
+	values[0].PropertyTag = 0x36070003;
+	values[0].Value.l = 0x12345678;
+	values[1].PropertyTag = 0x3001001F;
+	values[1].Value.lpszW = "In";
+	values[2].PropertyTag = 0x0FFF0102;
+	values[2].Value.bin.cb = sizeof (bytes);
+	values[2].Value.bin.lpb = bytes;
+
+	/* TaggedPropertyValue array in a request */
+	memset(&request, 0, sizeof (request));
+	request.RopId = 0x0A;
+	request.InputHandleIndex = 1;
+	request.PropertyValueSize = sizeof (wire) - 5;
+	request.PropertyValueCount = 3;
+	request.PropertyValues = values;
+	fail_if(mapirops_push_struct_RopSetProperties_request(push, &request) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != sizeof (wire));
+	fail_if(memcmp(push->data.data, wire, sizeof (wire)));
+
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	memset(&request_out, 0, sizeof (request_out));
+	fail_if(mapirops_pull_struct_RopSetProperties_request(pull, &request_out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(pull->offset != sizeof (wire));
+	fail_if(request_out.PropertyValueCount != 3);
+	fail_if(request_out.PropertyValues[0].PropertyTag != 0x36070003);
+	fail_if(request_out.PropertyValues[0].Value.l != 0x12345678);
+	fail_if(strcmp(request_out.PropertyValues[1].Value.lpszW, "In"));
+	fail_if(request_out.PropertyValues[2].Value.bin.cb != 2);
+	fail_if(memcmp(request_out.PropertyValues[2].Value.bin.lpb, bytes, 2));
+
+	/* Last value truncated */
+	pull->data.length = sizeof (wire) - 1;
+	pull->offset = 0;
+	fail_if(mapirops_pull_struct_RopSetProperties_request(pull, &request_out) != MAPIROPS_ERR_BUFSIZE);
+
+	/* TaggedPropertyValue array in a response */
+	push->offset = 0;
+	memset(&response, 0, sizeof (response));
+	response.RopId = 0x08;
+	response.InputHandleIndex = 1;
+	response.ReturnValue = ecNone;
+	response.ResponseType.success.PropertyValueCount = 2;
+	response.ResponseType.success.PropertyValues = values + 1;
+	fail_if(mapirops_push_struct_RopGetPropertiesAll_response(push, &response) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != 8 + 10 + 8);
+	fail_if(memcmp(push->data.data + 8, wire + 15, 18));
+
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	pull->offset = 0;
+	memset(&response_out, 0, sizeof (response_out));
+	fail_if(mapirops_pull_struct_RopGetPropertiesAll_response(pull, &response_out) != MAPIROPS_ERR_SUCCESS);
+	fail_if(pull->offset != push->offset);
+	fail_if(response_out.ResponseType.success.PropertyValueCount != 2);
+	fail_if(response_out.ResponseType.success.PropertyValues[0].PropertyTag != 0x3001001F);
+	fail_if(response_out.ResponseType.success.PropertyValues[1].Value.bin.lpb[1] != 0xAD);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_PropertyRowSet_columns)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_push		*push;
+	struct mapirops_pull		*pull;
+	struct mapirops_rowset		*rowset;
+	struct mapirops_rowset_column	*column;
+	PropertyValue			value;
+	uint32_t			tags[4] = { 0x3001001F, 0x67480014, 0x36020003, 0x0FFF0102 };
+	uint32_t			bad[2] = { 0x3001001F, 0x6801101F };
+	const char			*names[3] = { "Inbox", "", "Calendar" };
+	uint32_t			row;
+	uint32_t			i;
+
+	mem_ctx = talloc_named(NULL, 0, "test_PropertyRowSet_columns");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	pull = mapirops_pull_init(mem_ctx);
+	fail_if(pull == NULL);
+
+	/* Row 1 is flagged: no display name and an error for the count */
+	for (row = 0; row < 3; row++) {
+		fail_if(mapirops_push_uint8(push, row == 1 ? PROPERTY_ROW_FLAGGED : PROPERTY_ROW_STANDARD));
+		for (i = 0; i < 4; i++) {
+			if (row == 1 && i == 0) {
+				fail_if(mapirops_push_uint8(push, 0x1));
+				continue;
+			}
+			if (row == 1 && i == 2) {
+				fail_if(mapirops_push_uint8(push, 0xA));
+				fail_if(mapirops_push_uint32(push, MAPI_E_NOT_FOUND));
+				continue;
+			}
+			if (row == 1) {
+				fail_if(mapirops_push_uint8(push, 0x0));
+			}
+			switch (i) {
+			case 0:
+				value.lpszW = (char *)names[row];
+				break;
+			case 1:
+				value.d = 0x0100000000000001ULL + row;
+				break;
+			case 2:
+				value.l = 10 * row;
+				break;
+			case 3:
+				value.bin.cb = row;
+				value.bin.lpb = (uint8_t *)"xy";
+				break;
+			}
+			fail_if(mapirops_push_PropertyValue(push, PROP_TYPE(tags[i]), &value));
+		}
+	}
+
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	fail_if(mapirops_pull_PropertyRowSet_columns(pull, mem_ctx, tags, 4, 3, &rowset) != MAPIROPS_ERR_SUCCESS);
+	fail_if(pull->offset != push->offset);
+	fail_if(rowset->row_count != 3 || rowset->column_count != 4);
+
+	column = &rowset->columns[0];
+	fail_if(column->size != 0);
+	fail_if(strcmp((char *)rowset->blob + column->cells[0].offset, "Inbox"));
+	fail_if(column->cells[0].length != 5);
+	fail_if(strcmp((char *)rowset->blob + column->cells[2].offset, "Calendar"));
+	fail_if(MAPIROPS_ROWSET_BIT(column->null, 0) || !MAPIROPS_ROWSET_BIT(column->null, 1));
+	fail_if(column->cells[1].length != 0);
+
+	column = &rowset->columns[1];
+	fail_if(column->size != 8);
+	for (row = 0; row < 3; row++) {
+		memcpy(&value.d, column->values + row * 8, 8);
+		fail_if(value.d != 0x0100000000000001ULL + row);
+	}
+
+	column = &rowset->columns[2];
+	fail_if(IVAL(column->values, 8) != 20);
+	fail_if(!MAPIROPS_ROWSET_BIT(column->error, 1) || MAPIROPS_ROWSET_BIT(column->error, 2));
+	fail_if(column->errors == NULL || column->errors[1] != MAPI_E_NOT_FOUND);
+	fail_if(rowset->columns[0].errors != NULL);
+
+	column = &rowset->columns[3];
+	fail_if(column->cells[0].length != 0);
+	fail_if(column->cells[2].length != 2);
+	fail_if(memcmp(rowset->blob + column->cells[2].offset, "xy", 2));
+
+	/* Multiple-valued columns are rejected */
+	pull->offset = 0;
+	fail_if(mapirops_pull_PropertyRowSet_columns(pull, mem_ctx, bad, 2, 3, &rowset) != MAPIROPS_ERR_INVALID_VAL);
+
+	/* More rows than bytes */
+	pull->offset = 0;
+	fail_if(mapirops_pull_PropertyRowSet_columns(pull, mem_ctx, tags, 4, 100, &rowset) != MAPIROPS_ERR_BUFSIZE);
+
+	/* Invalid row flag */
+	pull->offset = 0;
+	push->data.data[0] = 0x2;
+	fail_if(mapirops_pull_PropertyRowSet_columns(pull, mem_ctx, tags, 4, 3, &rowset) != MAPIROPS_ERR_INVALID_VAL);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+Suite *property_suite(void)
+{
+	Suite	*s;
+	TCase	*tc;
+
+	s = suite_create("MAPIROPS property values");
+	tc = tcase_create("[MS-OXCDATA] 2.11");
+	suite_add_tcase(s, tc);
+	tcase_add_test(tc, test_PropertyValue_fixed);
+	tcase_add_test(tc, test_PropertyValue_variable);
+	tcase_add_test(tc, test_PropertyValue_mv);
+	tcase_add_test(tc, test_PropertyValue_invalid);
+	tcase_add_test(tc, test_PropertyValue_rops);
+	tcase_add_test(tc, test_PropertyRowSet_columns);
+
+	return s;
+}
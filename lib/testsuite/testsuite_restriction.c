@@ -0,0 +1,235 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testsuite.h"
+
+START_TEST (test_restriction_tree)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_push		*push;
+	struct mapirops_pull		*pull;
+	struct mapirops_restriction	*r;
+	const uint8_t			wire[] = {
+		0x00, 0x05, 0x00,
+		0x01, 0x02, 0x00,
+		0x04, 0x04, 0x1F, 0x00, 0x37, 0x00, 0x1F, 0x00, 0x37, 0x00,
+		0x48, 0x00, 0x69, 0x00, 0x00, 0x00,
+		0x08, 0x0B, 0x00, 0x1B, 0x0E,
+		0x02,
+		0x0A, 0x01, 0x03, 0x00, 0x07, 0x36, 0x2A, 0x00, 0x00, 0x00, 0x01,
+		0x03, 0x01, 0x00, 0x00, 0x00, 0x1E, 0x00, 0x37, 0x00, 0x1E, 0x00, 0x37, 0x00,
+		0x61, 0x62, 0x00,
+		0x0B, 0x0A, 0x00, 0x00, 0x00,
+		0x06, 0x01, 0x03, 0x00, 0x07, 0x0E, 0x02, 0x00, 0x00, 0x00,
+		0x09, 0x0D, 0x00, 0x13, 0x0E,
+		0x07, 0x02, 0x03, 0x00, 0x08, 0x0E, 0x00, 0x10, 0x00, 0x00,
+		0x05, 0x04, 0x03, 0x00, 0x07, 0x0E, 0x03, 0x00, 0x08, 0x0E
+	};
+	const uint8_t			types[] = {
+		RES_AND, RES_OR, RES_PROPERTY, RES_EXIST, RES_NOT, RES_COMMENT,
+		RES_CONTENT, RES_COUNT, RES_BITMASK, RES_SUBRESTRICTION, RES_SIZE,
+		RES_COMPAREPROPS
+	};
+	const uint32_t			ends[] = { 12, 4, 3, 4, 7, 7, 7, 9, 9, 11, 11, 12 };
+	uint32_t			i;
+
+	mem_ctx = talloc_named(NULL, 0, "test_restriction_tree");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	pull = mapirops_pull_init(mem_ctx);
+	fail_if(pull == NULL);
+
+	pull->data.data = (uint8_t *) wire;
+	pull->data.length = sizeof (wire);
+	fail_if(mapirops_pull_restriction(pull, mem_ctx, 0, 0, &r) != MAPIROPS_ERR_SUCCESS);
+	fail_if(pull->offset != sizeof (wire));
+	fail_if(r->node_count != 12);
+	fail_if(r->depth != 4);
+	for (i = 0; i < r->node_count; i++) {
+		fail_if(r->nodes[i].RestrictType != types[i]);
+		fail_if(r->nodes[i].end != ends[i]);
+	}
+	fail_if(r->nodes[0].children != 5);
+	fail_if(strcmp(r->nodes[2].u.Property.TaggedValue.Value.lpszW, "Hi"));
+	fail_if(r->nodes[5].u.Comment.TaggedValuesCount != 1);
+	fail_if(r->nodes[5].u.Comment.TaggedValues[0].Value.l != 42);
+	fail_if(r->nodes[6].u.Content.FuzzyLevelLow != 1);
+	fail_if(strcmp(r->nodes[6].u.Content.TaggedValue.Value.lpszA, "ab"));
+	fail_if(r->nodes[7].u.Count.Count != 10);
+	fail_if(r->nodes[8].u.Bitmask.Mask != 2);
+	fail_if(r->nodes[10].u.Size.Size != 0x1000);
+	fail_if(r->nodes[11].u.CompareProps.PropTag2 != 0x0E080003);
+
+	fail_if(mapirops_push_restriction(push, r) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != sizeof (wire));
+	fail_if(memcmp(push->data.data, wire, sizeof (wire)));
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_restriction_limits)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_push		*push;
+	struct mapirops_pull		*pull;
+	struct mapirops_restriction	*r;
+	uint8_t				*wire;
+	const uint32_t			count = 100000;
+	uint32_t			i;
+
+	mem_ctx = talloc_named(NULL, 0, "test_restriction_limits");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	pull = mapirops_pull_init(mem_ctx);
+	fail_if(pull == NULL);
+
+	/* count nested Not restrictions around an Exist restriction */
+	wire = talloc_array(mem_ctx, uint8_t, count + 5);
+	fail_if(wire == NULL);
+	memset(wire, RES_NOT, count);
+	wire[count] = RES_EXIST;
+	SIVAL(wire, count + 1, 0x0E1B000B);
+	pull->data.data = wire;
+	pull->data.length = count + 5;
+
+	fail_if(mapirops_pull_restriction(pull, mem_ctx, 0, 0, &r) != MAPIROPS_ERR_INVALID_VAL);
+
+	pull->offset = 0;
+	fail_if(mapirops_pull_restriction(pull, mem_ctx, count + 1, count + 1, &r) != MAPIROPS_ERR_SUCCESS);
+	fail_if(r->node_count != count + 1);
+	fail_if(r->depth != count + 1);
+	fail_if(r->nodes[0].end != count + 1);
+	fail_if(r->nodes[count].u.Exist.PropTag != 0x0E1B000B);
+
+	fail_if(mapirops_push_restriction(push, r) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != count + 5);
+	fail_if(memcmp(push->data.data, wire, count + 5));
+
+	/* One level short */
+	pull->offset = 0;
+	fail_if(mapirops_pull_restriction(pull, mem_ctx, count, 0xFFFFFFFF, &r) != MAPIROPS_ERR_INVALID_VAL);
+
+	/* Flat Or restriction with more children than allowed nodes */
+	wire[0] = RES_OR;
+	SSVAL(wire, 1, 2000);
+	for (i = 0; i < 2000; i++) {
+		wire[3 + i * 5] = RES_EXIST;
+		SIVAL(wire, 4 + i * 5, 0x0E1B000B);
+	}
+	pull->data.length = 3 + 2000 * 5;
+	pull->offset = 0;
+	fail_if(mapirops_pull_restriction(pull, mem_ctx, 0, 1000, &r) != MAPIROPS_ERR_INVALID_VAL);
+	pull->offset = 0;
+	fail_if(mapirops_pull_restriction(pull, mem_ctx, 0, 2001, &r) != MAPIROPS_ERR_SUCCESS);
+	fail_if(r->depth != 2);
+	fail_if(r->nodes[2000].end != 2001);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_restriction_invalid)
+{
+	TALLOC_CTX				*mem_ctx;
+	struct mapirops_push			*push;
+	struct mapirops_pull			*pull;
+	struct mapirops_restriction		*r;
+	struct mapirops_restriction		tree;
+	struct mapirops_restriction_node	nodes[3];
+	uint8_t					wire[16];
+
+	mem_ctx = talloc_named(NULL, 0, "test_restriction_invalid");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	pull = mapirops_pull_init(mem_ctx);
+	fail_if(pull == NULL);
+	pull->data.data = wire;
+
+	/* Unknown restriction type */
+	wire[0] = 0x0C;
+	pull->data.length = 1;
+	fail_if(mapirops_pull_restriction(pull, mem_ctx, 0, 0, &r) != MAPIROPS_ERR_INVALID_VAL);
+
+	/* And restriction announcing more children than bytes left */
+	wire[0] = RES_AND;
+	SSVAL(wire, 1, 0xFFFF);
+	wire[3] = RES_NOT;
+	pull->data.length = 4;
+	pull->offset = 0;
+	fail_if(mapirops_pull_restriction(pull, mem_ctx, 0, 0, &r) != MAPIROPS_ERR_BUFSIZE);
+
+	/* Truncated subtree */
+	SSVAL(wire, 1, 1);
+	pull->offset = 0;
+	fail_if(mapirops_pull_restriction(pull, mem_ctx, 0, 0, &r) != MAPIROPS_ERR_BUFSIZE);
+
+	/* RestrictionPresent neither TRUE nor FALSE */
+	wire[0] = RES_COMMENT;
+	wire[1] = 0;
+	wire[2] = 2;
+	pull->data.length = 3;
+	pull->offset = 0;
+	fail_if(mapirops_pull_restriction(pull, mem_ctx, 0, 0, &r) != MAPIROPS_ERR_INVALID_VAL);
+
+	/* Children counts not matching the node array */
+	memset(nodes, 0, sizeof (nodes));
+	nodes[0].RestrictType = RES_AND;
+	nodes[0].children = 3;
+	nodes[1].RestrictType = RES_EXIST;
+	nodes[2].RestrictType = RES_EXIST;
+	tree.nodes = nodes;
+	tree.node_count = 3;
+	fail_if(mapirops_push_restriction(push, &tree) != MAPIROPS_ERR_INVALID_VAL);
+	nodes[0].children = 1;
+	fail_if(mapirops_push_restriction(push, &tree) != MAPIROPS_ERR_INVALID_VAL);
+
+	/* Not restriction without child */
+	nodes[0].RestrictType = RES_NOT;
+	nodes[0].children = 0;
+	tree.node_count = 1;
+	fail_if(mapirops_push_restriction(push, &tree) != MAPIROPS_ERR_INVALID_VAL);
+	fail_if(push->offset != 0);
+
+	nodes[0].children = 1;
+	tree.node_count = 2;
+	fail_if(mapirops_push_restriction(push, &tree) != MAPIROPS_ERR_SUCCESS);
+	fail_if(push->offset != 6);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+Suite *restriction_suite(void)
+{
+	Suite	*s;
+	TCase	*tc;
+
+	s = suite_create("MAPIROPS Restriction");
+	tc = tcase_create("[MS-OXCDATA] 2.12");
+	suite_add_tcase(s, tc);
+	tcase_add_test(tc, test_restriction_tree);
+	tcase_add_test(tc, test_restriction_limits);
+	tcase_add_test(tc, test_restriction_invalid);
+
+	return s;
+}
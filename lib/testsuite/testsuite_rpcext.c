@@ -0,0 +1,202 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testsuite.h"
+
+START_TEST (test_rpcext_xor)
+{
+	uint8_t		data[200];
+	uint8_t		ref[200];
+	size_t		length;
+	size_t		i;
+
+	/* Cover the vector loops, the tail and unaligned starts */
+	for (length = 0; length < sizeof (data) - 3; length++) {
+		for (i = 0; i < sizeof (data); i++) {
+			data[i] = ref[i] = (uint8_t)(i * 7 + length);
+		}
+		for (i = 0; i < length; i++) {
+			ref[i + 3] ^= 0xA5;
+		}
+		mapirops_rpcext_xor(data + 3, length);
+		fail_if(memcmp(data, ref, sizeof (data)));
+	}
+}
+END_TEST
+
+START_TEST (test_rpcext_chain)
+{
+	TALLOC_CTX			*mem_ctx;
+	enum mapirops_err_code		errval;
+	struct mapirops_push		*push;
+	struct mapirops_pull		pull;
+	struct mapirops_rpcext_frame	frame;
+	struct mapirops_rpcext_iter	iter;
+	struct mapibuf			data;
+	uint32_t			i;
+	uint32_t			value;
+
+	mem_ctx = talloc_named(NULL, 0, "test_rpcext_chain");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+
+	/* Compressible, obfuscated */
+	fail_if(mapirops_rpcext_push_begin(push, &frame) != MAPIROPS_ERR_SUCCESS);
+	for (i = 0; i < 256; i++) {
+		fail_if(mapirops_push_uint32(push, 0x1234) != MAPIROPS_ERR_SUCCESS);
+	}
+	errval = mapirops_rpcext_push_end(push, &frame, RHEF_Compressed|RHEF_XorMagic);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(SVAL(push->data.data, 2) != (RHEF_Compressed|RHEF_XorMagic));
+	fail_if(SVAL(push->data.data, 4) >= 1024);
+	fail_if(SVAL(push->data.data, 6) != 1024);
+
+	/* Not worth compressing: sent as is */
+	fail_if(mapirops_rpcext_push_begin(push, &frame) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_uint32(push, 0xCAFEBABE) != MAPIROPS_ERR_SUCCESS);
+	errval = mapirops_rpcext_push_end(push, &frame, RHEF_Compressed|RHEF_Last);
+	fail_if(errval != MAPIROPS_ERR_SUCCESS);
+	fail_if(SVAL(push->data.data, frame.header + 2) != RHEF_Last);
+	fail_if(SVAL(push->data.data, frame.header + 4) != 4);
+	fail_if(push->offset != frame.header + MAPIROPS_RPCEXT_HEADER_SIZE + 4);
+	fail_if(push->limit != 0);
+
+	data.data = push->data.data;
+	data.length = push->offset;
+	fail_if(mapirops_rpcext_pull_init(&iter, mem_ctx, &data) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_pull_cursor_init(&pull, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+
+	fail_if(mapirops_rpcext_pull_next(&iter, &pull) != MAPIROPS_ERR_SUCCESS);
+	fail_if(pull.data.length != 1024);
+	for (i = 0; i < 256; i++) {
+		fail_if(mapirops_pull_uint32(&pull, &value) != MAPIROPS_ERR_SUCCESS);
+		fail_if(value != 0x1234);
+	}
+
+	fail_if(mapirops_rpcext_pull_next(&iter, &pull) != MAPIROPS_ERR_SUCCESS);
+	fail_if(pull.data.length != 4);
+	fail_if(mapirops_pull_uint32(&pull, &value) != MAPIROPS_ERR_SUCCESS);
+	fail_if(value != 0xCAFEBABE);
+
+	fail_if(mapirops_rpcext_pull_next(&iter, &pull) != MAPIROPS_ERR_NOT_FOUND);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_rpcext_limit)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_push		*push;
+	struct mapirops_rpcext_frame	frame;
+	uint32_t			savepoint;
+	uint32_t			count;
+	uint8_t				bytes[1000];
+
+	mem_ctx = talloc_named(NULL, 0, "test_rpcext_limit");
+	fail_if(mem_ctx == NULL);
+	push = mapirops_push_init(mem_ctx);
+	fail_if(push == NULL);
+	memset(bytes, 0x42, sizeof (bytes));
+
+	/* Fill the extended buffer until the next ROP doesn't fit */
+	fail_if(mapirops_rpcext_push_begin(push, &frame) != MAPIROPS_ERR_SUCCESS);
+	for (count = 0;; count++) {
+		savepoint = mapirops_push_savepoint(push);
+		if (mapirops_push_bytes(push, bytes, sizeof (bytes)) != MAPIROPS_ERR_SUCCESS) {
+			fail_if(mapirops_push_rollback(push, savepoint) != MAPIROPS_ERR_SUCCESS);
+			break;
+		}
+	}
+	fail_if(count != MAPIROPS_RPCEXT_MAX_PAYLOAD / sizeof (bytes));
+	fail_if(mapirops_rpcext_push_end(push, &frame, RHEF_Last) != MAPIROPS_ERR_SUCCESS);
+	fail_if(SVAL(push->data.data, 4) != count * sizeof (bytes));
+
+	/* The outer limit is restored and still applies */
+	fail_if(mapirops_push_set_limit(push, push->offset + MAPIROPS_RPCEXT_HEADER_SIZE + 10) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_rpcext_push_begin(push, &frame) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_bytes(push, bytes, 11) != MAPIROPS_ERR_BUFFER_TOO_SMALL);
+	fail_if(mapirops_push_bytes(push, bytes, 10) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_rpcext_push_end(push, &frame, RHEF_Last) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_rpcext_push_begin(push, &frame) != MAPIROPS_ERR_BUFFER_TOO_SMALL);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_rpcext_invalid)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_pull		pull;
+	struct mapirops_rpcext_iter	iter;
+	struct mapibuf			data;
+	uint8_t				bytes[12];
+
+	mem_ctx = talloc_named(NULL, 0, "test_rpcext_invalid");
+	fail_if(mem_ctx == NULL);
+	data.data = bytes;
+	data.length = sizeof (bytes);
+	fail_if(mapirops_pull_cursor_init(&pull, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+
+	/* Size past the end of the buffer */
+	memset(bytes, 0, sizeof (bytes));
+	SSVAL(bytes, 2, RHEF_Last);
+	SSVAL(bytes, 4, 5);
+	SSVAL(bytes, 6, 5);
+	fail_if(mapirops_rpcext_pull_init(&iter, mem_ctx, &data) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_rpcext_pull_next(&iter, &pull) != MAPIROPS_ERR_BUFSIZE);
+
+	/* Size and SizeActual mismatch without compression */
+	SSVAL(bytes, 4, 4);
+	fail_if(mapirops_rpcext_pull_init(&iter, mem_ctx, &data) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_rpcext_pull_next(&iter, &pull) != MAPIROPS_ERR_INVALID_VAL);
+
+	/* Unknown Version */
+	SSVAL(bytes, 0, 1);
+	SSVAL(bytes, 6, 4);
+	fail_if(mapirops_rpcext_pull_init(&iter, mem_ctx, &data) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_rpcext_pull_next(&iter, &pull) != MAPIROPS_ERR_INVALID_VAL);
+
+	/* Chain ending without Last */
+	SSVAL(bytes, 0, 0);
+	SSVAL(bytes, 2, 0);
+	fail_if(mapirops_rpcext_pull_init(&iter, mem_ctx, &data) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_rpcext_pull_next(&iter, &pull) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_rpcext_pull_next(&iter, &pull) != MAPIROPS_ERR_INVALID_VAL);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+Suite *rpcext_suite(void)
+{
+	Suite	*s;
+	TCase	*tc;
+
+	s = suite_create("MAPIROPS RPC_HEADER_EXT");
+	tc = tcase_create("[MS-OXCRPC] 2.2.2.1");
+	suite_add_tcase(s, tc);
+	tcase_add_test(tc, test_rpcext_xor);
+	tcase_add_test(tc, test_rpcext_chain);
+	tcase_add_test(tc, test_rpcext_limit);
+	tcase_add_test(tc, test_rpcext_invalid);
+
+	return s;
+}
@@ -0,0 +1,197 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "testsuite.h"
+
+#include <unistd.h>
+
+#define	STATS_THREADS	4
+#define	STATS_CALLS	1000
+
+START_TEST (test_stats_codecs)
+{
+	TALLOC_CTX					*mem_ctx;
+	struct mapirops_push				*push;
+	struct mapirops_pull				*pull;
+	struct mapirops_stats				*stats;
+	struct mapirops_stats_reader			*reader;
+	struct mapirops_stats_counters			counters;
+	struct mapirops_ropbuf_frame			frame;
+	struct mapirops_ropbuf				ropbuf;
+	struct RopGetNamesFromPropertyIds_request	request;
+	uint16_t					ids[1] = { 0x8501 };
+	uint32_t					threads;
+	uint64_t					expected;
+	char						*str;
+	char						path[32];
+
+	COMMON_TEST_START(stats_codecs);
+	testsuite_tmpfile(path, sizeof (path), "stats");
+
+#ifdef MAPIROPS_ENABLE_STATS
+	expected = 1;
+#else
+	expected = 0;
+#endif
+
+	stats = mapirops_stats_init(mem_ctx, path, 0);
+	fail_if(stats == NULL);
+	reader = mapirops_stats_reader_init(mem_ctx, path);
+	fail_if(reader == NULL);
+	fail_if(mapirops_stats_read(reader, &counters, &threads) != MAPIROPS_ERR_SUCCESS);
+	fail_if(threads != 0 || counters.bytes[MAPIROPS_STATS_PULL] != 0);
+	fail_if(mapirops_push_set_stats(push, stats) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_pull_set_stats(pull, stats) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_pull_set_stats(NULL, stats) != MAPIROPS_ERR_INVALID_VAL);
+
+	memset(&request, 0, sizeof (request));
+	request.RopId = RopGetNamesFromPropertyIds;
+	request.PropertyIdCount = 1;
+	request.PropertyIds = ids;
+	fail_if(mapirops_ropbuf_push_begin(push, &frame) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_push_struct_RopGetNamesFromPropertyIds_request(push, &request) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_ropbuf_push_end(push, &frame, NULL, 0) != MAPIROPS_ERR_SUCCESS);
+
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	fail_if(mapirops_ropbuf_pull(pull, &ropbuf) != MAPIROPS_ERR_SUCCESS);
+	pull->data = ropbuf.rops;
+	pull->offset = 0;
+	fail_if(mapirops_pull_struct_RopGetNamesFromPropertyIds_request(pull, &request) != MAPIROPS_ERR_SUCCESS);
+
+	/* Failed codecs are counted with their error */
+	pull->offset = 0;
+	pull->data.length--;
+	fail_if(mapirops_pull_struct_RopGetNamesFromPropertyIds_request(pull, &request) != MAPIROPS_ERR_BUFSIZE);
+
+	/* Pulled strings are allocations */
+	pull->data.data = (uint8_t *) "IPM.Note";
+	pull->data.length = 9;
+	pull->offset = 0;
+	fail_if(mapirops_pull_ascii_string(pull, mem_ctx, MAPIROPS_STR_NOSIZE, &str, 0) != MAPIROPS_ERR_SUCCESS);
+
+	fail_if(mapirops_stats_read(reader, &counters, &threads) != MAPIROPS_ERR_SUCCESS);
+	fail_if(threads != 1);
+	fail_if(counters.bytes[MAPIROPS_STATS_PUSH] != push->offset);
+	fail_if(counters.bytes[MAPIROPS_STATS_PULL] != push->offset);
+	fail_if(counters.rops[MAPIROPS_STATS_PUSH][RopGetNamesFromPropertyIds] != expected);
+	fail_if(counters.rops[MAPIROPS_STATS_PULL][RopGetNamesFromPropertyIds] != 2 * expected);
+	fail_if(counters.errors[MAPIROPS_ERR_BUFSIZE] != expected);
+	fail_if(counters.errors[MAPIROPS_ERR_SUCCESS] != 0);
+	fail_if(counters.allocs < 1);
+
+	/* Counters are left in place for the monitoring tools */
+	talloc_free(stats);
+	talloc_free(reader);
+	reader = mapirops_stats_reader_init(mem_ctx, path);
+	fail_if(reader == NULL);
+	fail_if(mapirops_stats_read(reader, &counters, NULL) != MAPIROPS_ERR_SUCCESS);
+	fail_if(counters.bytes[MAPIROPS_STATS_PUSH] != push->offset);
+	talloc_free(reader);
+
+	/* Not a statistics file */
+	fail_if(truncate(path, 4) != 0);
+	fail_if(mapirops_stats_reader_init(mem_ctx, path) != NULL);
+
+	unlink(path);
+	COMMON_TEST_END();
+}
+END_TEST
+
+/* Count STATS_CALLS pulls of RopGetNamesFromPropertyIds */
+static void *stats_thread(void *data)
+{
+	struct mapirops_stats	*stats = (struct mapirops_stats *) data;
+	uint32_t		i;
+
+	for (i = 0; i < STATS_CALLS; i++) {
+		mapirops_stats_rop(stats, MAPIROPS_STATS_PULL, RopGetNamesFromPropertyIds,
+				   (i % 10) ? MAPIROPS_ERR_SUCCESS : MAPIROPS_ERR_INVALID_VAL);
+	}
+
+	return NULL;
+}
+
+START_TEST (test_stats_threads)
+{
+	TALLOC_CTX			*mem_ctx;
+	struct mapirops_stats		*stats;
+	struct mapirops_stats_reader	*reader;
+	struct mapirops_stats_counters	counters;
+	struct testsuite_threads	threads;
+	uint64_t			previous;
+	uint32_t			used;
+	uint32_t			claimed;
+	uint32_t			i;
+	char				path[32];
+
+	mem_ctx = talloc_named(NULL, 0, "test_stats_threads");
+	fail_if(mem_ctx == NULL);
+	testsuite_tmpfile(path, sizeof (path), "stats");
+
+	stats = mapirops_stats_init(mem_ctx, path, STATS_THREADS + 1);
+	fail_if(stats == NULL);
+	reader = mapirops_stats_reader_init(mem_ctx, path);
+	fail_if(reader == NULL);
+
+	testsuite_threads_start(&threads, STATS_THREADS, stats_thread, stats, 0);
+	/* Read while threads are counting: counters never go back */
+	previous = 0;
+	for (i = 0; i < 100; i++) {
+		fail_if(mapirops_stats_read(reader, &counters, &used) != MAPIROPS_ERR_SUCCESS);
+		fail_if(used > STATS_THREADS);
+		fail_if(counters.rops[MAPIROPS_STATS_PULL][RopGetNamesFromPropertyIds] < previous);
+		fail_if(counters.rops[MAPIROPS_STATS_PULL][RopGetNamesFromPropertyIds] > STATS_THREADS * STATS_CALLS);
+		previous = counters.rops[MAPIROPS_STATS_PULL][RopGetNamesFromPropertyIds];
+	}
+	testsuite_threads_join(&threads);
+
+	/* Threads may exit before the others start */
+	fail_if(mapirops_stats_read(reader, &counters, &claimed) != MAPIROPS_ERR_SUCCESS);
+	fail_if(claimed < 1 || claimed > STATS_THREADS);
+	fail_if(counters.rops[MAPIROPS_STATS_PULL][RopGetNamesFromPropertyIds] != STATS_THREADS * STATS_CALLS);
+	fail_if(counters.errors[MAPIROPS_ERR_INVALID_VAL] != STATS_THREADS * STATS_CALLS / 10);
+
+	/* New threads take over the blocks of the exited ones */
+	testsuite_threads_start(&threads, 1, stats_thread, stats, 0);
+	testsuite_threads_join(&threads);
+	fail_if(mapirops_stats_read(reader, &counters, &used) != MAPIROPS_ERR_SUCCESS);
+	fail_if(used != claimed);
+	fail_if(counters.rops[MAPIROPS_STATS_PULL][RopGetNamesFromPropertyIds] != (STATS_THREADS + 1) * STATS_CALLS);
+
+	talloc_free(mem_ctx);
+	unlink(path);
+}
+END_TEST
+
+Suite *stats_suite(void)
+{
+	Suite	*s;
+	TCase	*tc;
+
+	s = suite_create("MAPIROPS statistics");
+	tc = tcase_create("[OC-STATS]");
+	suite_add_tcase(s, tc);
+	tcase_add_test(tc, test_stats_codecs);
+	tcase_add_test(tc, test_stats_threads);
+
+	return s;
+}
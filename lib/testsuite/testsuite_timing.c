@@ -0,0 +1,185 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "testsuite.h"
+
+#define	TIMING_THREADS	4
+#define	TIMING_CALLS	1000
+#define	TIMING_1MS	1000000
+
+/* Latency within the error of the histogram, plus scheduling noise */
+#define	TIMING_NEAR(v, ns)	((v) >= (ns) && (v) <= (ns) + (ns) / 8 + TIMING_1MS / 2)
+
+START_TEST (test_timing_histogram)
+{
+	TALLOC_CTX				*mem_ctx;
+	struct mapirops_timing			*timing;
+	struct mapirops_timing_histogram	histogram;
+	struct mapirops_timing_summary		*summary;
+	uint32_t				count;
+	uint32_t				i;
+
+	mem_ctx = talloc_named(NULL, 0, "test_timing_histogram");
+	fail_if(mem_ctx == NULL);
+	timing = mapirops_timing_init(mem_ctx);
+	fail_if(timing == NULL);
+
+	fail_if(mapirops_timing_merge(timing, MAPIROPS_TIMING_PULL, RopLogon, &histogram) != MAPIROPS_ERR_SUCCESS);
+	fail_if(histogram.count != 0);
+	fail_if(mapirops_timing_percentile(&histogram, 0.5) != 0);
+
+	for (i = 0; i < TIMING_CALLS; i++) {
+		mapirops_timing_stop(timing, MAPIROPS_TIMING_PULL, RopLogon, mapirops_timing_start() - TIMING_1MS);
+	}
+	mapirops_timing_stop(timing, MAPIROPS_TIMING_PULL, RopLogon, mapirops_timing_start() - 100 * TIMING_1MS);
+	mapirops_timing_stop(timing, MAPIROPS_TIMING_PUSH, RopRelease, mapirops_timing_start());
+
+	fail_if(mapirops_timing_merge(timing, MAPIROPS_TIMING_PULL, RopLogon, &histogram) != MAPIROPS_ERR_SUCCESS);
+	fail_if(histogram.count != TIMING_CALLS + 1);
+	fail_if(!TIMING_NEAR(histogram.max, 100 * TIMING_1MS));
+	fail_if(!TIMING_NEAR(mapirops_timing_percentile(&histogram, 0.5), TIMING_1MS));
+	fail_if(!TIMING_NEAR(mapirops_timing_percentile(&histogram, 0.999), TIMING_1MS));
+	fail_if(mapirops_timing_percentile(&histogram, 1.0) != histogram.max);
+	fail_if(mapirops_timing_merge(timing, 2, RopLogon, &histogram) != MAPIROPS_ERR_INVALID_VAL);
+
+	fail_if(mapirops_timing_export(timing, mem_ctx, &summary, &count) != MAPIROPS_ERR_SUCCESS);
+	fail_if(count != 2);
+	fail_if(summary[0].direction != MAPIROPS_TIMING_PULL || summary[0].RopId != RopLogon);
+	fail_if(summary[0].count != TIMING_CALLS + 1);
+	fail_if(!TIMING_NEAR(summary[0].p99, TIMING_1MS));
+	fail_if(summary[0].mean < TIMING_1MS + 99 * TIMING_1MS / (TIMING_CALLS + 1));
+	fail_if(summary[1].direction != MAPIROPS_TIMING_PUSH || summary[1].RopId != RopRelease);
+	fail_if(summary[1].count != 1);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+/* Record TIMING_CALLS pulls of RopGetNamesFromPropertyIds */
+static void *timing_thread(void *data)
+{
+	struct mapirops_timing	*timing = (struct mapirops_timing *) data;
+	uint32_t		i;
+
+	for (i = 0; i < TIMING_CALLS; i++) {
+		mapirops_timing_stop(timing, MAPIROPS_TIMING_PULL, RopGetNamesFromPropertyIds, mapirops_timing_start());
+	}
+
+	return NULL;
+}
+
+START_TEST (test_timing_threads)
+{
+	TALLOC_CTX				*mem_ctx;
+	struct mapirops_timing			*timing;
+	struct mapirops_timing_histogram	histogram;
+	struct testsuite_threads		threads;
+
+	mem_ctx = talloc_named(NULL, 0, "test_timing_threads");
+	fail_if(mem_ctx == NULL);
+	timing = mapirops_timing_init(mem_ctx);
+	fail_if(timing == NULL);
+
+	testsuite_threads_start(&threads, TIMING_THREADS, timing_thread, timing, 0);
+	/* Merge while threads are recording */
+	fail_if(mapirops_timing_merge(timing, MAPIROPS_TIMING_PULL, RopGetNamesFromPropertyIds, &histogram) != MAPIROPS_ERR_SUCCESS);
+	fail_if(histogram.count > TIMING_THREADS * TIMING_CALLS);
+	timing_thread(timing);
+	testsuite_threads_join(&threads);
+
+	/* Exited threads are merged with the live ones */
+	fail_if(mapirops_timing_merge(timing, MAPIROPS_TIMING_PULL, RopGetNamesFromPropertyIds, &histogram) != MAPIROPS_ERR_SUCCESS);
+	fail_if(histogram.count != (TIMING_THREADS + 1) * TIMING_CALLS);
+
+	talloc_free(mem_ctx);
+}
+END_TEST
+
+START_TEST (test_timing_codecs)
+{
+	TALLOC_CTX					*mem_ctx;
+	struct mapirops_push				*push;
+	struct mapirops_pull				*pull;
+	struct mapirops_timing				*timing;
+	struct mapirops_timing_histogram		histogram;
+	struct RopGetNamesFromPropertyIds_request	request;
+	uint16_t					ids[1] = { 0x8501 };
+	uint64_t					expected;
+
+	COMMON_TEST_START(timing_codecs);
+	timing = mapirops_timing_init(mem_ctx);
+	fail_if(timing == NULL);
+	fail_if(mapirops_push_set_timing(push, timing) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_pull_set_timing(pull, timing) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_pull_set_timing(NULL, timing) != MAPIROPS_ERR_INVALID_VAL);
+
+#ifdef MAPIROPS_ENABLE_TIMING
+	expected = 1;
+#else
+	expected = 0;
+#endif
+
+	memset(&request, 0, sizeof (request));
+	request.RopId = RopGetNamesFromPropertyIds;
+	request.PropertyIdCount = 1;
+	request.PropertyIds = ids;
+	fail_if(mapirops_push_struct_RopGetNamesFromPropertyIds_request(push, &request) != MAPIROPS_ERR_SUCCESS);
+	pull->data.data = push->data.data;
+	pull->data.length = push->offset;
+	fail_if(mapirops_pull_struct_RopGetNamesFromPropertyIds_request(pull, &request) != MAPIROPS_ERR_SUCCESS);
+	fail_if(request.PropertyIds[0] != 0x8501);
+
+	/* Failed calls are timed too */
+	pull->offset = 0;
+	pull->data.length--;
+	fail_if(mapirops_pull_struct_RopGetNamesFromPropertyIds_request(pull, &request) == MAPIROPS_ERR_SUCCESS);
+
+	fail_if(mapirops_timing_merge(timing, MAPIROPS_TIMING_PUSH, RopGetNamesFromPropertyIds, &histogram) != MAPIROPS_ERR_SUCCESS);
+	fail_if(histogram.count != expected);
+	fail_if(mapirops_timing_merge(timing, MAPIROPS_TIMING_PULL, RopGetNamesFromPropertyIds, &histogram) != MAPIROPS_ERR_SUCCESS);
+	fail_if(histogram.count != 2 * expected);
+
+	/* Untimed context */
+	fail_if(mapirops_pull_set_timing(pull, NULL) != MAPIROPS_ERR_SUCCESS);
+	pull->offset = 0;
+	pull->data.length++;
+	fail_if(mapirops_pull_struct_RopGetNamesFromPropertyIds_request(pull, &request) != MAPIROPS_ERR_SUCCESS);
+	fail_if(mapirops_timing_merge(timing, MAPIROPS_TIMING_PULL, RopGetNamesFromPropertyIds, &histogram) != MAPIROPS_ERR_SUCCESS);
+	fail_if(histogram.count != 2 * expected);
+
+	COMMON_TEST_END();
+}
+END_TEST
+
+Suite *timing_suite(void)
+{
+	Suite	*s;
+	TCase	*tc;
+
+	s = suite_create("MAPIROPS ROP timing");
+	tc = tcase_create("[OC-TIMING]");
+	suite_add_tcase(s, tc);
+	tcase_add_test(tc, test_timing_histogram);
+	tcase_add_test(tc, test_timing_threads);
+	tcase_add_test(tc, test_timing_codecs);
+
+	return s;
+}
@@ -0,0 +1,58 @@
+/*
+   OpenChange MAPI implementation.
+
+   Copyright (C) The OpenChange Project 2026.
+
+   This program is free software; you can redistribute it and/or modify
+   it under the terms of the GNU General Public License as published by
+   the Free Software Foundation; either version 3 of the License, or
+   (at your option) any later version.
+
+   This program is distributed in the hope that it will be useful,
+   but WITHOUT ANY WARRANTY; without even the implied warranty of
+   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+   GNU General Public License for more details.
+
+   You should have received a copy of the GNU General Public License
+   along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "testsuite.h"
+
+#include <unistd.h>
+
+/* Create an empty temporary file named after the suite */
+void testsuite_tmpfile(char *path, size_t size, const char *name)
+{
+	int	fd;
+
+	fail_if(snprintf(path, size, "/tmp/mapirops_%s_XXXXXX", name) >= (int)size);
+	fd = mkstemp(path);
+	fail_if(fd == -1);
+	close(fd);
+}
+
+/* Start count threads running fn. Thread i is passed data + i * size,
+ * all of them get data when size is 0 */
+void testsuite_threads_start(struct testsuite_threads *threads, uint32_t count,
+			     void *(*fn)(void *), void *data, size_t size)
+{
+	uint32_t	i;
+
+	fail_if(count > TESTSUITE_THREADS_MAX);
+	for (i = 0; i < count; i++) {
+		fail_if(pthread_create(&threads->ids[i], NULL, fn, (uint8_t *)data + i * size) != 0);
+	}
+	threads->count = count;
+}
+
+/* Wait for the threads started with testsuite_threads_start */
+void testsuite_threads_join(struct testsuite_threads *threads)
+{
+	uint32_t	i;
+
+	for (i = 0; i < threads->count; i++) {
+		pthread_join(threads->ids[i], NULL);
+	}
+	threads->count = 0;
+}
@@ -26,8 +26,13 @@
 
 #include "config.h"
 #include "libmapirops.h"
+#include "libmapirops_private.h"
 #include "mapirops_uuid.h"
 
+#ifdef	__SSE2__
+#include <emmintrin.h>
+#endif
+
 /**
    \details Return the number of bytes occupied by a buffer in ASCII
    format. The result includes the null termination limited by 'n'
@@ -65,14 +70,80 @@ size_t mapirops_ascii_len_n(const char *buf, size_t n)
    \return Size of the utf16 buffer
  */
 
+#ifdef	__SSE2__
+/* The aligned loads may read past the termination within its 16 bytes */
+__attribute__((no_sanitize_address))
+#endif
 size_t mapirops_utf16_len(const void *buf)
 {
-	size_t	len;
-
-	for (len = 0; SVAL(buf, len); len += 2);
+	size_t		len = 0;
+#ifdef	__SSE2__
+	const __m128i	zero = _mm_setzero_si128();
+	const uint8_t	*p = (const uint8_t *)buf;
+	int		mask;
+
+	/* Aligned loads never cross a page boundary, but only keep the
+	 * 16-bit units in their lanes if the string is at an even address */
+	if (!((uintptr_t)p & 1)) {
+		for (; ((uintptr_t)(p + len) & 15); len += 2) {
+			if (!SVAL(p, len)) {
+				return len + 2;
+			}
+		}
+		for (;; len += 16) {
+			mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_load_si128((const __m128i *)(p + len)), zero));
+			if (mask) {
+				return len + __builtin_ctz(mask) + 2;
+			}
+		}
+	}
+#endif
+	for (; SVAL(buf, len); len += 2);
 	return len + 2;
 }
 
+/**
+   \details Find the null termination of a CH_UTF16 buffer, looking at
+   the complete 16-bit units of the first n bytes only. The buffer
+   doesn't have to be aligned.
+
+   \param buf the utf16 buffer
+   \param n maximum size
+
+   \return Offset in bytes of the null 16-bit unit, n if there is none
+ */
+size_t mapirops_utf16_scan(const void *buf, size_t n)
+{
+	const uint8_t	*p = (const uint8_t *)buf;
+	size_t		i = 0;
+#ifdef	__SSE2__
+	const __m128i	zero = _mm_setzero_si128();
+	__m128i		a, b;
+	uint32_t	mask;
+
+	for (; i + 32 <= n; i += 32) {
+		a = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(p + i)), zero);
+		b = _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(p + i + 16)), zero);
+		if (_mm_movemask_epi8(_mm_or_si128(a, b))) {
+			mask = _mm_movemask_epi8(a) | ((uint32_t)_mm_movemask_epi8(b) << 16);
+			return i + __builtin_ctz(mask);
+		}
+	}
+	for (; i + 16 <= n; i += 16) {
+		mask = _mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(p + i)), zero));
+		if (mask) {
+			return i + __builtin_ctz(mask);
+		}
+	}
+#endif
+	for (; i + 2 <= n; i += 2) {
+		if (!SVAL(p, i)) {
+			return i;
+		}
+	}
+	return n;
+}
+
 
 /**
    \details Return the number of bytes occupied by a buffer in
@@ -91,9 +162,10 @@ size_t mapirops_utf16_len_n(const void *buf, size_t n)
 {
 	size_t	len;
 
-	for (len = 0; ((len + 2) < n) && SVAL(buf, len); len += 2);
-	if ((len + 2) <= n) {
-		len += 2;
+	len = mapirops_utf16_scan(buf, n);
+	if (len == n) {
+		/* No null termination, whole 16-bit units only */
+		return n & ~(size_t)1;
 	}
-	return len;
+	return len + 2;
 }
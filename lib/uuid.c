@@ -26,80 +26,255 @@
 #include "libmapirops.h"
 #include  "mapirops_uuid.h"
 
+#ifdef	__SSE2__
+#include <emmintrin.h>
+#endif
+
+/** \cond */
+#define	GUID_HEX_INVALID	0x100
+
+/* Value of each hexadecimal digit, GUID_HEX_INVALID otherwise */
+#define	XX	GUID_HEX_INVALID
+static const uint16_t guid_hex_value[256] = {
+	/* 0x00 */	 XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0x10 */	 XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0x20 */	 XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0x30 */	0x0, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0x40 */	 XX, 0xa, 0xb, 0xc, 0xd, 0xe, 0xf,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0x50 */	 XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0x60 */	 XX, 0xa, 0xb, 0xc, 0xd, 0xe, 0xf,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0x70 */	 XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0x80 */	 XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0x90 */	 XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0xA0 */	 XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0xB0 */	 XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0xC0 */	 XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0xD0 */	 XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0xE0 */	 XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,
+	/* 0xF0 */	 XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX,  XX
+};
+#undef	XX
+
+#ifndef	__SSE2__
+static const char guid_hex_digit[16] = "0123456789abcdef";
+#endif
+
+/* Offset in the 36 characters form of the 16 bytes of a GUID, in
+ * display order */
+static const uint8_t guid_hex_offset[16] = {
+	0, 2, 4, 6, 9, 11, 14, 16, 19, 21, 24, 26, 28, 30, 32, 34
+};
+/** \endcond */
+
+/*
+   Decode the byte at string offset, the result is above 0xFF if one
+   of the two digits is invalid
+ */
+static inline uint32_t guid_hex_byte(const char *string, uint8_t offset)
+{
+	return (guid_hex_value[(uint8_t)string[offset]] << 4) |
+		guid_hex_value[(uint8_t)string[offset + 1]];
+}
+
 /**
-   \details Build a GUID structure from a string
+   \details Build a GUID structure from a string of given length
 
-   The initial code for this function is taken from Samba
-   librpc/ndr/uuid.c. We are only interested in GUID string length
-   equal to 36 ( XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX ) or 38 (
-   {XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX})
+   Accepted forms are the 36 characters
+   XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX and the 38 characters
+   {XXXXXXXX-XXXX-XXXX-XXXX-XXXXXXXXXXXX}, with hexadecimal digits in
+   either case. The string doesn't need to be NULL terminated and
+   nothing is allocated.
 
    \param s Pointer to the string to convert
+   \param len Length of the string
    \param guid Pointer to the GUID structure to return
 
+   \return MAPIROPS_ERR_SUCCESS on success, MAPIROPS_ERR_INVALID_VAL if
+   s isn't a GUID string, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_GUID_parse(const char *s, size_t len, GUID *guid)
+{
+	uint8_t		b[16];
+	uint32_t	bad = 0;
+	uint32_t	v;
+	int		i;
+
+	if (s == NULL || guid == NULL) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	if (len == 38) {
+		if (s[0] != '{' || s[37] != '}') {
+			return MAPIROPS_ERR_INVALID_VAL;
+		}
+		s++;
+	} else if (len != 36) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	if (s[8] != '-' || s[13] != '-' || s[18] != '-' || s[23] != '-') {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	for (i = 0; i < 16; i++) {
+		v = guid_hex_byte(s, guid_hex_offset[i]);
+		bad |= v;
+		b[i] = v;
+	}
+	if (bad & ~0xFF) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	guid->Data1 = ((uint32_t)b[0] << 24) | ((uint32_t)b[1] << 16) | (b[2] << 8) | b[3];
+	guid->Data2 = (b[4] << 8) | b[5];
+	guid->Data3 = (b[6] << 8) | b[7];
+	memcpy(guid->Data4, b + 8, 8);
+
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Build a GUID structure from a NULL terminated string
+
+   \param s Pointer to the string to convert
+   \param guid Pointer to the GUID structure to return
+
+   \sa mapirops_GUID_parse
+
    \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
  */
 enum mapirops_err_code mapirops_GUID_from_string(const char *s, GUID *guid)
 {
-	TALLOC_CTX		*mem_ctx;
-	enum mapirops_err_code	retval = MAPIROPS_GENERIC_ERR;
-	const char		*string;
-	size_t			len = 0;
-
 	if (s == NULL) {
 		return MAPIROPS_ERR_BUFSIZE;
 	}
 
-	len = strlen(s);
+	return mapirops_GUID_parse(s, strlen(s), guid);
+}
+
+/**
+   \details Build an array of GUID structures from NULL terminated
+   strings
+
+   \param strings Array of count strings to convert
+   \param count Number of strings
+   \param guids Array of count GUID structures to return
 
-	mem_ctx = talloc_new(NULL);
-	if (mem_ctx == NULL) {
-		return MAPIROPS_ERR_NO_MEMORY;
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise the error of the
+   first string which failed to convert
+ */
+enum mapirops_err_code mapirops_GUID_parse_array(const char * const *strings, uint32_t count,
+						 GUID *guids)
+{
+	uint32_t	i;
+
+	if (count && (strings == NULL || guids == NULL)) {
+		return MAPIROPS_ERR_INVALID_VAL;
 	}
 
-	string = talloc_strndup(mem_ctx, s, len);
-	if (string == NULL) {
-		return MAPIROPS_ERR_NO_MEMORY;
+	for (i = 0; i < count; i++) {
+		MAPIROPS_CHECK(mapirops_GUID_from_string(strings[i], &guids[i]));
 	}
 
-	switch (len) {
-	case 36:
-		if (11 == sscanf(string,
-				 "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
-				 &guid->Data1, (unsigned int *)&guid->Data2, 
-				 (unsigned int *)&guid->Data3,
-				 (unsigned int *)&guid->Data4[0], 
-				 (unsigned int *)&guid->Data4[1],
-				 (unsigned int *)&guid->Data4[2], 
-				 (unsigned int *)&guid->Data4[3],
-				 (unsigned int *)&guid->Data4[4], 
-				 (unsigned int *)&guid->Data4[5],
-				 (unsigned int *)&guid->Data4[6], 
-				 (unsigned int *)&guid->Data4[7])) {
-			retval = MAPIROPS_ERR_SUCCESS;
-		}
-		break;
-	case 38:
-		if (11 == sscanf(string,
-				 "{%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x}",
-				 &guid->Data1, (unsigned int *)&guid->Data2, 
-				 (unsigned int *)&guid->Data3, 
-				 (unsigned int *)&guid->Data4[0], 
-				 (unsigned int *)&guid->Data4[1],
-				 (unsigned int *)&guid->Data4[2], 
-				 (unsigned int *)&guid->Data4[3], 
-				 (unsigned int *)&guid->Data4[4], 
-				 (unsigned int *)&guid->Data4[5], 
-				 (unsigned int *)&guid->Data4[6], 
-				 (unsigned int *)&guid->Data4[7])) {
-			retval = MAPIROPS_ERR_SUCCESS;
-		}
-		break;
+	return MAPIROPS_ERR_SUCCESS;
+}
+
+/**
+   \details Format a GUID structure in a caller provided buffer
+
+   \param guid Pointer to the GUID structure to format
+   \param buf Pointer to a buffer of at least MAPIROPS_GUID_STRING_SIZE
+   bytes, where the 36 characters form of the GUID is written NULL
+   terminated
+
+   \return buf
+ */
+char *mapirops_GUID_format(const GUID *guid, char *buf)
+{
+	uint8_t		b[16];
+#ifdef	__SSE2__
+	const __m128i	mask = _mm_set1_epi8(0x0f);
+	const __m128i	nine = _mm_set1_epi8(9);
+	__m128i		v, hi, lo, x;
+	char		hex[32];
+#else
+	int		i;
+#endif
+
+	b[0] = guid->Data1 >> 24;
+	b[1] = guid->Data1 >> 16;
+	b[2] = guid->Data1 >> 8;
+	b[3] = guid->Data1;
+	b[4] = guid->Data2 >> 8;
+	b[5] = guid->Data2;
+	b[6] = guid->Data3 >> 8;
+	b[7] = guid->Data3;
+	memcpy(b + 8, guid->Data4, 8);
+
+#ifdef	__SSE2__
+	/* Split the bytes in nibbles, interleaved high nibble first, and
+	 * map 0-9 to '0'-'9' and 10-15 to 'a'-'f' */
+	v = _mm_loadu_si128((const __m128i *)b);
+	hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+	lo = _mm_and_si128(v, mask);
+
+	x = _mm_unpacklo_epi8(hi, lo);
+	x = _mm_add_epi8(_mm_add_epi8(x, _mm_set1_epi8('0')),
+			 _mm_and_si128(_mm_cmpgt_epi8(x, nine), _mm_set1_epi8('a' - '0' - 10)));
+	_mm_storeu_si128((__m128i *)hex, x);
+
+	x = _mm_unpackhi_epi8(hi, lo);
+	x = _mm_add_epi8(_mm_add_epi8(x, _mm_set1_epi8('0')),
+			 _mm_and_si128(_mm_cmpgt_epi8(x, nine), _mm_set1_epi8('a' - '0' - 10)));
+	_mm_storeu_si128((__m128i *)(hex + 16), x);
+
+	memcpy(buf, hex, 8);
+	buf[8] = '-';
+	memcpy(buf + 9, hex + 8, 4);
+	buf[13] = '-';
+	memcpy(buf + 14, hex + 12, 4);
+	buf[18] = '-';
+	memcpy(buf + 19, hex + 16, 4);
+	buf[23] = '-';
+	memcpy(buf + 24, hex + 20, 12);
+#else
+	for (i = 0; i < 16; i++) {
+		buf[guid_hex_offset[i]] = guid_hex_digit[b[i] >> 4];
+		buf[guid_hex_offset[i] + 1] = guid_hex_digit[b[i] & 0xf];
 	}
-	talloc_free(mem_ctx);
-	return retval;
+	buf[8] = buf[13] = buf[18] = buf[23] = '-';
+#endif
+	buf[36] = '\0';
+
+	return buf;
 }
 
+/**
+   \details Format an array of GUID structures in a caller provided
+   buffer
+
+   \param guids Array of GUID structures to format
+   \param count Number of GUID structures
+   \param buf Pointer to a buffer of at least count *
+   MAPIROPS_GUID_STRING_SIZE bytes. The i-th GUID is written NULL
+   terminated at offset i * MAPIROPS_GUID_STRING_SIZE.
+
+   \return MAPIROPS_ERR_SUCCESS on success, otherwise MAPIROPS error
+ */
+enum mapirops_err_code mapirops_GUID_format_array(const GUID *guids, uint32_t count, char *buf)
+{
+	uint32_t	i;
+
+	if (count && (guids == NULL || buf == NULL)) {
+		return MAPIROPS_ERR_INVALID_VAL;
+	}
+
+	for (i = 0; i < count; i++) {
+		mapirops_GUID_format(&guids[i], buf + i * MAPIROPS_GUID_STRING_SIZE);
+	}
+
+	return MAPIROPS_ERR_SUCCESS;
+}
 
 /**
    \details Convert a GUID structure into a string
@@ -107,16 +282,18 @@ enum mapirops_err_code mapirops_GUID_from_string(const char *s, GUID *guid)
    \param mem_ctx Pointer to the memory context
    \param guid Pointer to the GUID structure to convert
 
+   \sa mapirops_GUID_format
+
    \return Allocated GUID string on success, otherwise NULL
  */
 char *mapirops_GUID_to_string(TALLOC_CTX *mem_ctx, GUID *guid)
 {
-	return talloc_asprintf(mem_ctx, 
-			       "%08x-%04x-%04x-%02x%02x-%02x%02x%02x%02x%02x%02x",
-			       guid->Data1, guid->Data2, guid->Data3,
-			       guid->Data4[0], guid->Data4[1],
-			       guid->Data4[2], guid->Data4[3],
-			       guid->Data4[4], guid->Data4[5],
-			       guid->Data4[6], guid->Data4[7]);
-}
+	char	*string;
 
+	string = talloc_array(mem_ctx, char, MAPIROPS_GUID_STRING_SIZE);
+	if (string == NULL) {
+		return NULL;
+	}
+
+	return mapirops_GUID_format(guid, string);
+}
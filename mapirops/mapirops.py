@@ -57,10 +57,10 @@ def mapirops_dump(mrdict, mr):
             print 'Specification: ' + spec[1]
             
 
-def mapirops_mapi_generator(mrdict, outputdir):
+def mapirops_mapi_generator(mrdict, outputdir, stickyErrors=False):
     assets = os.path.dirname(os.path.realpath(__file__))
     assets = os.path.join(assets, "assets")
-    mgen = MAPIGenerator.MAPIGenerator(mrdict, outputdir, assets)
+    mgen = MAPIGenerator.MAPIGenerator(mrdict, outputdir, assets, stickyErrors)
     spec = mgen.getNextSpecification()
     while spec:
         mgen.writeSpecificationHeader(spec)
@@ -77,6 +77,8 @@ if __name__ == '__main__':
                       help="Print debugging information")
     parser.add_option("--mapi-gen", action="store_true", 
                       help="Generate C files for the MAPI parser")
+    parser.add_option("--sticky-errors", action="store_true",
+                      help="Check errors once per structure in pull functions")
 
     opts,args = parser.parse_args()
     if len(args) != 0 or not opts.file:
@@ -100,7 +102,7 @@ if __name__ == '__main__':
     mrdict = mr.asDict()
 
     if (opts.mapi_gen is not None):
-        mapirops_mapi_generator(mrdict, opts.outputdir)
+        mapirops_mapi_generator(mrdict, opts.outputdir, opts.sticky_errors)
 
     if (opts.dump is not None):
         mapirops_dump(mrdict, mr)
@@ -22,6 +22,55 @@ import string
 
 __docformat__ = 'restructuredText'
 
+def MAPICommonCType(itemType):
+    """ Return the C type used to store an item of itemType
+    """
+    if itemType.startswith("uint") or itemType.startswith("int"):
+        return itemType + '_t'
+    if itemType == 'ascii_string' or itemType == 'utf16_string':
+        return 'char *'
+    return itemType
+
+
+class MAPICommonErrors(object):
+    """ Error handling of the generated pull code.
+
+    By default every call is checked and the pull function returns on
+    the first error. With sticky errors, pull functions of structures
+    record the first error in the context instead: primitives read
+    zeroes once the buffer is exhausted and the error is returned once
+    at the end of the function.
+    """
+
+    # Set by MAPIGenerator from --sticky-errors
+    sticky = False
+
+    # Set while the body of a structure pull function is written
+    scope = False
+
+    primitives = ('uint8', 'int8', 'uint16', 'int16', 'uint32', 'int32', 'uint64', 'int64')
+
+    @classmethod
+    def isSticky(cls):
+        return cls.sticky and cls.scope
+
+    @classmethod
+    def pullCall(cls, indent, call):
+        """Return the statement checking a pull call.
+        """
+        if cls.isSticky():
+            return "%sMAPIROPS_PULL_STICKY(mr, %s);\n" % ('\t' * indent, call)
+        return "%sMAPIROPS_CHECK(%s);\n" % ('\t' * indent, call)
+
+    @classmethod
+    def pullReturn(cls, indent, err):
+        """Return the statement leaving a pull function with err.
+        """
+        if cls.isSticky():
+            return "%sreturn mapirops_pull_sticky_end(mr, %s);\n" % ('\t' * indent, err)
+        return "%sreturn %s;\n" % ('\t' * indent, err)
+
+
 def MAPICommonPushItemHub(fd, indent, item, itemType, itemValue, itemAttr={}, arrayVal=""):
     """ Hub for pushing items    
     """
@@ -33,6 +82,8 @@ def MAPICommonPushItemHub(fd, indent, item, itemType, itemValue, itemAttr={}, ar
         return MAPIGeneratorEnum(fd).pushItem(indent, item, itemType, itemValue, itemAttr, arrayVal)
     if itemType.startswith("ascii_string") or itemType.startswith("utf16_string"):
         return MAPIGeneratorString(fd).pushItem(indent, item, itemType, itemValue, itemAttr, arrayVal)
+    if itemType in MAPIGeneratorProperty.types:
+        return MAPIGeneratorProperty(fd).pushItem(indent, item, itemType, itemValue, itemAttr, arrayVal)
 
     return MAPIGeneratorDefault(fd).pushItem(indent, item, itemType, 
                                              itemValue, itemAttr, arrayVal)
@@ -49,6 +100,8 @@ def MAPICommonPullItemHub(fd, indent, item, itemType, itemValue, itemAttr={}, ar
         return MAPIGeneratorEnum(fd).pullItem(indent, item, itemType, itemValue, itemAttr, arrayVal)
     if itemType.startswith("ascii_string") or itemType.startswith("utf16_string"):
         return MAPIGeneratorString(fd).pullItem(indent, item, itemType, itemValue, itemAttr, arrayVal)
+    if itemType in MAPIGeneratorProperty.types:
+        return MAPIGeneratorProperty(fd).pullItem(indent, item, itemType, itemValue, itemAttr, arrayVal)
 
     return MAPIGeneratorDefault(fd).pullItem(indent, item, itemType,
                                              itemValue, itemAttr, arrayVal)
@@ -69,8 +122,12 @@ class MAPIGeneratorDefault(object):
         return
 
     def pullItem(self, indent, item, itemType, itemValue, itemAttr, arrayVal=""):
-        self.fd.write("%sMAPIROPS_CHECK(mapirops_pull_%s(mr, &r->%s%s));\n" 
-                      % ('\t' * indent, itemType, itemValue, arrayVal))
+        if MAPICommonErrors.isSticky() and itemType in MAPICommonErrors.primitives:
+            self.fd.write("%smapirops_pull_sticky_%s(mr, &r->%s%s);\n"
+                          % ('\t' * indent, itemType, itemValue, arrayVal))
+            return
+        self.fd.write(MAPICommonErrors.pullCall(indent, "mapirops_pull_%s(mr, &r->%s%s)"
+                                                % (itemType, itemValue, arrayVal)))
         return
 
 class MAPIGeneratorString(object):
@@ -102,25 +159,365 @@ class MAPIGeneratorString(object):
                 lengthSize = "r->%s" % length
 
         if lengthSize is None:
-            self.fd.write("%sMAPIROPS_CHECK(mapirops_pull_%s(mr, mr->mem_ctx, MAPIROPS_STR_NOSIZE, &r->%s%s, %s));\n" % ('\t' * indent, itemType, itemValue, arrayVal, 0))
+            self.fd.write(MAPICommonErrors.pullCall(indent, "mapirops_pull_%s(mr, mr->mem_ctx, MAPIROPS_STR_NOSIZE, &r->%s%s, %s)" % (itemType, itemValue, arrayVal, 0)))
+        else:
+            self.fd.write(MAPICommonErrors.pullCall(indent, "mapirops_pull_%s(mr, mr->mem_ctx, 0, &r->%s%s, %s)" % (itemType, itemValue, arrayVal, lengthSize)))
+        return
+
+
+class MAPIGeneratorProperty(object):
+    """ Generate calls to the native property value codec.
+
+    Only the self-describing property types can be used as items: a
+    TaggedPropertyValue carries its property tag on the wire and a
+    PropertyName its kind.
+    """
+
+    types = ('TaggedPropertyValue', 'PropertyName')
+
+    def __init__(self, fd):
+        self.fd = fd
+        return
+
+    def pushItem(self, indent, item, itemType, itemValue, itemAttr=[], arrayVal=""):
+        self.fd.write("%sMAPIROPS_CHECK(mapirops_push_%s(mr, &r->%s%s));\n" %
+                      ('\t' * indent, itemType, itemValue, arrayVal))
+        return
+
+    def pullItem(self, indent, item, itemType, itemValue, itemAttr=[], arrayVal=""):
+        self.fd.write(MAPICommonErrors.pullCall(indent, "mapirops_pull_%s(mr, mr->mem_ctx, &r->%s%s)" %
+                                                (itemType, itemValue, arrayVal)))
+        return
+
+
+class MAPIGeneratorTemplate(object):
+    """ Compute the fixed-size leading part of a structure and generate
+    its pre-serialized byte template.
+
+    Every item up to the first variable-size one has a known offset on
+    the wire. Items with a [value=] attribute are written into the
+    template once and for all, remaining items become slots filled in
+    place by push and read in place by pull.
+    """
+
+    # Wire size, write macro and read macro for primitive types
+    primitives = {
+        'uint8':  (1, 'SCVAL', 'CVAL'),
+        'int8':   (1, 'SCVAL', '(int8_t)CVAL'),
+        'uint16': (2, 'SSVAL', 'SVAL'),
+        'int16':  (2, 'SSVAL', '(int16_t)SVAL'),
+        'uint32': (4, 'SIVAL', 'IVAL'),
+        'int32':  (4, 'SIVALS', 'IVALS'),
+        'uint64': (8, None, None),
+        'int64':  (8, None, None),
+        'double': (8, None, None),
+        'GUID':   (16, None, None),
+    }
+
+    def __init__(self, fd, struct, typeSizes):
+        self.fd = fd
+        self.name = struct["structName"][0]
+        self.typeSizes = typeSizes
+        self.structItems = []
+        if "structItems" in struct:
+            self.structItems = struct["structItems"][0]
+        self.items = []
+        self.size = 0
+        self.layout()
+        return
+
+    @staticmethod
+    def itemAttributes(item):
+        if "attributes" in item:
+            return item["attributes"][0].asList()
+        return []
+
+    @staticmethod
+    def typeSize(itemType, typeSizes):
+        """Return the wire size of itemType or None if it is variable.
+        """
+        if itemType in MAPIGeneratorTemplate.primitives:
+            return MAPIGeneratorTemplate.primitives[itemType][0]
+        return typeSizes.get(itemType)
+
+    @staticmethod
+    def itemSize(item, typeSizes):
+        """Return the wire size of a structure item or None if it is
+        variable.
+        """
+        itemType = item["structItemType"][0]
+        itemAttr = MAPIGeneratorTemplate.itemAttributes(item)
+        if len([attr for (attr, value) in itemAttr if 'switch_is' in attr]):
+            return None
+        size = MAPIGeneratorTemplate.typeSize(itemType, typeSizes)
+        if size is None:
+            return None
+        arraysize = [value for (attr, value) in itemAttr if 'arraysize' in attr]
+        if len(arraysize):
+            try:
+                return size * int(arraysize[0])
+            except ValueError:
+                return None
+        return size
+
+    # Smallest wire size of the native property types
+    nativeMinSizes = {
+        'PropertyName':        17,  # Kind and GUID
+        'TaggedPropertyValue': 4,   # PropertyTag
+    }
+
+    @staticmethod
+    def minSize(itemType, itemAttr, typeSizes):
+        """Return the smallest wire size of a single item of itemType
+        or None if it is unknown or may be empty.
+        """
+        size = MAPIGeneratorTemplate.typeSize(itemType, typeSizes)
+        if size is not None:
+            return size or None
+        if itemType in MAPIGeneratorTemplate.nativeMinSizes:
+            return MAPIGeneratorTemplate.nativeMinSizes[itemType]
+        if len([attr for (attr, value) in itemAttr if 'length' in attr]):
+            return None
+        # Terminating null character of string pulled without size
+        if itemType == 'utf16_string':
+            return 2
+        if itemType == 'ascii_string':
+            return 1
+        return None
+
+    @staticmethod
+    def structSize(struct, typeSizes):
+        """Return the wire size of a structure or None if it is variable.
+        """
+        if not "structItems" in struct:
+            return 0
+        size = 0
+        for item in struct["structItems"][0]:
+            itemSize = MAPIGeneratorTemplate.itemSize(item, typeSizes)
+            if itemSize is None:
+                return None
+            size += itemSize
+        return size
+
+    def layout(self):
+        """Walk the fixed-size prefix and record the offset, size and
+        kind of each item.
+        """
+        offset = 0
+        for item in self.structItems:
+            size = self.itemSize(item, self.typeSizes)
+            if size is None:
+                break
+            itemType = item["structItemType"][0]
+            itemAttr = self.itemAttributes(item)
+            arraysize = [value for (attr, value) in itemAttr if 'arraysize' in attr]
+            count = int(arraysize[0]) if len(arraysize) else 0
+            constant = [value for (attr, value) in itemAttr if attr == 'value']
+            if len(constant) and not count and itemType in self.primitives and itemType != 'GUID' and itemType != 'double':
+                kind = 'const'
+                constant = constant[0]
+            elif itemType in self.primitives:
+                kind = 'direct'
+                constant = None
+            else:
+                kind = 'call'
+                constant = None
+            self.items.append({'name': item["structItemValue"],
+                               'type': itemType.replace(' ', '_'),
+                               'offset': offset,
+                               'size': size,
+                               'count': count,
+                               'kind': kind,
+                               'value': constant})
+            offset += size
+        self.size = offset
+        return
+
+    def hasTemplate(self):
+        return self.size > 0
+
+    def itemCount(self):
+        """Return the number of structure items covered by the template.
+        """
+        return len(self.items)
+
+    def templateBytes(self):
+        data = [0] * self.size
+        for item in self.items:
+            if item['kind'] != 'const': continue
+            value = int(item['value'], 0)
+            for i in range(item['size']):
+                data[item['offset'] + i] = (value >> (8 * i)) & 0xFF
+        return data
+
+    def constRuns(self):
+        """Merge adjacent constant items into (name, offset, size) runs.
+        """
+        runs = []
+        for item in self.items:
+            if item['kind'] != 'const': continue
+            if len(runs) and runs[-1][1] + runs[-1][2] == item['offset']:
+                (name, offset, size) = runs[-1]
+                runs[-1] = (name, offset, size + item['size'])
+            else:
+                runs.append((item['name'], item['offset'], item['size']))
+        return runs
+
+    def writeTemplate(self):
+        """Write the static byte template and its descriptor.
+        """
+        prefix = 'mapirops_template_%s' % self.name
+        data = self.templateBytes()
+        self.fd.write("\nstatic const uint8_t %s_data[%d] = {\n" % (prefix, self.size))
+        lines = []
+        for i in range(0, len(data), 8):
+            lines.append('\t' + ', '.join('0x%.2X' % b for b in data[i:i + 8]))
+        self.fd.write(',\n'.join(lines))
+        self.fd.write("\n};\n")
+
+        slots = [item for item in self.items if item['kind'] != 'const']
+        if len(slots):
+            self.fd.write("\nstatic const struct mapirops_template_slot %s_slots[] = {\n" % prefix)
+            self.fd.write(',\n'.join('\t{ "%s", %d, %d }' % (item['name'], item['offset'], item['size'])
+                                     for item in slots))
+            self.fd.write("\n};\n")
+
+        runs = self.constRuns()
+        if len(runs):
+            self.fd.write("\nstatic const struct mapirops_template_slot %s_consts[] = {\n" % prefix)
+            self.fd.write(',\n'.join('\t{ "%s", %d, %d }' % run for run in runs))
+            self.fd.write("\n};\n")
+
+        self.fd.write("\nconst struct mapirops_template %s = {\n" % prefix)
+        self.fd.write('\t"%s",\n' % self.name)
+        self.fd.write("\t%s_data,\n" % prefix)
+        self.fd.write("\t%d,\n" % self.size)
+        self.fd.write("\t%s,\n" % ("%s_slots" % prefix if len(slots) else "NULL"))
+        self.fd.write("\t%d,\n" % len(slots))
+        self.fd.write("\t%s,\n" % ("%s_consts" % prefix if len(runs) else "NULL"))
+        self.fd.write("\t%d\n" % len(runs))
+        self.fd.write("};\n")
+        return
+
+    @staticmethod
+    def pos(offset, index=''):
+        """Return the C expression of the buffer position offset bytes
+        past the template base, optionally followed by an array index
+        term.
+        """
+        if offset == 0:
+            return "base%s" % index
+        return "base + %d%s" % (offset, index)
+
+    def _pushValue(self, indent, itemType, offset, index, value):
+        tabs = '\t' * indent
+        pos = lambda n: self.pos(offset + n, index)
+        if itemType in ('uint64', 'int64'):
+            self.fd.write("%sSIVAL(mr->data.data, %s, (%s & 0xFFFFFFFF));\n" % (tabs, pos(0), value))
+            self.fd.write("%sSIVAL(mr->data.data, %s, (%s >> 32));\n" % (tabs, pos(4), value))
+        elif itemType == 'double':
+            self.fd.write("%smemcpy(mr->data.data + %s, &%s, 8);\n" % (tabs, pos(0), value))
+        elif itemType == 'GUID':
+            self.fd.write("%sSIVAL(mr->data.data, %s, %s.Data1);\n" % (tabs, pos(0), value))
+            self.fd.write("%sSSVAL(mr->data.data, %s, %s.Data2);\n" % (tabs, pos(4), value))
+            self.fd.write("%sSSVAL(mr->data.data, %s, %s.Data3);\n" % (tabs, pos(6), value))
+            self.fd.write("%smemcpy(mr->data.data + %s, %s.Data4, 8);\n" % (tabs, pos(8), value))
+        else:
+            self.fd.write("%s%s(mr->data.data, %s, %s);\n" % (tabs, self.primitives[itemType][1], pos(0), value))
+        return
+
+    def _pullValue(self, indent, itemType, offset, index, value):
+        tabs = '\t' * indent
+        pos = lambda n: self.pos(offset + n, index)
+        if itemType in ('uint64', 'int64'):
+            self.fd.write("%s%s = IVAL(mr->data.data, %s);\n" % (tabs, value, pos(0)))
+            self.fd.write("%s%s |= (uint64_t)(IVAL(mr->data.data, %s)) << 32;\n" % (tabs, value, pos(4)))
+        elif itemType == 'double':
+            self.fd.write("%smemcpy(&%s, mr->data.data + %s, 8);\n" % (tabs, value, pos(0)))
+        elif itemType == 'GUID':
+            self.fd.write("%s%s.Data1 = IVAL(mr->data.data, %s);\n" % (tabs, value, pos(0)))
+            self.fd.write("%s%s.Data2 = SVAL(mr->data.data, %s);\n" % (tabs, value, pos(4)))
+            self.fd.write("%s%s.Data3 = SVAL(mr->data.data, %s);\n" % (tabs, value, pos(6)))
+            self.fd.write("%smemcpy(%s.Data4, mr->data.data + %s, 8);\n" % (tabs, value, pos(8)))
         else:
-            self.fd.write("%sMAPIROPS_CHECK(mapirops_pull_%s(mr, mr->mem_ctx, 0, &r->%s%s, %s));\n" % ('\t' * indent, itemType, itemValue, arrayVal, lengthSize))
+            self.fd.write("%s%s = %s(mr->data.data, %s);\n" % (tabs, value, self.primitives[itemType][2], pos(0)))
         return
 
+    def write(self, direction, indent):
+        """Write the template based push or pull code for the fixed-size
+        prefix of the structure.
+        """
+        tabs = '\t' * indent
+        self.fd.write("%sMAPIROPS_CHECK(mapirops_%s_template(mr, &mapirops_template_%s, &base));\n" %
+                      (tabs, direction, self.name))
+
+        # Offset of mr->offset relative to base
+        cursor = 0
+        for item in self.items:
+            name = item['name']
+            if item['kind'] == 'const':
+                if direction == "pull":
+                    self.fd.write("%sr->%s = %s;\n" % (tabs, name, item['value']))
+                continue
+
+            if item['kind'] == 'call' and cursor != item['offset']:
+                self.fd.write("%smr->offset = %s;\n" % (tabs, self.pos(item['offset'])))
+
+            if item['count']:
+                cntr = 'cntr_%s' % name
+                elemSize = item['size'] / item['count']
+                self.fd.write('%s{\n' % tabs)
+                self.fd.write('%s\tuint32_t %s;\n\n' % (tabs, cntr))
+                self.fd.write('%s\tfor (%s = 0; %s < %d; %s++) {\n' % (tabs, cntr, cntr, item['count'], cntr))
+                arrayVal = '[%s]' % cntr
+                index = ' + %s * %d' % (cntr, elemSize)
+                inner = indent + 2
+            else:
+                arrayVal = ''
+                index = ''
+                inner = indent
+
+            if item['kind'] == 'direct':
+                if direction == "push":
+                    self._pushValue(inner, item['type'], item['offset'], index, "r->%s%s" % (name, arrayVal))
+                else:
+                    self._pullValue(inner, item['type'], item['offset'], index, "r->%s%s" % (name, arrayVal))
+            else:
+                if direction == "push":
+                    MAPICommonPushItemHub(self.fd, inner, None, item['type'], name, [], arrayVal)
+                else:
+                    MAPICommonPullItemHub(self.fd, inner, None, item['type'], name, [], arrayVal)
+                cursor = item['offset'] + item['size']
+
+            if item['count']:
+                self.fd.write('%s\t}\n' % tabs)
+                self.fd.write('%s}\n' % tabs)
+
+        if cursor != self.size:
+            self.fd.write("%smr->offset = %s;\n" % (tabs, self.pos(self.size)))
+        return
 
 
 class MAPIGeneratorStruct(object):
     """ Generate MAPI code for push, pull and print functions
     """
 
-    def __init__(self, fd, struct={}):
+    def __init__(self, fd, struct={}, typeSizes={}):
         self.fd = fd
         self.struct = struct
         self.indent = 0
+        self.template = None
+        self.typeSizes = typeSizes
+        self.ropId = None
         if "structName" in struct:
             self.name = self.struct["structName"][0]
+            if self.name.endswith('_request') or self.name.endswith('_response'):
+                self.ropId = MAPIGeneratorRops.ropId(struct)
         if "structItems" in struct:
             self.structItems = struct["structItems"][0]
+            template = MAPIGeneratorTemplate(fd, struct, typeSizes)
+            if template.hasTemplate():
+                self.template = template
         else:
             self.structItems = []
         return
@@ -135,32 +532,112 @@ class MAPIGeneratorStruct(object):
     def pullItem(self, indent, item, itemType, itemValue, itemAttr, arrayVal=""):
         """ Write the pull call for a structure
         """
-        self.fd.write('%sMAPIROPS_CHECK(mapirops_pull_%s(mr, &r->%s%s));\n' %
-                      ('\t' * indent, itemType, itemValue, arrayVal))
+        self.fd.write(MAPICommonErrors.pullCall(indent, 'mapirops_pull_%s(mr, &r->%s%s)' %
+                                                (itemType, itemValue, arrayVal)))
         return
 
-    def _direction(self, direction):
-        self.fd.write("\n")
+    def _prototype(self, direction, suffix=""):
         if direction == "push":
             fmt_string = "enum mapirops_err_code "\
-                "mapirops_push_struct_%s(" \
+                "mapirops_push_struct_%s%s(" \
                 "struct mapirops_push *mr, const struct %s *r"\
                 ")\n"
         elif direction == "pull":
             fmt_string = "enum mapirops_err_code "\
-                "mapirops_pull_struct_%s("\
+                "mapirops_pull_struct_%s%s("\
                 "struct mapirops_pull *mr, struct %s *r)\n"
-        self.fd.write(fmt_string % (self.name, self.name))
+        return fmt_string % (self.name, suffix, self.name)
+
+    def _hooks(self):
+        """Return the condition under which the public codec of the
+        structure is a wrapper around its _codec function: every
+        structure is traced by the USDT probes, ROP structures are
+        also timed and counted.
+        """
+        if self.ropId is not None:
+            return "#if defined(MAPIROPS_ENABLE_TIMING) || defined(MAPIROPS_ENABLE_STATS) || " \
+                "defined(MAPIROPS_ENABLE_USDT)\n"
+        return "#ifdef MAPIROPS_ENABLE_USDT\n"
+
+    def _wrapper(self, direction):
+        """Write the public codec of a structure when the library is
+        built with timing, statistics or USDT probes: it fires the
+        struct_<direction>_entry and struct_<direction>_return probes
+        with the structure name, offset, size and error code. For ROP
+        structures, it also records the time spent in the codec into
+        the histograms of the context, and counts the ROP and its
+        errors into the statistics of the context.
+        """
+        call = "retval = mapirops_%s_struct_%s_codec(mr, r);\n" % (direction, self.name)
+        rop = self.ropId is not None
+        self.fd.write("\n" + self._hooks())
+        self.fd.write(self._prototype(direction))
+        self.fd.write("{\n")
+        self.fd.write("\tenum mapirops_err_code\tretval;\n")
+        if rop:
+            self.fd.write("#ifdef MAPIROPS_ENABLE_USDT\n")
+        self.fd.write("\tuint32_t\t\toffset = mr->offset;\n")
+        if rop:
+            self.fd.write("#endif\n")
+            self.fd.write("#ifdef MAPIROPS_ENABLE_TIMING\n")
+            self.fd.write("\tuint64_t\t\tstart;\n")
+            self.fd.write("#endif\n")
+        self.fd.write("\n\tMAPIROPS_PROBE2(struct_%s_entry, \"%s\", offset);\n" % (direction, self.name))
+        if rop:
+            self.fd.write("#ifdef MAPIROPS_ENABLE_TIMING\n")
+            self.fd.write("\tif (mr->timing != NULL) {\n")
+            self.fd.write("\t\tstart = mapirops_timing_start();\n")
+            self.fd.write("\t\t" + call)
+            self.fd.write("\t\tmapirops_timing_stop(mr->timing, MAPIROPS_TIMING_%s, 0x%.2X, start);\n" %
+                          (direction.upper(), self.ropId))
+            self.fd.write("\t} else {\n")
+            self.fd.write("\t\t" + call)
+            self.fd.write("\t}\n")
+            self.fd.write("#else\n")
+            self.fd.write("\t" + call)
+            self.fd.write("#endif\n")
+            self.fd.write("#ifdef MAPIROPS_ENABLE_STATS\n")
+            self.fd.write("\tif (mr->stats != NULL) {\n")
+            self.fd.write("\t\tmapirops_stats_rop(mr->stats, MAPIROPS_STATS_%s, 0x%.2X, retval);\n" %
+                          (direction.upper(), self.ropId))
+            self.fd.write("\t}\n")
+            self.fd.write("#endif\n")
+        else:
+            self.fd.write("\t" + call)
+        self.fd.write("\tMAPIROPS_PROBE4(struct_%s_return, \"%s\", offset, mr->offset - offset, retval);\n\n" %
+                      (direction, self.name))
+        self.fd.write("\treturn retval;\n")
+        self.fd.write("}\n")
+        self.fd.write("#endif\n")
+        return
+
+    def _direction(self, direction):
+        self.fd.write("\n")
+        self.fd.write(self._hooks())
+        self.fd.write("static " + self._prototype(direction, "_codec"))
+        self.fd.write("#else\n")
+        self.fd.write(self._prototype(direction))
+        self.fd.write("#endif\n")
         self.fd.write("{\n")
         self.indent += 1
+        MAPICommonErrors.scope = direction == "pull"
 
         # Deal with empty structures
         if len(self.structItems) == 0:
+            MAPICommonErrors.scope = False
             self.fd.write("%sreturn MAPIROPS_ERR_SUCCESS;\n" % ('\t' * self.indent))
             self.fd.write("}\n")
+            self._wrapper(direction)
             return
 
-        for i in range(len(self.structItems)):
+        # Fixed-size prefix goes through the byte template
+        start = 0
+        if self.template is not None:
+            self.fd.write("%suint32_t\tbase;\n\n" % ('\t' * self.indent))
+            self.template.write(direction, self.indent)
+            start = self.template.itemCount()
+
+        for i in range(start, len(self.structItems)):
             item = self.structItems[i]
             itemType = item["structItemType"][0].replace(' ', '_')
             itemValue = item["structItemValue"]
@@ -183,7 +660,16 @@ class MAPIGeneratorStruct(object):
                 self.fd.write('%s{\n' % ('\t' * self.indent))
                 self.indent += 1
                 cntr = 'cntr_%s' % itemValue
-                self.fd.write('%suint32_t %s;\n\n' % ('\t' * self.indent, cntr))
+                dynamic = direction == "pull" and not isinstance(arrayVal, int)
+                # Dynamic byte arrays are copied without a counter
+                if not dynamic or itemType not in ('uint8', 'int8'):
+                    self.fd.write('%suint32_t %s;\n\n' % ('\t' * self.indent, cntr))
+                # Dynamic arrays are allocated on pull
+                if dynamic:
+                    if self._pullDynamicArray(item, itemType, itemValue, itemAttr, arrayVal, cntr):
+                        self.indent -= 1
+                        self.fd.write('%s}\n' % ('\t' * self.indent))
+                        continue
                 self.fd.write('%sfor (%s = 0; %s < %s; %s++) {\n' % ('\t' * self.indent, cntr, cntr, arrayVal, cntr))
                 self.indent += 1
                 if direction == "push":
@@ -200,12 +686,69 @@ class MAPIGeneratorStruct(object):
                 elif direction == "pull":
                     MAPICommonPullItemHub(self.fd, self.indent, item, itemType, itemValue, itemAttr)
 
-        self.fd.write('\n%sreturn MAPIROPS_ERR_SUCCESS;\n' % ('\t' * self.indent))
+        self.fd.write('\n' + MAPICommonErrors.pullReturn(self.indent, 'MAPIROPS_ERR_SUCCESS'))
+        MAPICommonErrors.scope = False
         self.indent -= 1
         self.fd.write("}\n")
+        self._wrapper(direction)
         return
 
 
+    def _pullDynamicArray(self, item, itemType, itemValue, itemAttr, arrayVal, cntr):
+        """Write the validation and single allocation of a dynamic
+        array, then decode it in bulk when its items are fixed-size
+        primitives.
+
+        The count is checked against the remaining buffer size before
+        anything is allocated: every item takes at least minSize bytes
+        on the wire, so a hostile count cannot allocate more than the
+        buffer could ever hold. Generation fails for items whose
+        minimum size is unknown. Pull cursors without a memory context
+        refuse to allocate. Return True if the items were decoded,
+        False if the caller still has to pull them one by one.
+        """
+        ind = '\t' * self.indent
+        minSize = MAPIGeneratorTemplate.minSize(item["structItemType"][0], itemAttr, self.typeSizes)
+        if minSize is None:
+            raise Exception('%s.%s: unknown minimum wire size of %s, the array count can\'t be checked' %
+                            (self.name, itemValue, item["structItemType"][0]))
+        if minSize == 1:
+            self.fd.write('%sif (%s > mr->data.length - mr->offset) {\n' % (ind, arrayVal))
+        else:
+            self.fd.write('%sif (%s > (mr->data.length - mr->offset) / %d) {\n' % (ind, arrayVal, minSize))
+        self.fd.write(MAPICommonErrors.pullReturn(self.indent + 1, 'MAPIROPS_ERR_BUFSIZE'))
+        self.fd.write('%s}\n' % ind)
+        self.fd.write('%sif (unlikely(!MAPIROPS_PULL_CAN_ALLOC(mr, mr->mem_ctx))) {\n' % ind)
+        self.fd.write(MAPICommonErrors.pullReturn(self.indent + 1, 'MAPIROPS_ERR_ALLOC'))
+        self.fd.write('%s}\n' % ind)
+        self.fd.write('%sr->%s = talloc_array(mr->mem_ctx, %s, %s);\n' %
+                      (ind, itemValue, MAPICommonCType(item["structItemType"][0]), arrayVal))
+        self.fd.write('%sif (r->%s == NULL) {\n' % (ind, itemValue))
+        self.fd.write(MAPICommonErrors.pullReturn(self.indent + 1, 'MAPIROPS_ERR_NO_MEMORY'))
+        self.fd.write('%s}\n' % ind)
+
+        # The size check above is exact for fixed-size primitives
+        if itemType in ('uint8', 'int8'):
+            self.fd.write('%smemcpy(r->%s, mr->data.data + mr->offset, %s);\n' % (ind, itemValue, arrayVal))
+            self.fd.write('%smr->offset += %s;\n' % (ind, arrayVal))
+            return True
+        if itemType in ('uint16', 'int16', 'uint32', 'int32'):
+            (size, _, read) = MAPIGeneratorTemplate.primitives[itemType]
+            self.fd.write('%sfor (%s = 0; %s < %s; %s++) {\n' % (ind, cntr, cntr, arrayVal, cntr))
+            self.fd.write('%s\tr->%s[%s] = %s(mr->data.data, mr->offset + %s * %d);\n' %
+                          (ind, itemValue, cntr, read, cntr, size))
+            self.fd.write('%s}\n' % ind)
+            self.fd.write('%smr->offset += %s * %d;\n' % (ind, arrayVal, size))
+            return True
+        return False
+
+    def writeTemplate(self):
+        """Generate the byte template for the fixed-size prefix.
+        """
+        if self.template is not None:
+            self.template.writeTemplate()
+        return
+
     def push(self):
         """Generate push function for structure items.
         """
@@ -254,7 +797,7 @@ class MAPIGeneratorUnion(object):
         if not len(switchType): raise
         switchType = switchType[0]
 
-        self.fd.write('%sMAPIROPS_CHECK(mapirops_pull_%s(mr, r->%s, &r->%s%s));\n' % ('\t' * indent, itemType, switchType, itemValue, arrayVal))
+        self.fd.write(MAPICommonErrors.pullCall(indent, 'mapirops_pull_%s(mr, r->%s, &r->%s%s)' % (itemType, switchType, itemValue, arrayVal)))
 
         return
 
@@ -360,8 +903,8 @@ class MAPIGeneratorEnum(object):
     def pullItem(self, indent, item, itemType, itemValue, itemAttr, arrayVal=""):
         """ Write the pull call for an enum item
         """
-        self.fd.write("%sMAPIROPS_CHECK(mapirops_pull_%s(mr, &r->%s%s));\n"
-                      % ('\t' * indent, itemType, itemValue, arrayVal))
+        self.fd.write(MAPICommonErrors.pullCall(indent, "mapirops_pull_%s(mr, &r->%s%s)"
+                                                % (itemType, itemValue, arrayVal)))
         return
 
     def push(self):
@@ -439,9 +982,98 @@ class MAPIGeneratorEnum(object):
         return
         
 
+class MAPIGeneratorRops(object):
+    """ Generate the RopId dispatch table of a specification.
+
+    A ROP is any pair of Rop*_request and Rop*_response structures
+    starting with the same [value=] RopId. Each table entry holds
+    untyped pull wrappers so that callers can decode a RopsList by
+    RopId without knowing the structures.
+    """
+
+    def __init__(self, fd, spec):
+        self.fd = fd
+        self.name = spec["name"].lower()
+        self.rops = []
+        if not "specItem" in spec: return
+
+        requests = {}
+        responses = {}
+        for element in spec["specItem"]:
+            if not 'struct' in element: continue
+            structName = element["structName"][0]
+            ropId = self.ropId(element)
+            if ropId is None: continue
+            if structName.endswith('_request'):
+                requests[structName[:-len('_request')]] = ropId
+            elif structName.endswith('_response'):
+                responses[structName[:-len('_response')]] = ropId
+
+        for element in spec["specItem"]:
+            if not 'struct' in element: continue
+            structName = element["structName"][0]
+            if not structName.endswith('_request'): continue
+            ropName = structName[:-len('_request')]
+            if ropName in requests and responses.get(ropName) == requests[ropName]:
+                self.rops.append((ropName, requests[ropName]))
+        return
+
+    @staticmethod
+    def ropId(struct):
+        """Return the RopId of a structure starting with a constant RopId
+        item, otherwise None.
+        """
+        if not "structItems" in struct or not len(struct["structItems"][0]):
+            return None
+        item = struct["structItems"][0][0]
+        if item["structItemValue"] != 'RopId':
+            return None
+        itemAttr = MAPIGeneratorTemplate.itemAttributes(item)
+        value = [value for (attr, value) in itemAttr if attr == 'value']
+        if not len(value):
+            return None
+        return int(value[0], 0)
+
+    def writeDecl(self):
+        self.fd.write("extern const struct mapirops_rop_table mapirops_rops_%s;\n" % self.name)
+        return
+
+    def write(self):
+        """Write the pull wrappers and the dispatch table.
+        """
+        for (ropName, ropId) in self.rops:
+            for direction in ('request', 'response'):
+                self.fd.write("\nstatic enum mapirops_err_code mapirops_pull_rop_%s_%s(struct mapirops_pull *mr, void *r)\n" %
+                              (ropName, direction))
+                self.fd.write("{\n")
+                self.fd.write("\treturn mapirops_pull_struct_%s_%s(mr, (struct %s_%s *) r);\n" %
+                              (ropName, direction, ropName, direction))
+                self.fd.write("}\n")
+
+        if len(self.rops):
+            self.fd.write("\nstatic const struct mapirops_rop_dispatch mapirops_rops_%s_list[] = {\n" % self.name)
+            entries = []
+            for (ropName, ropId) in self.rops:
+                entries.append('\t{ 0x%.2X, "%s",\n'
+                               '\t  sizeof (struct %s_request), mapirops_pull_rop_%s_request,\n'
+                               '\t  sizeof (struct %s_response), mapirops_pull_rop_%s_response }' %
+                               (ropId, ropName, ropName, ropName, ropName, ropName))
+            self.fd.write(',\n'.join(entries))
+            self.fd.write("\n};\n")
+
+        self.fd.write("\nconst struct mapirops_rop_table mapirops_rops_%s = {\n" % self.name)
+        if len(self.rops):
+            self.fd.write("\tmapirops_rops_%s_list,\n" % self.name)
+        else:
+            self.fd.write("\tNULL,\n")
+        self.fd.write("\t%d\n" % len(self.rops))
+        self.fd.write("};\n")
+        return
+
+
 class MAPIGenerator(object):
 
-    def __init__(self, mrdict, outputdir, assets):
+    def __init__(self, mrdict, outputdir, assets, stickyErrors=False):
         self.mrdict = mrdict
         self.outputdir = outputdir
         self.spec_index = 0
@@ -449,6 +1081,11 @@ class MAPIGenerator(object):
 
         # precedence dict
         self.decls = []
+
+        # wire size of fixed-size enums and structures
+        self.typeSizes = {}
+
+        MAPICommonErrors.sticky = stickyErrors
         return
 
     def getSpecificationCount(self):
@@ -623,7 +1260,8 @@ class MAPIGenerator(object):
         """ Write struct definition in header files.
         """
         fd.write("\nstruct %s {\n" % struct["structName"][0])
-        self.decls.append(("struct", struct["structName"][0]))
+        template = MAPIGeneratorTemplate(fd, struct, self.typeSizes)
+        self.decls.append(("struct", struct["structName"][0], template.hasTemplate()))
 
         # Deal with empty structures
         if not "structItems" in struct:
@@ -676,6 +1314,27 @@ class MAPIGenerator(object):
         fd.write("};\n")
         return
 
+    def computeTypeSizes(self, spec):
+        """Record the wire size of every fixed-size enum and structure
+        of the specification.
+        """
+        self.typeSizes["enum MAPISTATUS"] = 4
+        if not "specItem" in spec: return
+
+        for element in spec["specItem"]:
+            if 'enum' in element:
+                enumsize = 32
+                if "attributes" in element:
+                    for (attr, value) in element["attributes"][0].asList():
+                        if attr == 'enumsize':
+                            enumsize = int(value)
+                self.typeSizes["enum %s" % element["enumName"][0]] = enumsize / 8
+            if 'struct' in element:
+                size = MAPIGeneratorTemplate.structSize(element, self.typeSizes)
+                if size is not None:
+                    self.typeSizes["struct %s" % element["structName"][0]] = size
+        return
+
     def writeHeaderTypes(self, fd, spec):
         if not "specItem" in spec: return
         count = len(spec["specItem"])
@@ -716,6 +1375,8 @@ __BEGIN_DECLS
             if decl[0] == 'struct':
                 fd.write("enum mapirops_err_code mapirops_push_struct_%s(struct mapirops_push *, const struct %s *);\n" % (decl[1], decl[1]))
                 fd.write("enum mapirops_err_code mapirops_pull_struct_%s(struct mapirops_pull *, struct %s *);\n" % (decl[1], decl[1]))
+                if decl[2]:
+                    fd.write("extern const struct mapirops_template mapirops_template_%s;\n" % decl[1])
             elif decl[0] == 'union':
                 fd.write("enum mapirops_err_code mapirops_push_union_%s(struct mapirops_push *, uint%s_t, const union %s *);\n" % (decl[1], decl[2], decl[1]))
                 fd.write("enum mapirops_err_code mapirops_pull_union_%s(struct mapirops_pull *, uint%s_t, union %s *);\n" % (decl[1], decl[2], decl[1]))
@@ -746,15 +1407,19 @@ __BEGIN_DECLS
             self.writeDoxygenFileDef(sh, name, spec)
             self.writeDblInclusionStart(sh, name)
             self.writeSpecDefineDef(sh, spec["name"], spec)
+            self.computeTypeSizes(spec)
             self.writeHeaderTypes(sh, spec)
             self.writeBeginDecls(sh)
             self.writeDecls(sh)
+            MAPIGeneratorRops(sh, spec).writeDecl()
             self.writeEndDecls(sh)
             self.writeDblInclusionEnd(sh, name)
         sh.close()
         return
 
     def writeCodeIncludes(self, fd):
+        fd.write("\n")
+        fd.write("#include \"config.h\"\n")
         fd.write("\n")
         fd.write("#include <libmapirops.h>\n")
         fd.write("\n")
@@ -773,7 +1438,8 @@ __BEGIN_DECLS
                 enum.push()
                 enum.pull()
             if 'struct' in element:
-                struct = MAPIGeneratorStruct(fd, element)
+                struct = MAPIGeneratorStruct(fd, element, self.typeSizes)
+                struct.writeTemplate()
                 struct.push()
                 struct.pull()
             if 'union' in element:
@@ -799,7 +1465,9 @@ __BEGIN_DECLS
             self.writeLicense(sh)
             self.writeDoxygenFileDef(sh, name, spec)
             self.writeCodeIncludes(sh)
+            self.computeTypeSizes(spec)
             self.writeCodeTypes(sh, spec)
+            MAPIGeneratorRops(sh, spec).write()
         sh.close()
         return
 
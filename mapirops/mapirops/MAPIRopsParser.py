@@ -83,6 +83,8 @@ def MAPIROPS_MR_BNF():
         ascii_string_  = Keyword("ascii_string")
         utf16_string_  = Keyword("utf16_string")
         GUID_          = Keyword("GUID")
+        TaggedPropertyValue_ = Keyword("TaggedPropertyValue")
+        PropertyName_  = Keyword("PropertyName")
 
         # General defs
         hexInteger = Combine(Optional("0x") + Word(hexnums))
@@ -90,7 +92,9 @@ def MAPIROPS_MR_BNF():
         sizeInt = (Literal("8") ^ Literal("16") ^ Literal("32") ^ Literal("64"))
         typeInt = (uint8_ ^ uint16_ ^ uint32_ ^ uint64_)
         typeName = (bool_ ^ uint8_ ^ uint16_ ^ uint32_ ^ uint64_ 
-                    ^ double_ ^ ascii_string_ ^ utf16_string_ ^ GUID_)
+                    ^ double_ ^ ascii_string_ ^ utf16_string_ ^ GUID_
+                    ^ TaggedPropertyValue_
+                    ^ PropertyName_)
         typeUserDef = Combine((struct_ ^ union_ ^ enum_) + OneOrMore(' ') + identifier)
         typeUserDef2 = Group((struct_ ^ enum_) + identifier)
 